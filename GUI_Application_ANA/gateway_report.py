@@ -0,0 +1,87 @@
+"""
+CAN-FD gateway report (CMD_GET_ROUTES)
+
+Reads the routing table of the gateway controller (0x01): the CAN-FD nodes
+it found by discovery, how long ago each answered, the requests forwarded
+to it and its timeouts, plus the gateway counters (forwarded, relayed,
+timed out, frames for unknown nodes, refused while busy).
+
+With --discover the gateway broadcasts a discovery first and the table is
+read again after --settle seconds, so newly powered nodes show up.
+
+With --ping every node in the table is pinged through the gateway and
+the round trip is shown.
+
+Usage:
+    python gateway_report.py COM5
+    python gateway_report.py COM5 --discover --ping
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import RS485Protocol, RS485_ADDR_CONTROLLER_420
+
+
+def print_report(routes, ping_times):
+    print(f"{'node':<8}{'last answer':>14}{'forwarded':>12}{'timeouts':>10}"
+          + (f"{'ping':>12}" if ping_times is not None else ""))
+    print("-" * (44 + (12 if ping_times is not None else 0)))
+    for route in sorted(routes.routes, key=lambda r: r.address):
+        row = (f"0x{route.address:02X}    {route.age_s:>12} s{route.forwarded:>12}"
+               f"{route.timeouts:>10}")
+        if ping_times is not None:
+            rtt = ping_times.get(route.address)
+            row += f"{'timeout':>12}" if rtt is None else f"{rtt * 1000:>9.1f} ms"
+        print(row)
+
+    print()
+    print(f"{len(routes.routes)} node(s); forwarded {routes.forwarded}, relayed {routes.relayed}, "
+          f"timeouts {routes.timeouts}, no route {routes.no_route}, busy {routes.busy}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CAN-FD gateway report")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--address", type=lambda value: int(value, 0),
+                        default=RS485_ADDR_CONTROLLER_420, help="gateway address (default: 0x01)")
+    parser.add_argument("--discover", action="store_true",
+                        help="broadcast a discovery before reading")
+    parser.add_argument("--settle", type=float, default=0.5,
+                        help="seconds to wait for discovery answers (default: 0.5)")
+    parser.add_argument("--ping", action="store_true", help="ping every node through the gateway")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        if args.discover:
+            protocol.get_routes(args.address, discover=True)
+            time.sleep(args.settle)
+        routes = protocol.get_routes(args.address)
+        if routes is None:
+            print(f"0x{args.address:02X}: no routes response (not a gateway?)")
+            return 1
+
+        ping_times = None
+        if args.ping:
+            ping_times = {}
+            for route in routes.routes:
+                start = time.perf_counter()
+                if protocol.ping(route.address):
+                    ping_times[route.address] = time.perf_counter() - start
+        print_report(routes, ping_times)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
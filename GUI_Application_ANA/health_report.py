@@ -0,0 +1,84 @@
+"""
+Computed health report (CMD_GET_HEALTH)
+
+Polls the health score of one or more controllers and lists them from the
+most to the least degraded, with the score of every component and the raw
+metrics behind it (RX errors, main loop overruns, queue overflows, stack
+high-water mark, missed I/O samples).
+
+Usage:
+    python health_report.py COM5
+    python health_report.py COM5 --address 0x01 0x02 --watch 10
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import (RS485Protocol, MCU_NAMES, HEALTH_COMPONENT_NAMES,
+                            RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO,
+                            RS485_ADDR_CONTROLLER_OUT)
+
+
+def print_report(results):
+    header = f"{'controller':<18}{'health':>8}" + "".join(f"{name:>17}" for name in HEALTH_COMPONENT_NAMES)
+    print(header)
+    print("-" * len(header))
+
+    # Most degraded first, unreachable controllers last
+    ranked = sorted(results.items(), key=lambda item: (item[1] is None, item[1].overall if item[1] else 0))
+    for address, health in ranked:
+        name = MCU_NAMES.get(address, hex(address))
+        if health is None:
+            print(f"{name:<18}{'-':>8}  no response")
+            continue
+        print(f"{name:<18}{health.overall:>7}%" +
+              "".join(f"{health.scores.get(c, '-'):>16}%" for c in HEALTH_COMPONENT_NAMES))
+
+    print()
+    for address, health in ranked:
+        if health is None:
+            continue
+        name = MCU_NAMES.get(address, hex(address))
+        print(f"{name}: last {health.window_s} s: "
+              f"rx errors {health.rx_errors}/{health.rx_frames + health.rx_errors}, "
+              f"loop overruns {health.loop_overruns}/{health.loop_passes} "
+              f"(max {health.max_loop_interval_ms} ms), "
+              f"queue overflows {health.queue_overflows}, "
+              f"I/O missed {health.io_missed}/{health.io_samples} "
+              f"(max lag {health.max_io_lag_ms} ms), "
+              f"stack {health.stack_used}/{health.stack_size} bytes")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Computed health report")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--address", type=lambda value: int(value, 0), nargs="+",
+                        default=[RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO,
+                                 RS485_ADDR_CONTROLLER_OUT],
+                        help="controller addresses (default: all)")
+    parser.add_argument("--watch", type=float, default=0, help="repeat every N seconds")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        while True:
+            print_report({address: protocol.get_health(address) for address in args.address})
+            if args.watch <= 0:
+                break
+            print()
+            time.sleep(args.watch)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,97 @@
+"""
+RS485 protocol telemetry report (CMD_GET_TELEMETRY)
+
+Prints the link counters, request-to-response turnaround and per-command
+request counts of one or more controllers side by side, to compare bus
+health across nodes (e.g. a failing transceiver shows up as framing/noise
+errors on one node only).
+
+Usage:
+    python telemetry_report.py COM5
+    python telemetry_report.py COM5 --address 0x01 0x03 --watch 60
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import (RS485Protocol, RS485Command, MCU_NAMES,
+                            TELEMETRY_COUNTER_NAMES, RS485_ADDR_CONTROLLER_420,
+                            RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT)
+
+
+def command_name(command):
+    try:
+        return RS485Command(command).name
+    except ValueError:
+        return f"CMD 0x{command:02X}"
+
+
+def print_report(results):
+    addresses = list(results)
+    print(f"{'':<22}" + "".join(f"{MCU_NAMES.get(a, hex(a)):>18}" for a in addresses))
+    print("-" * (22 + 18 * len(addresses)))
+
+    def row(label, values):
+        print(f"{label:<22}" + "".join(f"{value:>18}" for value in values))
+
+    def value_of(address, getter):
+        telemetry = results[address]
+        value = None if telemetry is None else getter(telemetry)
+        return "-" if value is None else value
+
+    for name in TELEMETRY_COUNTER_NAMES:
+        row(name, [value_of(a, lambda t: t.counters[name]) for a in addresses])
+    row("rx_buffer_high_water", [value_of(a, lambda t: t.rx_buffer_high_water) for a in addresses])
+    row("debug_ring_high_water", [value_of(a, lambda t: t.debug_ring_high_water) for a in addresses])
+    row("frame_queue_high_water", [value_of(a, lambda t: t.frame_queue_high_water) for a in addresses])
+    row("event_queue_high_water", [value_of(a, lambda t: t.event_queue_high_water) for a in addresses])
+
+    print()
+    row("turnaround count", [value_of(a, lambda t: t.turnaround_count) for a in addresses])
+    row("turnaround min us", [value_of(a, lambda t: t.turnaround_min_us) for a in addresses])
+    row("turnaround mean us", [value_of(a, lambda t: f"{t.turnaround_mean_us:.0f}") for a in addresses])
+    row("turnaround p50 us", [value_of(a, lambda t: f"{t.turnaround_percentile(50):.0f}") for a in addresses])
+    row("turnaround p99 us", [value_of(a, lambda t: f"{t.turnaround_percentile(99):.0f}") for a in addresses])
+    row("turnaround max us", [value_of(a, lambda t: t.turnaround_max_us) for a in addresses])
+
+    commands = sorted({c for t in results.values() if t for c in t.command_counts})
+    if commands:
+        print()
+        for command in commands:
+            row(command_name(command),
+                [value_of(a, lambda t: t.command_counts.get(command, 0)) for a in addresses])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="RS485 protocol telemetry report")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--address", type=lambda value: int(value, 0), nargs="+",
+                        default=[RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO,
+                                 RS485_ADDR_CONTROLLER_OUT],
+                        help="controller addresses (default: all)")
+    parser.add_argument("--watch", type=float, default=0, help="repeat every N seconds")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        while True:
+            print_report({address: protocol.get_telemetry(address) for address in args.address})
+            if args.watch <= 0:
+                break
+            print()
+            time.sleep(args.watch)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
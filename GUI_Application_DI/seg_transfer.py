@@ -0,0 +1,99 @@
+"""
+Segmented transfer tool (CMD_SEG_xxx)
+
+Reads or writes objects larger than one frame with a sliding window: a
+window of segments travels back to back, then one acknowledgement asks for
+the missing ones only. Prints the throughput against the raw wire rate.
+
+Objects:
+    capture   420 controller, completed waveform capture (read)
+    logic     OUT controller, compiled logic program (write, activated
+              once complete)
+
+Usage:
+    python seg_transfer.py COM5 read capture -o capture.bin
+    python seg_transfer.py COM5 write logic program.bin
+    python seg_transfer.py COM5 --address 0x01 read 0x01 -o capture.bin
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import (RS485Protocol, RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_OUT,
+                            SEG_OBJECT_CAPTURE, SEG_OBJECT_LOGIC, SEG_RESULT_OK, SEG_RESULT_NAMES)
+
+OBJECTS = {
+    "capture": (SEG_OBJECT_CAPTURE, RS485_ADDR_CONTROLLER_420),
+    "logic": (SEG_OBJECT_LOGIC, RS485_ADDR_CONTROLLER_OUT),
+}
+
+
+def show_progress(done, total):
+    print(f"\r  {done}/{total} bytes", end="", flush=True)
+
+
+def report(protocol, size, seconds):
+    rate = size / seconds if seconds > 0 else 0
+    wire = protocol.baudrate / 10
+    print(f"\r  {size} bytes in {seconds:.2f} s: {rate:.0f} B/s, "
+          f"{rate / wire * 100:.0f}% of the wire rate ({wire:.0f} B/s)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Segmented transfer of large objects")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("direction", choices=["read", "write"])
+    parser.add_argument("object", help="object name (capture, logic) or ID")
+    parser.add_argument("file", nargs="?", help="file to write to the controller")
+    parser.add_argument("-o", "--output", help="file for the object read")
+    parser.add_argument("--address", type=lambda value: int(value, 0),
+                        help="controller address (default: the object's controller)")
+    args = parser.parse_args()
+
+    if args.object in OBJECTS:
+        object_id, address = OBJECTS[args.object]
+    else:
+        object_id, address = int(args.object, 0), None
+    address = args.address if args.address is not None else address
+    if address is None:
+        print("--address is required for an object ID")
+        return 1
+    if args.direction == "write" and not args.file:
+        print("No file to write")
+        return 1
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        start = time.time()
+        if args.direction == "read":
+            result, data = protocol.seg_read(address, object_id, progress=show_progress)
+            if result != SEG_RESULT_OK:
+                print(f"\nRead failed: {SEG_RESULT_NAMES.get(result, result)}")
+                return 1
+            report(protocol, len(data), time.time() - start)
+            if args.output:
+                with open(args.output, "wb") as file:
+                    file.write(data)
+                print(f"  Saved to {args.output}")
+        else:
+            with open(args.file, "rb") as file:
+                data = file.read()
+            result, code = protocol.seg_write(address, object_id, data, progress=show_progress)
+            if result != SEG_RESULT_OK:
+                print(f"\nWrite failed: {SEG_RESULT_NAMES.get(result, result)}"
+                      f"{f' (object code {code})' if code else ''}")
+                return 1
+            report(protocol, len(data), time.time() - start)
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
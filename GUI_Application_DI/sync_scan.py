@@ -0,0 +1,107 @@
+"""
+Consistent bus-wide scan with SYNC / FREEZE (CMD_SYNC, CMD_READ_SNAPSHOT)
+
+Each cycle broadcasts a SYNC, so all controllers latch their images at the
+same instant, then reads the frozen snapshots one after the other. The
+snapshots carry the SYNC sequence number: a controller that missed the SYNC
+shows an older sequence and is flagged.
+
+With --outputs-on-sync, outputs written to the output controller between
+two SYNCs are applied together at the next one.
+
+Usage:
+    python sync_scan.py COM5
+    python sync_scan.py COM5 --count 0 --period 0.5
+    python sync_scan.py COM5 --outputs-on-sync
+    python sync_scan.py COM5 --status
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import (RS485Protocol, MCU_NAMES, RS485_ADDR_CONTROLLER_420,
+                            RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT,
+                            SYNC_MODE_IMMEDIATE, SYNC_MODE_ON_SYNC)
+
+CONTROLLERS = [RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_OUT]
+
+
+def format_image(address, image):
+    if address == RS485_ADDR_CONTROLLER_420:
+        values = [int.from_bytes(image[n:n + 2], 'little') for n in range(0, len(image) - 1, 2)]
+        return ' '.join(f"{value:5d}" for value in values[:8]) + (' ...' if len(values) > 8 else '')
+    bits = [n for n in range(len(image) * 8) if image[n // 8] & (1 << (n % 8))]
+    prefix = 'DI' if address == RS485_ADDR_CONTROLLER_DIO else 'DO'
+    return ' '.join(f"{prefix}{n}" for n in bits) or '-'
+
+
+def print_status(protocol, addresses):
+    for address in addresses:
+        status = protocol.get_sync_mode(address)
+        name = MCU_NAMES.get(address, f"0x{address:02X}")
+        if status is None:
+            print(f"{name:<16} no response")
+            continue
+        print(f"{name:<16} outputs {status.mode_name}, sequence {status.sequence}, "
+              f"{status.syncs} syncs, {status.missed} missed, "
+              f"latch delay {status.last_delay_us} us (max {status.max_delay_us} us)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Consistent bus-wide scan with SYNC")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--count", type=int, default=1, help="cycles, 0 = until Ctrl+C (default: 1)")
+    parser.add_argument("--period", type=float, default=1.0, help="seconds between SYNCs (default: 1)")
+    parser.add_argument("--outputs-on-sync", action="store_true",
+                        help="output controller: apply written outputs at the next SYNC")
+    parser.add_argument("--outputs-immediate", action="store_true",
+                        help="output controller: apply written outputs on receipt (default)")
+    parser.add_argument("--status", action="store_true", help="show sync statistics only")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        if args.outputs_on_sync or args.outputs_immediate:
+            mode = SYNC_MODE_ON_SYNC if args.outputs_on_sync else SYNC_MODE_IMMEDIATE
+            if protocol.get_sync_mode(RS485_ADDR_CONTROLLER_OUT, mode) is None:
+                print("Output controller: mode not set")
+                return 1
+
+        if args.status:
+            print_status(protocol, CONTROLLERS)
+            return 0
+
+        sequence = int(time.time()) & 0xFFFF
+        cycle = 0
+        while args.count == 0 or cycle < args.count:
+            sequence = (sequence + 1) & 0xFFFF
+            protocol.sync(sequence)
+            print(f"SYNC {sequence}")
+            for address in CONTROLLERS:
+                name = MCU_NAMES.get(address, f"0x{address:02X}")
+                snapshot = protocol.read_snapshot(address)
+                if snapshot is None:
+                    print(f"  {name:<16} no response")
+                elif not snapshot.valid or snapshot.sequence != sequence:
+                    print(f"  {name:<16} missed SYNC (snapshot {snapshot.sequence})")
+                else:
+                    print(f"  {name:<16} +{snapshot.latch_delay_us:>4} us  "
+                          f"{format_image(address, snapshot.image)}")
+            cycle += 1
+            if args.count == 0 or cycle < args.count:
+                time.sleep(args.period)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
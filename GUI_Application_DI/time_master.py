@@ -0,0 +1,87 @@
+"""
+Bus time master (CMD_TIME_SYNC)
+
+Broadcasts two-step time sync frames: each frame carries the send time of
+the previous one, taken on this PC when its last byte has left. The
+controllers timestamp the frames in their RX interrupt and discipline a
+64-bit microsecond bus clock (Unix time) to it. The achieved sync error,
+drift and state are read from the time section of their telemetry.
+
+The PC time stamp includes the USB-serial latency jitter, so the sync error
+reported here is an upper bound of what a hardware time master would get.
+
+Usage:
+    python time_master.py COM5                      (sync every second, report every 10 s)
+    python time_master.py COM5 --period 0.5 --report 30
+    python time_master.py COM5 --status
+"""
+
+import argparse
+import sys
+import time
+from datetime import datetime, timezone
+
+from rs485_protocol import (RS485Protocol, MCU_NAMES, RS485_ADDR_CONTROLLER_420,
+                            RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT)
+
+CONTROLLERS = [RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT]
+
+
+def print_report(protocol, addresses):
+    for address in addresses:
+        name = MCU_NAMES.get(address, f"0x{address:02X}")
+        status = protocol.get_time_sync(address)
+        if status is None:
+            print(f"  {name:<16} no response")
+            continue
+        bus_time = datetime.fromtimestamp(status.bus_time_us / 1e6, timezone.utc)
+        print(f"  {name:<16} {status.state_name:<9} error {status.last_error_us:+7d} us "
+              f"(max {status.max_error_us} us), drift {status.drift_ppb / 1000:+8.3f} ppm, "
+              f"{status.samples} samples, {status.steps} steps, "
+              f"bus time {bus_time:%H:%M:%S.%f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bus time master")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--period", type=float, default=1.0, help="seconds between sync frames (default: 1)")
+    parser.add_argument("--report", type=float, default=10.0,
+                        help="seconds between controller reports, 0 = none (default: 10)")
+    parser.add_argument("--status", action="store_true", help="report once, send no sync frames")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        if args.status:
+            print_report(protocol, CONTROLLERS)
+            return 0
+
+        sequence = 0
+        sent_us = None
+        next_report = time.monotonic() + args.report
+        while True:
+            sent_us = protocol.time_sync(sequence, sent_us)
+            sequence = (sequence + 1) & 0xFF
+            if sent_us is None:
+                print("Send failed")
+                return 1
+
+            if args.report > 0 and time.monotonic() >= next_report:
+                print(f"{datetime.now():%H:%M:%S} after {sequence} frames")
+                print_report(protocol, CONTROLLERS)
+                next_report += args.report
+            time.sleep(args.period)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,105 @@
+"""
+Boot time report (CMD_GET_BOOT_TIMES)
+
+Reads the boot phase timestamps of one or more controllers: time since
+Reset_Handler at main(), clock setup, peripheral init, RS485 ready, the
+first response sent and the end of the deferred init, with the interval
+of every phase and the reset cause. The first response is checked against
+the firmware target (20 ms).
+
+With --wait the controllers are pinged until they answer before reading,
+so the report can be started right before power cycling the nodes.
+
+Usage:
+    python boot_report.py COM5
+    python boot_report.py COM5 --address 0x01 --wait 10
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import (RS485Protocol, MCU_NAMES, BOOT_PHASE_NAMES,
+                            RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO,
+                            RS485_ADDR_CONTROLLER_OUT)
+
+
+def wait_for_node(protocol, address, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if protocol.ping(address):
+            return True
+    return False
+
+
+def print_report(results):
+    header = f"{'phase':<16}" + "".join(f"{MCU_NAMES.get(a, hex(a)):>18}" for a in results)
+    print(header)
+    print("-" * len(header))
+
+    seen = {address: [0] for address in results}
+    for phase in BOOT_PHASE_NAMES:
+        row = f"{phase:<16}"
+        for address, boot in results.items():
+            value = boot.phases.get(phase) if boot else None
+            if value is None:
+                row += f"{'-':>18}"
+                continue
+            # Time since reset (interval since the latest earlier phase: the
+            # first response may come before or after the deferred init)
+            previous = max(t for t in seen[address] if t <= value)
+            row += f"{value:>9} (+{value - previous:>6})"
+            seen[address].append(value)
+        print(row)
+
+    print()
+    for address, boot in results.items():
+        name = MCU_NAMES.get(address, hex(address))
+        if boot is None:
+            print(f"{name}: no response")
+            continue
+        causes = ", ".join(boot.reset_causes) or "none"
+        first = boot.first_response_us
+        if first is None:
+            verdict = "no response sent since boot"
+        else:
+            verdict = (f"first response {first / 1000:.2f} ms "
+                       f"({'OK' if first <= boot.target_us else 'over'} "
+                       f"target {boot.target_us / 1000:.0f} ms)")
+        print(f"{name}: reset cause {causes} (RSR 0x{boot.reset_flags:08X}), {verdict}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Boot time report")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--address", type=lambda value: int(value, 0), nargs="+",
+                        default=[RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO,
+                                 RS485_ADDR_CONTROLLER_OUT],
+                        help="controller addresses (default: all)")
+    parser.add_argument("--wait", type=float, default=0,
+                        help="ping each controller for up to N seconds before reading")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        results = {}
+        for address in args.address:
+            if args.wait > 0 and not wait_for_node(protocol, address, args.wait):
+                results[address] = None
+                continue
+            results[address] = protocol.get_boot_times(address)
+        print_report(results)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
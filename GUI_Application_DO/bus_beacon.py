@@ -0,0 +1,114 @@
+"""
+TDMA bus master (CMD_BUS_BEACON)
+
+Broadcasts one beacon per cycle. Each controller gets one slot for the
+frames it sends on its own (stream publications); the master keeps the
+start of the cycle for its requests. The controllers fall back to CSMA
+(carrier sense, random back-off) when the beacons stop.
+
+    |beacon| master | 420 slot | DIO slot | OUT slot | guard |beacon| ...
+
+For a report, the master sends a beacon without slots: the controllers hold
+their frames while it polls, then the normal cycle resumes. Collisions are
+frames failing CRC or end-byte checks, counted per mode by each controller.
+
+Usage:
+    python bus_beacon.py COM5                         (100 ms cycle, report every 10 s)
+    python bus_beacon.py COM5 --cycle 200 --slot 40 --duration 60
+    python bus_beacon.py COM5 --status
+    python bus_beacon.py COM5 --csma                  (end TDMA now)
+"""
+
+import argparse
+import sys
+import time
+
+from rs485_protocol import (RS485Protocol, MCU_NAMES, RS485_ADDR_CONTROLLER_420,
+                            RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT)
+
+CONTROLLERS = [RS485_ADDR_CONTROLLER_420, RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT]
+GUARD_MS = 5                # Before the next beacon
+QUIET_CYCLE_MS = 1000       # Beacon without slots while the master polls
+
+
+def build_slots(master_ms, slot_ms):
+    return [(address, master_ms + n * slot_ms, slot_ms) for n, address in enumerate(CONTROLLERS)]
+
+
+def print_report(protocol):
+    for address in CONTROLLERS:
+        name = MCU_NAMES.get(address, f"0x{address:02X}")
+        status = protocol.get_bus_access(address)
+        if status is None:
+            print(f"  {name:<16} no response")
+            continue
+        cycle = f"{status.cycle_ms} ms cycle, {status.own_slots} slots" if status.cycle_ms else "no cycle"
+        print(f"  {name:<16} {status.mode_name} ({cycle}), {status.beacons} beacons, "
+              f"{status.fallbacks} fallbacks, sent {status.slot_frames} in slot / "
+              f"{status.csma_frames} CSMA, {status.backoffs} back-offs, collisions "
+              f"{status.collisions_tdma} TDMA / {status.collisions_csma} CSMA")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TDMA bus master")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--cycle", type=int, default=100, help="cycle in ms (default: 100)")
+    parser.add_argument("--master", type=int, default=25, help="master time after the beacon, ms (default: 25)")
+    parser.add_argument("--slot", type=int, default=20, help="slot per controller, ms (default: 20)")
+    parser.add_argument("--report", type=float, default=10.0,
+                        help="seconds between controller reports, 0 = none (default: 10)")
+    parser.add_argument("--duration", type=float, default=0, help="seconds to run, 0 = until Ctrl+C")
+    parser.add_argument("--status", action="store_true", help="report once, send no beacons")
+    parser.add_argument("--csma", action="store_true", help="end TDMA (beacon with cycle 0) and report")
+    args = parser.parse_args()
+
+    slots = build_slots(args.master, args.slot)
+    if args.master + args.slot * len(CONTROLLERS) + GUARD_MS > args.cycle:
+        print(f"Cycle too short: {args.master} + {len(CONTROLLERS)} x {args.slot} + {GUARD_MS} ms")
+        return 1
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    beacons_sent = False
+    try:
+        if args.status or args.csma:
+            if args.csma:
+                protocol.bus_beacon(0, [])
+            print_report(protocol)
+            return 0
+
+        for address, start, length in slots:
+            print(f"{MCU_NAMES.get(address, hex(address))}: {start}-{start + length} ms of {args.cycle} ms")
+
+        start_time = time.monotonic()
+        next_beacon = start_time
+        next_report = start_time + args.report
+        while args.duration <= 0 or time.monotonic() - start_time < args.duration:
+            if args.report > 0 and time.monotonic() >= next_report:
+                protocol.bus_beacon(QUIET_CYCLE_MS, [])
+                print(f"After {time.monotonic() - start_time:.0f} s")
+                print_report(protocol)
+                next_report += args.report
+                next_beacon = time.monotonic()
+
+            if not protocol.bus_beacon(args.cycle, slots):
+                print("Send failed")
+                return 1
+            beacons_sent = True
+            next_beacon += args.cycle / 1000
+            time.sleep(max(0.0, next_beacon - time.monotonic()))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if beacons_sent:
+            protocol.bus_beacon(0, [])
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,396 @@
+"""
+Logic compiler for the OUT controller logic engine
+
+Translates a structured-text subset into the engine's bytecode (see
+logic_engine.h in SW_Controller_OUT). One statement per rung:
+
+    DO5 := DI0 AND NOT DI3;                 (* coil *)
+    M1 := R_TRIG(DI4) OR (M1 AND NOT DI5);  (* self-holding *)
+    SET(DO9, DI1);                          (* set coil *)
+    RESET(DO9, DI2);                        (* reset coil *)
+    DO6 := TON(T0, DI1, T#500ms);           (* on delay; also TOF, TP *)
+    DO7 := CTU(C0, DI2, DI3, 10);           (* count DI2 edges, DI3 resets, Q at 10 *)
+    DO8 := AI3 > 30000 AND AI_ONLINE;       (* raw analog compare: > < >= <= = <> *)
+    DO10 := T0 OR C0 OR FIRST_SCAN;
+
+Ladder rungs map one to one: series contacts are AND, parallel branches OR,
+normally closed contacts NOT, and the coil is the assignment (SET/RESET for
+S/R coils).
+
+Operands:
+- DI0-55 (DIO controller inputs), DO0-55, M0-255
+- T0-31 and C0-31: timer/counter outputs
+- AI0-31: raw 4-20mA controller values, in comparisons only
+- TRUE, FALSE, FIRST_SCAN, DI_ONLINE, AI_ONLINE, CLOCK_1HZ
+Times: T#500ms, T#2s, 500ms, 2s. Comments: (* ... *) and // ...
+
+Usage:
+    python logic_compiler.py program.st                 (check, print listing)
+    python logic_compiler.py program.st -o program.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+# Opcodes (logic_engine.h)
+OP_END = 0x00
+OP_LD = 0x01
+OP_LDN = 0x02
+OP_AND = 0x03
+OP_OR = 0x04
+OP_XOR = 0x05
+OP_NOT = 0x06
+OP_DUP = 0x07
+OP_ST = 0x08
+OP_SET = 0x09
+OP_RST = 0x0A
+OP_R_TRIG = 0x0B
+OP_F_TRIG = 0x0C
+OP_TON = 0x0D
+OP_TOF = 0x0E
+OP_TP = 0x0F
+OP_CTU = 0x10
+OP_ACMP = 0x11
+
+# Bit areas and limits
+AREA_DO = 0
+AREA_DI = 1
+AREA_MARKER = 2
+AREA_TIMER = 3
+AREA_COUNTER = 4
+AREA_SYSTEM = 5
+AREA_PREFIX = {"DO": (AREA_DO, 56), "DI": (AREA_DI, 56), "M": (AREA_MARKER, 256),
+               "T": (AREA_TIMER, 32), "C": (AREA_COUNTER, 32)}
+SYSTEM_BITS = {"ALWAYS_ON": 0, "FIRST_SCAN": 1, "DI_ONLINE": 2, "AI_ONLINE": 3, "CLOCK_1HZ": 4}
+NUM_ANALOG = 32
+NUM_EDGES = 64
+STACK_DEPTH = 16
+PROGRAM_SIZE = 4096
+
+COMPARE_OPS = {">": 0, "<": 1, ">=": 2, "<=": 3, "=": 4, "<>": 5}
+TIMER_OPS = {"TON": OP_TON, "TOF": OP_TOF, "TP": OP_TP}
+
+OPCODE_NAMES = {OP_END: "END", OP_LD: "LD", OP_LDN: "LDN", OP_AND: "AND", OP_OR: "OR",
+                OP_XOR: "XOR", OP_NOT: "NOT", OP_DUP: "DUP", OP_ST: "ST", OP_SET: "SET",
+                OP_RST: "RST", OP_R_TRIG: "R_TRIG", OP_F_TRIG: "F_TRIG", OP_TON: "TON",
+                OP_TOF: "TOF", OP_TP: "TP", OP_CTU: "CTU", OP_ACMP: "ACMP"}
+OPERAND_SIZE = {OP_LD: 2, OP_LDN: 2, OP_ST: 2, OP_SET: 2, OP_RST: 2, OP_R_TRIG: 1,
+                OP_F_TRIG: 1, OP_TON: 5, OP_TOF: 5, OP_TP: 5, OP_CTU: 3, OP_ACMP: 4}
+STACK_EFFECT = {OP_LD: 1, OP_LDN: 1, OP_AND: -1, OP_OR: -1, OP_XOR: -1, OP_DUP: 1,
+                OP_ST: -1, OP_SET: -1, OP_RST: -1, OP_CTU: -1, OP_ACMP: 1}
+
+TOKEN_RE = re.compile(r"""
+    (?P<space>\s+|\(\*.*?\*\)|//[^\n]*)
+  | (?P<time>T\#\d+(?:ms|s)|\d+(?:ms|s)\b)
+  | (?P<number>\d+)
+  | (?P<name>[A-Za-z_][A-Za-z0-9_]*)
+  | (?P<op>:=|>=|<=|<>|[><=();,&])
+""", re.VERBOSE | re.DOTALL | re.IGNORECASE)
+
+
+class LogicError(Exception):
+    """Compile error with source line"""
+
+    def __init__(self, message, line):
+        super().__init__(f"line {line}: {message}")
+        self.line = line
+
+
+def tokenize(source):
+    """Split source into (kind, text, line) tokens"""
+    tokens = []
+    position = 0
+    line = 1
+    while position < len(source):
+        match = TOKEN_RE.match(source, position)
+        if not match:
+            raise LogicError(f"unexpected '{source[position]}'", line)
+        kind = match.lastgroup
+        text = match.group()
+        if kind != "space":
+            tokens.append((kind, text.upper() if kind in ("name", "time") else text, line))
+        line += text.count("\n")
+        position = match.end()
+    tokens.append(("end", "", line))
+    return tokens
+
+
+def parse_time_ms(text):
+    """T#500MS / 2S -> milliseconds"""
+    text = text[2:] if text.startswith("T#") else text
+    if text.endswith("MS"):
+        return int(text[:-2])
+    return int(text[:-1]) * 1000
+
+
+class Compiler:
+    """Recursive descent compiler: statements -> bytecode"""
+
+    def __init__(self, source):
+        self.tokens = tokenize(source)
+        self.index = 0
+        self.code = bytearray()
+        self.listing = []
+        self.edges = 0
+        self.timers = {}
+        self.counters = {}
+        self.depth = 0
+
+    # Token helpers
+
+    def peek(self):
+        return self.tokens[self.index]
+
+    def next(self):
+        token = self.tokens[self.index]
+        self.index += 1
+        return token
+
+    def expect(self, text):
+        kind, value, line = self.next()
+        if value != text:
+            raise LogicError(f"expected '{text}', found '{value or 'end of file'}'", line)
+
+    def accept(self, text):
+        if self.peek()[1] == text:
+            self.index += 1
+            return True
+        return False
+
+    # Code emission
+
+    def emit(self, opcode, operands=b"", line=0):
+        needed = {OP_AND: 2, OP_OR: 2, OP_XOR: 2, OP_CTU: 2}.get(opcode, 1 if opcode in (
+            OP_NOT, OP_DUP, OP_ST, OP_SET, OP_RST, OP_R_TRIG, OP_F_TRIG, OP_TON, OP_TOF, OP_TP) else 0)
+        if self.depth < needed:
+            raise LogicError("internal: stack underflow", line)
+        self.depth += STACK_EFFECT.get(opcode, 0)
+        if self.depth > STACK_DEPTH:
+            raise LogicError(f"expression too deep (stack {STACK_DEPTH})", line)
+        self.code.append(opcode)
+        self.code.extend(operands)
+        if len(self.code) > PROGRAM_SIZE:
+            raise LogicError(f"program larger than {PROGRAM_SIZE} bytes", line)
+
+    # Grammar
+
+    def compile(self):
+        while self.peek()[0] != "end":
+            self.statement()
+        self.emit(OP_END)
+        return bytes(self.code)
+
+    def statement(self):
+        kind, value, line = self.next()
+        if value in ("SET", "RESET") and self.peek()[1] == "(":
+            self.expect("(")
+            area, index = self.target(self.next())
+            self.expect(",")
+            self.expression()
+            self.expect(")")
+            self.expect(";")
+            self.emit(OP_SET if value == "SET" else OP_RST, bytes([area, index]), line)
+            return
+
+        area, index = self.target((kind, value, line))
+        self.expect(":=")
+        self.expression()
+        self.expect(";")
+        self.emit(OP_ST, bytes([area, index]), line)
+
+    def target(self, token):
+        kind, value, line = token
+        operand = self.operand(value, line) if kind == "name" else None
+        if operand is None or operand[0] not in (AREA_DO, AREA_MARKER):
+            raise LogicError(f"'{value}' cannot be written (DO or M only)", line)
+        return operand
+
+    def expression(self):
+        self.xor_term()
+        while self.peek()[1] == "OR":
+            line = self.next()[2]
+            self.xor_term()
+            self.emit(OP_OR, line=line)
+
+    def xor_term(self):
+        self.and_term()
+        while self.peek()[1] == "XOR":
+            line = self.next()[2]
+            self.and_term()
+            self.emit(OP_XOR, line=line)
+
+    def and_term(self):
+        self.unary()
+        while self.peek()[1] in ("AND", "&"):
+            line = self.next()[2]
+            self.unary()
+            self.emit(OP_AND, line=line)
+
+    def unary(self):
+        if self.peek()[1] == "NOT":
+            line = self.next()[2]
+            kind, value, _ = self.peek()
+            operand = self.operand(value, line) if kind == "name" else None
+            if operand is not None and self.tokens[self.index + 1][1] not in COMPARE_OPS:
+                self.next()
+                self.emit(OP_LDN, bytes(operand), line)
+            else:
+                self.unary()
+                self.emit(OP_NOT, line=line)
+            return
+        self.primary()
+
+    def primary(self):
+        kind, value, line = self.next()
+        if value == "(":
+            self.expression()
+            self.expect(")")
+        elif value in ("TRUE", "FALSE"):
+            self.emit(OP_LD if value == "TRUE" else OP_LDN,
+                      bytes([AREA_SYSTEM, SYSTEM_BITS["ALWAYS_ON"]]), line)
+        elif value in ("R_TRIG", "F_TRIG"):
+            self.expect("(")
+            self.expression()
+            self.expect(")")
+            if self.edges >= NUM_EDGES:
+                raise LogicError(f"more than {NUM_EDGES} edge detections", line)
+            self.emit(OP_R_TRIG if value == "R_TRIG" else OP_F_TRIG, bytes([self.edges]), line)
+            self.edges += 1
+        elif value in TIMER_OPS:
+            self.expect("(")
+            timer = self.instance(self.next(), AREA_TIMER, self.timers)
+            self.expect(",")
+            self.expression()
+            self.expect(",")
+            time_kind, time_text, time_line = self.next()
+            if time_kind != "time":
+                raise LogicError(f"expected a time (T#500ms), found '{time_text}'", time_line)
+            self.expect(")")
+            self.emit(TIMER_OPS[value], struct.pack("<BI", timer, parse_time_ms(time_text)), line)
+        elif value == "CTU":
+            self.expect("(")
+            counter = self.instance(self.next(), AREA_COUNTER, self.counters)
+            self.expect(",")
+            self.expression()
+            self.expect(",")
+            self.expression()
+            self.expect(",")
+            preset = self.number(0xFFFF)
+            self.expect(")")
+            self.emit(OP_CTU, struct.pack("<BH", counter, preset), line)
+        elif kind == "name" and re.fullmatch(r"AI\d+", value):
+            channel = int(value[2:])
+            if channel >= NUM_ANALOG:
+                raise LogicError(f"'{value}': analog channels are AI0-{NUM_ANALOG - 1}", line)
+            compare_kind, compare, compare_line = self.next()
+            if compare not in COMPARE_OPS:
+                raise LogicError(f"'{value}' needs a comparison (> < >= <= = <>)", compare_line)
+            self.emit(OP_ACMP, struct.pack("<BBH", COMPARE_OPS[compare], channel,
+                                           self.number(0xFFFF)), line)
+        elif kind == "name":
+            operand = self.operand(value, line)
+            if operand is None:
+                raise LogicError(f"unknown operand '{value}'", line)
+            self.emit(OP_LD, bytes(operand), line)
+        else:
+            raise LogicError(f"unexpected '{value or 'end of file'}'", line)
+
+    def operand(self, name, line):
+        """Name -> (area, index), None if not an operand"""
+        if name in SYSTEM_BITS:
+            return AREA_SYSTEM, SYSTEM_BITS[name]
+        match = re.fullmatch(r"(DO|DI|M|T|C)(\d+)", name)
+        if not match:
+            return None
+        area, size = AREA_PREFIX[match.group(1)]
+        index = int(match.group(2))
+        if index >= size:
+            raise LogicError(f"'{name}': {match.group(1)}0-{size - 1} only", line)
+        return area, index
+
+    def instance(self, token, area, used):
+        """Timer/counter instance: one block per instance"""
+        kind, value, line = token
+        operand = self.operand(value, line) if kind == "name" else None
+        if operand is None or operand[0] != area:
+            raise LogicError(f"expected a {'timer (T0-31)' if area == AREA_TIMER else 'counter (C0-31)'}, "
+                             f"found '{value}'", line)
+        if value in used:
+            raise LogicError(f"'{value}' already used on line {used[value]}", line)
+        used[value] = line
+        return operand[1]
+
+    def number(self, maximum):
+        kind, value, line = self.next()
+        if kind != "number" or int(value) > maximum:
+            raise LogicError(f"expected a number 0-{maximum}, found '{value}'", line)
+        return int(value)
+
+
+def compile_source(source):
+    """Compile structured text to bytecode (raises LogicError)"""
+    return Compiler(source).compile()
+
+
+def disassemble(code):
+    """Bytecode -> listing lines"""
+    area_names = {AREA_DO: "DO", AREA_DI: "DI", AREA_MARKER: "M", AREA_TIMER: "T",
+                  AREA_COUNTER: "C"}
+    system_names = {index: name for name, index in SYSTEM_BITS.items()}
+    compare_names = {index: name for name, index in COMPARE_OPS.items()}
+    lines = []
+    pc = 0
+    while pc < len(code):
+        opcode = code[pc]
+        size = OPERAND_SIZE.get(opcode, 0)
+        operands = code[pc + 1:pc + 1 + size]
+        text = OPCODE_NAMES.get(opcode, f"?{opcode:02X}")
+        if opcode in (OP_LD, OP_LDN, OP_ST, OP_SET, OP_RST):
+            area, index = operands
+            text += " " + (system_names.get(index, f"SYS{index}") if area == AREA_SYSTEM
+                           else f"{area_names.get(area, '?')}{index}")
+        elif opcode in (OP_R_TRIG, OP_F_TRIG):
+            text += f" #{operands[0]}"
+        elif opcode in (OP_TON, OP_TOF, OP_TP):
+            timer, preset = struct.unpack("<BI", operands)
+            text += f" T{timer}, {preset} ms"
+        elif opcode == OP_CTU:
+            counter, preset = struct.unpack("<BH", operands)
+            text += f" C{counter}, {preset}"
+        elif opcode == OP_ACMP:
+            compare, channel, value = struct.unpack("<BBH", operands)
+            text += f" AI{channel} {compare_names.get(compare, '?')} {value}"
+        lines.append(f"{pc:04X}  {code[pc:pc + 1 + size].hex(' '):<18} {text}")
+        pc += 1 + size
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a logic program for the OUT controller")
+    parser.add_argument("source", help="structured text file")
+    parser.add_argument("-o", "--output", help="write the bytecode to this file")
+    parser.add_argument("-q", "--quiet", action="store_true", help="no listing")
+    args = parser.parse_args()
+
+    with open(args.source, encoding="utf-8") as f:
+        source = f.read()
+    try:
+        code = compile_source(source)
+    except LogicError as e:
+        print(f"{args.source}: {e}")
+        return 1
+
+    if not args.quiet:
+        print("\n".join(disassemble(code)))
+    instructions = len(disassemble(code))
+    print(f"{len(code)} bytes, {instructions} instructions")
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(code)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
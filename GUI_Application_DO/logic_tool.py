@@ -0,0 +1,115 @@
+"""
+Logic engine tool for the OUT controller (CMD_LOGIC_xxx)
+
+Compiles a structured-text program (see logic_compiler.py), downloads it and
+activates it; the controller swaps it in at the next scan boundary, timers,
+counters and markers keep their state. Without a program file the engine
+status is shown.
+
+Usage:
+    python logic_tool.py COM5 interlock.st          (compile, download, run)
+    python logic_tool.py COM5 interlock.st --list   (also print the listing)
+    python logic_tool.py COM5 --status
+    python logic_tool.py COM5 --stop
+    python logic_tool.py COM5 --run
+    python logic_tool.py COM5 --bench
+"""
+
+import argparse
+import sys
+
+from rs485_protocol import (RS485Protocol, RS485_ADDR_CONTROLLER_OUT, LOGIC_CTRL_READ,
+                            LOGIC_CTRL_RUN, LOGIC_CTRL_STOP, LOGIC_CTRL_RESET_STATS,
+                            LOGIC_RESULT_NAMES)
+from logic_compiler import LogicError, compile_source, disassemble
+
+
+def print_status(address, status):
+    if status is None:
+        print(f"Output controller 0x{address:02X}: no response")
+        return
+
+    print(f"Output controller 0x{address:02X}: {status.state_name}")
+    if status.length:
+        print(f"  Program:  {status.length} bytes, {status.instructions} instructions, "
+              f"CRC 0x{status.crc:04X}")
+    print(f"  Scans:    {status.scans}, last {status.last_scan_us:.1f} us, "
+          f"max {status.max_scan_us:.1f} us")
+    print(f"  Programs: {status.swaps} activated, {status.rejected} rejected"
+          f"{f', {status.staged} bytes staged' if status.staged else ''}")
+    markers = [f"M{n}" for n, value in enumerate(status.markers) if value]
+    print(f"  Markers:  {' '.join(markers) if markers else '-'}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OUT controller logic engine")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("program", nargs="?", help="structured text program to download")
+    parser.add_argument("--address", type=lambda value: int(value, 0), default=RS485_ADDR_CONTROLLER_OUT,
+                        help="output controller address (default: 0x03)")
+    parser.add_argument("--list", action="store_true", help="print the compiled program")
+    control = parser.add_mutually_exclusive_group()
+    control.add_argument("--status", action="store_true", help="show the engine status (default)")
+    control.add_argument("--run", action="store_true", help="start the loaded program")
+    control.add_argument("--stop", action="store_true", help="stop the program, its outputs go to 0")
+    control.add_argument("--reset-stats", action="store_true", help="clear the scan statistics")
+    control.add_argument("--bench", action="store_true", help="time 1000 instructions on the controller")
+    args = parser.parse_args()
+
+    code = None
+    if args.program:
+        try:
+            with open(args.program, encoding="utf-8") as f:
+                code = compile_source(f.read())
+        except (OSError, LogicError) as e:
+            print(f"{args.program}: {e}")
+            return 1
+        if args.list:
+            print("\n".join(disassemble(code)))
+        print(f"{args.program}: {len(code)} bytes, {len(disassemble(code))} instructions")
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        if code is not None:
+            result, offset = protocol.logic_download(args.address, code)
+            if result != 0:
+                reason = "no response" if result < 0 else LOGIC_RESULT_NAMES.get(result, f"error {result}")
+                print(f"Download failed: {reason}" + (f" at byte {offset}" if result > 0 else ""))
+                return 1
+            print("Program activated")
+
+        if args.bench:
+            bench = protocol.logic_bench(args.address)
+            if bench is None:
+                print(f"Output controller 0x{args.address:02X}: no response")
+                return 1
+            print(f"{bench.instructions} instructions in {bench.cycles} cycles "
+                  f"({bench.us_per_1k:.1f} us per 1000 instructions at "
+                  f"{bench.core_clock_hz / 1e6:.0f} MHz)")
+            return 0
+
+        operation = LOGIC_CTRL_READ
+        if args.run:
+            operation = LOGIC_CTRL_RUN
+        elif args.stop:
+            operation = LOGIC_CTRL_STOP
+        elif args.reset_stats:
+            operation = LOGIC_CTRL_RESET_STATS
+        status = protocol.get_logic_status(args.address, operation)
+        print_status(args.address, status)
+        if status is None:
+            return 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,112 @@
+"""
+DI -> DO peer mapping (CMD_DI_ROUTES, CMD_DO_MAP)
+
+Links inputs of the input controller (0x02) straight to outputs of the
+output controller (0x03) over CAN-FD, without the PC in the loop: the input
+controller gets a route carrying the linked inputs to the output controller,
+the output controller a mapping entry per link. Changes take effect within a
+few milliseconds; the tables are kept until power off.
+
+Without --link the current tables are shown.
+
+Link syntax: INPUT:OUTPUT[:invert][:latch]
+    0:5             DO5 follows DI0
+    3:7:invert      DO7 is the inverse of DI3
+    4:8:latch       DO8 is set when DI4 turns on, until --clear-latches
+
+Usage:
+    python peer_map.py COM5
+    python peer_map.py COM5 --link 0:5 --link 3:7:invert --link 4:8:latch
+    python peer_map.py COM5 --clear
+    python peer_map.py COM5 --clear-latches
+"""
+
+import argparse
+import sys
+
+from rs485_protocol import (RS485Protocol, RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT,
+                            DiRoute, DoMapEntry)
+
+
+def parse_link(text, source):
+    parts = text.split(':')
+    if len(parts) < 2 or any(option not in ('invert', 'latch') for option in parts[2:]):
+        raise argparse.ArgumentTypeError(f"invalid link '{text}'")
+    input_num, output = int(parts[0]), int(parts[1])
+    if not (0 <= input_num < 56 and 0 <= output < 56):
+        raise argparse.ArgumentTypeError(f"link '{text}': inputs and outputs are 0-55")
+    return DoMapEntry(source, input_num, output, 'invert' in parts[2:], 'latch' in parts[2:])
+
+
+def print_tables(di_addr, routes, do_addr, do_map):
+    if routes is not None:
+        print(f"Input controller 0x{di_addr:02X}: {len(routes.routes)} route(s), "
+              f"{routes.changes} changes / {routes.refreshes} refreshes sent, "
+              f"{routes.send_errors} send errors")
+        for route in routes.routes:
+            print(f"  -> 0x{route.dest:02X}: DI {', '.join(str(n) for n in route.inputs) or '-'}")
+    else:
+        print(f"Input controller 0x{di_addr:02X}: no response")
+
+    if do_map is not None:
+        print(f"Output controller 0x{do_addr:02X}: {len(do_map.entries)} entr"
+              f"{'y' if len(do_map.entries) == 1 else 'ies'}, {do_map.frames} frames, "
+              f"{do_map.applied} output changes, {do_map.timeouts} source timeouts")
+        for entry in sorted(do_map.entries, key=lambda e: e.output):
+            options = [name for name, on in (('invert', entry.invert), ('latch', entry.latch)) if on]
+            state = 'online' if entry.online else 'offline'
+            print(f"  DO{entry.output:<3} <- 0x{entry.source:02X} DI{entry.input:<3}"
+                  f"{' ' + ','.join(options) if options else '':<14} {state}")
+    else:
+        print(f"Output controller 0x{do_addr:02X}: no response")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="DI -> DO peer mapping")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--di", type=lambda value: int(value, 0), default=RS485_ADDR_CONTROLLER_DIO,
+                        help="input controller address (default: 0x02)")
+    parser.add_argument("--do", type=lambda value: int(value, 0), default=RS485_ADDR_CONTROLLER_OUT,
+                        help="output controller address (default: 0x03)")
+    parser.add_argument("--link", action="append", default=[],
+                        help="INPUT:OUTPUT[:invert][:latch], repeatable; replaces all links")
+    parser.add_argument("--clear", action="store_true", help="remove all links")
+    parser.add_argument("--clear-latches", action="store_true", help="clear latched outputs")
+    args = parser.parse_args()
+
+    try:
+        links = [parse_link(text, args.di) for text in args.link]
+    except argparse.ArgumentTypeError as e:
+        parser.error(str(e))
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        if links or args.clear:
+            # Output side first: frames sent meanwhile find their entries
+            do_map = protocol.set_do_map(args.do, links)
+            inputs = sorted({link.input for link in links})
+            routes = protocol.set_di_routes(args.di, [DiRoute(args.do, inputs)] if inputs else [])
+        else:
+            routes = protocol.get_di_routes(args.di)
+            do_map = protocol.get_do_map(args.do)
+
+        if args.clear_latches:
+            do_map = protocol.clear_do_latches(args.do)
+
+        print_tables(args.di, routes, args.do, do_map)
+        if routes is None or do_map is None:
+            return 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
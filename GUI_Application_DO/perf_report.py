@@ -0,0 +1,135 @@
+"""
+Cycle counter profiling report (CMD_GET_PERF, CMD_GET_TASKS)
+
+Prints count, min, mean, p50, p99 and max per probe in microseconds.
+p50/p99 are estimated from the controller's log2 histogram. The scheduler
+tasks follow with priority class, runs, missed periods, worst release
+lateness, worst response latency and execution time.
+
+To compare the bare-metal and FreeRTOS builds, save the tasks of one build
+and pass the file as baseline when reporting the other: the worst response
+latency of every task is then listed side by side.
+
+Usage:
+    python perf_report.py COM5
+    python perf_report.py COM5 --address 0x02 --reset --watch 10
+    python perf_report.py COM5 --save bare_metal.json
+    python perf_report.py COM5 --baseline bare_metal.json
+"""
+
+import argparse
+import json
+import sys
+import time
+
+from rs485_protocol import RS485Protocol, RS485_ADDR_CONTROLLER_OUT
+
+
+def print_report(probes):
+    print(f"{'Probe':<28}{'Count':>10}{'Min us':>10}{'Mean us':>10}"
+          f"{'p50 us':>10}{'p99 us':>10}{'Max us':>10}")
+    print("-" * 88)
+    for probe in probes:
+        if probe.count == 0:
+            print(f"{probe.name:<28}{0:>10}")
+            continue
+        print(f"{probe.name:<28}{probe.count:>10}"
+              f"{probe.to_us(probe.min_cycles):>10.2f}"
+              f"{probe.to_us(probe.mean_cycles):>10.2f}"
+              f"{probe.to_us(probe.percentile(50)):>10.2f}"
+              f"{probe.to_us(probe.percentile(99)):>10.2f}"
+              f"{probe.to_us(probe.max_cycles):>10.2f}")
+    if probes:
+        print(f"CPU clock: {probes[0].cpu_mhz} MHz")
+
+
+def print_tasks(tasks):
+    print(f"Scheduler: {tasks[0].kernel_name}")
+    print(f"{'Task':<14}{'Class':<14}{'Release':>10}{'Runs':>10}{'Missed':>8}{'Late ms':>9}"
+          f"{'Lat us':>10}{'Min us':>10}{'Mean us':>10}{'Max us':>10}")
+    print("-" * 105)
+    for task in tasks:
+        release = f"{task.period_ms} ms" if task.periodic else f"ev 0x{task.events:X}"
+        if task.runs == 0:
+            print(f"{task.name:<14}{task.priority_name:<14}{release:>10}{0:>10}")
+            continue
+        print(f"{task.name:<14}{task.priority_name:<14}{release:>10}{task.runs:>10}"
+              f"{task.missed:>8}{task.max_late_ms:>9}"
+              f"{task.to_us(task.max_latency_cycles):>10.2f}"
+              f"{task.to_us(task.min_cycles):>10.2f}"
+              f"{task.to_us(task.mean_cycles):>10.2f}"
+              f"{task.to_us(task.max_cycles):>10.2f}")
+
+
+def save_tasks(tasks, path):
+    latency = {task.name: task.to_us(task.max_latency_cycles) for task in tasks}
+    with open(path, "w") as file:
+        json.dump({"kernel": tasks[0].kernel_name, "max_latency_us": latency}, file, indent=2)
+
+
+def print_latency_comparison(tasks, path):
+    with open(path) as file:
+        baseline = json.load(file)
+    reference = baseline.get("max_latency_us", {})
+    kernel = tasks[0].kernel_name
+
+    print(f"Worst response latency: {kernel} vs {baseline.get('kernel', path)}")
+    print(f"{'Task':<14}{'Class':<14}{kernel + ' us':>16}{'Baseline us':>14}{'Change us':>12}")
+    print("-" * 70)
+    for task in tasks:
+        current = task.to_us(task.max_latency_cycles)
+        if task.name not in reference:
+            print(f"{task.name:<14}{task.priority_name:<14}{current:>16.2f}{'-':>14}")
+            continue
+        print(f"{task.name:<14}{task.priority_name:<14}{current:>16.2f}"
+              f"{reference[task.name]:>14.2f}{current - reference[task.name]:>+12.2f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Controller profiling report")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--address", type=lambda value: int(value, 0),
+                        default=RS485_ADDR_CONTROLLER_OUT, help="controller address")
+    parser.add_argument("--reset", action="store_true",
+                        help="clear the probes after each report")
+    parser.add_argument("--watch", type=float, default=0,
+                        help="repeat every N seconds")
+    parser.add_argument("--save", help="save the worst task latencies to a JSON file")
+    parser.add_argument("--baseline", help="compare the worst task latencies with a saved file")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    try:
+        while True:
+            probes = protocol.read_perf(args.address, reset=args.reset)
+            if probes is None:
+                print(f"No response from 0x{args.address:02X}")
+            else:
+                print_report(probes)
+            tasks = protocol.read_tasks(args.address, reset=args.reset)
+            if tasks:
+                print()
+                print_tasks(tasks)
+                if args.save:
+                    save_tasks(tasks, args.save)
+                if args.baseline:
+                    print()
+                    print_latency_comparison(tasks, args.baseline)
+            if args.watch <= 0:
+                break
+            print()
+            time.sleep(args.watch)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
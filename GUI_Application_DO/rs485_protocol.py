@@ -15,8 +15,9 @@ import struct
 import serial
 import threading
 import time
+import zlib
 from enum import IntEnum
-from typing import Optional, Callable, Dict
+from typing import Optional, Callable, Dict, Tuple
 from dataclasses import dataclass
 
 # Protocol Constants
@@ -47,13 +48,37 @@ class RS485Command(IntEnum):
     CMD_VERSION_RESPONSE = 0x04
     CMD_HEARTBEAT = 0x05
     CMD_HEARTBEAT_RESPONSE = 0x06
+    CMD_SYNC = 0x07                      # Broadcast, no response
+    CMD_TIME_SYNC = 0x08                 # Broadcast, no response
+    CMD_BUS_BEACON = 0x09                # Broadcast TDMA slots, no response
+    CMD_READ_SNAPSHOT = 0x0A
+    CMD_SNAPSHOT_RESPONSE = 0x0B
+    CMD_SYNC_MODE = 0x0C
+    CMD_SYNC_MODE_RESPONSE = 0x0D
     CMD_GET_STATUS = 0x10
     CMD_STATUS_RESPONSE = 0x11
+    CMD_GET_PERF = 0x12
+    CMD_PERF_RESPONSE = 0x13
+    CMD_GET_TELEMETRY = 0x14
+    CMD_TELEMETRY_RESPONSE = 0x15
+    CMD_GET_HEALTH = 0x16
+    CMD_HEALTH_RESPONSE = 0x17
+    CMD_GET_TASKS = 0x18
+    CMD_TASKS_RESPONSE = 0x19
+    CMD_GET_BOOT_TIMES = 0x1A
+    CMD_BOOT_TIMES_RESPONSE = 0x1B
+    CMD_GET_ROUTES = 0x1C
+    CMD_ROUTES_RESPONSE = 0x1D
     CMD_READ_DI = 0x20
     CMD_DI_RESPONSE = 0x21
+    CMD_DI_ROUTES = 0x22
+    CMD_DI_ROUTES_RESPONSE = 0x23
     CMD_WRITE_DO = 0x30
     CMD_DO_RESPONSE = 0x31
     CMD_READ_DO = 0x32
+    CMD_DI_CHANGE = 0x33
+    CMD_DO_MAP = 0x34
+    CMD_DO_MAP_RESPONSE = 0x35
     CMD_READ_ANALOG_420 = 0x40
     CMD_ANALOG_420_RESPONSE = 0x41
     CMD_READ_ANALOG_VOLTAGE = 0x42
@@ -62,6 +87,25 @@ class RS485Command(IntEnum):
     CMD_NTC_RESPONSE = 0x45
     CMD_READ_ALL_ANALOG = 0x46
     CMD_ALL_ANALOG_RESPONSE = 0x47
+    CMD_LOGIC_DOWNLOAD = 0x70
+    CMD_LOGIC_DOWNLOAD_RESPONSE = 0x71
+    CMD_LOGIC_ACTIVATE = 0x72
+    CMD_LOGIC_ACTIVATE_RESPONSE = 0x73
+    CMD_LOGIC_STATUS = 0x74
+    CMD_LOGIC_STATUS_RESPONSE = 0x75
+    CMD_LOGIC_BENCH = 0x76
+    CMD_LOGIC_BENCH_RESPONSE = 0x77
+    CMD_SEG_OPEN = 0x80
+    CMD_SEG_OPEN_RESPONSE = 0x81
+    CMD_SEG_READ = 0x82
+    CMD_SEG_DATA = 0x83
+    CMD_SEG_ACK = 0x84
+    CMD_SEG_ACK_RESPONSE = 0x85
+    CMD_STREAM_SUBSCRIBE = 0x90
+    CMD_STREAM_SUBSCRIBE_RESPONSE = 0x91
+    CMD_STREAM_STATUS = 0x92
+    CMD_STREAM_STATUS_RESPONSE = 0x93
+    CMD_STREAM_DATA = 0x94
     CMD_ERROR_RESPONSE = 0xFF
 
 class RS485Error(IntEnum):
@@ -73,6 +117,33 @@ class RS485Error(IntEnum):
     ERR_INVALID_LENGTH = 0x04
     ERR_TIMEOUT = 0x05
     ERR_BUSY = 0x06
+    ERR_INVALID_PARAM = 0x07
+
+class AnalogFormat(IntEnum):
+    """Analog read wire formats (first data byte of the analog read commands)"""
+    LEGACY = 0x00      # raw uint16 + float, 6 bytes/channel, no header
+    RAW16 = 0x01       # raw uint16, 2 bytes/channel
+    SCALED16 = 0x02    # int16 engineering units x 10^exponent, 2 bytes/channel
+    PACKED12 = 0x03    # [status:4][raw >> 4:12], 2 bytes/channel
+    DELTA = 0x04       # zigzag varint of raw delta to previous frame
+
+# Compact analog format header: [format][channel count][param]
+ANALOG_FORMAT_HEADER_SIZE = 3
+ANALOG_FLAG_KEYFRAME = 0x01
+
+# Nominal ADC conversion (matches analog_input_handler.h, without calibration)
+ADC_RESOLUTION = 65535.0
+ADC_VREF = 3.3
+CURRENT_SENSE_RESISTOR = 250.0
+VOLTAGE_DIVIDER_RATIO = 3.03
+
+def raw_to_mA(raw: int) -> float:
+    """Convert raw 4-20mA ADC value to mA"""
+    return (raw / ADC_RESOLUTION) * ADC_VREF / CURRENT_SENSE_RESISTOR * 1000.0
+
+def raw_to_volts(raw: int) -> float:
+    """Convert raw 0-10V ADC value to V"""
+    return (raw / ADC_RESOLUTION) * ADC_VREF * VOLTAGE_DIVIDER_RATIO
 
 @dataclass
 class RS485Packet:
@@ -104,7 +175,10 @@ class MCUStatus:
         
         mcu_id, health = struct.unpack('BB', data[0:2])
         uptime, error_count, rx_count = struct.unpack('<III', data[2:14])
-        tx_count = struct.unpack('<H', data[14:16])[0]
+        if len(data) >= 18:
+            tx_count = struct.unpack('<I', data[14:18])[0]
+        else:
+            tx_count = struct.unpack('<H', data[14:16])[0]     # 16-bit in older firmware
         
         return cls(mcu_id, health, uptime, error_count, rx_count, tx_count)
 
@@ -129,6 +203,566 @@ class MCUVersion:
         major, minor, patch, build, mcu_id = struct.unpack('BBBBB', data[0:5])
         return cls(major, minor, patch, build, mcu_id)
 
+@dataclass
+class PerfProbe:
+    """Cycle counter profiling probe (CMD_GET_PERF)"""
+    index: int
+    probe_id: int
+    command: int                # RS485 command (per-command probes only)
+    cpu_mhz: int
+    count: int
+    min_cycles: int
+    max_cycles: int
+    total_cycles: int
+    histogram: list             # Bin n: [2^(n-1), 2^n) cycles, last bin open
+    
+    @property
+    def name(self) -> str:
+        if self.probe_id == PERF_PROBE_COMMAND:
+            try:
+                return RS485Command(self.command).name
+            except ValueError:
+                return f"CMD 0x{self.command:02X}"
+        return PERF_PROBE_NAMES.get(self.probe_id, f"probe {self.probe_id}")
+    
+    def to_us(self, cycles: float) -> float:
+        return cycles / self.cpu_mhz if self.cpu_mhz else 0.0
+    
+    @property
+    def mean_cycles(self) -> float:
+        return self.total_cycles / self.count if self.count else 0.0
+    
+    def percentile(self, p: float) -> float:
+        """Estimate a percentile (cycles), interpolated inside the log2 bin"""
+        if self.count == 0:
+            return 0.0
+        rank = p / 100.0 * self.count
+        cumulative = 0
+        for n, bin_count in enumerate(self.histogram):
+            if bin_count and cumulative + bin_count >= rank:
+                low = 0 if n == 0 else 1 << (n - 1)
+                high = 0 if n == 0 else 1 << n
+                value = low + (high - low) * (rank - cumulative) / bin_count
+                return min(max(value, self.min_cycles), self.max_cycles)
+            cumulative += bin_count
+        return float(self.max_cycles)
+
+PERF_RESPONSE_HEADER_SIZE = 27
+PERF_FLAG_RESET = 0x01
+PERF_PROBE_COMMAND = 0xFF
+PERF_PROBE_NAMES = {
+    0: "scheduler pass",
+    1: "RS485 ISR",
+    2: "RS485 packet",
+    3: "I/O update",
+    4: "logic scan",
+}
+
+@dataclass
+class SchedTask:
+    """Scheduler task statistics (CMD_GET_TASKS)"""
+    index: int
+    name: str
+    periodic: bool
+    period_ms: int              # Periodic tasks
+    events: int                 # Event tasks: triggering event mask
+    cpu_mhz: int
+    runs: int
+    missed: int                 # Skipped periods
+    max_late_ms: int            # Release to start
+    min_cycles: int
+    max_cycles: int
+    total_cycles: int
+    max_latency_cycles: int     # Release / event post to start
+    priority: int               # See SCHED_PRIORITY_NAMES
+    kernel: int                 # See SCHED_KERNEL_NAMES
+    
+    @property
+    def priority_name(self) -> str:
+        return SCHED_PRIORITY_NAMES.get(self.priority, str(self.priority))
+    
+    @property
+    def kernel_name(self) -> str:
+        return SCHED_KERNEL_NAMES.get(self.kernel, str(self.kernel))
+    
+    def to_us(self, cycles: float) -> float:
+        return cycles / self.cpu_mhz if self.cpu_mhz else 0.0
+    
+    @property
+    def mean_cycles(self) -> float:
+        return self.total_cycles / self.runs if self.runs else 0.0
+
+SCHED_RESPONSE_HEADER_SIZE = 43
+SCHED_FLAG_RESET = 0x01
+SCHED_PRIORITY_NAMES = {0: "io", 1: "comm", 2: "housekeeping"}
+SCHED_KERNEL_NAMES = {0: "bare-metal", 1: "FreeRTOS"}
+
+BOOT_PHASE_NAMES = ["main", "clocks", "peripherals", "protocol ready", "first response", "init done"]
+BOOT_TIME_NONE = 0xFFFFFFFF
+RESET_FLAG_NAMES = {
+    17: "cpu",
+    21: "brown-out",
+    22: "pin",
+    23: "power-on",
+    24: "software",
+    26: "independent watchdog",
+    28: "window watchdog",
+    30: "low-power",
+}
+
+@dataclass
+class BootProfile:
+    """Boot phase timestamps (CMD_GET_BOOT_TIMES)"""
+    reset_flags: int            # RCC_RSR at boot, see RESET_FLAG_NAMES
+    target_us: int              # Reset to first response target
+    phases: dict                # Phase name -> us since Reset_Handler, None if not reached
+    
+    @property
+    def reset_causes(self) -> list:
+        return [name for bit, name in RESET_FLAG_NAMES.items() if self.reset_flags & (1 << bit)]
+    
+    @property
+    def first_response_us(self) -> Optional[int]:
+        return self.phases.get("first response")
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        """Parse boot times response"""
+        if len(data) < 9 or len(data) < 9 + data[0] * 4:
+            raise ValueError("Invalid boot times length")
+        
+        count = data[0]
+        reset_flags, target_us = struct.unpack('<II', data[1:9])
+        times = struct.unpack(f'<{count}I', data[9:9 + count * 4])
+        phases = {BOOT_PHASE_NAMES[i] if i < len(BOOT_PHASE_NAMES) else f"phase_{i}":
+                  None if t == BOOT_TIME_NONE else t for i, t in enumerate(times)}
+        
+        return cls(reset_flags, target_us, phases)
+
+GATEWAY_ROUTES_FLAG_DISCOVER = 0x01
+
+DI_STATE_BYTES = 7
+DO_MAP_INVERT = 0x01
+DO_MAP_LATCH = 0x02
+DO_MAP_ONLINE = 0x80
+DO_MAP_OP_READ = 0x00
+DO_MAP_OP_SET = 0x01
+DO_MAP_OP_CLEAR_LATCHES = 0x02
+
+@dataclass
+class DiRoute:
+    """Peer route on the input controller: inputs sent to a node or group"""
+    dest: int
+    inputs: list                # Input numbers (0-55)
+    
+    def to_bytes(self) -> bytes:
+        mask = sum(1 << i for i in self.inputs)
+        return bytes([self.dest]) + mask.to_bytes(DI_STATE_BYTES, 'little')
+
+@dataclass
+class DiRoutes:
+    """Input controller routing table and counters (CMD_DI_ROUTES)"""
+    changes: int                # Change frames sent
+    refreshes: int
+    send_errors: int
+    routes: list                # DiRoute
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < 13 or len(data) < 13 + data[0] * 8:
+            raise ValueError("Invalid DI routes length")
+        
+        changes, refreshes, send_errors = struct.unpack('<3I', data[1:13])
+        routes = []
+        for i in range(data[0]):
+            entry = data[13 + i * 8:21 + i * 8]
+            mask = int.from_bytes(entry[1:], 'little')
+            routes.append(DiRoute(entry[0], [n for n in range(DI_STATE_BYTES * 8) if mask >> n & 1]))
+        return cls(changes, refreshes, send_errors, routes)
+
+@dataclass
+class DoMapEntry:
+    """Output controller mapping: input of a peer node -> output"""
+    source: int                 # Input controller address
+    input: int
+    output: int
+    invert: bool = False
+    latch: bool = False
+    online: bool = False        # Read only: source heard recently
+    
+    def to_bytes(self) -> bytes:
+        flags = (DO_MAP_INVERT if self.invert else 0) | (DO_MAP_LATCH if self.latch else 0)
+        return bytes([self.source, self.input, self.output, flags])
+
+@dataclass
+class DoMap:
+    """Output controller mapping table and counters (CMD_DO_MAP)"""
+    frames: int                 # Change frames received from mapped sources
+    applied: int                # Output changes made by the mapping
+    timeouts: int               # Source timeouts (outputs to safe state)
+    ignored: int
+    entries: list               # DoMapEntry
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < 17 or len(data) < 17 + data[0] * 4:
+            raise ValueError("Invalid DO map length")
+        
+        counters = struct.unpack('<4I', data[1:17])
+        entries = []
+        for i in range(data[0]):
+            source, input_num, output, flags = data[17 + i * 4:21 + i * 4]
+            entries.append(DoMapEntry(source, input_num, output, bool(flags & DO_MAP_INVERT),
+                                      bool(flags & DO_MAP_LATCH), bool(flags & DO_MAP_ONLINE)))
+        return cls(*counters, entries)
+
+LOGIC_BLOCK_SIZE = 240
+LOGIC_CTRL_READ = 0x00
+LOGIC_CTRL_RUN = 0x01
+LOGIC_CTRL_STOP = 0x02
+LOGIC_CTRL_RESET_STATS = 0x03
+LOGIC_STATE_NAMES = {0: "empty", 1: "running", 2: "stopped"}
+LOGIC_RESULT_NAMES = {
+    0x00: "ok",
+    0x01: "bad size",
+    0x02: "block out of sequence",
+    0x03: "CRC mismatch",
+    0x04: "unknown opcode",
+    0x05: "operand out of range",
+    0x06: "stack error",
+    0x07: "END missing",
+    0x08: "busy (previous program not swapped in yet)",
+}
+
+@dataclass
+class LogicStatus:
+    """OUT logic engine status (CMD_LOGIC_STATUS)"""
+    state: int                  # LOGIC_STATE_NAMES
+    length: int                 # Active program bytes
+    crc: int
+    staged: int                 # Bytes downloaded for the next program
+    swaps: int
+    rejected: int
+    scans: int
+    instructions: int           # Per scan
+    last_cycles: int
+    max_cycles: int
+    core_clock_hz: int
+    markers: list               # M0-255
+    
+    @property
+    def state_name(self) -> str:
+        return LOGIC_STATE_NAMES.get(self.state, f"state {self.state}")
+    
+    @property
+    def last_scan_us(self) -> float:
+        return self.last_cycles * 1e6 / self.core_clock_hz if self.core_clock_hz else 0.0
+    
+    @property
+    def max_scan_us(self) -> float:
+        return self.max_cycles * 1e6 / self.core_clock_hz if self.core_clock_hz else 0.0
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < 63:
+            raise ValueError("Invalid logic status length")
+        
+        state = data[0]
+        length, crc, staged, swaps, rejected = struct.unpack('<5H', data[1:11])
+        scans, instructions, last_cycles, max_cycles, clock = struct.unpack('<5I', data[11:31])
+        markers = [(data[31 + n // 8] >> (n % 8)) & 1 for n in range(256)]
+        return cls(state, length, crc, staged, swaps, rejected, scans, instructions,
+                   last_cycles, max_cycles, clock, markers)
+
+@dataclass
+class LogicBench:
+    """Logic engine benchmark (CMD_LOGIC_BENCH)"""
+    instructions: int
+    cycles: int
+    core_clock_hz: int
+    
+    @property
+    def us_per_1k(self) -> float:
+        """Scan time per 1000 instructions"""
+        if not self.instructions or not self.core_clock_hz:
+            return 0.0
+        return self.cycles * 1e6 / self.core_clock_hz * 1000 / self.instructions
+
+SYNC_MODE_IMMEDIATE = 0x00
+SYNC_MODE_ON_SYNC = 0x01
+SYNC_MODE_NAMES = {0: "immediate", 1: "on SYNC"}
+SYNC_SNAPSHOT_HEADER_SIZE = 9
+
+@dataclass
+class SyncSnapshot:
+    """Image frozen by the last SYNC (CMD_READ_SNAPSHOT)"""
+    valid: bool                 # False before the first SYNC
+    sequence: int               # SYNC that took the snapshot
+    latch_delay_us: int         # SYNC end byte to latch
+    age_ms: int
+    image: bytes                # DIO: input states, 420: raw values, OUT: output states
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < SYNC_SNAPSHOT_HEADER_SIZE:
+            raise ValueError("Invalid snapshot length")
+        
+        sequence, delay, age = struct.unpack('<HHI', data[1:SYNC_SNAPSHOT_HEADER_SIZE])
+        return cls(bool(data[0]), sequence, delay, age, bytes(data[SYNC_SNAPSHOT_HEADER_SIZE:]))
+
+@dataclass
+class SyncStatus:
+    """SYNC output mode and statistics (CMD_SYNC_MODE)"""
+    mode: int                   # SYNC_MODE_NAMES
+    sequence: int
+    syncs: int
+    missed: int                 # Sequence numbers skipped
+    last_delay_us: int
+    max_delay_us: int
+    
+    @property
+    def mode_name(self) -> str:
+        return SYNC_MODE_NAMES.get(self.mode, f"mode {self.mode}")
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < 15:
+            raise ValueError("Invalid sync status length")
+        return cls(data[0], *struct.unpack('<HIIHH', data[1:15]))
+
+SEG_OBJECT_CAPTURE = 0x01        # 420: waveform capture (read)
+SEG_OBJECT_LOGIC = 0x02          # OUT: logic program (write)
+SEG_DIR_READ = 0x00
+SEG_DIR_WRITE = 0x01
+SEG_ACK_FLAG_ABORT = 0x01
+SEG_DATA_HEADER_SIZE = 5         # [transfer id][offset:4]
+SEG_RESULT_OK = 0x00
+SEG_RESULT_PENDING = 0x01
+SEG_RESULT_CRC = 0x05
+SEG_RESULT_NAMES = {
+    0x00: "ok", 0x01: "pending", 0x02: "no such object", 0x03: "transfer not open",
+    0x04: "bad size", 0x05: "CRC32 mismatch", 0x06: "rejected by the object",
+    -1: "no response",
+}
+
+STREAM_SET_DI = 0x01             # DIO: input states
+STREAM_SET_DO = 0x02             # OUT: output states
+STREAM_SET_ANALOG = 0x03         # 420: raw 4-20mA then voltage values
+STREAM_SET_NAMES = {STREAM_SET_DI: "inputs", STREAM_SET_DO: "outputs", STREAM_SET_ANALOG: "analog"}
+STREAM_DATA_HEADER_SIZE = 11     # [data set][sequence:2][sample time us:8]
+STREAM_STATUS_ENTRY_SIZE = 22
+STREAM_RESULT_NAMES = {0: "ok", 1: "no such data set", 2: "no free stream", 3: "offset not within the period"}
+
+
+@dataclass
+class StreamSample:
+    """One publication (CMD_STREAM_DATA)"""
+    source: int
+    data_set: int
+    sequence: int
+    sample_time_us: int
+    data: bytes
+    
+    @classmethod
+    def from_packet(cls, packet: 'RS485Packet'):
+        if len(packet.data) < STREAM_DATA_HEADER_SIZE:
+            raise ValueError("Invalid stream data length")
+        data_set, sequence, sample_time_us = struct.unpack('<BHQ', packet.data[:STREAM_DATA_HEADER_SIZE])
+        return cls(packet.src_addr, data_set, sequence, sample_time_us,
+                   bytes(packet.data[STREAM_DATA_HEADER_SIZE:]))
+
+
+@dataclass
+class StreamInfo:
+    """Active stream on a controller (CMD_STREAM_STATUS)"""
+    data_set: int
+    subscriber: int
+    period_ms: int
+    offset_ms: int
+    deadband: int
+    sequence: int
+    published: int
+    suppressed: int
+    overruns: int
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        return cls(*struct.unpack('<BBHHHHIII', data[:STREAM_STATUS_ENTRY_SIZE]))
+
+TIME_SYNC_FLAG_FOLLOW_UP = 0x01
+TIME_SYNC_STATE_NAMES = {0: "free", 1: "locking", 2: "synced", 3: "holdover"}
+
+@dataclass
+class TimeSyncStatus:
+    """Bus clock synchronization (CMD_GET_TELEMETRY, time section)"""
+    state: int                  # TIME_SYNC_STATE_NAMES
+    samples: int
+    steps: int
+    last_error_us: int          # Master minus bus clock at the last sample
+    max_error_us: int           # Largest |error| while synced
+    drift_ppb: int              # Local oscillator correction
+    bus_time_us: int            # When the response was built
+    age_ms: int                 # Since the last sample
+    
+    @property
+    def state_name(self) -> str:
+        return TIME_SYNC_STATE_NAMES.get(self.state, f"state {self.state}")
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < 33:
+            raise ValueError("Invalid time sync length")
+        return cls(*struct.unpack('<BIIiIiQI', data[:33]))
+
+BUS_ACCESS_MODE_NAMES = {0: "CSMA", 1: "TDMA"}
+
+@dataclass
+class BusAccessStatus:
+    """Bus access for unsolicited frames (CMD_GET_TELEMETRY, bus section)"""
+    mode: int                   # BUS_ACCESS_MODE_NAMES
+    own_slots: int              # Slots of this node in the last beacon
+    cycle_ms: int               # 0 in CSMA
+    beacon_age_ms: int
+    beacons: int
+    fallbacks: int              # TDMA to CSMA on beacon loss
+    slot_frames: int            # Frames sent in an own slot
+    csma_frames: int            # Frames sent after carrier sense
+    backoffs: int
+    collisions_tdma: int        # Frames failing CRC/end byte, per mode
+    collisions_csma: int
+    
+    @property
+    def mode_name(self) -> str:
+        return BUS_ACCESS_MODE_NAMES.get(self.mode, f"mode {self.mode}")
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        if len(data) < 36:
+            raise ValueError("Invalid bus access length")
+        return cls(*struct.unpack('<BBHI7I', data[:36]))
+
+@dataclass
+class GatewayRoute:
+    """CAN-FD node reachable through the gateway"""
+    address: int
+    age_s: int                  # Seconds since the node last answered
+    forwarded: int              # Requests forwarded to the node
+    timeouts: int
+
+@dataclass
+class GatewayRoutes:
+    """Gateway routing table and counters (CMD_GET_ROUTES, 0x01 only)"""
+    forwarded: int
+    relayed: int
+    timeouts: int
+    no_route: int
+    busy: int
+    routes: list                # GatewayRoute
+    
+    @staticmethod
+    def parse_page(data: bytes):
+        """Parse one routes response: (total, header counters, routes)"""
+        if len(data) < 23 or len(data) < 23 + data[2] * 9:
+            raise ValueError("Invalid routes length")
+        
+        total, _, count = data[0], data[1], data[2]
+        counters = struct.unpack('<5I', data[3:23])
+        routes = []
+        for i in range(count):
+            address, age_s, forwarded, timeouts = struct.unpack('<BHIH', data[23 + i * 9:32 + i * 9])
+            routes.append(GatewayRoute(address, age_s, forwarded, timeouts))
+        return total, counters, routes
+
+@dataclass
+class ProtocolTelemetry:
+    """RS485 protocol telemetry (CMD_GET_TELEMETRY)"""
+    version: int
+    counters: dict                  # Name -> count, see TELEMETRY_COUNTER_NAMES
+    rx_buffer_high_water: int
+    debug_ring_high_water: int
+    frame_queue_high_water: Optional[int]       # None from older firmware
+    event_queue_high_water: Optional[int]       # CAN-FD event queue
+    command_counts: dict            # Command code -> requests
+    turnaround_count: int
+    turnaround_min_us: int
+    turnaround_max_us: int
+    turnaround_total_us: int
+    turnaround_histogram: list      # Bin n: [2^(n-1), 2^n) us, last bin open
+    
+    @property
+    def turnaround_mean_us(self) -> float:
+        return self.turnaround_total_us / self.turnaround_count if self.turnaround_count else 0.0
+    
+    def turnaround_percentile(self, p: float) -> float:
+        """Estimate a turnaround percentile (us) from the log2 histogram"""
+        if self.turnaround_count == 0:
+            return 0.0
+        rank = p / 100.0 * self.turnaround_count
+        cumulative = 0
+        for n, bin_count in enumerate(self.turnaround_histogram):
+            if bin_count and cumulative + bin_count >= rank:
+                low = 0 if n == 0 else 1 << (n - 1)
+                high = 0 if n == 0 else 1 << n
+                value = low + (high - low) * (rank - cumulative) / bin_count
+                return min(max(value, self.turnaround_min_us), self.turnaround_max_us)
+            cumulative += bin_count
+        return float(self.turnaround_max_us)
+
+TELEMETRY_SECTION_COUNTERS = 0
+TELEMETRY_SECTION_COMMANDS = 1
+TELEMETRY_SECTION_TURNAROUND = 2
+TELEMETRY_SECTION_TIME = 3
+TELEMETRY_SECTION_BUS = 4
+TELEMETRY_MAX_COMMANDS = 48
+TELEMETRY_COUNTER_NAMES = [
+    "rx_frames", "tx_frames", "crc_errors", "framing_errors", "noise_errors",
+    "overrun_errors", "parity_errors", "end_byte_errors", "parser_timeouts",
+    "buffer_overflows", "foreign_frames", "broadcast_frames", "rx_during_tx",
+    "tx_errors", "unknown_commands", "uptime_s", "debug_dropped",
+]
+
+@dataclass
+class HealthReport:
+    """Computed health score and its inputs (CMD_GET_HEALTH)"""
+    window_s: int                   # Sliding window of the rate totals
+    overall: int                    # 0-100%, lowest component
+    scores: dict                    # Component name -> 0-100%, see HEALTH_COMPONENT_NAMES
+    rx_frames: int
+    rx_errors: int
+    loop_passes: int
+    loop_overruns: int
+    queue_overflows: int
+    io_samples: int
+    io_missed: int                  # Missed ADC conversion / DI sample slots
+    max_loop_interval_ms: int       # Since boot
+    max_io_lag_ms: int              # Since boot
+    stack_used: int                 # Bytes, high-water mark
+    stack_size: int
+    
+    @property
+    def worst_component(self) -> str:
+        return min(self.scores, key=self.scores.get) if self.scores else ""
+    
+    @classmethod
+    def from_bytes(cls, data: bytes):
+        """Parse health response"""
+        if len(data) < 3 or len(data) < 3 + data[2] + 36:
+            raise ValueError("Invalid health data length")
+        
+        window_s, overall, count = data[0], data[1], data[2]
+        scores = health_scores(data[3:3 + count])
+        totals = struct.unpack('<7I', data[3 + count:31 + count])
+        values = struct.unpack('<4H', data[31 + count:39 + count])
+        
+        return cls(window_s, overall, scores, *totals, *values)
+
+HEALTH_COMPONENT_NAMES = ["rx_errors", "loop_overruns", "queue_overflows", "stack", "io"]
+
+def health_scores(data: bytes) -> dict:
+    """Name the component scores (unknown components get their index)"""
+    return {HEALTH_COMPONENT_NAMES[i] if i < len(HEALTH_COMPONENT_NAMES) else f"component_{i}": score
+            for i, score in enumerate(data)}
+
 class RS485Protocol:
     """
     RS485 Protocol Handler
@@ -167,6 +801,9 @@ class RS485Protocol:
         self.response_handlers: Dict[int, Callable] = {}
         self.pending_responses: Dict[int, Optional[RS485Packet]] = {}
         
+        # DELTA analog format baselines, keyed by (dest_addr, command)
+        self.analog_baselines: Dict[tuple, Optional[list]] = {}
+        
     def connect(self) -> bool:
         """
         Connect to RS485 port
@@ -426,8 +1063,10 @@ class RS485Protocol:
         if packet.dest_addr != self.my_address and packet.dest_addr != RS485_ADDR_BROADCAST:
             return
         
-        # Store response for waiting commands
-        self.pending_responses[packet.src_addr] = packet
+        # Store response for waiting commands (publications and streamed
+        # segments arrive unrequested, they are not responses)
+        if packet.command not in (RS485Command.CMD_STREAM_DATA, RS485Command.CMD_SEG_DATA):
+            self.pending_responses[packet.src_addr] = packet
         
         # Call registered handler
         if packet.command in self.response_handlers:
@@ -485,6 +1124,525 @@ class RS485Protocol:
         
         return None
     
+    def heartbeat_health(self, dest_addr: int) -> Optional[tuple]:
+        """
+        Send heartbeat and decode the health component scores
+        
+        Returns:
+            (mcu_id, health, scores dict), scores is empty for firmware
+            without computed health
+        """
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_HEARTBEAT)
+        
+        if response and response.command == RS485Command.CMD_HEARTBEAT_RESPONSE:
+            data = response.data
+            if len(data) >= 2:
+                count = data[2] if len(data) >= 3 else 0
+                return (data[0], data[1], health_scores(data[3:3 + count]))
+        
+        return None
+    
+    def get_health(self, dest_addr: int) -> Optional[HealthReport]:
+        """Get computed health with component scores and raw metrics"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_GET_HEALTH)
+        
+        if response and response.command == RS485Command.CMD_HEALTH_RESPONSE:
+            try:
+                return HealthReport.from_bytes(response.data)
+            except Exception as e:
+                print(f"Health parse error: {e}")
+        
+        return None
+    
+    # Protocol telemetry
+    
+    def _get_telemetry_section(self, dest_addr: int, section: int,
+                               first: int = 0) -> Optional[bytes]:
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_GET_TELEMETRY,
+                                              bytes([section, first]))
+        
+        if not response or response.command != RS485Command.CMD_TELEMETRY_RESPONSE:
+            return None
+        if len(response.data) < 2 or response.data[1] != section:
+            return None
+        return response.data
+    
+    def get_time_sync(self, dest_addr: int) -> Optional[TimeSyncStatus]:
+        """Read the bus clock synchronization state and error"""
+        data = self._get_telemetry_section(dest_addr, TELEMETRY_SECTION_TIME)
+        if data is None:
+            return None
+        try:
+            return TimeSyncStatus.from_bytes(data[2:])
+        except Exception as e:
+            print(f"Time sync parse error: {e}")
+            return None
+    
+    def get_bus_access(self, dest_addr: int) -> Optional[BusAccessStatus]:
+        """Read the bus access mode and collision counters"""
+        data = self._get_telemetry_section(dest_addr, TELEMETRY_SECTION_BUS)
+        if data is None:
+            return None
+        try:
+            return BusAccessStatus.from_bytes(data[2:])
+        except Exception as e:
+            print(f"Bus access parse error: {e}")
+            return None
+    
+    def time_sync(self, sequence: int, follow_up_us: Optional[int] = None) -> Optional[int]:
+        """
+        Broadcast a TIME_SYNC frame (two-step)
+        
+        Args:
+            sequence: Frame sequence number (0-255)
+            follow_up_us: Send time of the previous frame (sequence - 1), as
+                returned by the previous call; None for the first frame
+            
+        Returns:
+            Send time of this frame (Unix time in us, taken when the last
+            byte has left), None on error
+        """
+        if not self.is_connected():
+            return None
+        
+        data = struct.pack('<BBQ', sequence & 0xFF, TIME_SYNC_FLAG_FOLLOW_UP, follow_up_us or 0)
+        packet = RS485Packet(RS485_ADDR_BROADCAST, self.my_address, RS485Command.CMD_TIME_SYNC, data)
+        encoded = self.encode_packet(packet)
+        
+        try:
+            with self.lock:
+                self.serial.write(encoded)
+                self.serial.flush()
+                sent_us = time.time_ns() // 1000
+                self.tx_count += 1
+            return sent_us
+        except Exception as e:
+            print(f"Send error: {e}")
+            self.error_count += 1
+            return None
+    
+    def bus_beacon(self, cycle_ms: int, slots: list) -> bool:
+        """
+        Broadcast a BUS_BEACON frame (TDMA cycle and slots)
+        
+        The cycle starts at the end of the beacon on every controller. Send
+        one per cycle; after 4 cycles without beacon the controllers fall
+        back to CSMA.
+        
+        Args:
+            cycle_ms: Cycle length in ms, 0 ends TDMA
+            slots: List of (address, start ms, length ms), from the end of the beacon
+            
+        Returns:
+            True if sent
+        """
+        if not self.is_connected():
+            return False
+        
+        data = struct.pack('<HB', cycle_ms, len(slots))
+        for address, start_ms, length_ms in slots:
+            data += struct.pack('<BHH', address, start_ms, length_ms)
+        packet = RS485Packet(RS485_ADDR_BROADCAST, self.my_address, RS485Command.CMD_BUS_BEACON, data)
+        encoded = self.encode_packet(packet)
+        
+        # No pause after the write: the cycle starts when the beacon has left
+        try:
+            with self.lock:
+                self.serial.write(encoded)
+                self.serial.flush()
+                self.tx_count += 1
+            return True
+        except Exception as e:
+            print(f"Send error: {e}")
+            self.error_count += 1
+            return False
+    
+    def _seg_open(self, dest_addr: int, payload: bytes) -> Optional[tuple]:
+        """Open a segmented transfer: (result, transfer id, size, crc32, segment size, window)"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_SEG_OPEN, payload)
+        if not response or response.command != RS485Command.CMD_SEG_OPEN_RESPONSE \
+                or len(response.data) < 12:
+            return None
+        return struct.unpack('<BBIIBB', response.data[:12])
+    
+    def seg_read(self, dest_addr: int, object_id: int, timeout: float = 1.0,
+                 progress: Optional[Callable] = None) -> Tuple[int, bytes]:
+        """
+        Read an object with a segmented transfer (sliding window)
+        
+        Each CMD_SEG_READ acknowledges everything below its first segment and
+        requests the missing segments of the next window, which the
+        controller streams back to back.
+        
+        Args:
+            dest_addr: Destination address
+            object_id: SEG_OBJECT_xxx
+            timeout: Seconds without a segment before a window is requested again
+            progress: Optional callback(bytes received, total)
+            
+        Returns:
+            (result, data): result SEG_RESULT_OK with the object when its
+            CRC32 matched, see SEG_RESULT_NAMES
+        """
+        opened = self._seg_open(dest_addr, struct.pack('<BB', object_id, SEG_DIR_READ))
+        if opened is None:
+            return -1, b''
+        result, transfer_id, size, crc, segment_size, window = opened
+        if result != SEG_RESULT_OK:
+            return result, b''
+        
+        segments = (size + segment_size - 1) // segment_size
+        received: Dict[int, bytes] = {}
+        
+        def on_segment(packet: RS485Packet):
+            if len(packet.data) > SEG_DATA_HEADER_SIZE and packet.data[0] == transfer_id:
+                offset = struct.unpack('<I', packet.data[1:5])[0]
+                received[offset // segment_size] = bytes(packet.data[SEG_DATA_HEADER_SIZE:])
+        
+        previous_handler = self.response_handlers.get(RS485Command.CMD_SEG_DATA)
+        self.register_handler(RS485Command.CMD_SEG_DATA, on_segment)
+        try:
+            first = 0
+            stalls = 0
+            while True:
+                while first < segments and first in received:
+                    first += 1
+                if first >= segments:
+                    break
+                wanted = [n for n in range(first, min(first + window, segments)) if n not in received]
+                bitmap = sum(1 << (n - first) for n in wanted)
+                before = len(received)
+                self.send_packet(dest_addr, RS485Command.CMD_SEG_READ,
+                                 struct.pack('<BHH', transfer_id, first, bitmap))
+                
+                # Wait for the window, restarting the timeout on every segment
+                last_count, last_time = before, time.time()
+                while any(n not in received for n in wanted) and time.time() - last_time < timeout:
+                    if len(received) != last_count:
+                        last_count, last_time = len(received), time.time()
+                    time.sleep(0.005)
+                
+                stalls = stalls + 1 if len(received) == before else 0
+                if stalls >= 3:
+                    return -1, b''
+                if progress:
+                    progress(min(len(received) * segment_size, size), size)
+            
+            # First segment past the end: acknowledges all, closes the transfer
+            self.send_packet(dest_addr, RS485Command.CMD_SEG_READ,
+                             struct.pack('<BHH', transfer_id, segments, 0))
+        finally:
+            if previous_handler:
+                self.register_handler(RS485Command.CMD_SEG_DATA, previous_handler)
+            else:
+                self.response_handlers.pop(RS485Command.CMD_SEG_DATA, None)
+        
+        data = b''.join(received[n] for n in range(segments))[:size]
+        if zlib.crc32(data) != crc:
+            return SEG_RESULT_CRC, data
+        return SEG_RESULT_OK, data
+    
+    def seg_write(self, dest_addr: int, object_id: int, data: bytes,
+                  progress: Optional[Callable] = None) -> Tuple[int, int]:
+        """
+        Write an object with a segmented transfer (sliding window)
+        
+        Streams a window of segments without waiting, then asks with
+        CMD_SEG_ACK which arrived and resends only the missing ones.
+        
+        Returns:
+            (result, object code): SEG_RESULT_OK once the object accepted the
+            data, see SEG_RESULT_NAMES; the object code explains a rejection
+            (e.g. LOGIC_RESULT_NAMES)
+        """
+        opened = self._seg_open(dest_addr, struct.pack('<BBII', object_id, SEG_DIR_WRITE,
+                                                       len(data), zlib.crc32(data)))
+        if opened is None:
+            return -1, 0
+        result, transfer_id, _, _, segment_size, window = opened
+        if result != SEG_RESULT_OK:
+            return result, 0
+        
+        segments = (len(data) + segment_size - 1) // segment_size
+        acknowledged = set()
+        stalls = 0
+        while True:
+            missing = [n for n in range(segments) if n not in acknowledged][:window]
+            with self.lock:
+                for n in missing:
+                    offset = n * segment_size
+                    payload = struct.pack('<BI', transfer_id, offset) + data[offset:offset + segment_size]
+                    self.serial.write(self.encode_packet(
+                        RS485Packet(dest_addr, self.my_address, RS485Command.CMD_SEG_DATA, payload)))
+                    self.tx_count += 1
+                self.serial.flush()
+            
+            response = self.send_command_and_wait(dest_addr, RS485Command.CMD_SEG_ACK,
+                                                  struct.pack('<BB', transfer_id, 0))
+            if not response or response.command != RS485Command.CMD_SEG_ACK_RESPONSE \
+                    or len(response.data) < 7:
+                stalls += 1
+                if stalls >= 3:
+                    return -1, 0
+                continue
+            
+            result, _, next_segment, bitmap, code = struct.unpack('<BBHHB', response.data[:7])
+            if result != SEG_RESULT_PENDING:
+                return result, code
+            
+            before = len(acknowledged)
+            acknowledged.update(range(next_segment))
+            acknowledged.update(next_segment + 1 + n for n in range(16) if bitmap & (1 << n))
+            stalls = stalls + 1 if len(acknowledged) == before else 0
+            if stalls >= 3:
+                self.send_packet(dest_addr, RS485Command.CMD_SEG_ACK,
+                                 struct.pack('<BB', transfer_id, SEG_ACK_FLAG_ABORT))
+                return -1, 0
+            if progress:
+                progress(min(len(acknowledged) * segment_size, len(data)), len(data))
+    
+    def subscribe(self, dest_addr: int, data_set: int, period_ms: int, offset_ms: int = 0,
+                  deadband: int = 0) -> Optional[tuple]:
+        """
+        Subscribe to a data stream (renews an identical subscription)
+        
+        Publications arrive as CMD_STREAM_DATA frames, see register_handler
+        and StreamSample.from_packet. The subscription ends after 60 s
+        unless renewed (subscribe again or get_streams).
+        
+        Args:
+            dest_addr: Destination address
+            data_set: STREAM_SET_xxx
+            period_ms: Publication period, 0 cancels the stream
+            offset_ms: Slot offset within the period (bus time)
+            deadband: 0 publishes every period, else only changes beyond it
+            
+        Returns:
+            (result, period ms, offset ms, active streams): the period is
+            rounded to the controller's scan period; see STREAM_RESULT_NAMES
+        """
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_STREAM_SUBSCRIBE,
+                                              struct.pack('<BHHH', data_set, period_ms, offset_ms, deadband))
+        if not response or response.command != RS485Command.CMD_STREAM_SUBSCRIBE_RESPONSE \
+                or len(response.data) < 7:
+            return None
+        result, _, period, offset, active = struct.unpack('<BBHHB', response.data[:7])
+        return result, period, offset, active
+    
+    def unsubscribe(self, dest_addr: int, data_set: int) -> bool:
+        """Cancel a data stream"""
+        result = self.subscribe(dest_addr, data_set, 0)
+        return result is not None and result[0] == 0
+    
+    def get_streams(self, dest_addr: int) -> Optional[list]:
+        """Read the active streams (renews our subscriptions)"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_STREAM_STATUS)
+        if not response or response.command != RS485Command.CMD_STREAM_STATUS_RESPONSE \
+                or len(response.data) < 1:
+            return None
+        data = response.data
+        return [StreamInfo.from_bytes(data[1 + n * STREAM_STATUS_ENTRY_SIZE:])
+                for n in range(data[0]) if len(data) >= 1 + (n + 1) * STREAM_STATUS_ENTRY_SIZE]
+    
+    def get_telemetry(self, dest_addr: int) -> Optional[ProtocolTelemetry]:
+        """Read all telemetry sections (counters, per-command counts, turnaround)"""
+        data = self._get_telemetry_section(dest_addr, TELEMETRY_SECTION_COUNTERS)
+        count = len(TELEMETRY_COUNTER_NAMES)
+        if not data or len(data) < 2 + count * 4 + 4:
+            return None
+        
+        version = data[0]
+        values = struct.unpack(f'<{count}I', data[2:2 + count * 4])
+        rx_high_water, debug_high_water = struct.unpack('<HH', data[2 + count * 4:6 + count * 4])
+        frame_high_water, event_high_water = (data[6 + count * 4], data[7 + count * 4]) \
+            if len(data) >= 8 + count * 4 else (None, None)
+        
+        command_counts = {}
+        first = 0
+        while first < 256:
+            data = self._get_telemetry_section(dest_addr, TELEMETRY_SECTION_COMMANDS, first)
+            if not data or len(data) < 3:
+                return None
+            entries = data[2]
+            for i in range(entries):
+                command, requests = struct.unpack('<BI', data[3 + i * 5:8 + i * 5])
+                command_counts[command] = requests
+                first = command + 1
+            if entries < TELEMETRY_MAX_COMMANDS:
+                break
+        
+        data = self._get_telemetry_section(dest_addr, TELEMETRY_SECTION_TURNAROUND)
+        if not data or len(data) < 23:
+            return None
+        bins = data[2]
+        turnaround_count, turnaround_min, turnaround_max, turnaround_total = \
+            struct.unpack('<IIIQ', data[3:23])
+        histogram = list(struct.unpack(f'<{bins}I', data[23:23 + bins * 4]))
+        
+        return ProtocolTelemetry(version, dict(zip(TELEMETRY_COUNTER_NAMES, values)),
+                                 rx_high_water, debug_high_water, frame_high_water,
+                                 event_high_water, command_counts,
+                                 turnaround_count, turnaround_min, turnaround_max,
+                                 turnaround_total, histogram)
+    
+    # Cycle counter profiling
+    
+    def get_perf(self, dest_addr: int, index: int = 0, reset: bool = False) -> Optional[tuple]:
+        """
+        Read one profiling probe
+        
+        Args:
+            dest_addr: Destination address
+            index: Probe index
+            reset: Clear all probes after reading
+            
+        Returns:
+            (probe count, PerfProbe) or None
+        """
+        flags = PERF_FLAG_RESET if reset else 0
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_GET_PERF,
+                                              bytes([index, flags]))
+        
+        if not response or response.command != RS485Command.CMD_PERF_RESPONSE:
+            return None
+        
+        data = response.data
+        if len(data) < PERF_RESPONSE_HEADER_SIZE:
+            return None
+        
+        (index, probe_count, cpu_mhz, probe_id, command, count,
+         min_cycles, max_cycles, total_cycles, bins) = struct.unpack('<BBHBBIIIQB', data[0:27])
+        histogram = list(struct.unpack(f'<{bins}I', data[27:27 + bins * 4]))
+        
+        return probe_count, PerfProbe(index, probe_id, command, cpu_mhz, count,
+                                      min_cycles, max_cycles, total_cycles, histogram)
+    
+    def read_perf(self, dest_addr: int, reset: bool = False) -> Optional[list]:
+        """Read all profiling probes (optionally clearing them afterwards)"""
+        probes = []
+        probe_count = 1
+        while len(probes) < probe_count:
+            result = self.get_perf(dest_addr, len(probes))
+            if result is None:
+                return probes if probes else None
+            probe_count, probe = result
+            probes.append(probe)
+        
+        if reset:
+            self.get_perf(dest_addr, 0, reset=True)
+        
+        return probes
+    
+    def get_task(self, dest_addr: int, index: int = 0, reset: bool = False) -> Optional[tuple]:
+        """
+        Read the statistics of one scheduler task
+        
+        Returns:
+            (task count, SchedTask) or None
+        """
+        flags = SCHED_FLAG_RESET if reset else 0
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_GET_TASKS,
+                                              bytes([index, flags]))
+        
+        if not response or response.command != RS485Command.CMD_TASKS_RESPONSE:
+            return None
+        
+        data = response.data
+        if len(data) < SCHED_RESPONSE_HEADER_SIZE:
+            return None
+        
+        (index, task_count, cpu_mhz, task_type, parameter, runs, missed, max_late,
+         min_cycles, max_cycles, total_cycles, max_latency, priority,
+         kernel) = struct.unpack('<BBHBIIIIIIQIBB', data[0:43])
+        name = data[43:].decode('ascii', 'replace')
+        periodic = task_type == 0
+        
+        return task_count, SchedTask(index, name, periodic,
+                                     parameter if periodic else 0,
+                                     0 if periodic else parameter,
+                                     cpu_mhz, runs, missed, max_late,
+                                     min_cycles, max_cycles, total_cycles,
+                                     max_latency, priority, kernel)
+    
+    def read_tasks(self, dest_addr: int, reset: bool = False) -> Optional[list]:
+        """Read all scheduler tasks (optionally clearing the statistics afterwards)"""
+        tasks = []
+        task_count = 1
+        while len(tasks) < task_count:
+            result = self.get_task(dest_addr, len(tasks))
+            if result is None:
+                return tasks if tasks else None
+            task_count, task = result
+            tasks.append(task)
+        
+        if reset:
+            self.get_task(dest_addr, 0, reset=True)
+        
+        return tasks
+    
+    def get_boot_times(self, dest_addr: int) -> Optional[BootProfile]:
+        """Get the boot phase timestamps and reset cause"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_GET_BOOT_TIMES)
+        
+        if response and response.command == RS485Command.CMD_BOOT_TIMES_RESPONSE:
+            try:
+                return BootProfile.from_bytes(response.data)
+            except Exception as e:
+                print(f"Boot times parse error: {e}")
+        
+        return None
+    
+    def sync(self, sequence: int) -> bool:
+        """Broadcast SYNC: every controller latches its snapshot (no response)"""
+        return self.send_packet(RS485_ADDR_BROADCAST, RS485Command.CMD_SYNC,
+                                struct.pack('<H', sequence & 0xFFFF))
+    
+    def read_snapshot(self, dest_addr: int) -> Optional[SyncSnapshot]:
+        """Read the image frozen by the last SYNC"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_READ_SNAPSHOT)
+        
+        if response and response.command == RS485Command.CMD_SNAPSHOT_RESPONSE:
+            try:
+                return SyncSnapshot.from_bytes(response.data)
+            except Exception as e:
+                print(f"Snapshot parse error: {e}")
+        
+        return None
+    
+    def get_sync_mode(self, dest_addr: int, mode: Optional[int] = None) -> Optional[SyncStatus]:
+        """Read the SYNC statistics, optionally set the output mode first"""
+        data = bytes([mode]) if mode is not None else b''
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_SYNC_MODE, data)
+        
+        if response and response.command == RS485Command.CMD_SYNC_MODE_RESPONSE:
+            try:
+                return SyncStatus.from_bytes(response.data)
+            except Exception as e:
+                print(f"Sync status parse error: {e}")
+        
+        return None
+    
+    def get_routes(self, dest_addr: int, discover: bool = False) -> Optional[GatewayRoutes]:
+        """Get the CAN-FD gateway routing table (all pages)"""
+        flags = GATEWAY_ROUTES_FLAG_DISCOVER if discover else 0
+        routes = []
+        
+        while True:
+            response = self.send_command_and_wait(dest_addr, RS485Command.CMD_GET_ROUTES,
+                                                  bytes([flags, len(routes)]))
+            if not response or response.command != RS485Command.CMD_ROUTES_RESPONSE:
+                return None
+            try:
+                total, counters, page = GatewayRoutes.parse_page(response.data)
+            except Exception as e:
+                print(f"Routes parse error: {e}")
+                return None
+            
+            routes.extend(page)
+            flags = 0
+            if not page or len(routes) >= total:
+                return GatewayRoutes(*counters, routes)
+    
     def read_digital_inputs(self, dest_addr: int) -> Optional[bytes]:
         """Read digital inputs"""
         response = self.send_command_and_wait(dest_addr, RS485Command.CMD_READ_DI)
@@ -508,39 +1666,221 @@ class RS485Protocol:
         
         return None
     
-    def read_analog_420mA(self, dest_addr: int) -> Optional[list]:
-        """Read 26x 4-20mA analog inputs"""
-        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_READ_ANALOG_420)
+    def get_di_routes(self, dest_addr: int, routes: Optional[list] = None) -> Optional[DiRoutes]:
+        """Read the peer routing table of an input controller, or replace it (list of DiRoute)"""
+        payload = b''
+        if routes is not None:
+            payload = bytes([len(routes)]) + b''.join(route.to_bytes() for route in routes)
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_DI_ROUTES, payload)
         
-        if response and response.command == RS485Command.CMD_ANALOG_420_RESPONSE:
-            # Parse 26 channels * 6 bytes each (2 raw + 4 float)
-            channels = []
-            for i in range(26):
-                offset = i * 6
-                if offset + 6 <= len(response.data):
-                    raw = struct.unpack('<H', response.data[offset:offset+2])[0]
-                    current = struct.unpack('<f', response.data[offset+2:offset+6])[0]
-                    channels.append({'raw': raw, 'current_mA': current})
-            return channels
+        if response and response.command == RS485Command.CMD_DI_ROUTES_RESPONSE:
+            try:
+                return DiRoutes.from_bytes(response.data)
+            except Exception as e:
+                print(f"DI routes parse error: {e}")
+        return None
+    
+    def set_di_routes(self, dest_addr: int, routes: list) -> Optional[DiRoutes]:
+        """Replace the peer routing table of an input controller"""
+        return self.get_di_routes(dest_addr, routes)
+    
+    def _do_map(self, dest_addr: int, payload: bytes) -> Optional[DoMap]:
+        """Send a CMD_DO_MAP operation, parse the table"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_DO_MAP, payload)
         
+        if response and response.command == RS485Command.CMD_DO_MAP_RESPONSE:
+            try:
+                return DoMap.from_bytes(response.data)
+            except Exception as e:
+                print(f"DO map parse error: {e}")
         return None
     
-    def read_analog_voltage(self, dest_addr: int) -> Optional[list]:
-        """Read 6x 0-10V analog inputs"""
-        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_READ_ANALOG_VOLTAGE)
+    def get_do_map(self, dest_addr: int) -> Optional[DoMap]:
+        """Read the input mapping table of an output controller"""
+        return self._do_map(dest_addr, bytes([DO_MAP_OP_READ]))
+    
+    def set_do_map(self, dest_addr: int, entries: list) -> Optional[DoMap]:
+        """Replace the input mapping table of an output controller (list of DoMapEntry)"""
+        payload = bytes([DO_MAP_OP_SET, len(entries)]) + b''.join(entry.to_bytes() for entry in entries)
+        return self._do_map(dest_addr, payload)
+    
+    def clear_do_latches(self, dest_addr: int) -> Optional[DoMap]:
+        """Clear the latched outputs of an output controller"""
+        return self._do_map(dest_addr, bytes([DO_MAP_OP_CLEAR_LATCHES]))
+    
+    def logic_download(self, dest_addr: int, code: bytes) -> Tuple[int, int]:
+        """
+        Download and activate a logic program (OUT controller)
         
-        if response and response.command == RS485Command.CMD_ANALOG_VOLTAGE_RESPONSE:
-            # Parse 6 channels * 6 bytes each
-            channels = []
-            for i in range(6):
+        Returns:
+            (result, error offset): result 0 when the program runs from the
+            next scan, see LOGIC_RESULT_NAMES; -1 when the controller did
+            not answer
+        """
+        offset = 0
+        while offset < len(code):
+            block = code[offset:offset + LOGIC_BLOCK_SIZE]
+            response = self.send_command_and_wait(dest_addr, RS485Command.CMD_LOGIC_DOWNLOAD,
+                                                  struct.pack('<H', offset) + block)
+            if not response or response.command != RS485Command.CMD_LOGIC_DOWNLOAD_RESPONSE \
+                    or len(response.data) < 3:
+                return -1, offset
+            result, next_offset = response.data[0], struct.unpack('<H', response.data[1:3])[0]
+            if result != 0:
+                return result, offset
+            offset = next_offset
+        
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_LOGIC_ACTIVATE,
+                                              struct.pack('<HH', len(code), self.calculate_crc(code)))
+        if not response or response.command != RS485Command.CMD_LOGIC_ACTIVATE_RESPONSE \
+                or len(response.data) < 3:
+            return -1, 0
+        return response.data[0], struct.unpack('<H', response.data[1:3])[0]
+    
+    def get_logic_status(self, dest_addr: int, operation: int = LOGIC_CTRL_READ) -> Optional[LogicStatus]:
+        """Read the logic engine status, optionally run/stop/reset statistics first"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_LOGIC_STATUS,
+                                              bytes([operation]))
+        
+        if response and response.command == RS485Command.CMD_LOGIC_STATUS_RESPONSE:
+            try:
+                return LogicStatus.from_bytes(response.data)
+            except Exception as e:
+                print(f"Logic status parse error: {e}")
+        return None
+    
+    def logic_bench(self, dest_addr: int) -> Optional[LogicBench]:
+        """Time 1000 logic instructions on the controller"""
+        response = self.send_command_and_wait(dest_addr, RS485Command.CMD_LOGIC_BENCH)
+        
+        if response and response.command == RS485Command.CMD_LOGIC_BENCH_RESPONSE \
+                and len(response.data) >= 12:
+            return LogicBench(*struct.unpack('<3I', response.data[:12]))
+        return None
+    
+    def _read_analog(self, dest_addr: int, command: RS485Command, 
+                     response_command: RS485Command, count: int, fmt: AnalogFormat,
+                     value_key: str, raw_to_value: Callable) -> Optional[list]:
+        """
+        Read analog channels in the requested wire format
+        
+        Args:
+            dest_addr: Destination address
+            command: Read command code
+            response_command: Expected response code
+            count: Number of channels
+            fmt: Wire format (AnalogFormat)
+            value_key: Dictionary key for the engineering value
+            raw_to_value: Nominal raw-to-engineering conversion
+            
+        Returns:
+            list of channel dicts or None
+        """
+        key = (dest_addr, command)
+        request = b''
+        if fmt != AnalogFormat.LEGACY:
+            flags = 0
+            if fmt == AnalogFormat.DELTA and self.analog_baselines.get(key) is None:
+                flags |= ANALOG_FLAG_KEYFRAME
+            request = struct.pack('BB', fmt, flags)
+        
+        response = self.send_command_and_wait(dest_addr, command, request)
+        
+        if not response or response.command != response_command:
+            # A lost DELTA frame invalidates the baseline
+            self.analog_baselines[key] = None
+            return None
+        
+        try:
+            return self._decode_analog(key, response.data, count, fmt, 
+                                       value_key, raw_to_value)
+        except (struct.error, ValueError, IndexError) as e:
+            print(f"Analog decode error: {e}")
+            self.analog_baselines[key] = None
+            return None
+    
+    def _decode_analog(self, key: tuple, data: bytes, count: int, fmt: AnalogFormat,
+                       value_key: str, raw_to_value: Callable) -> list:
+        """Decode an analog response payload"""
+        channels = []
+        
+        if fmt == AnalogFormat.LEGACY:
+            # count channels * 6 bytes each (2 raw + 4 float)
+            for i in range(count):
                 offset = i * 6
-                if offset + 6 <= len(response.data):
-                    raw = struct.unpack('<H', response.data[offset:offset+2])[0]
-                    voltage = struct.unpack('<f', response.data[offset+2:offset+6])[0]
-                    channels.append({'raw': raw, 'voltage_V': voltage})
+                if offset + 6 <= len(data):
+                    raw, value = struct.unpack('<Hf', data[offset:offset+6])
+                    channels.append({'raw': raw, value_key: value})
             return channels
         
-        return None
+        if len(data) < ANALOG_FORMAT_HEADER_SIZE:
+            raise ValueError("Missing analog format header")
+        
+        resp_fmt, resp_count, param = struct.unpack('BBB', data[0:3])
+        if resp_fmt != fmt or resp_count != count:
+            raise ValueError(f"Unexpected analog header {resp_fmt}/{resp_count}")
+        payload = data[ANALOG_FORMAT_HEADER_SIZE:]
+        
+        if fmt == AnalogFormat.RAW16:
+            for raw in struct.unpack(f'<{count}H', payload[:count * 2]):
+                channels.append({'raw': raw, value_key: raw_to_value(raw)})
+        
+        elif fmt == AnalogFormat.SCALED16:
+            exponent = struct.unpack('b', bytes([param]))[0]
+            scale = 10.0 ** exponent
+            for units in struct.unpack(f'<{count}h', payload[:count * 2]):
+                channels.append({'raw': None, value_key: units * scale})
+        
+        elif fmt == AnalogFormat.PACKED12:
+            for word in struct.unpack(f'<{count}H', payload[:count * 2]):
+                raw = (word & 0x0FFF) << 4
+                channels.append({'raw': raw, value_key: raw_to_value(raw),
+                                 'status': word >> 12})
+        
+        elif fmt == AnalogFormat.DELTA:
+            if param & ANALOG_FLAG_KEYFRAME:
+                baseline = [0] * count
+            else:
+                baseline = self.analog_baselines.get(key)
+                if baseline is None:
+                    raise ValueError("DELTA frame without baseline")
+            
+            offset = 0
+            values = []
+            for i in range(count):
+                zigzag, shift = 0, 0
+                while True:
+                    b = payload[offset]
+                    offset += 1
+                    zigzag |= (b & 0x7F) << shift
+                    shift += 7
+                    if not b & 0x80:
+                        break
+                delta = (zigzag >> 1) ^ -(zigzag & 1)
+                values.append((baseline[i] + delta) & 0xFFFF)
+            
+            self.analog_baselines[key] = values
+            for raw in values:
+                channels.append({'raw': raw, value_key: raw_to_value(raw)})
+        
+        else:
+            raise ValueError(f"Unknown analog format {fmt}")
+        
+        return channels
+    
+    def read_analog_420mA(self, dest_addr: int, 
+                          fmt: AnalogFormat = AnalogFormat.LEGACY) -> Optional[list]:
+        """Read 26x 4-20mA analog inputs"""
+        return self._read_analog(dest_addr, RS485Command.CMD_READ_ANALOG_420,
+                                 RS485Command.CMD_ANALOG_420_RESPONSE, 26, fmt,
+                                 'current_mA', raw_to_mA)
+    
+    def read_analog_voltage(self, dest_addr: int, 
+                            fmt: AnalogFormat = AnalogFormat.LEGACY) -> Optional[list]:
+        """Read 6x 0-10V analog inputs"""
+        return self._read_analog(dest_addr, RS485Command.CMD_READ_ANALOG_VOLTAGE,
+                                 RS485Command.CMD_ANALOG_VOLTAGE_RESPONSE, 6, fmt,
+                                 'voltage_V', raw_to_volts)
     
     def read_ntc_temperatures(self, dest_addr: int) -> Optional[list]:
         """Read 4x NTC temperature sensors"""
@@ -0,0 +1,136 @@
+"""
+Data stream monitor (CMD_STREAM_xxx)
+
+Subscribes to the data sets of the controllers instead of polling them.
+Each controller gets its own slot offset within the period, so with the bus
+clocks synchronized (time_master.py) the publications do not overlap. The
+monitor checks the sequence numbers for lost publications and reports how
+much of the bus time carried useful data.
+
+Usage:
+    python stream_monitor.py COM5                         (all data sets, 100 ms)
+    python stream_monitor.py COM5 --period 50 --duration 30
+    python stream_monitor.py COM5 --sets analog --deadband 20
+    python stream_monitor.py COM5 --status
+"""
+
+import argparse
+import sys
+import threading
+import time
+
+from rs485_protocol import (RS485Protocol, RS485Command, MCU_NAMES, RS485_ADDR_CONTROLLER_420,
+                            RS485_ADDR_CONTROLLER_DIO, RS485_ADDR_CONTROLLER_OUT, STREAM_SET_DI,
+                            STREAM_SET_DO, STREAM_SET_ANALOG, STREAM_SET_NAMES, STREAM_RESULT_NAMES,
+                            StreamSample)
+
+DATA_SETS = {
+    "inputs": (RS485_ADDR_CONTROLLER_DIO, STREAM_SET_DI),
+    "analog": (RS485_ADDR_CONTROLLER_420, STREAM_SET_ANALOG),
+    "outputs": (RS485_ADDR_CONTROLLER_OUT, STREAM_SET_DO),
+}
+FRAME_OVERHEAD = 8          # Start, header, CRC and end bytes
+RENEW_INTERVAL_S = 20       # Subscriptions expire after 60 s
+
+
+class StreamStats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.received = {}      # (source, data set) -> count
+        self.lost = {}
+        self.last_sequence = {}
+        self.payload_bytes = 0
+        self.wire_bytes = 0
+
+    def on_packet(self, packet):
+        sample = StreamSample.from_packet(packet)
+        key = (sample.source, sample.data_set)
+        with self.lock:
+            previous = self.last_sequence.get(key)
+            if previous is not None:
+                self.lost[key] = self.lost.get(key, 0) + ((sample.sequence - previous - 1) & 0xFFFF)
+            self.last_sequence[key] = sample.sequence
+            self.received[key] = self.received.get(key, 0) + 1
+            self.payload_bytes += len(sample.data)
+            self.wire_bytes += len(packet.data) + FRAME_OVERHEAD
+
+
+def print_status(protocol):
+    for name, (address, _) in DATA_SETS.items():
+        streams = protocol.get_streams(address)
+        controller = MCU_NAMES.get(address, f"0x{address:02X}")
+        if streams is None:
+            print(f"{controller:<16} no response")
+            continue
+        if not streams:
+            print(f"{controller:<16} no streams")
+        for stream in streams:
+            print(f"{controller:<16} {STREAM_SET_NAMES.get(stream.data_set, stream.data_set)} to "
+                  f"0x{stream.subscriber:02X} every {stream.period_ms} ms at +{stream.offset_ms} ms, "
+                  f"{stream.published} published, {stream.suppressed} unchanged, "
+                  f"{stream.overruns} overruns")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Publish/subscribe data stream monitor")
+    parser.add_argument("port", help="RS485 serial port")
+    parser.add_argument("--sets", nargs="+", choices=list(DATA_SETS), default=list(DATA_SETS),
+                        help="data sets to subscribe (default: all)")
+    parser.add_argument("--period", type=int, default=100, help="publication period in ms (default: 100)")
+    parser.add_argument("--deadband", type=int, default=0,
+                        help="publish changes only: raw analog step / any bit change (default: 0, every period)")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds to monitor (default: 10)")
+    parser.add_argument("--status", action="store_true", help="show the active streams only")
+    args = parser.parse_args()
+
+    protocol = RS485Protocol(args.port)
+    if not protocol.connect():
+        print(f"Cannot open {args.port}")
+        return 1
+
+    stats = StreamStats()
+    try:
+        if args.status:
+            print_status(protocol)
+            return 0
+
+        protocol.register_handler(RS485Command.CMD_STREAM_DATA, stats.on_packet)
+        subscribed = []
+        for index, name in enumerate(args.sets):
+            address, data_set = DATA_SETS[name]
+            offset = index * args.period // len(args.sets)
+            result = protocol.subscribe(address, data_set, args.period, offset, args.deadband)
+            if result is None or result[0] != 0:
+                reason = "no response" if result is None else STREAM_RESULT_NAMES.get(result[0], result[0])
+                print(f"{name}: not subscribed ({reason})")
+                continue
+            print(f"{name}: every {result[1]} ms at +{result[2]} ms")
+            subscribed.append((name, address, data_set))
+
+        start = time.time()
+        next_renew = start + RENEW_INTERVAL_S
+        while time.time() - start < args.duration:
+            time.sleep(0.1)
+            if time.time() >= next_renew:
+                for _, address, _ in subscribed:
+                    protocol.get_streams(address)
+                next_renew += RENEW_INTERVAL_S
+        elapsed = time.time() - start
+
+        for name, address, data_set in subscribed:
+            protocol.unsubscribe(address, data_set)
+            key = (address, data_set)
+            print(f"{name:<8} {stats.received.get(key, 0)} received, {stats.lost.get(key, 0)} lost")
+        print(f"Useful data {stats.payload_bytes / elapsed:.0f} B/s, "
+              f"{stats.wire_bytes / elapsed:.0f} B/s on the wire, "
+              f"{stats.wire_bytes / elapsed / (protocol.baudrate / 10) * 100:.1f}% of the bus")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        protocol.disconnect()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
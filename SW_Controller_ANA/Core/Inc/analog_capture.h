@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file           : analog_capture.h
+ * @brief          : Triggered Waveform Capture for Analog Inputs
+ ******************************************************************************
+ * @attention
+ *
+ * Records selected analog channels into a large AXI SRAM buffer:
+ * - Channel mask, sample rate and pre/post-trigger depth set by the host
+ * - Immediate, threshold (rising/falling) or external (DI edge) trigger
+ * - Capture is read back in fixed-size chunks with offset and CRC
+ *
+ * Frames are pushed from the ADC scan path (DMA conversion complete
+ * callback once the ADC is configured, scan stub until then) at
+ * ANALOG_FRAME_RATE_HZ; lower sample rates are decimated from it.
+ *
+ ******************************************************************************
+ */
+
+#ifndef ANALOG_CAPTURE_H
+#define ANALOG_CAPTURE_H
+
+#include "main.h"
+#include "analog_input_handler.h"
+
+/* Capture Configuration */
+#define CAPTURE_BUFFER_SIZE         (256U * 1024U)  // Bytes, AXI SRAM (D2 SRAM in the RAM configuration)
+#define CAPTURE_CHUNK_SIZE          192             // Bytes per read chunk
+#define CAPTURE_ARM_DATA_SIZE       16              // CMD_CAPTURE_ARM payload
+#define CAPTURE_STATUS_DATA_SIZE    24              // CMD_CAPTURE_STATUS payload
+
+/* Buffer placement: uninitialized AXI SRAM section (see linker script) */
+#define CAPTURE_BUFFER_SECTION      __attribute__((section(".axi_sram_noinit"), aligned(32)))
+
+/* Trigger Sources */
+typedef enum {
+    CAPTURE_TRIGGER_IMMEDIATE = 0,  // Trigger as soon as pre-trigger is filled
+    CAPTURE_TRIGGER_RISING = 1,     // Channel raw value crosses threshold upwards
+    CAPTURE_TRIGGER_FALLING = 2,    // Channel raw value crosses threshold downwards
+    CAPTURE_TRIGGER_EXTERNAL = 3    // DI edge, via AnalogCapture_ExternalTrigger()
+} CaptureTrigger_t;
+
+/* Capture States */
+typedef enum {
+    CAPTURE_STATE_IDLE = 0,
+    CAPTURE_STATE_ARMED = 1,        // Filling pre-trigger, waiting for trigger
+    CAPTURE_STATE_TRIGGERED = 2,    // Recording post-trigger samples
+    CAPTURE_STATE_DONE = 3          // Capture complete, ready for readout
+} CaptureState_t;
+
+/* Capture Configuration (CMD_CAPTURE_ARM payload, little endian) */
+typedef struct {
+    uint32_t channelMask;       // Bit 0-25: 4-20mA, bit 26-31: 0-10V
+    uint32_t sampleRateHz;      // Requested sample rate (up to ANALOG_FRAME_RATE_HZ)
+    uint16_t preTrigger;        // Frames kept before the trigger
+    uint16_t postTrigger;       // Frames recorded after the trigger
+    uint8_t triggerSource;      // CaptureTrigger_t
+    uint8_t triggerChannel;     // Channel index for threshold triggers (0-31)
+    uint16_t threshold;         // Raw ADC threshold
+} CaptureConfig_t;
+
+/* Function Prototypes */
+void AnalogCapture_Init(void);
+HAL_StatusTypeDef AnalogCapture_Arm(const CaptureConfig_t* config);
+void AnalogCapture_Abort(void);
+void AnalogCapture_PushFrame(const uint16_t* raw);
+void AnalogCapture_ExternalTrigger(void);
+CaptureState_t AnalogCapture_GetState(void);
+uint32_t AnalogCapture_GetSize(void);
+uint16_t AnalogCapture_GetStatus(uint8_t* buffer, uint16_t bufferSize);
+uint16_t AnalogCapture_ReadChunk(uint32_t offset, uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* ANALOG_CAPTURE_H */
@@ -22,6 +22,11 @@
 #define NUM_420MA_CHANNELS      26
 #define NUM_VOLTAGE_CHANNELS    6
 #define TOTAL_ANALOG_CHANNELS   (NUM_420MA_CHANNELS + NUM_VOLTAGE_CHANNELS)
+#define NUM_NTC_CHANNELS        4           // Scanned separately (slow channels)
+
+/* Scan Timing: the analog task converts one frame (all channels) per run */
+#define ANALOG_FRAME_PERIOD_MS  100         // Analog task period
+#define ANALOG_FRAME_RATE_HZ    (1000U / ANALOG_FRAME_PERIOD_MS)
 
 /* ADC Configuration */
 #define ADC_RESOLUTION          65535.0f    // 16-bit ADC
@@ -39,6 +44,10 @@
 #define VOLTAGE_MAX_V           10.0f
 #define VOLTAGE_DIVIDER_RATIO   3.03f       // Adjust based on hardware
 
+/* NTC Configuration (table parameters in ntc_table.h) */
+#define NTC_OPEN_CIRCUIT_ADC    65000       // Pull-up only, sensor missing
+#define NTC_SHORT_CIRCUIT_ADC   500         // Sensor shorted to GND
+
 /* Status Codes */
 typedef enum {
     ANALOG_STATUS_OK = 0,
@@ -49,6 +58,29 @@ typedef enum {
     ANALOG_STATUS_ERROR = 5
 } AnalogStatus_t;
 
+/* Wire Formats (selected by first data byte of the analog read commands) */
+typedef enum {
+    ANALOG_FORMAT_LEGACY = 0,       // raw uint16 + float (6 bytes/channel, no header)
+    ANALOG_FORMAT_RAW16 = 1,        // raw uint16 (2 bytes/channel)
+    ANALOG_FORMAT_SCALED16 = 2,     // int16 engineering units x 10^exponent (2 bytes/channel)
+    ANALOG_FORMAT_PACKED12 = 3,     // [status:4][raw >> 4:12] (2 bytes/channel)
+    ANALOG_FORMAT_DELTA = 4         // zigzag varint of raw delta to previous frame (1-3 bytes/channel)
+} AnalogFormat_t;
+
+/* Compact format header: [format][channel count][param] */
+#define ANALOG_FORMAT_HEADER_SIZE   3
+#define ANALOG_SCALED_EXPONENT      (-3)        // uA for 4-20mA, mV for 0-10V
+#define ANALOG_FLAG_KEYFRAME        0x01        // DELTA: values are relative to zero
+
+/* Largest encoded payload (legacy format) */
+#define ANALOG_420_MAX_PAYLOAD      (NUM_420MA_CHANNELS * 6)
+#define ANALOG_VOLTAGE_MAX_PAYLOAD  (NUM_VOLTAGE_CHANNELS * 6)
+#define ANALOG_NTC_PAYLOAD          (NUM_NTC_CHANNELS * 6)
+
+/* Trend History (CMD_READ_HISTORY record payload, int16 per channel) */
+#define ANALOG_HISTORY_INTERVAL_MS  1000
+#define ANALOG_HISTORY_PAYLOAD_SIZE ((TOTAL_ANALOG_CHANNELS + NUM_NTC_CHANNELS) * 2)
+
 /* 4-20mA Data Structure */
 typedef struct {
     uint16_t raw_adc;
@@ -65,10 +97,18 @@ typedef struct {
     AnalogStatus_t status;
 } AnalogVoltage_Channel_t;
 
+/* NTC Data Structure */
+typedef struct {
+    uint16_t raw_adc;
+    int16_t temperature_centi;      // 0.01 degC (fixed point, from lookup table)
+    AnalogStatus_t status;
+} AnalogNTC_Channel_t;
+
 /* Complete Analog Data Structure */
 typedef struct {
     Analog420_Channel_t analog_420[NUM_420MA_CHANNELS];
     AnalogVoltage_Channel_t analog_voltage[NUM_VOLTAGE_CHANNELS];
+    AnalogNTC_Channel_t analog_ntc[NUM_NTC_CHANNELS];
     uint32_t last_update_time;
     uint32_t update_count;
 } AnalogData_t;
@@ -84,6 +124,8 @@ float AnalogInput_Get420mA_Current(uint8_t channel);
 float AnalogInput_Get420mA_Percent(uint8_t channel);
 AnalogStatus_t AnalogInput_Get420mA_Status(uint8_t channel);
 void AnalogInput_GetAll420mA(uint8_t* buffer, uint16_t bufferSize);
+uint16_t AnalogInput_Encode420mA(AnalogFormat_t format, uint8_t flags,
+                                 uint8_t* buffer, uint16_t bufferSize);
 
 /* 0-10V Functions */
 uint16_t AnalogInput_GetVoltage_Raw(uint8_t channel);
@@ -91,6 +133,15 @@ float AnalogInput_GetVoltage_V(uint8_t channel);
 float AnalogInput_GetVoltage_Percent(uint8_t channel);
 AnalogStatus_t AnalogInput_GetVoltage_Status(uint8_t channel);
 void AnalogInput_GetAllVoltage(uint8_t* buffer, uint16_t bufferSize);
+uint16_t AnalogInput_EncodeVoltage(AnalogFormat_t format, uint8_t flags,
+                                   uint8_t* buffer, uint16_t bufferSize);
+
+/* NTC Functions */
+uint16_t AnalogInput_GetNTC_Raw(uint8_t channel);
+float AnalogInput_GetNTC_Temperature(uint8_t channel);
+AnalogStatus_t AnalogInput_GetNTC_Status(uint8_t channel);
+void AnalogInput_GetAllNTC(uint8_t* buffer, uint16_t bufferSize);
+int16_t AnalogInput_NTC_ToCentiCelsius(uint16_t adc_value);
 
 /* Bulk Read */
 void AnalogInput_GetAllData(uint8_t* buffer, uint16_t bufferSize);
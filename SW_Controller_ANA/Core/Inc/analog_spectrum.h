@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ * @file           : analog_spectrum.h
+ * @brief          : Spectral Analysis (FFT / Band Energy) for Analog Inputs
+ ******************************************************************************
+ * @attention
+ *
+ * Optional spectral stage for vibration and ripple monitoring:
+ * - Up to 4 selected channels, block size 64-1024 (power of two)
+ * - Windowed real FFT (Hann or rectangular), single precision
+ * - Per window: overall RMS, peak frequency/amplitude, band energies
+ *
+ * Samples are collected from the ADC frame path at ANALOG_FRAME_RATE_HZ
+ * (decimated to the configured rate), the FFT runs from the main loop
+ * (AnalogSpectrum_Process) so the ADC path stays short.
+ *
+ ******************************************************************************
+ */
+
+#ifndef ANALOG_SPECTRUM_H
+#define ANALOG_SPECTRUM_H
+
+#include "main.h"
+#include "analog_input_handler.h"
+
+/* Spectrum Configuration */
+#define SPECTRUM_MAX_CHANNELS       4
+#define SPECTRUM_MIN_BLOCK          64
+#define SPECTRUM_MAX_BLOCK          1024
+#define SPECTRUM_MAX_BANDS          8
+#define SPECTRUM_CONFIG_HEADER_SIZE 12              // CMD_SPECTRUM_CONFIG without bands
+#define SPECTRUM_BAND_SIZE          4               // [low Hz:2][high Hz:2]
+#define SPECTRUM_RESULT_HEADER_SIZE 16              // [ch][bands][seq:2][rms][peak Hz][peak amp]
+#define SPECTRUM_RESULT_MAX_SIZE    (1 + SPECTRUM_MAX_CHANNELS * \
+                                     (SPECTRUM_RESULT_HEADER_SIZE + SPECTRUM_MAX_BANDS * 4))
+
+/* Window Functions */
+typedef enum {
+    SPECTRUM_WINDOW_RECTANGULAR = 0,
+    SPECTRUM_WINDOW_HANN = 1
+} SpectrumWindow_t;
+
+/* Frequency Band */
+typedef struct {
+    uint16_t lowHz;             // Inclusive
+    uint16_t highHz;            // Exclusive
+} SpectrumBand_t;
+
+/* Spectrum Configuration (CMD_SPECTRUM_CONFIG payload, little endian) */
+typedef struct {
+    uint32_t channelMask;       // Bit 0-25: 4-20mA, bit 26-31: 0-10V (max 4 bits)
+    uint32_t sampleRateHz;      // Requested sample rate (decimated from ANALOG_FRAME_RATE_HZ)
+    uint16_t blockSize;         // FFT length, power of two
+    uint8_t numBands;           // 0-SPECTRUM_MAX_BANDS
+    uint8_t window;             // SpectrumWindow_t
+    SpectrumBand_t bands[SPECTRUM_MAX_BANDS];
+} SpectrumConfig_t;
+
+/* Function Prototypes */
+void AnalogSpectrum_Init(void);
+HAL_StatusTypeDef AnalogSpectrum_Configure(const SpectrumConfig_t* config);
+void AnalogSpectrum_Disable(void);
+void AnalogSpectrum_PushFrame(const float* values);
+void AnalogSpectrum_Process(void);
+uint16_t AnalogSpectrum_GetConfig(uint8_t* buffer, uint16_t bufferSize);
+uint16_t AnalogSpectrum_Read(uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* ANALOG_SPECTRUM_H */
@@ -0,0 +1,57 @@
+/**
+ ******************************************************************************
+ * @file           : analog_stats.h
+ * @brief          : Rolling Statistics for Analog Inputs
+ ******************************************************************************
+ * @attention
+ *
+ * Incremental per-channel statistics, updated once per ADC frame:
+ * - min, max, mean, RMS and standard deviation (Welford)
+ * - sample count
+ * - optional fixed time window, otherwise accumulated until read
+ *
+ * Reads have read-and-reset semantics, so every sample is reported once.
+ *
+ ******************************************************************************
+ */
+
+#ifndef ANALOG_STATS_H
+#define ANALOG_STATS_H
+
+#include "main.h"
+#include "analog_input_handler.h"
+
+/* Statistics Configuration */
+#define STATS_HEADER_SIZE           4       // [first][count][source][reserved]
+#define STATS_CHANNEL_SIZE          24      // min, max, mean, rms, std (float) + count
+#define STATS_MAX_CHANNELS_PER_READ 10      // Fits one RS485 frame
+
+/* Read Flags (CMD_READ_ANALOG_STATS) */
+#define STATS_FLAG_PEEK             0x01    // Read without resetting
+
+/* Statistics Source */
+typedef enum {
+    STATS_SOURCE_RUNNING = 0,       // Accumulated since the last read
+    STATS_SOURCE_WINDOW = 1         // Last completed window
+} StatsSource_t;
+
+/* Per-Channel Statistics */
+typedef struct {
+    float min;
+    float max;
+    float mean;
+    float rms;
+    float stddev;
+    uint32_t count;
+} AnalogStats_t;
+
+/* Function Prototypes */
+void AnalogStats_Init(void);
+void AnalogStats_Update(const float* values);
+void AnalogStats_SetWindow(uint32_t window_ms);
+uint32_t AnalogStats_GetWindow(void);
+void AnalogStats_Get(uint8_t channel, AnalogStats_t* stats);
+uint16_t AnalogStats_Read(uint8_t first, uint8_t count, uint8_t flags,
+                          uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* ANALOG_STATS_H */
@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * @file           : bus_sync.h
+ * @brief          : Bus-Wide SYNC / FREEZE Snapshots
+ ******************************************************************************
+ * @attention
+ *
+ * Polling the controllers one after the other reads their images tens of
+ * milliseconds apart. CMD_SYNC, broadcast by the master (address 0x00, no
+ * response), makes every controller latch its current image into a frozen
+ * snapshot at the same instant: the end byte of the SYNC frame reaches all
+ * nodes together, and the latch delay after it (frame queue to handler) is
+ * measured and reported with the snapshot.
+ *
+ * CMD_READ_SNAPSHOT then returns the frozen image, tagged with the sequence
+ * number of the SYNC that took it, until the next SYNC. The image is the
+ * same on every read: the DIO input states, the raw analog values of the
+ * 420 controller (CAN-FD image layout) or the OUT output states.
+ *
+ * Output mode BUS_SYNC_MODE_ON_SYNC (CMD_SYNC_MODE, controllers with
+ * outputs): outputs written since the previous SYNC are held and applied
+ * at the next one, just before the latch, so all nodes switch together.
+ *
+ ******************************************************************************
+ */
+
+#ifndef BUS_SYNC_H
+#define BUS_SYNC_H
+
+#include "main.h"
+
+/* Bus Sync Configuration */
+#define BUS_SYNC_IMAGE_SIZE         96      // Largest frozen image (bytes)
+#define BUS_SYNC_MAX_GAP            0x8000U // Larger sequence jumps are master restarts
+
+/* Output Modes */
+#define BUS_SYNC_MODE_IMMEDIATE     0       // Outputs written on receipt
+#define BUS_SYNC_MODE_ON_SYNC       1       // Outputs held until the next SYNC
+
+/* CMD_SNAPSHOT_RESPONSE Layout: header then the image */
+#define BUS_SYNC_SNAPSHOT_HEADER_SIZE 9     // [valid][sequence:2][latch delay us:2][age ms:4]
+#define BUS_SYNC_SNAPSHOT_SIZE      (BUS_SYNC_SNAPSHOT_HEADER_SIZE + BUS_SYNC_IMAGE_SIZE)
+
+/* CMD_SYNC_MODE_RESPONSE Layout */
+#define BUS_SYNC_STATUS_SIZE        15      // [mode][sequence:2][syncs:4][missed:4][last delay us:2][max delay us:2]
+
+/* Snapshot capture: copy the current image, return its length */
+typedef uint16_t (*BusSync_Capture_t)(uint8_t* buffer, uint16_t bufferSize);
+
+/* Apply the outputs held since the previous SYNC */
+typedef void (*BusSync_Apply_t)(void);
+
+/* Sync Statistics */
+typedef struct {
+    uint32_t syncs;
+    uint32_t missed;                // Sequence numbers skipped
+    uint16_t lastDelayUs;           // SYNC end byte to latch
+    uint16_t maxDelayUs;
+} BusSync_Stats_t;
+
+/* Function Prototypes */
+void BusSync_Init(BusSync_Capture_t capture, BusSync_Apply_t apply);
+void BusSync_Latch(const uint8_t* data, uint16_t length);
+uint16_t BusSync_ReadSnapshot(uint8_t* buffer, uint16_t bufferSize);
+uint8_t BusSync_SetMode(uint8_t mode);
+uint8_t BusSync_OutputsOnSync(void);
+uint16_t BusSync_ReadStatus(uint8_t* buffer, uint16_t bufferSize);
+const BusSync_Stats_t* BusSync_GetStats(void);
+
+#endif /* BUS_SYNC_H */
@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * @file           : can_gateway.h
+ * @brief          : RS485 to CAN-FD Gateway
+ ******************************************************************************
+ * @attention
+ *
+ * Lets an RS485 master reach I/O nodes that are only on CAN-FD. RS485
+ * frames for addresses GATEWAY_REMOTE_FIRST..GATEWAY_REMOTE_LAST that are
+ * in the routing table are forwarded onto FDCAN1 with the master's source
+ * address. The master's address becomes a CAN-FD proxy of this node, so
+ * the node's response (addressed to the master) is received here and
+ * relayed on RS485 with the node's source address: the master sees the
+ * node as if it were on the serial bus.
+ *
+ * Pipelining: requests are forwarded as soon as they are received, up to
+ * GATEWAY_MAX_PENDING outstanding (any nodes). Responses wait in the relay
+ * queue until the RS485 line is idle, so a master may send several requests
+ * back to back and then collect the responses. A request not answered
+ * within GATEWAY_REQUEST_TIMEOUT_MS gets RS485_ERR_TIMEOUT, one refused
+ * because the pending table is full RS485_ERR_BUSY, both sent with the
+ * node's address as source. Each forwarded request holds a relay queue
+ * slot for its response or timeout error until it is released, so an
+ * accepted request is always answered; without a free slot the request is
+ * refused with RS485_ERR_BUSY.
+ *
+ * Routing table: built from discovery (PING broadcast on CAN-FD at start,
+ * every GATEWAY_DISCOVERY_PERIOD_MS and when a frame for an unknown remote
+ * address is seen), refreshed by every response, dropped after
+ * GATEWAY_ROUTE_TIMEOUT_MS of silence. Read with CMD_GET_ROUTES.
+ *
+ * Broadcasts are not forwarded.
+ *
+ ******************************************************************************
+ */
+
+#ifndef CAN_GATEWAY_H
+#define CAN_GATEWAY_H
+
+#include "main.h"
+#include "rs485_protocol.h"
+
+/* Gateway Configuration */
+#define GATEWAY_ENABLED             1
+#define GATEWAY_REMOTE_FIRST        0x20    // CAN-FD node addresses served through the gateway
+#define GATEWAY_REMOTE_LAST         0xDF
+#define GATEWAY_MAX_ROUTES          32
+#define GATEWAY_MAX_PENDING         8       // Outstanding forwarded requests
+#define GATEWAY_RELAY_QUEUE_SIZE    (GATEWAY_MAX_PENDING + 2)   // One per pending request, one for BUSY, one unused
+#define GATEWAY_REQUEST_TIMEOUT_MS  200
+#define GATEWAY_DISCOVERY_PERIOD_MS 10000
+#define GATEWAY_DISCOVERY_HOLDOFF_MS 1000   // Minimum time between discoveries
+#define GATEWAY_ROUTE_TIMEOUT_MS    35000   // About three missed discoveries
+
+/* CMD_ROUTES_RESPONSE Layout */
+#define GATEWAY_ROUTES_HEADER_SIZE  23
+#define GATEWAY_ROUTE_ENTRY_SIZE    9
+#define GATEWAY_ROUTES_PER_RESPONSE 24
+#define GATEWAY_ROUTES_RESPONSE_SIZE \
+    (GATEWAY_ROUTES_HEADER_SIZE + GATEWAY_ROUTES_PER_RESPONSE * GATEWAY_ROUTE_ENTRY_SIZE)
+#define GATEWAY_ROUTES_FLAG_DISCOVER 0x01   // Request: discover before reading
+
+/* Route (node reachable on CAN-FD) */
+typedef struct {
+    uint8_t active;
+    uint8_t address;
+    uint32_t lastSeen;              // HAL tick of the last response
+    uint32_t forwarded;
+    uint16_t timeouts;
+} Gateway_Route_t;
+
+/* Gateway Statistics */
+typedef struct {
+    uint32_t forwarded;             // Requests sent onto CAN-FD
+    uint32_t relayed;               // Responses sent on RS485
+    uint32_t timeouts;
+    uint32_t noRoute;               // Frames for unknown remote addresses
+    uint32_t busy;                  // Refused: pending table or relay queue full
+    uint32_t unmatched;             // Responses without a pending request (late)
+    uint32_t discoveries;
+} Gateway_Stats_t;
+
+/* Function Prototypes */
+void Gateway_Init(void);
+void Gateway_Process(void);
+void Gateway_Discover(void);
+uint16_t Gateway_ReadRoutes(uint8_t* buffer, uint16_t bufferSize, uint8_t start);
+const Gateway_Stats_t* Gateway_GetStats(void);
+
+#endif /* CAN_GATEWAY_H */
@@ -0,0 +1,159 @@
+/**
+ ******************************************************************************
+ * @file           : canfd_transport.h
+ * @brief          : Controller Protocol over CAN-FD (FDCAN1)
+ ******************************************************************************
+ * @attention
+ *
+ * Carries the RS485 command set over FDCAN1, dispatched through the same
+ * command handlers (RS485_DispatchPacket); responses go back over the
+ * transport the request came in on.
+ *
+ * Bus: 500 kbit/s arbitration, 2.5 Mbit/s data phase (bit rate switching),
+ * 64-byte frames, 25 MHz HSE kernel clock.
+ *
+ * Frame ID (29 bit): [28:26] priority, [15:8] destination, [7:0] source.
+ * The source in the ID keeps IDs unique between senders, so any number of
+ * masters can arbitrate on the bus.
+ *
+ * Message: [command][data], segmented ISO 15765-2 (ISO-TP) style with the
+ * CAN-FD frame sizes; the first byte of every frame is the PCI:
+ * - Single frame:      [0x00][length][message]              (up to 62 bytes)
+ * - First frame:       [0x1L][length low][message]           (length 12 bit)
+ * - Consecutive frame: [0x2N][message]                       (N: sequence)
+ * - Flow control:      [0x3S][block size][STmin]             (S: 0 CTS, 1 WAIT, 2 OVERFLOW)
+ * Events are single frames (CanFd_SendEvent).
+ * Frames are padded with CANFD_PADDING to the next CAN-FD length.
+ *
+ * Message RAM (MX_FDCAN1_Init) and acceptance filtering, so foreign traffic
+ * never reaches the CPU and events never wait behind bulk transfers:
+ * - Extended filters 0-2: priority 0-3 to this node, its group or broadcast
+ *   -> RX FIFO1 (8 elements): events and flow control
+ * - Extended filters 3-5: any other priority to the same destinations
+ *   -> RX FIFO0 (32 elements): commands and segmented (bulk) messages
+ * - Extended filters 6-9: the same pair for up to two proxy addresses
+ *   (CanFd_AddProxy: gateway replies), handed to the proxy's handler
+ * - Standard filters: subscribed process images -> RX FIFO1
+ * - Everything else is rejected by the global filter
+ * FIFO1 is drained in the interrupt (flow control latched, events queued).
+ * FIFO0 is read straight from message RAM by the task: its new message
+ * interrupt is masked until the task has emptied it, the watermark
+ * interrupt counts when the task falls behind.
+ *
+ * Transmit: TX buffer 0 holds this node's process image, TX buffer 1 the
+ * next event or flow control frame, the TX FIFO commands and bulk frames.
+ * The controller sends the pending element with the lowest ID first, so
+ * a queued segmented message cannot hold back an event.
+ *
+ * Process image: periodic state frame (standard ID CANFD_IMAGE_ID, newest
+ * value wins), published with CanFd_PublishImage, received through
+ * CanFd_SubscribeImage.
+ *
+ * Reassembly (up to CANFD_RX_SESSIONS senders at a time) and dispatch run
+ * in the canfd scheduler task, events first.
+ * Sending a segmented message waits for the receiver's flow control
+ * (thread mode only).
+ *
+ ******************************************************************************
+ */
+
+#ifndef CANFD_TRANSPORT_H
+#define CANFD_TRANSPORT_H
+
+#include "main.h"
+
+/* CAN-FD Configuration */
+#define CANFD_ENABLED               1
+#define CANFD_EVENT_QUEUE_SIZE      8       // RX FIFO1 frames waiting for CanFd_Process
+#define CANFD_MAX_MESSAGE_SIZE      256     // [command][data], one RS485 payload
+#define CANFD_RX_FIFO0_WATERMARK    24      // Of RxFifo0ElmtsNbr (32): task falling behind
+#define CANFD_MAX_SUBSCRIPTIONS     4       // Process images received (= StdFiltersNbr)
+#define CANFD_MAX_PROXIES           2       // Addresses relayed for (ExtFiltersNbr = 6 + 2 x proxies)
+#define CANFD_RX_SESSIONS           4       // Segmented messages received at the same time
+#define CANFD_SEGMENT_TIMEOUT_MS    100     // Flow control / consecutive frame wait (N_Bs, N_Cr)
+#define CANFD_TX_TIMEOUT_MS         20      // Wait for a free TX FIFO element
+#define CANFD_IRQ_PRIORITY          5       // Within the kernel range of the RTOS variant
+#define CANFD_PADDING               0xCC
+
+/* Frame ID */
+#define CANFD_ID(priority, dest, src) \
+    (((uint32_t)(priority) << 26) | ((uint32_t)(dest) << 8) | (uint32_t)(src))
+#define CANFD_ID_PRIORITY(id)       (((id) >> 26) & 0x07U)
+#define CANFD_ID_DEST(id)           ((uint8_t)((id) >> 8))
+#define CANFD_ID_SRC(id)            ((uint8_t)(id))
+#define CANFD_ID_DEST_MASK          0x0000FF00U
+#define CANFD_ID_BULK_BIT           0x10000000U     // Priority 4-7
+
+/* Frame Priorities (0 wins arbitration; 0-3 RX FIFO1 / TX buffer, 4-7 RX FIFO0 / TX FIFO) */
+#define CANFD_PRIORITY_EVENT        1       // Events (single frame)
+#define CANFD_PRIORITY_FLOW_CONTROL 2
+#define CANFD_PRIORITY_COMMAND      4       // Single frames
+#define CANFD_PRIORITY_SEGMENT      6       // First and consecutive frames (bulk)
+
+/* Group Addresses (CAN only, one group per controller type) */
+#define CANFD_GROUP_ANALOG          0xE1
+#define CANFD_GROUP_DIGITAL_IN      0xE2
+#define CANFD_GROUP_DIGITAL_OUT     0xE3
+
+/* Process Image (standard ID: after events and flow control, before commands) */
+#define CANFD_IMAGE_ID(src)         (0x200U | (uint32_t)(src))
+#define CANFD_IMAGE_SRC(id)         ((uint8_t)(id))
+#define CANFD_IMAGE_TX_BUFFER       FDCAN_TX_BUFFER0
+#define CANFD_EVENT_TX_BUFFER       FDCAN_TX_BUFFER1
+
+/* Protocol Control Information */
+#define CANFD_PCI_SINGLE            0x00
+#define CANFD_PCI_FIRST             0x10
+#define CANFD_PCI_CONSECUTIVE       0x20
+#define CANFD_PCI_FLOW_CONTROL      0x30
+#define CANFD_FLOW_CTS              0
+#define CANFD_FLOW_WAIT             1
+#define CANFD_FLOW_OVERFLOW         2
+#define CANFD_FRAME_SIZE            64
+#define CANFD_SINGLE_MAX            (CANFD_FRAME_SIZE - 2)
+#define CANFD_FIRST_PAYLOAD         (CANFD_FRAME_SIZE - 2)
+#define CANFD_CONSECUTIVE_PAYLOAD   (CANFD_FRAME_SIZE - 1)
+
+/* Transport Statistics */
+typedef struct {
+    uint32_t rxFrames;
+    uint32_t txFrames;
+    uint32_t rxMessages;            // Complete messages dispatched
+    uint32_t txMessages;
+    uint32_t rxEvents;              // RX FIFO1 frames (events, flow control)
+    uint32_t rxQueueOverflows;      // Event frames dropped, queue full
+    uint32_t eventQueueHighWater;   // Most event frames waiting for CanFd_Process
+    uint32_t rxFifoLost;            // Frames lost in message RAM, FIFO full
+    uint32_t rxWatermarks;          // RX FIFO0 reached CANFD_RX_FIFO0_WATERMARK
+    uint32_t sequenceErrors;        // Consecutive frame out of order
+    uint32_t segmentTimeouts;       // Flow control or consecutive frame missing
+    uint32_t flowOverflows;         // Segmented message refused by the receiver
+    uint32_t txErrors;
+    uint32_t imagesSent;
+    uint32_t imagesReceived;
+    uint32_t imageOverruns;         // Previous image still pending, replaced
+    uint32_t busOff;
+} CanFd_Stats_t;
+
+/* Process Image Handler (task context) */
+typedef void (*CanFd_ImageHandler_t)(uint8_t source, const uint8_t* data, uint8_t length);
+
+/* Proxy Message Handler (task context), message: [command][data] */
+typedef void (*CanFd_MessageHandler_t)(uint8_t source, uint8_t dest, const uint8_t* message,
+                                       uint16_t length);
+
+/* Function Prototypes */
+void CanFd_Init(uint8_t myAddress, uint8_t group);
+void CanFd_Process(void);
+HAL_StatusTypeDef CanFd_Send(uint8_t destAddr, uint8_t command, const uint8_t* data,
+                             uint16_t length);
+HAL_StatusTypeDef CanFd_SendFrom(uint8_t srcAddr, uint8_t destAddr, uint8_t command,
+                                 const uint8_t* data, uint16_t length);
+HAL_StatusTypeDef CanFd_SendEvent(uint8_t destAddr, uint8_t command, const uint8_t* data,
+                                  uint8_t length);
+HAL_StatusTypeDef CanFd_PublishImage(const uint8_t* data, uint8_t length);
+HAL_StatusTypeDef CanFd_SubscribeImage(uint8_t source, CanFd_ImageHandler_t handler);
+HAL_StatusTypeDef CanFd_AddProxy(uint8_t address, CanFd_MessageHandler_t handler);
+const CanFd_Stats_t* CanFd_GetStats(void);
+
+#endif /* CANFD_TRANSPORT_H */
@@ -0,0 +1,38 @@
+/**
+ ******************************************************************************
+ * @file           : history_buffer.h
+ * @brief          : Store-and-Forward Trend History
+ ******************************************************************************
+ * @attention
+ *
+ * Circular buffer of downsampled trend records in the .history section of
+ * the linker script, which also sets its size (_shistory to _ehistory):
+ * - Fixed-size records: [sequence:4][timestamp ms:4][payload]
+ * - Sequence numbers are monotonic, the host backfills from the last
+ *   sequence it has seen after a communication loss
+ * - Oldest records are overwritten when the buffer is full
+ *
+ * The payload layout is defined by the application (see CMD_READ_HISTORY).
+ *
+ ******************************************************************************
+ */
+
+#ifndef HISTORY_BUFFER_H
+#define HISTORY_BUFFER_H
+
+#include "main.h"
+
+/* History Configuration */
+#define HISTORY_RECORD_HEADER_SIZE  8               // [sequence:4][timestamp:4]
+#define HISTORY_RESPONSE_HEADER_SIZE 10             // [oldest:4][newest:4][size][count]
+#define HISTORY_MAX_RESPONSE        240             // Fits one RS485 frame
+
+/* Function Prototypes */
+void History_Init(uint16_t payloadSize, uint32_t interval_ms);
+uint8_t History_IsDue(void);
+void History_Append(const uint8_t* payload);
+uint16_t History_Read(uint32_t fromSequence, uint8_t maxRecords,
+                      uint8_t* buffer, uint16_t bufferSize);
+uint32_t History_GetNewestSequence(void);
+
+#endif /* HISTORY_BUFFER_H */
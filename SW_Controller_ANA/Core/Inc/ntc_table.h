@@ -0,0 +1,29 @@
+/**
+ ******************************************************************************
+ * @file           : ntc_table.h
+ * @brief          : NTC Lookup Table (generated by Scripts/gen_ntc_table.py)
+ ******************************************************************************
+ * @attention
+ *
+ * DO NOT EDIT - regenerate with Scripts/gen_ntc_table.py
+ * R0=10000 Ohm, T0=25 degC, Beta=3950 K, pull-up=10000 Ohm
+ * Max interpolation error <= 0.1 degC in -40..125 degC
+ *
+ ******************************************************************************
+ */
+
+#ifndef NTC_TABLE_H
+#define NTC_TABLE_H
+
+#include <stdint.h>
+
+/* Table Layout */
+#define NTC_TABLE_SHIFT         8       // ADC bits below the table index
+#define NTC_TABLE_SIZE          257     // Entries (0.01 degC)
+#define NTC_TEMP_MIN_CENTI      (-5500)
+#define NTC_TEMP_MAX_CENTI      (15000)
+
+/* Temperature in 0.01 degC, indexed by ADC >> NTC_TABLE_SHIFT */
+extern const int16_t ntcTable[NTC_TABLE_SIZE];
+
+#endif /* NTC_TABLE_H */
@@ -0,0 +1,105 @@
+/**
+ ******************************************************************************
+ * @file           : seg_transfer.h
+ * @brief          : Segmented Transfer of Large Objects (sliding window)
+ ******************************************************************************
+ * @attention
+ *
+ * Moves objects larger than one frame (waveform captures, logic programs)
+ * over the normal frame format. A transfer is opened on a registered
+ * object and gets a transfer ID, the object size and its CRC32. The data
+ * then travels in CMD_SEG_DATA segments of SEG_TRANSFER_SEGMENT_SIZE bytes,
+ * each tagged with the transfer ID and its byte offset.
+ *
+ * Read (controller -> master): CMD_SEG_READ acknowledges all segments
+ * before its first segment and requests up to SEG_TRANSFER_WINDOW segments
+ * from there (bitmap). The controller streams them back to back from
+ * SegTransfer_Process, without a request per segment. Lost segments are
+ * requested again selectively in the next window.
+ *
+ * Write (master -> controller): the master streams up to
+ * SEG_TRANSFER_WINDOW segments, then asks with CMD_SEG_ACK which ones
+ * arrived and resends only the missing ones. The object is committed once
+ * it is complete and its CRC32 matches.
+ *
+ * CRC32: IEEE 802.3 (zlib.crc32 on the master).
+ *
+ ******************************************************************************
+ */
+
+#ifndef SEG_TRANSFER_H
+#define SEG_TRANSFER_H
+
+#include "main.h"
+
+/* Segmented Transfer Configuration */
+#define SEG_TRANSFER_SEGMENT_SIZE   240     // Data bytes per CMD_SEG_DATA frame
+#define SEG_TRANSFER_WINDOW         16      // Segments in flight (bitmap bits)
+#define SEG_TRANSFER_MAX_OBJECTS    4
+#define SEG_TRANSFER_MAX_SEGMENTS   512     // Write objects: up to 120 KB
+#define SEG_TRANSFER_TIMEOUT_MS     10000   // Idle transfer closed after this
+
+/* Object IDs */
+#define SEG_OBJECT_CAPTURE          0x01    // 420: waveform capture, read (analog_capture.h)
+#define SEG_OBJECT_LOGIC            0x02    // OUT: logic program, write (logic_engine.h)
+
+/* Directions (CMD_SEG_OPEN) */
+#define SEG_DIR_READ                0x00
+#define SEG_DIR_WRITE               0x01
+
+/* CMD_SEG_ACK Flags */
+#define SEG_ACK_FLAG_ABORT          0x01
+
+/* Results */
+#define SEG_RESULT_OK               0x00    // Open: transfer ready. Ack: object committed
+#define SEG_RESULT_PENDING          0x01    // Ack: segments missing
+#define SEG_RESULT_NO_OBJECT        0x02    // Unknown object or direction not supported
+#define SEG_RESULT_NO_TRANSFER      0x03    // Transfer ID not open (timed out, superseded)
+#define SEG_RESULT_SIZE             0x04    // Empty or too large
+#define SEG_RESULT_CRC              0x05    // Complete, CRC32 mismatch
+#define SEG_RESULT_REJECTED         0x06    // Object refused the data (code in the response)
+
+/* Layouts */
+#define SEG_TRANSFER_DATA_HEADER    5       // [transfer id][offset:4]
+#define SEG_TRANSFER_OPEN_SIZE      12      // [result][transfer id][size:4][crc32:4][segment size][window]
+#define SEG_TRANSFER_ACK_SIZE       7       // [result][transfer id][next:2][received bitmap:2][object code]
+
+/* Object Callbacks */
+typedef uint32_t (*SegTransfer_Size_t)(void);
+typedef uint16_t (*SegTransfer_Read_t)(uint32_t offset, uint8_t* buffer, uint16_t bufferSize);
+typedef uint8_t (*SegTransfer_Commit_t)(const uint8_t* data, uint32_t size);   // 0 = accepted
+
+/* Object Descriptor (read: size and read, write: buffer and commit) */
+typedef struct {
+    uint8_t id;                     // SEG_OBJECT_xxx
+    SegTransfer_Size_t size;        // Current size, 0 = nothing to read
+    SegTransfer_Read_t read;
+    uint8_t* buffer;                // Receive buffer of write transfers
+    uint32_t capacity;
+    SegTransfer_Commit_t commit;    // Complete object with matching CRC32
+} SegTransfer_Object_t;
+
+/* Transfer Statistics */
+typedef struct {
+    uint32_t transfers;             // Opened
+    uint32_t completed;
+    uint32_t segmentsSent;
+    uint32_t retransmissions;       // Read segments sent again
+    uint32_t segmentsReceived;
+    uint32_t duplicates;            // Write segments received again
+    uint32_t crcErrors;
+    uint32_t timeouts;
+} SegTransfer_Stats_t;
+
+/* Function Prototypes */
+void SegTransfer_Init(void);
+uint8_t SegTransfer_Register(const SegTransfer_Object_t* object);
+void SegTransfer_Process(void);
+uint16_t SegTransfer_Open(const uint8_t* data, uint16_t length, uint8_t* response, uint16_t responseSize);
+uint8_t SegTransfer_RequestWindow(const uint8_t* data, uint16_t length, uint8_t srcAddr);
+void SegTransfer_ReceiveData(const uint8_t* data, uint16_t length);
+uint16_t SegTransfer_Acknowledge(const uint8_t* data, uint16_t length, uint8_t* response, uint16_t responseSize);
+uint32_t SegTransfer_Crc32(uint32_t crc, const uint8_t* data, uint32_t length);
+const SegTransfer_Stats_t* SegTransfer_GetStats(void);
+
+#endif /* SEG_TRANSFER_H */
@@ -0,0 +1,327 @@
+/**
+ ******************************************************************************
+ * @file           : analog_capture.c
+ * @brief          : Triggered Waveform Capture Implementation
+ ******************************************************************************
+ */
+
+#include "analog_capture.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Capture buffer: ring of frames, each frame holds the selected channels */
+static uint16_t captureBuffer[CAPTURE_BUFFER_SIZE / sizeof(uint16_t)] CAPTURE_BUFFER_SECTION;
+
+/* Private Variables */
+static CaptureConfig_t captureConfig;
+static volatile CaptureState_t captureState = CAPTURE_STATE_IDLE;
+static volatile uint8_t externalTriggerPending = 0;
+static uint8_t channelList[TOTAL_ANALOG_CHANNELS];
+static uint8_t numChannels = 0;
+static uint32_t totalFrames = 0;        // Ring size in frames (pre + post)
+static uint32_t writeFrame = 0;         // Next frame slot in ring
+static uint32_t framesStored = 0;       // Frames stored (saturates at totalFrames)
+static uint32_t postRemaining = 0;      // Frames left after trigger
+static uint32_t decimation = 1;         // Frames skipped per stored frame
+static uint32_t decimationCounter = 0;
+static uint32_t triggerTime = 0;
+static uint16_t previousTriggerValue = 0;
+static uint8_t previousTriggerValid = 0;
+
+/* Private Function Prototypes */
+static uint8_t Check_Trigger(const uint16_t* raw);
+static uint32_t Sample_Rate_mHz(void);
+
+/**
+ * @brief  Initialize waveform capture
+ * @retval None
+ */
+void AnalogCapture_Init(void)
+{
+    memset(&captureConfig, 0, sizeof(captureConfig));
+    captureState = CAPTURE_STATE_IDLE;
+    externalTriggerPending = 0;
+    numChannels = 0;
+    totalFrames = 0;
+
+    DEBUG_INFO("Analog Capture initialized (%lu KB buffer)",
+               (uint32_t)(CAPTURE_BUFFER_SIZE / 1024U));
+}
+
+/**
+ * @brief  Arm a new capture (discards any previous capture)
+ * @param  config: Capture configuration
+ * @retval HAL_OK if armed, HAL_ERROR if the configuration is invalid
+ */
+HAL_StatusTypeDef AnalogCapture_Arm(const CaptureConfig_t* config)
+{
+    uint8_t count = 0;
+
+    /* Stop recording before touching the ring */
+    captureState = CAPTURE_STATE_IDLE;
+
+    for (uint8_t ch = 0; ch < TOTAL_ANALOG_CHANNELS; ch++) {
+        if (config->channelMask & (1UL << ch)) {
+            channelList[count++] = ch;
+        }
+    }
+
+    uint32_t frames = (uint32_t)config->preTrigger + config->postTrigger;
+
+    if (count == 0 || config->postTrigger == 0 || config->sampleRateHz == 0 ||
+        config->triggerSource > CAPTURE_TRIGGER_EXTERNAL ||
+        config->triggerChannel >= TOTAL_ANALOG_CHANNELS ||
+        (frames * count * sizeof(uint16_t)) > CAPTURE_BUFFER_SIZE) {
+        DEBUG_WARNING("Capture: invalid configuration");
+        return HAL_ERROR;
+    }
+
+    memcpy(&captureConfig, config, sizeof(captureConfig));
+    numChannels = count;
+    totalFrames = frames;
+    writeFrame = 0;
+    framesStored = 0;
+    postRemaining = config->postTrigger;
+    previousTriggerValid = 0;
+    externalTriggerPending = 0;
+    triggerTime = 0;
+
+    /* Sample rate is derived from the ADC frame rate by decimation */
+    decimation = ANALOG_FRAME_RATE_HZ / config->sampleRateHz;
+    if (decimation == 0) {
+        decimation = 1;
+        DEBUG_WARNING("Capture: %lu Hz above frame rate, sampling at %lu Hz",
+                      config->sampleRateHz, (uint32_t)ANALOG_FRAME_RATE_HZ);
+    }
+    decimationCounter = 0;
+
+    captureState = CAPTURE_STATE_ARMED;
+
+    DEBUG_INFO("Capture armed: %d ch, %lu mHz, pre=%u post=%u trig=%u",
+               numChannels, Sample_Rate_mHz(),
+               config->preTrigger, config->postTrigger, config->triggerSource);
+    return HAL_OK;
+}
+
+/**
+ * @brief  Abort capture and return to idle
+ * @retval None
+ */
+void AnalogCapture_Abort(void)
+{
+    captureState = CAPTURE_STATE_IDLE;
+    externalTriggerPending = 0;
+}
+
+/**
+ * @brief  Push one ADC frame into the capture (ISR safe)
+ * @note   Called once per complete ADC scan with all channels
+ * @param  raw: Raw values of all TOTAL_ANALOG_CHANNELS channels
+ * @retval None
+ */
+void AnalogCapture_PushFrame(const uint16_t* raw)
+{
+    CaptureState_t state = captureState;
+
+    if (state != CAPTURE_STATE_ARMED && state != CAPTURE_STATE_TRIGGERED) {
+        return;
+    }
+
+    if (++decimationCounter < decimation) {
+        return;
+    }
+    decimationCounter = 0;
+
+    /* Store selected channels in the next ring slot */
+    uint16_t* frame = &captureBuffer[writeFrame * numChannels];
+    for (uint8_t i = 0; i < numChannels; i++) {
+        frame[i] = raw[channelList[i]];
+    }
+
+    writeFrame++;
+    if (writeFrame >= totalFrames) {
+        writeFrame = 0;
+    }
+    if (framesStored < totalFrames) {
+        framesStored++;
+    }
+
+    if (state == CAPTURE_STATE_ARMED) {
+        uint8_t triggered = Check_Trigger(raw);
+
+        /* Trigger only counts once the pre-trigger history is complete */
+        if (!triggered || framesStored <= captureConfig.preTrigger) {
+            return;
+        }
+
+        triggerTime = HAL_GetTick();
+        captureState = CAPTURE_STATE_TRIGGERED;
+    }
+
+    /* Trigger frame is the first post-trigger frame */
+    if (--postRemaining == 0) {
+        captureState = CAPTURE_STATE_DONE;
+    }
+}
+
+/**
+ * @brief  Request an external (DI edge) trigger (ISR safe)
+ * @retval None
+ */
+void AnalogCapture_ExternalTrigger(void)
+{
+    if (captureState == CAPTURE_STATE_ARMED &&
+        captureConfig.triggerSource == CAPTURE_TRIGGER_EXTERNAL) {
+        externalTriggerPending = 1;
+    }
+}
+
+/**
+ * @brief  Get capture state
+ * @retval Capture state
+ */
+CaptureState_t AnalogCapture_GetState(void)
+{
+    return captureState;
+}
+
+/**
+ * @brief  Get the size of the completed capture
+ * @retval Bytes readable with AnalogCapture_ReadChunk, 0 if not done
+ */
+uint32_t AnalogCapture_GetSize(void)
+{
+    if (captureState != CAPTURE_STATE_DONE) {
+        return 0;
+    }
+    return totalFrames * numChannels * sizeof(uint16_t);
+}
+
+/**
+ * @brief  Get capture status
+ * @note   Layout: [state][trigger source][channels][reserved]
+ *         [channel mask:4][sample rate mHz:4][pre:2][post:2]
+ *         [capture bytes:4][trigger tick:4]
+ * @param  buffer: Buffer to store status
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written
+ */
+uint16_t AnalogCapture_GetStatus(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < CAPTURE_STATUS_DATA_SIZE) {
+        return 0;
+    }
+
+    CaptureState_t state = captureState;
+    uint32_t sampleRate = (numChannels > 0) ? Sample_Rate_mHz() : 0;
+    uint32_t captureBytes = (state == CAPTURE_STATE_DONE) ?
+                            (totalFrames * numChannels * sizeof(uint16_t)) : 0;
+
+    buffer[0] = (uint8_t)state;
+    buffer[1] = captureConfig.triggerSource;
+    buffer[2] = numChannels;
+    buffer[3] = 0;
+    memcpy(&buffer[4], &captureConfig.channelMask, 4);
+    memcpy(&buffer[8], &sampleRate, 4);
+    memcpy(&buffer[12], &captureConfig.preTrigger, 2);
+    memcpy(&buffer[14], &captureConfig.postTrigger, 2);
+    memcpy(&buffer[16], &captureBytes, 4);
+    memcpy(&buffer[20], &triggerTime, 4);
+
+    return CAPTURE_STATUS_DATA_SIZE;
+}
+
+/**
+ * @brief  Read a chunk of the completed capture
+ * @note   Capture data is frame ordered, oldest frame first, each frame
+ *         holding the selected channels in ascending order (uint16 LE)
+ * @param  offset: Byte offset into the capture
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Maximum number of bytes to read
+ * @retval Number of bytes read (0 = no capture or offset past end)
+ */
+uint16_t AnalogCapture_ReadChunk(uint32_t offset, uint8_t* buffer, uint16_t bufferSize)
+{
+    if (captureState != CAPTURE_STATE_DONE) {
+        return 0;
+    }
+
+    uint32_t frameBytes = numChannels * sizeof(uint16_t);
+    uint32_t ringBytes = totalFrames * frameBytes;
+
+    if (offset >= ringBytes) {
+        return 0;
+    }
+
+    uint32_t length = ringBytes - offset;
+    if (length > bufferSize) {
+        length = bufferSize;
+    }
+
+    /* Ring is full when done: the oldest frame is at the write position */
+    const uint8_t* ring = (const uint8_t*)captureBuffer;
+    uint32_t start = (writeFrame * frameBytes + offset) % ringBytes;
+    uint32_t first = ringBytes - start;
+
+    if (first >= length) {
+        memcpy(buffer, &ring[start], length);
+    } else {
+        memcpy(buffer, &ring[start], first);
+        memcpy(&buffer[first], ring, length - first);
+    }
+
+    return (uint16_t)length;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Evaluate trigger condition for the current frame
+ * @param  raw: Raw values of all channels
+ * @retval 1 if triggered, 0 otherwise
+ */
+static uint8_t Check_Trigger(const uint16_t* raw)
+{
+    uint16_t value = raw[captureConfig.triggerChannel];
+    uint8_t triggered = 0;
+
+    switch (captureConfig.triggerSource) {
+        case CAPTURE_TRIGGER_IMMEDIATE:
+            triggered = 1;
+            break;
+
+        case CAPTURE_TRIGGER_RISING:
+            triggered = previousTriggerValid &&
+                        (previousTriggerValue < captureConfig.threshold) &&
+                        (value >= captureConfig.threshold);
+            break;
+
+        case CAPTURE_TRIGGER_FALLING:
+            triggered = previousTriggerValid &&
+                        (previousTriggerValue > captureConfig.threshold) &&
+                        (value <= captureConfig.threshold);
+            break;
+
+        case CAPTURE_TRIGGER_EXTERNAL:
+            triggered = externalTriggerPending;
+            break;
+
+        default:
+            break;
+    }
+
+    previousTriggerValue = value;
+    previousTriggerValid = 1;
+
+    return triggered;
+}
+
+/**
+ * @brief  Actual sample rate after decimation
+ * @note   In mHz: the frame rate is low and decimation rarely divides it
+ * @retval Sample rate in mHz
+ */
+static uint32_t Sample_Rate_mHz(void)
+{
+    return (ANALOG_FRAME_RATE_HZ * 1000U) / decimation;
+}
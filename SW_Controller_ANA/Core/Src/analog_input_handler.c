@@ -6,6 +6,11 @@
  */
 
 #include "analog_input_handler.h"
+#include "analog_capture.h"
+#include "analog_stats.h"
+#include "analog_spectrum.h"
+#include "history_buffer.h"
+#include "ntc_table.h"
 #include "debug_uart.h"
 #include <string.h>
 #include <math.h>
@@ -22,11 +27,31 @@ static float calibration_420_gain[NUM_420MA_CHANNELS] = {1.0f};
 static float calibration_voltage_offset[NUM_VOLTAGE_CHANNELS] = {0};
 static float calibration_voltage_gain[NUM_VOLTAGE_CHANNELS] = {1.0f};
 
+/* DELTA format baselines (last raw values sent to the host) */
+static uint16_t delta_baseline_420[NUM_420MA_CHANNELS];
+static uint16_t delta_baseline_voltage[NUM_VOLTAGE_CHANNELS];
+static uint8_t delta_baseline_420_valid = 0;
+static uint8_t delta_baseline_voltage_valid = 0;
+
+/* Trend history accumulation (mean over the history interval) */
+static float history_sum[TOTAL_ANALOG_CHANNELS];
+static uint32_t history_frames = 0;
+
 /* Private Function Prototypes */
 static float Convert_ADC_To_420mA(uint16_t adc_value);
 static float Convert_ADC_To_Voltage(uint16_t adc_value);
 static AnalogStatus_t Check_420mA_Status(float current_mA);
 static AnalogStatus_t Check_Voltage_Status(float voltage_V);
+static AnalogStatus_t Check_NTC_Status(uint16_t adc_value);
+static void Update_NTC(void);
+static void Process_Frame(void);
+static void Record_History(const float* value);
+static int16_t Scale_To_Int16(float value);
+static uint16_t Encode_Channels(AnalogFormat_t format, uint8_t flags, uint8_t count,
+                                const uint16_t* raw, const float* value,
+                                const AnalogStatus_t* status,
+                                uint16_t* baseline, uint8_t* baselineValid,
+                                uint8_t* buffer, uint16_t bufferSize);
 
 /**
  * @brief  Initialize analog input handler
@@ -35,6 +60,10 @@ static AnalogStatus_t Check_Voltage_Status(float voltage_V);
 void AnalogInput_Init(void)
 {
     memset(&analogData, 0, sizeof(analogData));
+    delta_baseline_420_valid = 0;
+    delta_baseline_voltage_valid = 0;
+    memset(history_sum, 0, sizeof(history_sum));
+    history_frames = 0;
     
     /* Initialize calibration to unity */
     for (uint8_t i = 0; i < NUM_420MA_CHANNELS; i++) {
@@ -59,6 +88,7 @@ void AnalogInput_Init(void)
 
 /**
  * @brief  Update all analog inputs
+ * @note   Converts one complete frame, called every ANALOG_FRAME_PERIOD_MS
  * @retval None
  */
 void AnalogInput_Update(void)
@@ -68,72 +98,71 @@ void AnalogInput_Update(void)
      * For now, generate simulated test values
      */
     
-    static uint8_t current_channel = 0;
-    uint16_t adc_value = 0;
+    /* One full scan (frame) of all channels per call */
+    for (uint8_t current_channel = 0; current_channel < TOTAL_ANALOG_CHANNELS; current_channel++) {
+        uint16_t adc_value = 0;
     
-    /* Generate simulated ADC value */
-    adc_value = 32768 + (current_channel * 1000);  // Simulated mid-range value
+        /* Generate simulated ADC value */
+        adc_value = 32768 + (current_channel * 1000);  // Simulated mid-range value
     
-    /* STUB: Comment out real ADC code until configured */
-    // HAL_ADC_Start(&hadc1);
-    // if (HAL_ADC_PollForConversion(&hadc1, 10) == HAL_OK) {
-    //     adc_value = HAL_ADC_GetValue(&hadc1);
+        /* STUB: Comment out real ADC code until configured */
+        // HAL_ADC_Start(&hadc1);
+        // if (HAL_ADC_PollForConversion(&hadc1, 10) == HAL_OK) {
+        //     adc_value = HAL_ADC_GetValue(&hadc1);
         
-        /* Route to appropriate channel based on sequencer */
-        if (current_channel < NUM_420MA_CHANNELS) {
-            /* 4-20mA Channel */
-            analogData.analog_420[current_channel].raw_adc = adc_value;
-            analogData.analog_420[current_channel].current_mA = 
-                Convert_ADC_To_420mA(adc_value);
+            /* Route to appropriate channel based on sequencer */
+            if (current_channel < NUM_420MA_CHANNELS) {
+                /* 4-20mA Channel */
+                analogData.analog_420[current_channel].raw_adc = adc_value;
+                analogData.analog_420[current_channel].current_mA = 
+                    Convert_ADC_To_420mA(adc_value);
             
-            /* Apply calibration */
-            analogData.analog_420[current_channel].current_mA = 
-                (analogData.analog_420[current_channel].current_mA + 
-                 calibration_420_offset[current_channel]) * 
-                calibration_420_gain[current_channel];
+                /* Apply calibration */
+                analogData.analog_420[current_channel].current_mA = 
+                    (analogData.analog_420[current_channel].current_mA + 
+                     calibration_420_offset[current_channel]) * 
+                    calibration_420_gain[current_channel];
             
-            /* Scale to percentage */
-            analogData.analog_420[current_channel].scaled_percent = 
-                ((analogData.analog_420[current_channel].current_mA - CURRENT_MIN_MA) / 
-                 (CURRENT_MAX_MA - CURRENT_MIN_MA)) * 100.0f;
+                /* Scale to percentage */
+                analogData.analog_420[current_channel].scaled_percent = 
+                    ((analogData.analog_420[current_channel].current_mA - CURRENT_MIN_MA) / 
+                     (CURRENT_MAX_MA - CURRENT_MIN_MA)) * 100.0f;
             
-            /* Check status */
-            analogData.analog_420[current_channel].status = 
-                Check_420mA_Status(analogData.analog_420[current_channel].current_mA);
-        }
-        else if (current_channel < (NUM_420MA_CHANNELS + NUM_VOLTAGE_CHANNELS)) {
-            /* 0-10V Channel */
-            uint8_t v_ch = current_channel - NUM_420MA_CHANNELS;
-            analogData.analog_voltage[v_ch].raw_adc = adc_value;
-            analogData.analog_voltage[v_ch].voltage_V = 
-                Convert_ADC_To_Voltage(adc_value);
+                /* Check status */
+                analogData.analog_420[current_channel].status = 
+                    Check_420mA_Status(analogData.analog_420[current_channel].current_mA);
+            }
+            else if (current_channel < (NUM_420MA_CHANNELS + NUM_VOLTAGE_CHANNELS)) {
+                /* 0-10V Channel */
+                uint8_t v_ch = current_channel - NUM_420MA_CHANNELS;
+                analogData.analog_voltage[v_ch].raw_adc = adc_value;
+                analogData.analog_voltage[v_ch].voltage_V = 
+                    Convert_ADC_To_Voltage(adc_value);
             
-            /* Apply calibration */
-            analogData.analog_voltage[v_ch].voltage_V = 
-                (analogData.analog_voltage[v_ch].voltage_V + 
-                 calibration_voltage_offset[v_ch]) * 
-                calibration_voltage_gain[v_ch];
+                /* Apply calibration */
+                analogData.analog_voltage[v_ch].voltage_V = 
+                    (analogData.analog_voltage[v_ch].voltage_V + 
+                     calibration_voltage_offset[v_ch]) * 
+                    calibration_voltage_gain[v_ch];
             
-            /* Scale to percentage */
-            analogData.analog_voltage[v_ch].scaled_percent = 
-                (analogData.analog_voltage[v_ch].voltage_V / VOLTAGE_MAX_V) * 100.0f;
+                /* Scale to percentage */
+                analogData.analog_voltage[v_ch].scaled_percent = 
+                    (analogData.analog_voltage[v_ch].voltage_V / VOLTAGE_MAX_V) * 100.0f;
             
-            /* Check status */
-            analogData.analog_voltage[v_ch].status = 
-                Check_Voltage_Status(analogData.analog_voltage[v_ch].voltage_V);
-        }
-    // }  // End of if (HAL_ADC_PollForConversion(...))
-    
-    /* STUB: Comment out until ADC configured */
-    // HAL_ADC_Stop(&hadc1);
+                /* Check status */
+                analogData.analog_voltage[v_ch].status = 
+                    Check_Voltage_Status(analogData.analog_voltage[v_ch].voltage_V);
+            }
+        // }  // End of if (HAL_ADC_PollForConversion(...))
     
-    /* Move to next channel */
-    current_channel++;
-    if (current_channel >= TOTAL_ANALOG_CHANNELS) {
-        current_channel = 0;
-        analogData.last_update_time = HAL_GetTick();
-        analogData.update_count++;
+        /* STUB: Comment out until ADC configured */
+        // HAL_ADC_Stop(&hadc1);
     }
+    
+    analogData.last_update_time = HAL_GetTick();
+    analogData.update_count++;
+    Update_NTC();
+    Process_Frame();
 }
 
 /**
@@ -221,6 +250,32 @@ void AnalogInput_GetAll420mA(uint8_t* buffer, uint16_t bufferSize)
     }
 }
 
+/**
+ * @brief  Encode all 4-20mA channels in the requested wire format
+ * @param  format: Wire format
+ * @param  flags: ANALOG_FLAG_KEYFRAME forces a DELTA keyframe
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 = unknown format or buffer too small)
+ */
+uint16_t AnalogInput_Encode420mA(AnalogFormat_t format, uint8_t flags,
+                                 uint8_t* buffer, uint16_t bufferSize)
+{
+    uint16_t raw[NUM_420MA_CHANNELS];
+    float value[NUM_420MA_CHANNELS];
+    AnalogStatus_t status[NUM_420MA_CHANNELS];
+    
+    for (uint8_t i = 0; i < NUM_420MA_CHANNELS; i++) {
+        raw[i] = analogData.analog_420[i].raw_adc;
+        value[i] = analogData.analog_420[i].current_mA;
+        status[i] = analogData.analog_420[i].status;
+    }
+    
+    return Encode_Channels(format, flags, NUM_420MA_CHANNELS, raw, value, status,
+                           delta_baseline_420, &delta_baseline_420_valid,
+                           buffer, bufferSize);
+}
+
 /**
  * @brief  Get raw ADC value for 0-10V channel
  * @param  channel: Channel number (0-5)
@@ -295,16 +350,111 @@ void AnalogInput_GetAllVoltage(uint8_t* buffer, uint16_t bufferSize)
 }
 
 /**
- * @brief  Get all NTC data (REMOVED - NTC not supported)
+ * @brief  Encode all voltage channels in the requested wire format
+ * @param  format: Wire format
+ * @param  flags: ANALOG_FLAG_KEYFRAME forces a DELTA keyframe
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 = unknown format or buffer too small)
+ */
+uint16_t AnalogInput_EncodeVoltage(AnalogFormat_t format, uint8_t flags,
+                                   uint8_t* buffer, uint16_t bufferSize)
+{
+    uint16_t raw[NUM_VOLTAGE_CHANNELS];
+    float value[NUM_VOLTAGE_CHANNELS];
+    AnalogStatus_t status[NUM_VOLTAGE_CHANNELS];
+    
+    for (uint8_t i = 0; i < NUM_VOLTAGE_CHANNELS; i++) {
+        raw[i] = analogData.analog_voltage[i].raw_adc;
+        value[i] = analogData.analog_voltage[i].voltage_V;
+        status[i] = analogData.analog_voltage[i].status;
+    }
+    
+    return Encode_Channels(format, flags, NUM_VOLTAGE_CHANNELS, raw, value, status,
+                           delta_baseline_voltage, &delta_baseline_voltage_valid,
+                           buffer, bufferSize);
+}
+
+/**
+ * @brief  Get raw ADC value for NTC channel
+ * @param  channel: Channel number (0-3)
+ * @retval Raw ADC value (0-65535)
+ */
+uint16_t AnalogInput_GetNTC_Raw(uint8_t channel)
+{
+    if (channel < NUM_NTC_CHANNELS) {
+        return analogData.analog_ntc[channel].raw_adc;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Get NTC temperature
+ * @param  channel: Channel number (0-3)
+ * @retval Temperature in degC
+ */
+float AnalogInput_GetNTC_Temperature(uint8_t channel)
+{
+    if (channel < NUM_NTC_CHANNELS) {
+        return (float)analogData.analog_ntc[channel].temperature_centi * 0.01f;
+    }
+    return 0.0f;
+}
+
+/**
+ * @brief  Get NTC status
+ * @param  channel: Channel number (0-3)
+ * @retval Status code
+ */
+AnalogStatus_t AnalogInput_GetNTC_Status(uint8_t channel)
+{
+    if (channel < NUM_NTC_CHANNELS) {
+        return analogData.analog_ntc[channel].status;
+    }
+    return ANALOG_STATUS_ERROR;
+}
+
+/**
+ * @brief  Get all NTC data
+ * @note   Layout per channel: raw ADC (uint16) + temperature degC (float)
  * @param  buffer: Buffer to store data
  * @param  bufferSize: Buffer size
  * @retval None
  */
 void AnalogInput_GetAllNTC(uint8_t* buffer, uint16_t bufferSize)
 {
-    (void)buffer;
-    (void)bufferSize;
-    // NTC functionality removed
+    if (bufferSize < ANALOG_NTC_PAYLOAD) {
+        return;
+    }
+    
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < NUM_NTC_CHANNELS; i++) {
+        float temperature = AnalogInput_GetNTC_Temperature(i);
+        memcpy(&buffer[offset], &analogData.analog_ntc[i].raw_adc, 2);
+        offset += 2;
+        memcpy(&buffer[offset], &temperature, 4);
+        offset += 4;
+    }
+}
+
+/**
+ * @brief  Convert NTC ADC value to temperature
+ * @note   Lookup table indexed by the upper ADC bits with fixed-point
+ *         linear interpolation: one shift, two loads, one multiply, no logf.
+ *         Max error vs. the Beta equation <= 0.1 degC in -40..125 degC
+ *         (checked by Scripts/gen_ntc_table.py --verify).
+ * @param  adc_value: Raw ADC value
+ * @retval Temperature in 0.01 degC
+ */
+int16_t AnalogInput_NTC_ToCentiCelsius(uint16_t adc_value)
+{
+    uint32_t index = (uint32_t)adc_value >> NTC_TABLE_SHIFT;
+    int32_t frac = (int32_t)(adc_value & ((1U << NTC_TABLE_SHIFT) - 1U));
+    int32_t t0 = ntcTable[index];
+    int32_t t1 = ntcTable[index + 1];
+    
+    /* Arithmetic shift floors, matching the generator's reference model */
+    return (int16_t)(t0 + (((t1 - t0) * frac) >> NTC_TABLE_SHIFT));
 }
 
 /**
@@ -415,6 +565,117 @@ static float Convert_ADC_To_Voltage(uint16_t adc_value)
     return voltage;
 }
 
+/**
+ * @brief  Update NTC channels (once per scan, sensors are slow)
+ * @retval None
+ */
+static void Update_NTC(void)
+{
+    for (uint8_t i = 0; i < NUM_NTC_CHANNELS; i++) {
+        /* STUB: simulated divider voltage until ADC configured (~25 degC and below) */
+        uint16_t adc_value = 32768 + (i * 2000);
+        
+        analogData.analog_ntc[i].raw_adc = adc_value;
+        analogData.analog_ntc[i].temperature_centi = AnalogInput_NTC_ToCentiCelsius(adc_value);
+        analogData.analog_ntc[i].status = Check_NTC_Status(adc_value);
+    }
+}
+
+/**
+ * @brief  Process one complete scan of all channels (block-processing path)
+ * @note   Runs once per AnalogInput_Update (ANALOG_FRAME_RATE_HZ); with the
+ *         ADC in circular DMA mode, from the conversion complete callback
+ * @retval None
+ */
+static void Process_Frame(void)
+{
+    uint16_t raw[TOTAL_ANALOG_CHANNELS];
+    float value[TOTAL_ANALOG_CHANNELS];
+    
+    for (uint8_t i = 0; i < NUM_420MA_CHANNELS; i++) {
+        raw[i] = analogData.analog_420[i].raw_adc;
+        value[i] = analogData.analog_420[i].current_mA;
+    }
+    for (uint8_t i = 0; i < NUM_VOLTAGE_CHANNELS; i++) {
+        raw[NUM_420MA_CHANNELS + i] = analogData.analog_voltage[i].raw_adc;
+        value[NUM_420MA_CHANNELS + i] = analogData.analog_voltage[i].voltage_V;
+    }
+    
+    AnalogCapture_PushFrame(raw);
+    AnalogStats_Update(value);
+    AnalogSpectrum_PushFrame(value);
+    Record_History(value);
+}
+
+/**
+ * @brief  Accumulate frame and append a trend record when due
+ * @note   Record payload: mean of each 4-20mA / 0-10V channel (int16, uA / mV)
+ *         followed by each NTC temperature (int16, 0.01 degC)
+ * @param  value: Engineering values of all channels
+ * @retval None
+ */
+static void Record_History(const float* value)
+{
+    for (uint8_t i = 0; i < TOTAL_ANALOG_CHANNELS; i++) {
+        history_sum[i] += value[i];
+    }
+    history_frames++;
+    
+    if (!History_IsDue()) {
+        return;
+    }
+    
+    uint8_t payload[ANALOG_HISTORY_PAYLOAD_SIZE];
+    uint16_t offset = 0;
+    
+    for (uint8_t i = 0; i < TOTAL_ANALOG_CHANNELS; i++) {
+        int16_t units = Scale_To_Int16(history_sum[i] / (float)history_frames);
+        memcpy(&payload[offset], &units, 2);
+        offset += 2;
+        history_sum[i] = 0.0f;
+    }
+    for (uint8_t i = 0; i < NUM_NTC_CHANNELS; i++) {
+        memcpy(&payload[offset], &analogData.analog_ntc[i].temperature_centi, 2);
+        offset += 2;
+    }
+    history_frames = 0;
+    
+    History_Append(payload);
+}
+
+/**
+ * @brief  Scale engineering value by 10^-ANALOG_SCALED_EXPONENT
+ * @param  value: Value in mA or V
+ * @retval Value in uA or mV, rounded and saturated to int16
+ */
+static int16_t Scale_To_Int16(float value)
+{
+    float scaled = value * 1000.0f;
+    int32_t units = (int32_t)(scaled + ((scaled >= 0.0f) ? 0.5f : -0.5f));
+    
+    if (units > INT16_MAX) {
+        units = INT16_MAX;
+    } else if (units < INT16_MIN) {
+        units = INT16_MIN;
+    }
+    return (int16_t)units;
+}
+
+/**
+ * @brief  Check NTC status
+ * @param  adc_value: Raw ADC value
+ * @retval Status code
+ */
+static AnalogStatus_t Check_NTC_Status(uint16_t adc_value)
+{
+    if (adc_value >= NTC_OPEN_CIRCUIT_ADC) {
+        return ANALOG_STATUS_OPEN_CIRCUIT;  // Sensor missing / wire break
+    }
+    if (adc_value <= NTC_SHORT_CIRCUIT_ADC) {
+        return ANALOG_STATUS_SHORT_CIRCUIT;
+    }
+    return ANALOG_STATUS_OK;
+}
 
 /**
  * @brief  Check 4-20mA status
@@ -448,5 +709,104 @@ static AnalogStatus_t Check_Voltage_Status(float voltage_V)
     return ANALOG_STATUS_OK;
 }
 
-
-
+/**
+ * @brief  Encode channel values in a wire format
+ * @note   LEGACY has no header. All other formats start with
+ *         [format][count][param] where param is the exponent (SCALED16)
+ *         or the flags (DELTA). A DELTA frame becomes a keyframe when
+ *         requested or when no baseline has been sent yet.
+ * @param  format: Wire format
+ * @param  flags: Request flags
+ * @param  count: Number of channels
+ * @param  raw: Raw ADC values
+ * @param  value: Engineering values (mA or V)
+ * @param  status: Channel status codes
+ * @param  baseline: DELTA baseline (updated)
+ * @param  baselineValid: DELTA baseline valid flag (updated)
+ * @param  buffer: Output buffer
+ * @param  bufferSize: Output buffer size
+ * @retval Number of bytes written (0 on error)
+ */
+static uint16_t Encode_Channels(AnalogFormat_t format, uint8_t flags, uint8_t count,
+                                const uint16_t* raw, const float* value,
+                                const AnalogStatus_t* status,
+                                uint16_t* baseline, uint8_t* baselineValid,
+                                uint8_t* buffer, uint16_t bufferSize)
+{
+    uint16_t offset = 0;
+    
+    if (format == ANALOG_FORMAT_LEGACY) {
+        if (bufferSize < (count * 6)) {
+            return 0;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            memcpy(&buffer[offset], &raw[i], 2);
+            memcpy(&buffer[offset + 2], &value[i], 4);
+            offset += 6;
+        }
+        return offset;
+    }
+    
+    /* Worst case: 3 bytes per channel (DELTA) */
+    uint16_t maxSize = ANALOG_FORMAT_HEADER_SIZE + 
+                       ((format == ANALOG_FORMAT_DELTA) ? (count * 3) : (count * 2));
+    if (format > ANALOG_FORMAT_DELTA || bufferSize < maxSize) {
+        return 0;
+    }
+    
+    buffer[offset++] = (uint8_t)format;
+    buffer[offset++] = count;
+    buffer[offset++] = 0;   // param, filled in below
+    
+    switch (format) {
+        case ANALOG_FORMAT_RAW16:
+            for (uint8_t i = 0; i < count; i++) {
+                buffer[offset++] = raw[i] & 0xFF;
+                buffer[offset++] = (raw[i] >> 8) & 0xFF;
+            }
+            break;
+            
+        case ANALOG_FORMAT_SCALED16:
+            buffer[2] = (uint8_t)(int8_t)ANALOG_SCALED_EXPONENT;
+            for (uint8_t i = 0; i < count; i++) {
+                int16_t units = Scale_To_Int16(value[i]);
+                buffer[offset++] = (uint16_t)units & 0xFF;
+                buffer[offset++] = ((uint16_t)units >> 8) & 0xFF;
+            }
+            break;
+            
+        case ANALOG_FORMAT_PACKED12:
+            for (uint8_t i = 0; i < count; i++) {
+                uint16_t word = (uint16_t)(((uint16_t)status[i] & 0x0F) << 12) | (raw[i] >> 4);
+                buffer[offset++] = word & 0xFF;
+                buffer[offset++] = (word >> 8) & 0xFF;
+            }
+            break;
+            
+        case ANALOG_FORMAT_DELTA:
+            if ((flags & ANALOG_FLAG_KEYFRAME) || !(*baselineValid)) {
+                memset(baseline, 0, count * sizeof(uint16_t));
+                buffer[2] = ANALOG_FLAG_KEYFRAME;
+            }
+            for (uint8_t i = 0; i < count; i++) {
+                int32_t delta = (int32_t)raw[i] - (int32_t)baseline[i];
+                uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+                
+                /* LEB128 varint, 7 bits per byte */
+                do {
+                    uint8_t b = zigzag & 0x7F;
+                    zigzag >>= 7;
+                    buffer[offset++] = zigzag ? (b | 0x80) : b;
+                } while (zigzag);
+                
+                baseline[i] = raw[i];
+            }
+            *baselineValid = 1;
+            break;
+            
+        default:
+            return 0;
+    }
+    
+    return offset;
+}
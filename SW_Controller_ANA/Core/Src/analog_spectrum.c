@@ -0,0 +1,447 @@
+/**
+ ******************************************************************************
+ * @file           : analog_spectrum.c
+ * @brief          : Spectral Analysis Implementation
+ ******************************************************************************
+ */
+
+#include "analog_spectrum.h"
+#include "debug_uart.h"
+#include "scheduler.h"
+#include <string.h>
+#include <math.h>
+
+#define SPECTRUM_PI                 3.14159265358979f
+
+/* Analysis Result (per channel) */
+typedef struct {
+    uint16_t sequence;          // Incremented per analysis window (0 = none yet)
+    float rms;                  // Time-domain RMS of the block
+    float peakHz;               // Interpolated peak frequency (DC excluded)
+    float peakAmplitude;        // Peak sine amplitude
+    float bandPower[SPECTRUM_MAX_BANDS];    // AC mean square per band
+} SpectrumResult_t;
+
+/* Private Variables */
+static SpectrumConfig_t spectrumConfig;
+static volatile uint8_t spectrumEnabled = 0;
+static uint8_t channelList[SPECTRUM_MAX_CHANNELS];
+static uint8_t numChannels = 0;
+static uint16_t blockSize = 0;
+static float sampleRateHz = 0.0f;       // Actual rate after decimation
+static uint32_t decimation = 1;
+static uint32_t decimationCounter = 0;
+static volatile uint16_t sampleCount = 0;
+static volatile uint8_t blockReady = 0;
+
+/* Sample blocks and FFT work buffers */
+static float sampleBuffer[SPECTRUM_MAX_CHANNELS][SPECTRUM_MAX_BLOCK];
+static float fftBuffer[SPECTRUM_MAX_BLOCK];             // N/2 complex, interleaved
+static float binPower[SPECTRUM_MAX_BLOCK / 2 + 1];      // |X[k]|^2, k = 0..N/2
+static float windowTable[SPECTRUM_MAX_BLOCK];
+static float twiddleCos[SPECTRUM_MAX_BLOCK / 2];
+static float twiddleSin[SPECTRUM_MAX_BLOCK / 2];
+static float windowSum = 0.0f;          // Sum of w[n] (amplitude correction)
+static float windowSumSq = 0.0f;        // Sum of w[n]^2 (power correction)
+static uint16_t bandStart[SPECTRUM_MAX_BANDS];
+static uint16_t bandEnd[SPECTRUM_MAX_BANDS];
+static SpectrumResult_t results[SPECTRUM_MAX_CHANNELS];
+
+/* Private Function Prototypes */
+static void Analyze_Channel(uint8_t index);
+static void FFT_Complex(float* data, uint16_t points);
+static void FFT_RealSplit(const float* data, float* power, uint16_t length);
+
+/**
+ * @brief  Initialize spectral analysis (disabled until configured)
+ * @retval None
+ */
+void AnalogSpectrum_Init(void)
+{
+    memset(&spectrumConfig, 0, sizeof(spectrumConfig));
+    memset(results, 0, sizeof(results));
+    spectrumEnabled = 0;
+    numChannels = 0;
+    blockSize = 0;
+
+    DEBUG_INFO("Analog Spectrum initialized (disabled)");
+}
+
+/**
+ * @brief  Configure and enable spectral analysis
+ * @note   Window and twiddle tables are computed here, not per block
+ * @param  config: Spectrum configuration
+ * @retval HAL_OK if enabled, HAL_ERROR if the configuration is invalid
+ */
+HAL_StatusTypeDef AnalogSpectrum_Configure(const SpectrumConfig_t* config)
+{
+    uint8_t count = 0;
+
+    /* Stop sampling before touching the tables */
+    spectrumEnabled = 0;
+
+    for (uint8_t ch = 0; ch < TOTAL_ANALOG_CHANNELS; ch++) {
+        if (config->channelMask & (1UL << ch)) {
+            if (count >= SPECTRUM_MAX_CHANNELS) {
+                DEBUG_WARNING("Spectrum: more than %d channels", SPECTRUM_MAX_CHANNELS);
+                return HAL_ERROR;
+            }
+            channelList[count++] = ch;
+        }
+    }
+
+    uint16_t n = config->blockSize;
+
+    if (count == 0 || config->sampleRateHz == 0 ||
+        n < SPECTRUM_MIN_BLOCK || n > SPECTRUM_MAX_BLOCK || (n & (n - 1)) != 0 ||
+        config->numBands > SPECTRUM_MAX_BANDS ||
+        config->window > SPECTRUM_WINDOW_HANN) {
+        DEBUG_WARNING("Spectrum: invalid configuration");
+        return HAL_ERROR;
+    }
+
+    for (uint8_t b = 0; b < config->numBands; b++) {
+        if (config->bands[b].lowHz >= config->bands[b].highHz) {
+            DEBUG_WARNING("Spectrum: invalid band %d", b);
+            return HAL_ERROR;
+        }
+    }
+
+    memcpy(&spectrumConfig, config, sizeof(spectrumConfig));
+    numChannels = count;
+    blockSize = n;
+
+    /* Sample rate is derived from the ADC frame rate by decimation */
+    decimation = ANALOG_FRAME_RATE_HZ / config->sampleRateHz;
+    if (decimation == 0) {
+        decimation = 1;
+        DEBUG_WARNING("Spectrum: %lu Hz above frame rate, sampling at %lu Hz",
+                      config->sampleRateHz, (uint32_t)ANALOG_FRAME_RATE_HZ);
+    }
+    decimationCounter = 0;
+    sampleRateHz = (float)ANALOG_FRAME_RATE_HZ / (float)decimation;
+
+    /* Window (periodic Hann or rectangular) */
+    windowSum = 0.0f;
+    windowSumSq = 0.0f;
+    for (uint16_t i = 0; i < n; i++) {
+        float w = 1.0f;
+        if (config->window == SPECTRUM_WINDOW_HANN) {
+            w = 0.5f - 0.5f * cosf(2.0f * SPECTRUM_PI * (float)i / (float)n);
+        }
+        windowTable[i] = w;
+        windowSum += w;
+        windowSumSq += w * w;
+    }
+
+    /* Twiddles W_N^k = cos - j sin, shared by the N/2 FFT and the real split */
+    for (uint16_t k = 0; k < n / 2; k++) {
+        twiddleCos[k] = cosf(2.0f * SPECTRUM_PI * (float)k / (float)n);
+        twiddleSin[k] = sinf(2.0f * SPECTRUM_PI * (float)k / (float)n);
+    }
+
+    /* Band edges as bin ranges [start, end) */
+    float binHz = sampleRateHz / (float)n;
+    for (uint8_t b = 0; b < config->numBands; b++) {
+        uint32_t start = (uint32_t)ceilf((float)config->bands[b].lowHz / binHz);
+        uint32_t end = (uint32_t)ceilf((float)config->bands[b].highHz / binHz);
+        bandStart[b] = (uint16_t)((start > n / 2 + 1U) ? (n / 2 + 1U) : start);
+        bandEnd[b] = (uint16_t)((end > n / 2 + 1U) ? (n / 2 + 1U) : end);
+    }
+
+    memset(results, 0, sizeof(results));
+    sampleCount = 0;
+    blockReady = 0;
+    spectrumEnabled = 1;
+
+    DEBUG_INFO("Spectrum enabled: %d ch, N=%u, %lu mHz, %d bands",
+               numChannels, blockSize, (uint32_t)(sampleRateHz * 1000.0f + 0.5f),
+               config->numBands);
+    return HAL_OK;
+}
+
+/**
+ * @brief  Disable spectral analysis
+ * @retval None
+ */
+void AnalogSpectrum_Disable(void)
+{
+    spectrumEnabled = 0;
+    numChannels = 0;
+    spectrumConfig.channelMask = 0;
+}
+
+/**
+ * @brief  Push one frame of engineering values (ISR safe)
+ * @param  values: Values of all TOTAL_ANALOG_CHANNELS channels (mA / V)
+ * @retval None
+ */
+void AnalogSpectrum_PushFrame(const float* values)
+{
+    /* Block is held until the main loop has analyzed it */
+    if (!spectrumEnabled || blockReady) {
+        return;
+    }
+
+    if (++decimationCounter < decimation) {
+        return;
+    }
+    decimationCounter = 0;
+
+    uint16_t index = sampleCount;
+    for (uint8_t i = 0; i < numChannels; i++) {
+        sampleBuffer[i][index] = values[channelList[i]];
+    }
+
+    if (++index >= blockSize) {
+        index = 0;
+        blockReady = 1;
+        Sched_PostEvent(SCHED_EVENT_SPECTRUM_BLOCK);
+    }
+    sampleCount = index;
+}
+
+/**
+ * @brief  Analyze completed blocks (SCHED_EVENT_SPECTRUM_BLOCK task)
+ * @retval None
+ */
+void AnalogSpectrum_Process(void)
+{
+    if (!spectrumEnabled || !blockReady) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < numChannels; i++) {
+        Analyze_Channel(i);
+    }
+
+    /* Release the block, sampling restarts with the next frame */
+    blockReady = 0;
+}
+
+/**
+ * @brief  Get spectrum configuration
+ * @note   Layout: [channel mask:4][sample rate mHz:4][block size:2][bands][window]
+ * @param  buffer: Buffer to store configuration
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written
+ */
+uint16_t AnalogSpectrum_GetConfig(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < SPECTRUM_CONFIG_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint32_t mask = spectrumEnabled ? spectrumConfig.channelMask : 0;
+    uint32_t rate = spectrumEnabled ? (uint32_t)(sampleRateHz * 1000.0f + 0.5f) : 0;
+
+    memcpy(&buffer[0], &mask, 4);
+    memcpy(&buffer[4], &rate, 4);
+    memcpy(&buffer[8], &blockSize, 2);
+    buffer[10] = spectrumConfig.numBands;
+    buffer[11] = spectrumConfig.window;
+
+    return SPECTRUM_CONFIG_HEADER_SIZE;
+}
+
+/**
+ * @brief  Read latest analysis results of all configured channels
+ * @note   Layout: [count], then per channel [channel][bands][sequence:2]
+ *         [rms][peak Hz][peak amplitude] + [band power] x bands (float)
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 = disabled or buffer too small)
+ */
+uint16_t AnalogSpectrum_Read(uint8_t* buffer, uint16_t bufferSize)
+{
+    uint8_t bands = spectrumConfig.numBands;
+    uint16_t recordSize = SPECTRUM_RESULT_HEADER_SIZE + bands * 4;
+
+    if (!spectrumEnabled || bufferSize < (1 + numChannels * recordSize)) {
+        return 0;
+    }
+
+    uint16_t offset = 0;
+    buffer[offset++] = numChannels;
+
+    for (uint8_t i = 0; i < numChannels; i++) {
+        const SpectrumResult_t* result = &results[i];
+
+        buffer[offset] = channelList[i];
+        buffer[offset + 1] = bands;
+        memcpy(&buffer[offset + 2], &result->sequence, 2);
+        memcpy(&buffer[offset + 4], &result->rms, 4);
+        memcpy(&buffer[offset + 8], &result->peakHz, 4);
+        memcpy(&buffer[offset + 12], &result->peakAmplitude, 4);
+        memcpy(&buffer[offset + 16], result->bandPower, bands * 4);
+        offset += recordSize;
+    }
+
+    return offset;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Analyze the completed block of one channel
+ * @param  index: Index into the configured channel list
+ * @retval None
+ */
+static void Analyze_Channel(uint8_t index)
+{
+    const float* x = sampleBuffer[index];
+    SpectrumResult_t* result = &results[index];
+    uint16_t n = blockSize;
+    uint16_t half = n / 2;
+    float sum = 0.0f;
+    float sumSq = 0.0f;
+
+    /* Time-domain RMS (including DC) */
+    for (uint16_t i = 0; i < n; i++) {
+        sum += x[i];
+        sumSq += x[i] * x[i];
+    }
+    result->rms = sqrtf(sumSq / (float)n);
+
+    /* Remove the block mean so window leakage of a loop offset (e.g. 12 mA)
+     * does not mask the AC content, then window into the FFT buffer */
+    float mean = sum / (float)n;
+    for (uint16_t i = 0; i < n; i++) {
+        fftBuffer[i] = (x[i] - mean) * windowTable[i];
+    }
+
+    FFT_Complex(fftBuffer, half);
+    FFT_RealSplit(fftBuffer, binPower, n);
+
+    /* Peak (DC excluded), parabolic interpolation on magnitudes */
+    uint16_t peak = 1;
+    for (uint16_t k = 2; k <= half; k++) {
+        if (binPower[k] > binPower[peak]) {
+            peak = k;
+        }
+    }
+
+    float beta = sqrtf(binPower[peak]);
+    float offsetBins = 0.0f;
+    if (peak < half) {
+        float alpha = sqrtf(binPower[peak - 1]);
+        float gamma = sqrtf(binPower[peak + 1]);
+        float denom = alpha - 2.0f * beta + gamma;
+        if (denom < 0.0f) {
+            offsetBins = 0.5f * (alpha - gamma) / denom;
+            if (offsetBins > 0.5f) {
+                offsetBins = 0.5f;
+            } else if (offsetBins < -0.5f) {
+                offsetBins = -0.5f;
+            }
+            beta -= 0.25f * (alpha - gamma) * offsetBins;
+        }
+    }
+    result->peakHz = ((float)peak + offsetBins) * sampleRateHz / (float)n;
+    result->peakAmplitude = 2.0f * beta / windowSum;
+
+    /* Band power: one-sided, window corrected, sums to the AC mean square */
+    float scale = 1.0f / ((float)n * windowSumSq);
+    for (uint8_t b = 0; b < spectrumConfig.numBands; b++) {
+        float power = 0.0f;
+        for (uint16_t k = bandStart[b]; k < bandEnd[b]; k++) {
+            power += (k == 0 || k == half) ? binPower[k] : 2.0f * binPower[k];
+        }
+        result->bandPower[b] = power * scale;
+    }
+
+    result->sequence++;
+    if (result->sequence == 0) {
+        result->sequence = 1;
+    }
+}
+
+/**
+ * @brief  In-place iterative radix-2 complex FFT
+ * @param  data: Interleaved complex data [re, im] x points
+ * @param  points: Number of complex points (power of two, <= N/2)
+ * @retval None
+ */
+static ITCM_TEXT void FFT_Complex(float* data, uint16_t points)
+{
+    /* Bit-reversal permutation */
+    for (uint16_t i = 1, j = 0; i < points; i++) {
+        uint16_t bit = points >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            float re = data[2 * i];
+            float im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+
+    /* Butterflies; twiddle tables are for length 2 * points */
+    for (uint16_t len = 2; len <= points; len <<= 1) {
+        uint16_t halfLen = len >> 1;
+        uint16_t stride = (uint16_t)((2U * points) / len);
+
+        for (uint16_t i = 0; i < points; i += len) {
+            for (uint16_t k = 0; k < halfLen; k++) {
+                float c = twiddleCos[k * stride];
+                float s = twiddleSin[k * stride];
+                float* u = &data[2 * (i + k)];
+                float* v = &data[2 * (i + k + halfLen)];
+
+                /* v * W, W = c - j s */
+                float vr = v[0] * c + v[1] * s;
+                float vi = v[1] * c - v[0] * s;
+
+                v[0] = u[0] - vr;
+                v[1] = u[1] - vi;
+                u[0] += vr;
+                u[1] += vi;
+            }
+        }
+    }
+}
+
+/**
+ * @brief  Split N/2-point complex FFT of packed real data into N-point spectrum
+ * @note   Input z[n] = x[2n] + j x[2n+1]; output |X[k]|^2 for k = 0..N/2
+ * @param  data: Complex FFT result (N/2 points, interleaved)
+ * @param  power: Output power per bin (N/2 + 1 values)
+ * @param  length: Real FFT length N
+ * @retval None
+ */
+static ITCM_TEXT void FFT_RealSplit(const float* data, float* power, uint16_t length)
+{
+    uint16_t half = length / 2;
+
+    /* DC and Nyquist are real */
+    float dc = data[0] + data[1];
+    float nyquist = data[0] - data[1];
+    power[0] = dc * dc;
+    power[half] = nyquist * nyquist;
+
+    for (uint16_t k = 1; k < half; k++) {
+        float ar = data[2 * k];
+        float ai = data[2 * k + 1];
+        float br = data[2 * (half - k)];
+        float bi = data[2 * (half - k) + 1];
+
+        /* Even / odd sample spectra */
+        float er = 0.5f * (ar + br);
+        float ei = 0.5f * (ai - bi);
+        float or_ = 0.5f * (ai + bi);
+        float oi = -0.5f * (ar - br);
+
+        float c = twiddleCos[k];
+        float s = twiddleSin[k];
+        float xr = er + c * or_ + s * oi;
+        float xi = ei + c * oi - s * or_;
+
+        power[k] = xr * xr + xi * xi;
+    }
+}
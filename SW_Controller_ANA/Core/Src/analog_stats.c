@@ -0,0 +1,233 @@
+/**
+ ******************************************************************************
+ * @file           : analog_stats.c
+ * @brief          : Rolling Statistics Implementation
+ ******************************************************************************
+ */
+
+#include "analog_stats.h"
+#include "debug_uart.h"
+#include <string.h>
+#include <math.h>
+
+/* Welford Accumulator */
+typedef struct {
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float m2;           // Sum of squared differences from the mean
+} StatsAccumulator_t;
+
+/* Private Variables */
+static StatsAccumulator_t running[TOTAL_ANALOG_CHANNELS];
+static StatsAccumulator_t window[TOTAL_ANALOG_CHANNELS];
+static uint32_t windowLength_ms = 0;    // 0 = accumulate until read
+static uint32_t windowStart = 0;
+
+/* Private Function Prototypes */
+static void Accumulator_Reset(StatsAccumulator_t* acc);
+static void Accumulator_ToStats(const StatsAccumulator_t* acc, AnalogStats_t* stats);
+
+/**
+ * @brief  Initialize analog statistics
+ * @retval None
+ */
+void AnalogStats_Init(void)
+{
+    for (uint8_t i = 0; i < TOTAL_ANALOG_CHANNELS; i++) {
+        Accumulator_Reset(&running[i]);
+        Accumulator_Reset(&window[i]);
+    }
+    windowLength_ms = 0;
+    windowStart = HAL_GetTick();
+
+    DEBUG_INFO("Analog Statistics initialized");
+}
+
+/**
+ * @brief  Add one frame of engineering values (block-processing path)
+ * @param  values: Values of all TOTAL_ANALOG_CHANNELS channels (mA / V)
+ * @retval None
+ */
+void AnalogStats_Update(const float* values)
+{
+    for (uint8_t i = 0; i < TOTAL_ANALOG_CHANNELS; i++) {
+        StatsAccumulator_t* acc = &running[i];
+        float x = values[i];
+
+        acc->count++;
+        if (x < acc->min) {
+            acc->min = x;
+        }
+        if (x > acc->max) {
+            acc->max = x;
+        }
+
+        /* Welford: numerically stable running mean and variance */
+        float delta = x - acc->mean;
+        acc->mean += delta / (float)acc->count;
+        acc->m2 += delta * (x - acc->mean);
+    }
+
+    /* Latch completed window */
+    if (windowLength_ms > 0 && (HAL_GetTick() - windowStart) >= windowLength_ms) {
+        windowStart += windowLength_ms;
+        memcpy(window, running, sizeof(window));
+        for (uint8_t i = 0; i < TOTAL_ANALOG_CHANNELS; i++) {
+            Accumulator_Reset(&running[i]);
+        }
+    }
+}
+
+/**
+ * @brief  Set statistics window
+ * @param  window_ms: Window length in ms (0 = accumulate until read)
+ * @retval None
+ */
+void AnalogStats_SetWindow(uint32_t window_ms)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    windowLength_ms = window_ms;
+    windowStart = HAL_GetTick();
+    for (uint8_t i = 0; i < TOTAL_ANALOG_CHANNELS; i++) {
+        Accumulator_Reset(&running[i]);
+        Accumulator_Reset(&window[i]);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Get statistics window
+ * @retval Window length in ms (0 = accumulate until read)
+ */
+uint32_t AnalogStats_GetWindow(void)
+{
+    return windowLength_ms;
+}
+
+/**
+ * @brief  Get statistics of one channel without resetting
+ * @param  channel: Channel number (0-25: 4-20mA, 26-31: 0-10V)
+ * @param  stats: Output statistics
+ * @retval None
+ */
+void AnalogStats_Get(uint8_t channel, AnalogStats_t* stats)
+{
+    StatsAccumulator_t acc;
+
+    if (channel >= TOTAL_ANALOG_CHANNELS) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    acc = (windowLength_ms > 0) ? window[channel] : running[channel];
+    __set_PRIMASK(primask);
+
+    Accumulator_ToStats(&acc, stats);
+}
+
+/**
+ * @brief  Read statistics of a channel range (read-and-reset)
+ * @note   Layout: [first][count][source][reserved], then per channel
+ *         [min][max][mean][rms][stddev] (float) + [count] (uint32)
+ * @param  first: First channel
+ * @param  count: Number of channels (max STATS_MAX_CHANNELS_PER_READ)
+ * @param  flags: STATS_FLAG_PEEK to read without resetting
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 on invalid range)
+ */
+uint16_t AnalogStats_Read(uint8_t first, uint8_t count, uint8_t flags,
+                          uint8_t* buffer, uint16_t bufferSize)
+{
+    if (count == 0 || count > STATS_MAX_CHANNELS_PER_READ ||
+        first >= TOTAL_ANALOG_CHANNELS || (first + count) > TOTAL_ANALOG_CHANNELS ||
+        bufferSize < (STATS_HEADER_SIZE + count * STATS_CHANNEL_SIZE)) {
+        return 0;
+    }
+
+    StatsAccumulator_t snapshot[STATS_MAX_CHANNELS_PER_READ];
+    StatsAccumulator_t* source = (windowLength_ms > 0) ? window : running;
+
+    /* Snapshot and reset atomically so no sample is lost or counted twice */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i < count; i++) {
+        snapshot[i] = source[first + i];
+        if (!(flags & STATS_FLAG_PEEK)) {
+            Accumulator_Reset(&source[first + i]);
+        }
+    }
+    __set_PRIMASK(primask);
+
+    uint16_t offset = 0;
+    buffer[offset++] = first;
+    buffer[offset++] = count;
+    buffer[offset++] = (windowLength_ms > 0) ? STATS_SOURCE_WINDOW : STATS_SOURCE_RUNNING;
+    buffer[offset++] = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        AnalogStats_t stats;
+        Accumulator_ToStats(&snapshot[i], &stats);
+
+        memcpy(&buffer[offset], &stats.min, 4);
+        memcpy(&buffer[offset + 4], &stats.max, 4);
+        memcpy(&buffer[offset + 8], &stats.mean, 4);
+        memcpy(&buffer[offset + 12], &stats.rms, 4);
+        memcpy(&buffer[offset + 16], &stats.stddev, 4);
+        memcpy(&buffer[offset + 20], &stats.count, 4);
+        offset += STATS_CHANNEL_SIZE;
+    }
+
+    return offset;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Reset accumulator
+ * @param  acc: Accumulator
+ * @retval None
+ */
+static void Accumulator_Reset(StatsAccumulator_t* acc)
+{
+    acc->count = 0;
+    acc->min = INFINITY;
+    acc->max = -INFINITY;
+    acc->mean = 0.0f;
+    acc->m2 = 0.0f;
+}
+
+/**
+ * @brief  Convert accumulator to statistics
+ * @param  acc: Accumulator
+ * @param  stats: Output statistics
+ * @retval None
+ */
+static void Accumulator_ToStats(const StatsAccumulator_t* acc, AnalogStats_t* stats)
+{
+    stats->count = acc->count;
+
+    if (acc->count == 0) {
+        stats->min = 0.0f;
+        stats->max = 0.0f;
+        stats->mean = 0.0f;
+        stats->rms = 0.0f;
+        stats->stddev = 0.0f;
+        return;
+    }
+
+    float variance = acc->m2 / (float)acc->count;   // Population variance
+
+    stats->min = acc->min;
+    stats->max = acc->max;
+    stats->mean = acc->mean;
+    stats->rms = sqrtf(acc->mean * acc->mean + variance);
+    stats->stddev = (acc->count > 1) ? sqrtf(acc->m2 / (float)(acc->count - 1)) : 0.0f;
+}
@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file           : boot_profile.c
+ * @brief          : Boot Phase Timestamps Implementation
+ ******************************************************************************
+ */
+
+#include "boot_profile.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Private Variables */
+static uint32_t phaseUs[BOOT_PHASE_COUNT];
+static uint32_t resetFlags = 0;             // RCC_RSR at boot
+static uint32_t lastUs = 0;                 // Time of the last mark
+static uint32_t lastCycles = 0;             // Reset_Handler: CYCCNT = 0
+static uint32_t lastTick = 0;
+static uint32_t lastClockHz = 0;            // Core clock at the last mark
+
+static const char* const phaseNames[BOOT_PHASE_COUNT] = {
+    "main", "clocks", "peripherals", "protocol ready", "first response", "init done"
+};
+
+/**
+ * @brief  Start the boot profile (first statement of main)
+ * @note   Latches and clears the reset cause flags, marks BOOT_PHASE_MAIN
+ * @retval None
+ */
+void Boot_Init(void)
+{
+    memset(phaseUs, 0xFF, sizeof(phaseUs));
+    lastClockHz = SystemCoreClock;
+
+    resetFlags = RCC->RSR;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+
+    Boot_Mark(BOOT_PHASE_MAIN);
+}
+
+/**
+ * @brief  Stamp a boot phase (only the first call per phase counts)
+ * @note   Thread mode only
+ * @param  phase: Boot phase
+ * @retval None
+ */
+void Boot_Mark(BootPhase_t phase)
+{
+    if (phase >= BOOT_PHASE_COUNT || phaseUs[phase] != BOOT_TIME_NONE) {
+        return;
+    }
+
+    uint32_t cycles = DWT->CYCCNT;
+    uint32_t tick = HAL_GetTick();
+
+    if (tick - lastTick >= BOOT_TICK_GUARD_MS) {
+        lastUs += (tick - lastTick) * 1000U;
+    } else {
+        lastUs += (cycles - lastCycles) / (lastClockHz / 1000000U);
+    }
+
+    lastCycles = cycles;
+    lastTick = tick;
+    lastClockHz = SystemCoreClock;
+    phaseUs[phase] = lastUs;
+}
+
+/**
+ * @brief  Get the time of a boot phase
+ * @param  phase: Boot phase
+ * @retval Microseconds since reset, BOOT_TIME_NONE if not reached
+ */
+uint32_t Boot_GetTime(BootPhase_t phase)
+{
+    return (phase < BOOT_PHASE_COUNT) ? phaseUs[phase] : BOOT_TIME_NONE;
+}
+
+/**
+ * @brief  Log the reached boot phases (deferred until init is done)
+ * @retval None
+ */
+void Boot_Log(void)
+{
+    DEBUG_INFO("Boot phases (us since reset, reset flags 0x%08lX):", resetFlags);
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (phaseUs[i] != BOOT_TIME_NONE) {
+            DEBUG_INFO("  %-15s %7lu", phaseNames[i], phaseUs[i]);
+        } else {
+            DEBUG_INFO("  %-15s       -", phaseNames[i]);
+        }
+    }
+}
+
+/**
+ * @brief  Serialize the boot profile (CMD_BOOT_TIMES_RESPONSE payload)
+ * @note   Layout: [phase count][reset flags:4][target us:4][phase us:4 x count],
+ *         BOOT_TIME_NONE for phases not reached yet
+ * @param  buffer: Output buffer
+ * @param  bufferSize: Buffer size (>= BOOT_RESPONSE_SIZE)
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t Boot_Read(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < BOOT_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    const uint32_t target = BOOT_TARGET_US;
+    uint16_t length = 0;
+
+    buffer[length++] = BOOT_PHASE_COUNT;
+    memcpy(&buffer[length], &resetFlags, 4);
+    length += 4;
+    memcpy(&buffer[length], &target, 4);
+    length += 4;
+    memcpy(&buffer[length], phaseUs, sizeof(phaseUs));
+    length += sizeof(phaseUs);
+
+    return length;
+}
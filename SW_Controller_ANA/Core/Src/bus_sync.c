@@ -0,0 +1,179 @@
+/**
+ ******************************************************************************
+ * @file           : bus_sync.c
+ * @brief          : Bus-Wide SYNC / FREEZE Snapshots Implementation
+ ******************************************************************************
+ * @attention
+ *
+ * Latch and reads run in the command handlers (SCHED_PRIORITY_COMM). The
+ * capture runs with interrupts disabled, so the I/O task cannot update the
+ * image halfway through.
+ *
+ ******************************************************************************
+ */
+
+#include "bus_sync.h"
+#include "rs485_protocol.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Private Variables */
+static BusSync_Capture_t captureImage = NULL;
+static BusSync_Apply_t applyOutputs = NULL;
+static uint8_t mode = BUS_SYNC_MODE_IMMEDIATE;
+static uint8_t snapshot[BUS_SYNC_IMAGE_SIZE];
+static uint16_t snapshotLength = 0;
+static uint8_t snapshotValid = 0;
+static uint16_t sequence = 0;
+static uint32_t latchTick = 0;
+static BusSync_Stats_t stats = {0};
+
+/**
+ * @brief  Initialize SYNC handling
+ * @param  capture: Copies the current image (required)
+ * @param  apply: Applies held outputs, NULL on controllers without outputs
+ * @retval None
+ */
+void BusSync_Init(BusSync_Capture_t capture, BusSync_Apply_t apply)
+{
+    captureImage = capture;
+    applyOutputs = apply;
+    mode = BUS_SYNC_MODE_IMMEDIATE;
+    snapshotLength = 0;
+    snapshotValid = 0;
+    sequence = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief  Latch the snapshot (CMD_SYNC handler)
+ * @note   Held outputs are applied first, then the image is captured.
+ *         Any sequence is accepted and followed.
+ * @param  data: [sequence:2] from the master, empty: previous + 1
+ * @param  length: Data length
+ * @retval None
+ */
+void BusSync_Latch(const uint8_t* data, uint16_t length)
+{
+    uint16_t next = (uint16_t)(sequence + 1);
+    if (length >= 2) {
+        memcpy(&next, data, 2);
+    }
+    /* Forward gaps are missed SYNCs; a jump back or by half the sequence
+     * space or more is a master restart: resync without counting */
+    uint16_t gap = (uint16_t)(next - sequence - 1);
+    if (stats.syncs > 0 && gap < BUS_SYNC_MAX_GAP) {
+        stats.missed += gap;
+    }
+
+    if (mode == BUS_SYNC_MODE_ON_SYNC && applyOutputs != NULL) {
+        applyOutputs();
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t latchCycles = DWT->CYCCNT;
+    snapshotLength = captureImage(snapshot, sizeof(snapshot));
+    __set_PRIMASK(primask);
+
+    uint32_t delayUs = (latchCycles - RS485_GetRequestCycles()) / (SystemCoreClock / 1000000U);
+    stats.lastDelayUs = (delayUs > UINT16_MAX) ? UINT16_MAX : (uint16_t)delayUs;
+    if (stats.lastDelayUs > stats.maxDelayUs) {
+        stats.maxDelayUs = stats.lastDelayUs;
+    }
+
+    sequence = next;
+    latchTick = HAL_GetTick();
+    snapshotValid = 1;
+    stats.syncs++;
+}
+
+/**
+ * @brief  Read the frozen snapshot (CMD_SNAPSHOT_RESPONSE)
+ * @note   Layout: [valid][sequence:2][latch delay us:2][age ms:4][image],
+ *         no image before the first SYNC
+ * @param  buffer: Output buffer (BUS_SYNC_SNAPSHOT_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t BusSync_ReadSnapshot(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < BUS_SYNC_SNAPSHOT_SIZE) {
+        return 0;
+    }
+
+    uint32_t age = snapshotValid ? (HAL_GetTick() - latchTick) : 0;
+    uint16_t length = snapshotValid ? snapshotLength : 0;
+
+    buffer[0] = snapshotValid;
+    memcpy(&buffer[1], &sequence, 2);
+    memcpy(&buffer[3], &stats.lastDelayUs, 2);
+    memcpy(&buffer[5], &age, 4);
+    memcpy(&buffer[BUS_SYNC_SNAPSHOT_HEADER_SIZE], snapshot, length);
+
+    return BUS_SYNC_SNAPSHOT_HEADER_SIZE + length;
+}
+
+/**
+ * @brief  Select the output mode (CMD_SYNC_MODE)
+ * @note   Back to BUS_SYNC_MODE_IMMEDIATE: held outputs are applied now
+ * @param  newMode: BUS_SYNC_MODE_xxx
+ * @retval 1 if set, 0 if invalid or the controller has no outputs
+ */
+uint8_t BusSync_SetMode(uint8_t newMode)
+{
+    if (newMode > BUS_SYNC_MODE_ON_SYNC ||
+        (newMode == BUS_SYNC_MODE_ON_SYNC && applyOutputs == NULL)) {
+        return 0;
+    }
+
+    if (mode == BUS_SYNC_MODE_ON_SYNC && newMode == BUS_SYNC_MODE_IMMEDIATE) {
+        applyOutputs();
+    }
+    if (newMode != mode) {
+        DEBUG_INFO("Bus sync: outputs %s", (newMode == BUS_SYNC_MODE_ON_SYNC) ? "on SYNC" : "immediate");
+    }
+    mode = newMode;
+    return 1;
+}
+
+/**
+ * @brief  Check whether written outputs are held until the next SYNC
+ * @retval 1 in BUS_SYNC_MODE_ON_SYNC
+ */
+uint8_t BusSync_OutputsOnSync(void)
+{
+    return mode == BUS_SYNC_MODE_ON_SYNC;
+}
+
+/**
+ * @brief  Read mode and statistics (CMD_SYNC_MODE_RESPONSE)
+ * @note   Layout: [mode][sequence:2][syncs:4][missed:4][last delay us:2][max delay us:2]
+ * @param  buffer: Output buffer (BUS_SYNC_STATUS_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t BusSync_ReadStatus(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < BUS_SYNC_STATUS_SIZE) {
+        return 0;
+    }
+
+    buffer[0] = mode;
+    memcpy(&buffer[1], &sequence, 2);
+    memcpy(&buffer[3], &stats.syncs, 4);
+    memcpy(&buffer[7], &stats.missed, 4);
+    memcpy(&buffer[11], &stats.lastDelayUs, 2);
+    memcpy(&buffer[13], &stats.maxDelayUs, 2);
+
+    return BUS_SYNC_STATUS_SIZE;
+}
+
+/**
+ * @brief  Get sync statistics
+ * @retval Statistics
+ */
+const BusSync_Stats_t* BusSync_GetStats(void)
+{
+    return &stats;
+}
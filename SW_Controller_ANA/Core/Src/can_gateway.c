@@ -0,0 +1,412 @@
+/**
+ ******************************************************************************
+ * @file           : can_gateway.c
+ * @brief          : RS485 to CAN-FD Gateway Implementation
+ ******************************************************************************
+ */
+
+#include "can_gateway.h"
+#include "canfd_transport.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Forwarded Request Waiting For Its Response */
+typedef struct {
+    uint8_t active;
+    uint8_t master;                 // RS485 source of the request
+    uint8_t node;                   // CAN-FD destination
+    uint32_t sentTick;
+} Gateway_Pending_t;
+
+/* Private Variables */
+static uint8_t ready = 0;
+static Gateway_Route_t routes[GATEWAY_MAX_ROUTES];
+static Gateway_Pending_t pending[GATEWAY_MAX_PENDING];
+static RS485_Packet_t relayQueue[GATEWAY_RELAY_QUEUE_SIZE];
+static uint8_t relayHead = 0;
+static uint8_t relayTail = 0;
+static uint32_t lastDiscoveryTick = 0;
+static uint8_t discoveryRequested = 0;
+static Gateway_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static void Gateway_Forward(const RS485_Packet_t* packet);
+static void Gateway_Response(uint8_t source, uint8_t dest, const uint8_t* message, uint16_t length);
+static void Gateway_HandlePingResponse(const RS485_Packet_t* packet);
+static Gateway_Route_t* Find_Route(uint8_t address);
+static Gateway_Route_t* Learn_Route(uint8_t address);
+static void Queue_Relay(uint8_t master, uint8_t node, uint8_t command, const uint8_t* data,
+                        uint8_t length);
+static void Queue_Error(uint8_t master, uint8_t node, RS485_Error_t error);
+static void Flush_Relay(void);
+static uint8_t Relay_Free(void);
+
+/**
+ * @brief  Start the gateway (after RS485_Init and CanFd_Init)
+ * @note   Takes over foreign RS485 frames and CMD_PING_RESPONSE
+ * @retval None
+ */
+void Gateway_Init(void)
+{
+#if GATEWAY_ENABLED
+    memset(routes, 0, sizeof(routes));
+    memset(pending, 0, sizeof(pending));
+    memset(&stats, 0, sizeof(stats));
+    relayHead = 0;
+    relayTail = 0;
+
+    RS485_SetForwardHandler(Gateway_Forward);
+    RS485_RegisterCommandHandler(CMD_PING_RESPONSE, Gateway_HandlePingResponse);
+
+    ready = 1;
+    Gateway_Discover();
+    DEBUG_INFO("CAN-FD gateway started, remote nodes 0x%02X-0x%02X",
+               GATEWAY_REMOTE_FIRST, GATEWAY_REMOTE_LAST);
+#endif
+}
+
+/**
+ * @brief  Relay responses, time out requests, rediscover (1 ms task)
+ * @retval None
+ */
+void Gateway_Process(void)
+{
+    if (!ready) {
+        return;
+    }
+
+    uint32_t now = HAL_GetTick();
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_PENDING; i++) {
+        Gateway_Pending_t* request = &pending[i];
+        if (request->active && now - request->sentTick > GATEWAY_REQUEST_TIMEOUT_MS) {
+            request->active = 0;
+            stats.timeouts++;
+            Gateway_Route_t* route = Find_Route(request->node);
+            if (route != NULL) {
+                route->timeouts++;
+            }
+            Queue_Error(request->master, request->node, RS485_ERR_TIMEOUT);
+        }
+    }
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_ROUTES; i++) {
+        if (routes[i].active && now - routes[i].lastSeen > GATEWAY_ROUTE_TIMEOUT_MS) {
+            routes[i].active = 0;
+            DEBUG_WARNING("Gateway: node 0x%02X lost", routes[i].address);
+        }
+    }
+
+    uint32_t sinceDiscovery = now - lastDiscoveryTick;
+    if (sinceDiscovery >= GATEWAY_DISCOVERY_PERIOD_MS ||
+        (discoveryRequested && sinceDiscovery >= GATEWAY_DISCOVERY_HOLDOFF_MS)) {
+        Gateway_Discover();
+    }
+
+    Flush_Relay();
+}
+
+/**
+ * @brief  Broadcast PING on CAN-FD, the responses build the routing table
+ * @retval None
+ */
+void Gateway_Discover(void)
+{
+    if (!ready) {
+        return;
+    }
+
+    lastDiscoveryTick = HAL_GetTick();
+    discoveryRequested = 0;
+    stats.discoveries++;
+    CanFd_Send(RS485_ADDR_BROADCAST, CMD_PING, NULL, 0);
+}
+
+/**
+ * @brief  Serialize the routing table (CMD_ROUTES_RESPONSE payload)
+ * @note   Layout: [route count][start][entries][forwarded:4][relayed:4]
+ *         [timeouts:4][no route:4][busy:4], then per entry [address]
+ *         [seconds since last response:2][forwarded:4][timeouts:2]
+ * @param  buffer: Output buffer
+ * @param  bufferSize: Buffer size (>= GATEWAY_ROUTES_RESPONSE_SIZE)
+ * @param  start: First route (index among the active routes)
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t Gateway_ReadRoutes(uint8_t* buffer, uint16_t bufferSize, uint8_t start)
+{
+    if (bufferSize < GATEWAY_ROUTES_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    uint32_t now = HAL_GetTick();
+    uint16_t length = GATEWAY_ROUTES_HEADER_SIZE;
+    uint8_t total = 0;
+    uint8_t entries = 0;
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_ROUTES; i++) {
+        const Gateway_Route_t* route = &routes[i];
+        if (!route->active) {
+            continue;
+        }
+        if (total++ < start || entries >= GATEWAY_ROUTES_PER_RESPONSE) {
+            continue;
+        }
+
+        uint32_t age = (now - route->lastSeen) / 1000U;
+        uint16_t ageS = (age > 0xFFFF) ? 0xFFFF : (uint16_t)age;
+        buffer[length++] = route->address;
+        memcpy(&buffer[length], &ageS, 2);
+        memcpy(&buffer[length + 2], &route->forwarded, 4);
+        memcpy(&buffer[length + 6], &route->timeouts, 2);
+        length += GATEWAY_ROUTE_ENTRY_SIZE - 1;
+        entries++;
+    }
+
+    buffer[0] = total;
+    buffer[1] = start;
+    buffer[2] = entries;
+    memcpy(&buffer[3], &stats.forwarded, 4);
+    memcpy(&buffer[7], &stats.relayed, 4);
+    memcpy(&buffer[11], &stats.timeouts, 4);
+    memcpy(&buffer[15], &stats.noRoute, 4);
+    memcpy(&buffer[19], &stats.busy, 4);
+
+    return length;
+}
+
+/**
+ * @brief  Get gateway statistics
+ * @retval Statistics
+ */
+const Gateway_Stats_t* Gateway_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Forward an RS485 frame for a remote node onto CAN-FD
+ * @note   RS485_Process context (foreign frame handler)
+ * @param  packet: Frame addressed to another node
+ * @retval None
+ */
+static void Gateway_Forward(const RS485_Packet_t* packet)
+{
+    uint8_t node = packet->destAddr;
+
+    if (node < GATEWAY_REMOTE_FIRST || node > GATEWAY_REMOTE_LAST) {
+        return;     // Node on the serial bus
+    }
+
+    Gateway_Route_t* route = Find_Route(node);
+    if (route == NULL) {
+        stats.noRoute++;
+        discoveryRequested = 1;
+        return;
+    }
+
+    /* The master's address receives the node's response on CAN-FD. The
+     * request also needs a relay slot for its response or timeout error */
+    Gateway_Pending_t* request = NULL;
+    for (uint8_t i = 0; i < GATEWAY_MAX_PENDING && request == NULL; i++) {
+        if (!pending[i].active) {
+            request = &pending[i];
+        }
+    }
+    if (request == NULL || Relay_Free() == 0 ||
+        CanFd_AddProxy(packet->srcAddr, Gateway_Response) != HAL_OK) {
+        stats.busy++;
+        if (Relay_Free() > 0) {
+            Queue_Error(packet->srcAddr, node, RS485_ERR_BUSY);
+        }
+        return;
+    }
+
+    request->active = 1;
+    request->master = packet->srcAddr;
+    request->node = node;
+    request->sentTick = HAL_GetTick();
+
+    if (CanFd_SendFrom(packet->srcAddr, node, packet->command, packet->data,
+                       packet->length) != HAL_OK) {
+        request->active = 0;
+        route->timeouts++;
+        stats.timeouts++;
+        Queue_Error(packet->srcAddr, node, RS485_ERR_TIMEOUT);
+        return;
+    }
+
+    route->forwarded++;
+    stats.forwarded++;
+}
+
+/**
+ * @brief  Response from a CAN-FD node to an RS485 master (proxy handler)
+ * @note   canfd task context
+ * @param  source: CAN-FD node
+ * @param  dest: RS485 master
+ * @param  message: [command][data]
+ * @param  length: Message length (>= 1)
+ * @retval None
+ */
+static void Gateway_Response(uint8_t source, uint8_t dest, const uint8_t* message, uint16_t length)
+{
+    /* Oldest request of this master to this node */
+    Gateway_Pending_t* request = NULL;
+    for (uint8_t i = 0; i < GATEWAY_MAX_PENDING; i++) {
+        Gateway_Pending_t* candidate = &pending[i];
+        if (candidate->active && candidate->node == source && candidate->master == dest &&
+            (request == NULL || (int32_t)(candidate->sentTick - request->sentTick) < 0)) {
+            request = candidate;
+        }
+    }
+    if (request == NULL || length - 1U > sizeof(relayQueue[0].data)) {
+        stats.unmatched++;
+        return;
+    }
+    request->active = 0;
+
+    Gateway_Route_t* route = Find_Route(source);
+    if (route != NULL) {
+        route->lastSeen = HAL_GetTick();
+    }
+
+    Queue_Relay(dest, source, message[0], &message[1], (uint8_t)(length - 1));
+    Flush_Relay();
+}
+
+/**
+ * @brief  Handle PING_RESPONSE: discovery answer from a CAN-FD node
+ * @param  packet: Received packet
+ * @retval None
+ */
+static void Gateway_HandlePingResponse(const RS485_Packet_t* packet)
+{
+    uint8_t node = packet->srcAddr;
+
+    if (node < GATEWAY_REMOTE_FIRST || node > GATEWAY_REMOTE_LAST) {
+        return;
+    }
+
+    Gateway_Route_t* route = Learn_Route(node);
+    if (route != NULL) {
+        route->lastSeen = HAL_GetTick();
+    }
+}
+
+/**
+ * @brief  Find an active route
+ * @param  address: Node address
+ * @retval Route, NULL if the node is unknown
+ */
+static Gateway_Route_t* Find_Route(uint8_t address)
+{
+    for (uint8_t i = 0; i < GATEWAY_MAX_ROUTES; i++) {
+        if (routes[i].active && routes[i].address == address) {
+            return &routes[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Find or add a route
+ * @param  address: Node address
+ * @retval Route, NULL if the table is full
+ */
+static Gateway_Route_t* Learn_Route(uint8_t address)
+{
+    Gateway_Route_t* route = Find_Route(address);
+    if (route != NULL) {
+        return route;
+    }
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_ROUTES; i++) {
+        if (!routes[i].active) {
+            memset(&routes[i], 0, sizeof(routes[i]));
+            routes[i].active = 1;
+            routes[i].address = address;
+            DEBUG_INFO("Gateway: node 0x%02X found", address);
+            return &routes[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Queue a frame from a CAN-FD node for the RS485 master
+ * @note   Not full for the answer of a released request, its slot was held
+ *         (Relay_Free)
+ * @param  master: RS485 destination
+ * @param  node: Source (the CAN-FD node)
+ * @param  command: Command code
+ * @param  data: Data payload
+ * @param  length: Data length
+ * @retval None
+ */
+static void Queue_Relay(uint8_t master, uint8_t node, uint8_t command, const uint8_t* data,
+                        uint8_t length)
+{
+    uint8_t next = (relayHead + 1) % GATEWAY_RELAY_QUEUE_SIZE;
+    if (next == relayTail) {
+        stats.busy++;
+        return;
+    }
+
+    RS485_Packet_t* packet = &relayQueue[relayHead];
+    packet->destAddr = master;
+    packet->srcAddr = node;
+    packet->command = command;
+    packet->length = length;
+    memcpy(packet->data, data, length);
+    relayHead = next;
+}
+
+/**
+ * @brief  Relay queue slots not taken by queued frames or pending requests
+ * @note   Each active request holds one slot, so its response or timeout
+ *         error can always be queued once the request is released
+ * @retval Free slots
+ */
+static uint8_t Relay_Free(void)
+{
+    uint8_t used = (uint8_t)((relayHead + GATEWAY_RELAY_QUEUE_SIZE - relayTail) % GATEWAY_RELAY_QUEUE_SIZE);
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_PENDING; i++) {
+        if (pending[i].active) {
+            used++;
+        }
+    }
+    return (used < GATEWAY_RELAY_QUEUE_SIZE - 1) ? (uint8_t)(GATEWAY_RELAY_QUEUE_SIZE - 1 - used) : 0;
+}
+
+/**
+ * @brief  Queue an error response on behalf of a CAN-FD node
+ * @param  master: RS485 destination
+ * @param  node: CAN-FD node the request was for
+ * @param  error: Error code
+ * @retval None
+ */
+static void Queue_Error(uint8_t master, uint8_t node, RS485_Error_t error)
+{
+    uint8_t errorData[2];
+    errorData[0] = error;
+    errorData[1] = RS485_GetStatus()->mcuId;   // Reported by the gateway
+
+    Queue_Relay(master, node, CMD_ERROR_RESPONSE, errorData, 2);
+}
+
+/**
+ * @brief  Send the queued frames while the RS485 line is idle
+ * @retval None
+ */
+static void Flush_Relay(void)
+{
+    while (relayTail != relayHead && RS485_IsLineIdle()) {
+        if (RS485_RelayPacket(&relayQueue[relayTail]) == HAL_OK) {
+            stats.relayed++;
+        }
+        relayTail = (relayTail + 1) % GATEWAY_RELAY_QUEUE_SIZE;
+    }
+}
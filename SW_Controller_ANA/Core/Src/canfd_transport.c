@@ -0,0 +1,1016 @@
+/**
+ ******************************************************************************
+ * @file           : canfd_transport.c
+ * @brief          : Controller Protocol over CAN-FD Implementation
+ ******************************************************************************
+ */
+
+#include "canfd_transport.h"
+#include "rs485_protocol.h"
+#include "scheduler.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* External FDCAN Handle */
+extern FDCAN_HandleTypeDef hfdcan1;
+
+/* Received Frame */
+typedef struct {
+    uint32_t id;
+    uint8_t length;
+    uint8_t data[CANFD_FRAME_SIZE];
+} CanFd_Frame_t;
+
+/* Segmented Message Being Received (one session per sender) */
+typedef struct {
+    uint8_t active;
+    uint8_t source;
+    uint8_t dest;
+    uint8_t sequence;                       // Next expected sequence number
+    uint16_t length;
+    uint16_t received;
+    uint32_t lastTick;
+    uint8_t data[CANFD_MAX_MESSAGE_SIZE];
+} CanFd_Reassembly_t;
+
+/* Flow Control Received For Our Segmented Message (set in the interrupt) */
+typedef struct {
+    volatile uint8_t pending;
+    volatile uint8_t source;
+    volatile uint8_t status;
+    volatile uint8_t blockSize;
+    volatile uint8_t separationTime;
+} CanFd_FlowControl_t;
+
+/* Process Image Subscription (latest image, set in the interrupt) */
+typedef struct {
+    uint8_t source;
+    CanFd_ImageHandler_t handler;
+    volatile uint8_t pending;
+    uint8_t length;
+    uint8_t data[CANFD_FRAME_SIZE];
+} CanFd_Subscription_t;
+
+/* Proxy Address (messages relayed for a node behind this one) */
+typedef struct {
+    uint8_t address;
+    CanFd_MessageHandler_t handler;
+} CanFd_Proxy_t;
+
+/* Destinations accepted by the extended filters (event and command filter each),
+ * then the proxy filters */
+#define CANFD_FILTER_DESTS          3
+
+/* Private Variables */
+static uint8_t myAddress = 0;
+static uint8_t myGroup = 0;
+static uint8_t ready = 0;
+static CanFd_Frame_t eventQueue[CANFD_EVENT_QUEUE_SIZE];
+static volatile uint8_t eventHead = 0;
+static volatile uint8_t eventTail = 0;
+static CanFd_Reassembly_t rxSessions[CANFD_RX_SESSIONS];
+static CanFd_FlowControl_t flowControl;
+static CanFd_Subscription_t subscriptions[CANFD_MAX_SUBSCRIPTIONS];
+static uint8_t subscriptionCount = 0;
+static CanFd_Proxy_t proxies[CANFD_MAX_PROXIES];
+static uint8_t proxyCount = 0;
+static CanFd_Stats_t stats = {0};
+
+/* Data bytes per DLC code */
+static const uint8_t dlcBytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+/* Private Function Prototypes */
+static HAL_StatusTypeDef Config_Filters(void);
+static void Process_Events(void);
+static void Process_Images(void);
+static void Handle_Frame(const CanFd_Frame_t* frame);
+static void Handle_FirstFrame(const CanFd_Frame_t* frame);
+static void Handle_ConsecutiveFrame(const CanFd_Frame_t* frame);
+static CanFd_Reassembly_t* Find_Session(uint8_t source);
+static const CanFd_Proxy_t* Find_Proxy(uint8_t address);
+static void Dispatch_Message(uint8_t source, uint8_t dest, const uint8_t* message, uint16_t length);
+static uint8_t Pad_Frame(uint8_t* frame, uint8_t length);
+static void Fill_TxHeader(FDCAN_TxHeaderTypeDef* header, uint32_t id, uint32_t idType, uint8_t dlc);
+static HAL_StatusTypeDef Send_Frame(uint32_t id, uint8_t* frame, uint8_t length);
+static HAL_StatusTypeDef Send_FlowControl(uint8_t srcAddr, uint8_t destAddr, uint8_t flowStatus);
+static uint8_t Wait_FlowControl(uint8_t destAddr, uint8_t* blockSize, uint8_t* separationTime);
+static void Wait_SeparationTime(uint8_t separationTime);
+
+/**
+ * @brief  Start the CAN-FD transport (after MX_FDCAN1_Init and RS485_Init)
+ * @param  myAddr: This MCU's address (same as on RS485)
+ * @param  group: Group address (CANFD_GROUP_xxx)
+ * @retval None
+ */
+void CanFd_Init(uint8_t myAddr, uint8_t group)
+{
+#if CANFD_ENABLED
+    myAddress = myAddr;
+    myGroup = group;
+    eventHead = 0;
+    eventTail = 0;
+    subscriptionCount = 0;
+    proxyCount = 0;
+    memset(rxSessions, 0, sizeof(rxSessions));
+    memset((void*)&flowControl, 0, sizeof(flowControl));
+    memset(subscriptions, 0, sizeof(subscriptions));
+    memset(proxies, 0, sizeof(proxies));
+    memset(&stats, 0, sizeof(stats));
+
+    if (Config_Filters() != HAL_OK) {
+        DEBUG_ERROR("CAN-FD filter config failed");
+        return;
+    }
+    HAL_FDCAN_ConfigFifoWatermark(&hfdcan1, FDCAN_CFG_RX_FIFO0, CANFD_RX_FIFO0_WATERMARK);
+
+    /* Transceiver loop delay exceeds a data bit at 2.5 Mbit/s: compensate,
+     * secondary sample point at the data phase sample point */
+    HAL_FDCAN_ConfigTxDelayCompensation(&hfdcan1,
+                                        hfdcan1.Init.DataPrescaler * hfdcan1.Init.DataTimeSeg1, 0);
+    HAL_FDCAN_EnableTxDelayCompensation(&hfdcan1);
+
+    HAL_FDCAN_ActivateNotification(&hfdcan1,
+                                   FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_WATERMARK |
+                                   FDCAN_IT_RX_FIFO0_MESSAGE_LOST |
+                                   FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_MESSAGE_LOST |
+                                   FDCAN_IT_BUS_OFF, 0);
+    HAL_NVIC_SetPriority(FDCAN1_IT0_IRQn, CANFD_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(FDCAN1_IT0_IRQn);
+
+    if (HAL_FDCAN_Start(&hfdcan1) != HAL_OK) {
+        DEBUG_ERROR("CAN-FD start failed");
+        return;
+    }
+
+    ready = 1;
+    DEBUG_INFO("CAN-FD transport started, Address: 0x%02X, Group: 0x%02X", myAddress, myGroup);
+#else
+    (void)myAddr;
+    (void)group;
+#endif
+}
+
+/**
+ * @brief  Reassemble and dispatch received frames (SCHED_EVENT_CANFD_FRAME task)
+ * @retval None
+ */
+void CanFd_Process(void)
+{
+    FDCAN_RxHeaderTypeDef header;
+    CanFd_Frame_t frame;
+
+    if (!ready) {
+        return;
+    }
+
+    Process_Events();
+    Process_Images();
+
+    /* Commands and bulk straight from message RAM, at most one FIFO's worth
+     * per run; events go first between the frames */
+    uint32_t count = HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0);
+    while (count-- > 0) {
+        if (HAL_FDCAN_GetRxMessage(&hfdcan1, FDCAN_RX_FIFO0, &header, frame.data) != HAL_OK) {
+            break;
+        }
+        stats.rxFrames++;
+        frame.id = header.Identifier;
+        frame.length = dlcBytes[header.DataLength & 0x0F];
+        if (frame.length > 0) {
+            Handle_Frame(&frame);
+        }
+        Process_Events();
+    }
+
+    /* Unmask the new message interrupt; the flag is cleared first so the
+     * frames read above do not fire it again */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    __HAL_FDCAN_CLEAR_FLAG(&hfdcan1, FDCAN_FLAG_RX_FIFO0_NEW_MESSAGE);
+    __HAL_FDCAN_ENABLE_IT(&hfdcan1, FDCAN_IT_RX_FIFO0_NEW_MESSAGE);
+    __set_PRIMASK(primask);
+    if (HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0) > 0) {
+        Sched_PostEvent(SCHED_EVENT_CANFD_FRAME);
+    }
+
+    for (uint8_t i = 0; i < CANFD_RX_SESSIONS; i++) {
+        if (rxSessions[i].active && HAL_GetTick() - rxSessions[i].lastTick > CANFD_SEGMENT_TIMEOUT_MS) {
+            rxSessions[i].active = 0;
+            stats.segmentTimeouts++;
+        }
+    }
+}
+
+/**
+ * @brief  Send one message, segmented if it does not fit a single frame
+ * @note   Thread mode only: waits for the receiver's flow control
+ * @param  destAddr: Destination address
+ * @param  command: Command code
+ * @param  data: Data payload
+ * @param  length: Data length (message is command + data, max CANFD_MAX_MESSAGE_SIZE)
+ * @retval HAL status
+ */
+HAL_StatusTypeDef CanFd_Send(uint8_t destAddr, uint8_t command, const uint8_t* data,
+                             uint16_t length)
+{
+    return CanFd_SendFrom(myAddress, destAddr, command, data, length);
+}
+
+/**
+ * @brief  Send one message on behalf of another node (gateway forwarding)
+ * @note   Thread mode only. Replies to srcAddr only reach this node if it
+ *         is a proxy address (CanFd_AddProxy).
+ * @param  srcAddr: Source address in the frame IDs
+ * @param  destAddr: Destination address
+ * @param  command: Command code
+ * @param  data: Data payload
+ * @param  length: Data length (message is command + data, max CANFD_MAX_MESSAGE_SIZE)
+ * @retval HAL status
+ */
+HAL_StatusTypeDef CanFd_SendFrom(uint8_t srcAddr, uint8_t destAddr, uint8_t command,
+                                 const uint8_t* data, uint16_t length)
+{
+    uint8_t frame[CANFD_FRAME_SIZE];
+    uint16_t messageLength = length + 1;
+
+    if (!ready || messageLength > CANFD_MAX_MESSAGE_SIZE) {
+        return HAL_ERROR;
+    }
+
+    /* Single frame */
+    if (messageLength <= CANFD_SINGLE_MAX) {
+        frame[0] = CANFD_PCI_SINGLE;
+        frame[1] = (uint8_t)messageLength;
+        frame[2] = command;
+        if (length > 0 && data != NULL) {
+            memcpy(&frame[3], data, length);
+        }
+        HAL_StatusTypeDef result = Send_Frame(CANFD_ID(CANFD_PRIORITY_COMMAND, destAddr, srcAddr),
+                                              frame, (uint8_t)(messageLength + 2));
+        if (result == HAL_OK) {
+            stats.txMessages++;
+        }
+        return result;
+    }
+
+    /* First frame, then consecutive frames in the blocks the receiver allows */
+    uint8_t message[CANFD_MAX_MESSAGE_SIZE];
+    message[0] = command;
+    memcpy(&message[1], data, length);
+
+    uint32_t id = CANFD_ID(CANFD_PRIORITY_SEGMENT, destAddr, srcAddr);
+    flowControl.pending = 0;
+    frame[0] = CANFD_PCI_FIRST | (uint8_t)((messageLength >> 8) & 0x0F);
+    frame[1] = (uint8_t)messageLength;
+    memcpy(&frame[2], message, CANFD_FIRST_PAYLOAD);
+    if (Send_Frame(id, frame, CANFD_FRAME_SIZE) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    uint16_t offset = CANFD_FIRST_PAYLOAD;
+    uint8_t sequence = 1;
+    while (offset < messageLength) {
+        uint8_t blockSize = 0;
+        uint8_t separationTime = 0;
+        if (Wait_FlowControl(destAddr, &blockSize, &separationTime) != CANFD_FLOW_CTS) {
+            return HAL_ERROR;
+        }
+
+        for (uint8_t sent = 0; offset < messageLength && (blockSize == 0 || sent < blockSize); sent++) {
+            uint16_t chunk = messageLength - offset;
+            if (chunk > CANFD_CONSECUTIVE_PAYLOAD) {
+                chunk = CANFD_CONSECUTIVE_PAYLOAD;
+            }
+            if (sent > 0) {
+                Wait_SeparationTime(separationTime);
+            }
+            frame[0] = CANFD_PCI_CONSECUTIVE | sequence;
+            memcpy(&frame[1], &message[offset], chunk);
+            if (Send_Frame(id, frame, (uint8_t)(chunk + 1)) != HAL_OK) {
+                return HAL_ERROR;
+            }
+            offset += chunk;
+            sequence = (sequence + 1) & 0x0F;
+        }
+    }
+
+    stats.txMessages++;
+    return HAL_OK;
+}
+
+/**
+ * @brief  Send an event: single frame on the event TX buffer, received
+ *         through RX FIFO1 ahead of commands and bulk transfers
+ * @param  destAddr: Destination address (node, group or broadcast)
+ * @param  command: Command code
+ * @param  data: Data payload
+ * @param  length: Data length (max CANFD_SINGLE_MAX - 1)
+ * @retval HAL status
+ */
+HAL_StatusTypeDef CanFd_SendEvent(uint8_t destAddr, uint8_t command, const uint8_t* data,
+                                  uint8_t length)
+{
+    uint8_t frame[CANFD_FRAME_SIZE];
+
+    if (!ready || length + 1U > CANFD_SINGLE_MAX) {
+        return HAL_ERROR;
+    }
+
+    frame[0] = CANFD_PCI_SINGLE;
+    frame[1] = length + 1;
+    frame[2] = command;
+    if (length > 0 && data != NULL) {
+        memcpy(&frame[3], data, length);
+    }
+    HAL_StatusTypeDef result = Send_Frame(CANFD_ID(CANFD_PRIORITY_EVENT, destAddr, myAddress),
+                                          frame, (uint8_t)(length + 3));
+    if (result == HAL_OK) {
+        stats.txMessages++;
+    }
+    return result;
+}
+
+/**
+ * @brief  Publish this node's process image (dedicated TX buffer)
+ * @note   An image still waiting for the bus is replaced: newest value wins
+ * @param  data: Image
+ * @param  length: Image length (max CANFD_FRAME_SIZE)
+ * @retval HAL status
+ */
+HAL_StatusTypeDef CanFd_PublishImage(const uint8_t* data, uint8_t length)
+{
+    FDCAN_TxHeaderTypeDef header;
+    uint8_t frame[CANFD_FRAME_SIZE];
+
+    if (!ready || length > CANFD_FRAME_SIZE) {
+        return HAL_ERROR;
+    }
+
+    if (HAL_FDCAN_IsTxBufferMessagePending(&hfdcan1, CANFD_IMAGE_TX_BUFFER)) {
+        stats.imageOverruns++;
+        HAL_FDCAN_AbortTxRequest(&hfdcan1, CANFD_IMAGE_TX_BUFFER);
+        /* A frame already on the bus completes first */
+        uint32_t start = HAL_GetTick();
+        while (HAL_FDCAN_IsTxBufferMessagePending(&hfdcan1, CANFD_IMAGE_TX_BUFFER)) {
+            if (HAL_GetTick() - start > CANFD_TX_TIMEOUT_MS) {
+                stats.txErrors++;
+                return HAL_TIMEOUT;
+            }
+        }
+    }
+
+    memcpy(frame, data, length);
+    Fill_TxHeader(&header, CANFD_IMAGE_ID(myAddress), FDCAN_STANDARD_ID, Pad_Frame(frame, length));
+    if (HAL_FDCAN_AddMessageToTxBuffer(&hfdcan1, &header, frame, CANFD_IMAGE_TX_BUFFER) != HAL_OK ||
+        HAL_FDCAN_EnableTxBufferRequest(&hfdcan1, CANFD_IMAGE_TX_BUFFER) != HAL_OK) {
+        stats.txErrors++;
+        return HAL_ERROR;
+    }
+
+    stats.imagesSent++;
+    return HAL_OK;
+}
+
+/**
+ * @brief  Receive another node's process image
+ * @note   Programs a standard ID filter to RX FIFO1; the handler runs in the
+ *         canfd task with the latest image
+ * @param  source: Publishing node's address
+ * @param  handler: Image handler
+ * @retval HAL status (HAL_ERROR if all CANFD_MAX_SUBSCRIPTIONS are in use)
+ */
+HAL_StatusTypeDef CanFd_SubscribeImage(uint8_t source, CanFd_ImageHandler_t handler)
+{
+    FDCAN_FilterTypeDef filter = {0};
+
+    if (!ready || handler == NULL || subscriptionCount >= CANFD_MAX_SUBSCRIPTIONS) {
+        return HAL_ERROR;
+    }
+
+    CanFd_Subscription_t* subscription = &subscriptions[subscriptionCount];
+    subscription->source = source;
+    subscription->handler = handler;
+    subscription->pending = 0;
+
+    filter.IdType = FDCAN_STANDARD_ID;
+    filter.FilterIndex = subscriptionCount;
+    filter.FilterType = FDCAN_FILTER_DUAL;
+    filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO1;
+    filter.FilterID1 = CANFD_IMAGE_ID(source);
+    filter.FilterID2 = CANFD_IMAGE_ID(source);
+    if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* Filter active: the interrupt may match it from here on */
+    subscriptionCount++;
+    return HAL_OK;
+}
+
+/**
+ * @brief  Accept messages for another address and hand them to a handler
+ *         (gateway: replies to the nodes it forwards for)
+ * @note   Programs an event and a command filter for the address
+ * @param  address: Proxied address
+ * @param  handler: Message handler (task context)
+ * @retval HAL status (HAL_ERROR if all CANFD_MAX_PROXIES are in use)
+ */
+HAL_StatusTypeDef CanFd_AddProxy(uint8_t address, CanFd_MessageHandler_t handler)
+{
+    FDCAN_FilterTypeDef filter = {0};
+
+    if (!ready || handler == NULL) {
+        return HAL_ERROR;
+    }
+    if (Find_Proxy(address) != NULL) {
+        return HAL_OK;
+    }
+    if (proxyCount >= CANFD_MAX_PROXIES) {
+        return HAL_ERROR;
+    }
+
+    proxies[proxyCount].address = address;
+    proxies[proxyCount].handler = handler;
+
+    filter.IdType = FDCAN_EXTENDED_ID;
+    filter.FilterType = FDCAN_FILTER_MASK;
+    filter.FilterID1 = CANFD_ID(0, address, 0);
+
+    filter.FilterIndex = CANFD_FILTER_DESTS * 2 + proxyCount * 2;
+    filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO1;
+    filter.FilterID2 = CANFD_ID_DEST_MASK | CANFD_ID_BULK_BIT;
+    if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    filter.FilterIndex++;
+    filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
+    filter.FilterID2 = CANFD_ID_DEST_MASK;
+    if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    proxyCount++;
+    return HAL_OK;
+}
+
+/**
+ * @brief  Get transport statistics
+ * @retval Statistics
+ */
+const CanFd_Stats_t* CanFd_GetStats(void)
+{
+    return &stats;
+}
+
+/**
+ * @brief  FDCAN RX FIFO 0 callback: wake the task, frames stay in message RAM
+ * @note   The new message interrupt stays masked until the task emptied the FIFO
+ * @param  hfdcan: FDCAN handle
+ * @param  RxFifo0ITs: Interrupt flags
+ * @retval None
+ */
+void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
+{
+    if (hfdcan->Instance != FDCAN1) {
+        return;
+    }
+
+    if (RxFifo0ITs & FDCAN_IT_RX_FIFO0_MESSAGE_LOST) {
+        stats.rxFifoLost++;
+    }
+    if (RxFifo0ITs & FDCAN_IT_RX_FIFO0_WATERMARK) {
+        stats.rxWatermarks++;
+    }
+
+    __HAL_FDCAN_DISABLE_IT(hfdcan, FDCAN_IT_RX_FIFO0_NEW_MESSAGE);
+    Sched_PostEvent(SCHED_EVENT_CANFD_FRAME);
+}
+
+/**
+ * @brief  FDCAN RX FIFO 1 callback: take flow control and process images,
+ *         queue events
+ * @param  hfdcan: FDCAN handle
+ * @param  RxFifo1ITs: Interrupt flags
+ * @retval None
+ */
+void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo1ITs)
+{
+    FDCAN_RxHeaderTypeDef header;
+    uint8_t data[CANFD_FRAME_SIZE];
+    uint8_t queued = 0;
+
+    if (hfdcan->Instance != FDCAN1) {
+        return;
+    }
+
+    if (RxFifo1ITs & FDCAN_IT_RX_FIFO1_MESSAGE_LOST) {
+        stats.rxFifoLost++;
+    }
+
+    while (HAL_FDCAN_GetRxFifoFillLevel(hfdcan, FDCAN_RX_FIFO1) > 0) {
+        if (HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO1, &header, data) != HAL_OK) {
+            break;
+        }
+        stats.rxFrames++;
+        stats.rxEvents++;
+
+        uint8_t length = dlcBytes[header.DataLength & 0x0F];
+        if (length == 0) {
+            continue;
+        }
+
+        /* Process image: keep the latest per subscription */
+        if (header.IdType == FDCAN_STANDARD_ID) {
+            for (uint8_t i = 0; i < subscriptionCount; i++) {
+                if (subscriptions[i].source == CANFD_IMAGE_SRC(header.Identifier)) {
+                    memcpy(subscriptions[i].data, data, length);
+                    subscriptions[i].length = length;
+                    subscriptions[i].pending = 1;
+                    queued = 1;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        /* Flow control only releases the sender waiting in CanFd_Send */
+        if ((data[0] & 0xF0) == CANFD_PCI_FLOW_CONTROL) {
+            if (length >= 3) {
+                flowControl.source = CANFD_ID_SRC(header.Identifier);
+                flowControl.status = data[0] & 0x0F;
+                flowControl.blockSize = data[1];
+                flowControl.separationTime = data[2];
+                flowControl.pending = 1;
+            }
+            continue;
+        }
+
+        uint8_t next = (eventHead + 1) % CANFD_EVENT_QUEUE_SIZE;
+        if (next == eventTail) {
+            stats.rxQueueOverflows++;
+            continue;
+        }
+        eventQueue[eventHead].id = header.Identifier;
+        eventQueue[eventHead].length = length;
+        memcpy(eventQueue[eventHead].data, data, length);
+        eventHead = next;
+        queued = 1;
+
+        uint32_t waiting = (next + CANFD_EVENT_QUEUE_SIZE - eventTail) % CANFD_EVENT_QUEUE_SIZE;
+        if (waiting > stats.eventQueueHighWater) {
+            stats.eventQueueHighWater = waiting;
+        }
+    }
+
+    if (queued) {
+        Sched_PostEvent(SCHED_EVENT_CANFD_FRAME);
+    }
+}
+
+/**
+ * @brief  FDCAN error status callback: recover from bus-off
+ * @param  hfdcan: FDCAN handle
+ * @param  ErrorStatusITs: Interrupt flags
+ * @retval None
+ */
+void HAL_FDCAN_ErrorStatusCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t ErrorStatusITs)
+{
+    if (hfdcan->Instance == FDCAN1 && (ErrorStatusITs & FDCAN_IT_BUS_OFF) != 0) {
+        stats.busOff++;
+        /* Leaving init starts the 128 x 11 recessive bits recovery sequence */
+        CLEAR_BIT(hfdcan->Instance->CCCR, FDCAN_CCCR_INIT);
+    }
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Program the acceptance filters (message RAM, before HAL_FDCAN_Start)
+ * @note   First match wins: the event filters (priority 0-3) come before the
+ *         command filters. Proxy and standard filters stay disabled until
+ *         added.
+ * @retval HAL status
+ */
+static HAL_StatusTypeDef Config_Filters(void)
+{
+    const uint8_t dests[CANFD_FILTER_DESTS] = { myAddress, myGroup, RS485_ADDR_BROADCAST };
+    FDCAN_FilterTypeDef filter = {0};
+
+    filter.IdType = FDCAN_EXTENDED_ID;
+    filter.FilterType = FDCAN_FILTER_MASK;
+    for (uint8_t i = 0; i < CANFD_FILTER_DESTS; i++) {
+        filter.FilterID1 = CANFD_ID(0, dests[i], 0);
+
+        filter.FilterIndex = i;
+        filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO1;
+        filter.FilterID2 = CANFD_ID_DEST_MASK | CANFD_ID_BULK_BIT;
+        if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+            return HAL_ERROR;
+        }
+
+        filter.FilterIndex = CANFD_FILTER_DESTS + i;
+        filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
+        filter.FilterID2 = CANFD_ID_DEST_MASK;
+        if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    filter.FilterConfig = FDCAN_FILTER_DISABLE;
+    filter.FilterID1 = 0;
+    filter.FilterID2 = 0;
+    for (uint8_t i = 0; i < CANFD_MAX_PROXIES * 2; i++) {
+        filter.FilterIndex = CANFD_FILTER_DESTS * 2 + i;
+        if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    filter.IdType = FDCAN_STANDARD_ID;
+    filter.FilterType = FDCAN_FILTER_DUAL;
+    for (uint8_t i = 0; i < CANFD_MAX_SUBSCRIPTIONS; i++) {
+        filter.FilterIndex = i;
+        if (HAL_FDCAN_ConfigFilter(&hfdcan1, &filter) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    return HAL_FDCAN_ConfigGlobalFilter(&hfdcan1, FDCAN_REJECT, FDCAN_REJECT,
+                                        FDCAN_REJECT_REMOTE, FDCAN_REJECT_REMOTE);
+}
+
+/**
+ * @brief  Handle the queued events (RX FIFO1)
+ * @retval None
+ */
+static void Process_Events(void)
+{
+    while (eventTail != eventHead) {
+        Handle_Frame(&eventQueue[eventTail]);
+        eventTail = (eventTail + 1) % CANFD_EVENT_QUEUE_SIZE;
+    }
+}
+
+/**
+ * @brief  Hand new process images to their handlers
+ * @retval None
+ */
+static void Process_Images(void)
+{
+    uint8_t image[CANFD_FRAME_SIZE];
+
+    for (uint8_t i = 0; i < subscriptionCount; i++) {
+        CanFd_Subscription_t* subscription = &subscriptions[i];
+        if (!subscription->pending) {
+            continue;
+        }
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint8_t length = subscription->length;
+        memcpy(image, subscription->data, length);
+        subscription->pending = 0;
+        __set_PRIMASK(primask);
+
+        stats.imagesReceived++;
+        subscription->handler(subscription->source, image, length);
+    }
+}
+
+/**
+ * @brief  Handle one received frame
+ * @param  frame: Frame
+ * @retval None
+ */
+static void Handle_Frame(const CanFd_Frame_t* frame)
+{
+    uint8_t source = CANFD_ID_SRC(frame->id);
+    uint8_t dest = CANFD_ID_DEST(frame->id);
+
+    switch (frame->data[0] & 0xF0) {
+        case CANFD_PCI_SINGLE: {
+            /* Classic single frame: length in the PCI, CAN-FD: in the next byte */
+            uint8_t offset = (frame->data[0] & 0x0F) ? 1 : 2;
+            uint8_t length = (offset == 1) ? (frame->data[0] & 0x0F) : frame->data[1];
+            if (length > 0 && offset + length <= frame->length) {
+                Dispatch_Message(source, dest, &frame->data[offset], length);
+            }
+            break;
+        }
+        case CANFD_PCI_FIRST:
+            Handle_FirstFrame(frame);
+            break;
+        case CANFD_PCI_CONSECUTIVE:
+            Handle_ConsecutiveFrame(frame);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief  Start reassembling a segmented message
+ * @param  frame: First frame
+ * @retval None
+ */
+static void Handle_FirstFrame(const CanFd_Frame_t* frame)
+{
+    uint8_t source = CANFD_ID_SRC(frame->id);
+    uint8_t dest = CANFD_ID_DEST(frame->id);
+    uint16_t length = ((uint16_t)(frame->data[0] & 0x0F) << 8) | frame->data[1];
+
+    /* Flow control comes from the address the message was sent to: this
+     * node or a proxied one (group and broadcast: this node) */
+    uint8_t flowSource = (Find_Proxy(dest) != NULL) ? dest : myAddress;
+
+    /* A sender restarting replaces its own session; new senders get a free
+     * or timed out one, or are refused */
+    CanFd_Reassembly_t* session = Find_Session(source);
+    if (session == NULL || length > CANFD_MAX_MESSAGE_SIZE || length <= CANFD_SINGLE_MAX ||
+        frame->length < CANFD_FRAME_SIZE) {
+        Send_FlowControl(flowSource, source, CANFD_FLOW_OVERFLOW);
+        return;
+    }
+
+    session->active = 1;
+    session->source = source;
+    session->dest = dest;
+    session->sequence = 1;
+    session->length = length;
+    session->received = CANFD_FIRST_PAYLOAD;
+    session->lastTick = HAL_GetTick();
+    memcpy(session->data, &frame->data[2], CANFD_FIRST_PAYLOAD);
+
+    /* Whole message in one block, no separation time */
+    Send_FlowControl(flowSource, source, CANFD_FLOW_CTS);
+}
+
+/**
+ * @brief  Append a consecutive frame, dispatch the completed message
+ * @param  frame: Consecutive frame
+ * @retval None
+ */
+static void Handle_ConsecutiveFrame(const CanFd_Frame_t* frame)
+{
+    uint8_t source = CANFD_ID_SRC(frame->id);
+    CanFd_Reassembly_t* session = Find_Session(source);
+
+    /* Find_Session may return another sender's timed out session as free:
+     * only this sender's live session takes the frame */
+    if (session == NULL || !session->active || session->source != source) {
+        return;
+    }
+    if (HAL_GetTick() - session->lastTick > CANFD_SEGMENT_TIMEOUT_MS) {
+        session->active = 0;
+        stats.segmentTimeouts++;
+        return;
+    }
+    if ((frame->data[0] & 0x0F) != session->sequence) {
+        stats.sequenceErrors++;
+        session->active = 0;
+        return;
+    }
+
+    uint16_t chunk = session->length - session->received;
+    if (chunk > frame->length - 1U) {
+        chunk = frame->length - 1U;
+    }
+    memcpy(&session->data[session->received], &frame->data[1], chunk);
+    session->received += chunk;
+    session->sequence = (session->sequence + 1) & 0x0F;
+    session->lastTick = HAL_GetTick();
+
+    if (session->received >= session->length) {
+        session->active = 0;
+        Dispatch_Message(session->source, session->dest, session->data, session->length);
+    }
+}
+
+/**
+ * @brief  Find the reassembly session of a sender
+ * @param  source: Sender address
+ * @retval The sender's active session, else a free or timed out one, NULL if none
+ */
+static CanFd_Reassembly_t* Find_Session(uint8_t source)
+{
+    CanFd_Reassembly_t* free = NULL;
+
+    for (uint8_t i = 0; i < CANFD_RX_SESSIONS; i++) {
+        CanFd_Reassembly_t* session = &rxSessions[i];
+        if (session->active && session->source == source) {
+            return session;
+        }
+        if (free == NULL && (!session->active ||
+                             HAL_GetTick() - session->lastTick > CANFD_SEGMENT_TIMEOUT_MS)) {
+            free = session;
+        }
+    }
+    return free;
+}
+
+/**
+ * @brief  Find a proxied address
+ * @param  address: Destination address
+ * @retval Proxy, NULL if the address is not proxied
+ */
+static const CanFd_Proxy_t* Find_Proxy(uint8_t address)
+{
+    for (uint8_t i = 0; i < proxyCount; i++) {
+        if (proxies[i].address == address) {
+            return &proxies[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Hand a complete message to the command handlers
+ * @param  source: Sender address
+ * @param  dest: Destination address (this node, its group, broadcast or a proxy)
+ * @param  message: [command][data]
+ * @param  length: Message length (>= 1)
+ * @retval None
+ */
+static void Dispatch_Message(uint8_t source, uint8_t dest, const uint8_t* message, uint16_t length)
+{
+    RS485_Packet_t packet;
+
+    const CanFd_Proxy_t* proxy = Find_Proxy(dest);
+    if (proxy != NULL) {
+        stats.rxMessages++;
+        proxy->handler(source, dest, message, length);
+        return;
+    }
+
+    if (length - 1U > sizeof(packet.data)) {
+        return;
+    }
+
+    packet.destAddr = dest;
+    packet.srcAddr = source;
+    packet.command = message[0];
+    packet.length = (uint8_t)(length - 1);
+    memcpy(packet.data, &message[1], packet.length);
+
+    stats.rxMessages++;
+    RS485_DispatchPacket(&packet, RS485_TRANSPORT_CANFD);
+}
+
+/**
+ * @brief  Pad a frame to the next CAN-FD length
+ * @param  frame: Frame data (CANFD_FRAME_SIZE bytes buffer)
+ * @param  length: Used bytes
+ * @retval DLC code
+ */
+static uint8_t Pad_Frame(uint8_t* frame, uint8_t length)
+{
+    uint8_t dlc = 0;
+
+    while (dlcBytes[dlc] < length) {
+        dlc++;
+    }
+    memset(&frame[length], CANFD_PADDING, dlcBytes[dlc] - length);
+    return dlc;
+}
+
+/**
+ * @brief  Fill a TX header for a CAN-FD data frame with bit rate switching
+ * @param  header: TX header
+ * @param  id: Frame ID
+ * @param  idType: FDCAN_STANDARD_ID or FDCAN_EXTENDED_ID
+ * @param  dlc: DLC code
+ * @retval None
+ */
+static void Fill_TxHeader(FDCAN_TxHeaderTypeDef* header, uint32_t id, uint32_t idType, uint8_t dlc)
+{
+    header->Identifier = id;
+    header->IdType = idType;
+    header->TxFrameType = FDCAN_DATA_FRAME;
+    header->DataLength = dlc;
+    header->ErrorStateIndicator = FDCAN_ESI_ACTIVE;
+    header->BitRateSwitch = FDCAN_BRS_ON;
+    header->FDFormat = FDCAN_FD_CAN;
+    header->TxEventFifoControl = FDCAN_NO_TX_EVENTS;
+    header->MessageMarker = 0;
+}
+
+/**
+ * @brief  Queue one frame for transmission (padded to the next CAN-FD length)
+ * @note   Priority 0-3 goes to the event TX buffer, which does not wait
+ *         behind the frames in the TX FIFO
+ * @param  id: Extended frame ID
+ * @param  frame: Frame data (CANFD_FRAME_SIZE bytes buffer)
+ * @param  length: Used bytes
+ * @retval HAL status
+ */
+static HAL_StatusTypeDef Send_Frame(uint32_t id, uint8_t* frame, uint8_t length)
+{
+    FDCAN_TxHeaderTypeDef header;
+    HAL_StatusTypeDef result;
+    uint8_t event = (id & CANFD_ID_BULK_BIT) == 0;
+
+    Fill_TxHeader(&header, id, FDCAN_EXTENDED_ID, Pad_Frame(frame, length));
+
+    uint32_t start = HAL_GetTick();
+    while (event ? HAL_FDCAN_IsTxBufferMessagePending(&hfdcan1, CANFD_EVENT_TX_BUFFER) != 0
+                 : HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1) == 0) {
+        if (HAL_GetTick() - start > CANFD_TX_TIMEOUT_MS) {
+            stats.txErrors++;
+            return HAL_TIMEOUT;
+        }
+    }
+
+    if (event) {
+        result = HAL_FDCAN_AddMessageToTxBuffer(&hfdcan1, &header, frame, CANFD_EVENT_TX_BUFFER);
+        if (result == HAL_OK) {
+            result = HAL_FDCAN_EnableTxBufferRequest(&hfdcan1, CANFD_EVENT_TX_BUFFER);
+        }
+    } else {
+        result = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &header, frame);
+    }
+    if (result != HAL_OK) {
+        stats.txErrors++;
+        return HAL_ERROR;
+    }
+
+    stats.txFrames++;
+    return HAL_OK;
+}
+
+/**
+ * @brief  Send a flow control frame
+ * @param  srcAddr: Receiver of the segmented message (this node or a proxy)
+ * @param  destAddr: Sender of the segmented message
+ * @param  flowStatus: CANFD_FLOW_CTS / WAIT / OVERFLOW
+ * @retval HAL status
+ */
+static HAL_StatusTypeDef Send_FlowControl(uint8_t srcAddr, uint8_t destAddr, uint8_t flowStatus)
+{
+    uint8_t frame[CANFD_FRAME_SIZE];
+
+    frame[0] = CANFD_PCI_FLOW_CONTROL | flowStatus;
+    frame[1] = 0;       // Block size: no further flow control
+    frame[2] = 0;       // STmin
+    return Send_Frame(CANFD_ID(CANFD_PRIORITY_FLOW_CONTROL, destAddr, srcAddr), frame, 3);
+}
+
+/**
+ * @brief  Wait for the receiver's flow control
+ * @param  destAddr: Receiver of our segmented message
+ * @param  blockSize: Frames until the next flow control (0 = all)
+ * @param  separationTime: STmin between consecutive frames
+ * @retval CANFD_FLOW_CTS, CANFD_FLOW_OVERFLOW or 0xFF on timeout
+ */
+static uint8_t Wait_FlowControl(uint8_t destAddr, uint8_t* blockSize, uint8_t* separationTime)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (HAL_GetTick() - start <= CANFD_SEGMENT_TIMEOUT_MS) {
+        if (!flowControl.pending || flowControl.source != destAddr) {
+            continue;
+        }
+        flowControl.pending = 0;
+
+        if (flowControl.status == CANFD_FLOW_WAIT) {
+            start = HAL_GetTick();
+            continue;
+        }
+        if (flowControl.status != CANFD_FLOW_CTS) {
+            stats.flowOverflows++;
+            return CANFD_FLOW_OVERFLOW;
+        }
+        *blockSize = flowControl.blockSize;
+        *separationTime = flowControl.separationTime;
+        return CANFD_FLOW_CTS;
+    }
+
+    stats.segmentTimeouts++;
+    return 0xFF;
+}
+
+/**
+ * @brief  Wait the separation time between consecutive frames
+ * @param  separationTime: STmin (0x00-0x7F ms, 0xF1-0xF9 100-900 us)
+ * @retval None
+ */
+static void Wait_SeparationTime(uint8_t separationTime)
+{
+    uint32_t us;
+
+    if (separationTime == 0) {
+        return;
+    }
+    if (separationTime <= 0x7F) {
+        us = separationTime * 1000U;
+    } else if (separationTime >= 0xF1 && separationTime <= 0xF9) {
+        us = (separationTime - 0xF0) * 100U;
+    } else {
+        us = 0x7F * 1000U;      // Reserved values: longest valid time
+    }
+
+    uint32_t start = DWT->CYCCNT;
+    uint32_t cycles = us * (SystemCoreClock / 1000000U);
+    while (DWT->CYCCNT - start < cycles) {
+    }
+}
@@ -25,7 +25,23 @@
 #include "version.h"
 #include "debug_uart.h"
 #include "rs485_protocol.h"
+#include "perf_monitor.h"
+#include "mem_benchmark.h"
+#include "boot_profile.h"
+#include "canfd_transport.h"
+#include "can_gateway.h"
+#include "health_monitor.h"
+#include "scheduler.h"
 #include "analog_input_handler.h"
+#include "analog_capture.h"
+#include "analog_stats.h"
+#include "analog_spectrum.h"
+#include "history_buffer.h"
+#include "bus_sync.h"
+#include "time_sync.h"
+#include "data_stream.h"
+#include "bus_access.h"
+#include "seg_transfer.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -54,14 +70,57 @@ UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
-static uint32_t heartbeatTimer = 0;
-static uint32_t statusLedTimer = 0;
-static uint32_t analogUpdateTimer = 0;
+static uint32_t analogUpdateTick = 0;
 static char versionString[VERSION_STRING_SIZE];
 
+/* Completed waveform capture, read with segmented transfers */
+static const SegTransfer_Object_t captureObject = {
+    .id = SEG_OBJECT_CAPTURE,
+    .size = AnalogCapture_GetSize,
+    .read = AnalogCapture_ReadChunk,
+};
+
 /* Command handlers for analog inputs */
 void HandleRead420mA(const RS485_Packet_t* packet);
 void HandleReadVoltage(const RS485_Packet_t* packet);
+void HandleReadNTC(const RS485_Packet_t* packet);
+
+/* Command handlers for waveform capture */
+void HandleCaptureArm(const RS485_Packet_t* packet);
+void HandleCaptureStatus(const RS485_Packet_t* packet);
+void HandleCaptureRead(const RS485_Packet_t* packet);
+void HandleCaptureTrigger(const RS485_Packet_t* packet);
+
+/* Command handlers for analog statistics */
+void HandleReadAnalogStats(const RS485_Packet_t* packet);
+void HandleSetStatsWindow(const RS485_Packet_t* packet);
+
+/* Command handlers for spectral analysis */
+void HandleSpectrumConfig(const RS485_Packet_t* packet);
+void HandleReadSpectrum(const RS485_Packet_t* packet);
+
+/* Command handlers for trend history */
+void HandleReadHistory(const RS485_Packet_t* packet);
+
+/* Command handlers for the CAN-FD gateway */
+void HandleGetRoutes(const RS485_Packet_t* packet);
+
+/* Command handlers for SYNC snapshots */
+void HandleSync(const RS485_Packet_t* packet);
+void HandleReadSnapshot(const RS485_Packet_t* packet);
+void HandleSyncMode(const RS485_Packet_t* packet);
+void HandleTimeSync(const RS485_Packet_t* packet);
+void HandleBusBeacon(const RS485_Packet_t* packet);
+
+/* Command handlers for segmented transfers */
+void HandleSegOpen(const RS485_Packet_t* packet);
+void HandleSegRead(const RS485_Packet_t* packet);
+void HandleSegData(const RS485_Packet_t* packet);
+void HandleSegAck(const RS485_Packet_t* packet);
+
+/* Command handlers for data streams */
+void HandleStreamSubscribe(const RS485_Packet_t* packet);
+void HandleStreamStatus(const RS485_Packet_t* packet);
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -74,7 +133,18 @@ static void MX_USART1_UART_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_SPI1_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void Task_AnalogUpdate(void);
+static void Task_StatusLed(void);
+static void Task_Heartbeat(void);
+static uint16_t Build_AnalogImage(uint8_t* buffer, uint16_t bufferSize);
+
+/* Raw analog values, published from the analog task */
+static const Stream_DataSet_t streamDataSet = {
+    .id = STREAM_SET_ANALOG,
+    .elementSize = 2,
+    .scanPeriodMs = ANALOG_FRAME_PERIOD_MS,
+    .capture = Build_AnalogImage,
+};
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -90,12 +160,20 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  Boot_Init();
   /* USER CODE END 1 */
 
   /* MPU Configuration--------------------------------------------------------*/
   MPU_Config();
 
+  /* Enable the CPU Cache */
+
+  /* Enable I-Cache---------------------------------------------------------*/
+  SCB_EnableICache();
+
+  /* Enable D-Cache---------------------------------------------------------*/
+  SCB_EnableDCache();
+
   /* MCU Configuration--------------------------------------------------------*/
 
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
@@ -109,7 +187,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  Boot_Mark(BOOT_PHASE_CLOCKS);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -120,32 +198,105 @@ int main(void)
   MX_USART2_UART_Init();
   MX_SPI1_Init();
   /* USER CODE BEGIN 2 */
+  Boot_Mark(BOOT_PHASE_PERIPHERALS);
   
-  /* Initialize hierarchical layers */
+  /* Fast start: only the RS485 link and what it depends on come up before
+   * the node answers, the rest is initialized afterwards */
   Debug_Init();
   
-  /* Print startup banner */
+  /* Enable cycle counter profiling */
+  Perf_Init();
+  
+  /* Bus clock (DWT based): local time until the first TIME_SYNC */
+  TimeSync_Init();
+  
+  /* Log flash/ITCM, SRAM/DTCM/DMA region and cache timings (before RS485 RX starts) */
+  MemBench_Run();
+  
+  /* RS485 task first: frame events posted during the deferred init are kept */
+  Sched_Init();
+  Sched_AddEvent("rs485", RS485_Process, SCHED_EVENT_RS485_FRAME, SCHED_PRIORITY_COMM);
+  
+  /* Initialize RS485 protocol layer */
+  RS485_Init(RS485_ADDR_CONTROLLER_420);
+  Boot_Mark(BOOT_PHASE_PROTOCOL_READY);
+  
+  /* Same command set over CAN-FD (FDCAN1) */
+  CanFd_Init(RS485_ADDR_CONTROLLER_420, CANFD_GROUP_ANALOG);
+  Sched_AddEvent("canfd", CanFd_Process, SCHED_EVENT_CANFD_FRAME, SCHED_PRIORITY_COMM);
+  
+  /* RS485 masters reach the CAN-FD only nodes through this controller */
+  Gateway_Init();
+  Sched_AddPeriodic("gateway", Gateway_Process, 1, SCHED_PRIORITY_COMM);
+  
+  /* Deferred init: frames received meanwhile are served between the steps,
+   * analog commands once their handlers are registered */
   Version_GetString(versionString, VERSION_STRING_SIZE);
   DEBUG_INFO("===========================================");
   DEBUG_INFO("  %s", versionString);
   DEBUG_INFO("===========================================");
+  RS485_Process();
   
   /* Initialize analog input handler */
   AnalogInput_Init();
+  AnalogCapture_Init();
+  AnalogStats_Init();
+  AnalogSpectrum_Init();
+  History_Init(ANALOG_HISTORY_PAYLOAD_SIZE, ANALOG_HISTORY_INTERVAL_MS);
+  BusSync_Init(Build_AnalogImage, NULL);
+  SegTransfer_Init();
+  SegTransfer_Register(&captureObject);
+  BusAccess_Init(RS485_ADDR_CONTROLLER_420);
+  Stream_Init();
+  Stream_RegisterDataSet(&streamDataSet);
+  RS485_Process();
   
-  /* Initialize RS485 protocol layer */
-  RS485_Init(RS485_ADDR_CONTROLLER_420);
+  /* Compute health from live metrics (after RS485_Init) */
+  Health_Init();
   
   /* Register analog command handlers */
   RS485_RegisterCommandHandler(CMD_READ_ANALOG_420, HandleRead420mA);
   RS485_RegisterCommandHandler(CMD_READ_ANALOG_VOLTAGE, HandleReadVoltage);
+  RS485_RegisterCommandHandler(CMD_READ_NTC, HandleReadNTC);
+  RS485_RegisterCommandHandler(CMD_CAPTURE_ARM, HandleCaptureArm);
+  RS485_RegisterCommandHandler(CMD_CAPTURE_STATUS, HandleCaptureStatus);
+  RS485_RegisterCommandHandler(CMD_CAPTURE_READ, HandleCaptureRead);
+  RS485_RegisterCommandHandler(CMD_CAPTURE_TRIGGER, HandleCaptureTrigger);
+  RS485_RegisterCommandHandler(CMD_READ_ANALOG_STATS, HandleReadAnalogStats);
+  RS485_RegisterCommandHandler(CMD_SET_STATS_WINDOW, HandleSetStatsWindow);
+  RS485_RegisterCommandHandler(CMD_SPECTRUM_CONFIG, HandleSpectrumConfig);
+  RS485_RegisterCommandHandler(CMD_READ_SPECTRUM, HandleReadSpectrum);
+  RS485_RegisterCommandHandler(CMD_READ_HISTORY, HandleReadHistory);
+  RS485_RegisterCommandHandler(CMD_GET_ROUTES, HandleGetRoutes);
+  RS485_RegisterCommandHandler(CMD_SYNC, HandleSync);
+  RS485_RegisterCommandHandler(CMD_READ_SNAPSHOT, HandleReadSnapshot);
+  RS485_RegisterCommandHandler(CMD_SYNC_MODE, HandleSyncMode);
+  RS485_RegisterCommandHandler(CMD_TIME_SYNC, HandleTimeSync);
+  RS485_RegisterCommandHandler(CMD_BUS_BEACON, HandleBusBeacon);
+  RS485_RegisterCommandHandler(CMD_STREAM_SUBSCRIBE, HandleStreamSubscribe);
+  RS485_RegisterCommandHandler(CMD_STREAM_STATUS, HandleStreamStatus);
+  RS485_RegisterCommandHandler(CMD_SEG_OPEN, HandleSegOpen);
+  RS485_RegisterCommandHandler(CMD_SEG_READ, HandleSegRead);
+  RS485_RegisterCommandHandler(CMD_SEG_DATA, HandleSegData);
+  RS485_RegisterCommandHandler(CMD_SEG_ACK, HandleSegAck);
+  
+  /* Remaining tasks: spectrum on events, the rest periodic. The spectrum
+   * shares its results with the command handlers: communication class */
+  Sched_AddEvent("spectrum", AnalogSpectrum_Process, SCHED_EVENT_SPECTRUM_BLOCK,
+                 SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("health", Health_Process, 1, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("time_sync", TimeSync_Process, 1000, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("stream", Stream_Process, 1, SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("seg_xfer", SegTransfer_Process, 1, SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("analog", Task_AnalogUpdate, ANALOG_FRAME_PERIOD_MS, SCHED_PRIORITY_IO);
+  Sched_AddPeriodic("status_led", Task_StatusLed, 500, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("heartbeat", Task_Heartbeat, 10000, SCHED_PRIORITY_HOUSEKEEPING);
+  analogUpdateTick = HAL_GetTick();
   
+  Boot_Mark(BOOT_PHASE_INIT_DONE);
+  Boot_Log();
   DEBUG_INFO("System initialization complete");
   DEBUG_INFO("Entering main loop...");
-  
-  heartbeatTimer = HAL_GetTick();
-  statusLedTimer = HAL_GetTick();
-  analogUpdateTimer = HAL_GetTick();
 
   /* USER CODE END 2 */
 
@@ -156,33 +307,8 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    
-    /* Process RS485 communication */
-    RS485_Process();
-    
-    /* Update analog inputs every 100ms */
-    if (HAL_GetTick() - analogUpdateTimer >= 100) {
-      analogUpdateTimer = HAL_GetTick();
-      AnalogInput_Update();
-    }
-    
-    /* Status LED blink (every 500ms) */
-    if (HAL_GetTick() - statusLedTimer >= 500) {
-      statusLedTimer = HAL_GetTick();
-      HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_1); // Status LED
-    }
-    
-    /* Periodic heartbeat logging (every 10 seconds) */
-    if (HAL_GetTick() - heartbeatTimer >= 10000) {
-      heartbeatTimer = HAL_GetTick();
-      RS485_Status_t* status = RS485_GetStatus();
-      DEBUG_INFO("Heartbeat: Uptime=%lu RX=%lu TX=%lu Err=%lu Health=%d%%", 
-                 status->uptime, status->rxPacketCount, 
-                 status->txPacketCount, status->errorCount, status->health);
-    }
-    
-    /* Small delay to prevent CPU hogging */
-    HAL_Delay(1);
+    /* Run the task scheduler (does not return) */
+    Sched_Run();
   }
   /* USER CODE END 3 */
 }
@@ -261,33 +387,33 @@ static void MX_FDCAN1_Init(void)
 
   /* USER CODE END FDCAN1_Init 1 */
   hfdcan1.Instance = FDCAN1;
-  hfdcan1.Init.FrameFormat = FDCAN_FRAME_CLASSIC;
+  hfdcan1.Init.FrameFormat = FDCAN_FRAME_FD_BRS;
   hfdcan1.Init.Mode = FDCAN_MODE_NORMAL;
-  hfdcan1.Init.AutoRetransmission = DISABLE;
-  hfdcan1.Init.TransmitPause = DISABLE;
+  hfdcan1.Init.AutoRetransmission = ENABLE;
+  hfdcan1.Init.TransmitPause = ENABLE;
   hfdcan1.Init.ProtocolException = DISABLE;
-  hfdcan1.Init.NominalPrescaler = 16;
-  hfdcan1.Init.NominalSyncJumpWidth = 1;
-  hfdcan1.Init.NominalTimeSeg1 = 1;
-  hfdcan1.Init.NominalTimeSeg2 = 1;
+  hfdcan1.Init.NominalPrescaler = 1;
+  hfdcan1.Init.NominalSyncJumpWidth = 10;
+  hfdcan1.Init.NominalTimeSeg1 = 39;
+  hfdcan1.Init.NominalTimeSeg2 = 10;
   hfdcan1.Init.DataPrescaler = 1;
-  hfdcan1.Init.DataSyncJumpWidth = 1;
-  hfdcan1.Init.DataTimeSeg1 = 1;
-  hfdcan1.Init.DataTimeSeg2 = 1;
+  hfdcan1.Init.DataSyncJumpWidth = 2;
+  hfdcan1.Init.DataTimeSeg1 = 7;
+  hfdcan1.Init.DataTimeSeg2 = 2;
   hfdcan1.Init.MessageRAMOffset = 0;
-  hfdcan1.Init.StdFiltersNbr = 0;
-  hfdcan1.Init.ExtFiltersNbr = 0;
-  hfdcan1.Init.RxFifo0ElmtsNbr = 0;
-  hfdcan1.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_8;
-  hfdcan1.Init.RxFifo1ElmtsNbr = 0;
-  hfdcan1.Init.RxFifo1ElmtSize = FDCAN_DATA_BYTES_8;
+  hfdcan1.Init.StdFiltersNbr = 4;
+  hfdcan1.Init.ExtFiltersNbr = 10;
+  hfdcan1.Init.RxFifo0ElmtsNbr = 32;
+  hfdcan1.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_64;
+  hfdcan1.Init.RxFifo1ElmtsNbr = 8;
+  hfdcan1.Init.RxFifo1ElmtSize = FDCAN_DATA_BYTES_64;
   hfdcan1.Init.RxBuffersNbr = 0;
   hfdcan1.Init.RxBufferSize = FDCAN_DATA_BYTES_8;
   hfdcan1.Init.TxEventsNbr = 0;
-  hfdcan1.Init.TxBuffersNbr = 0;
-  hfdcan1.Init.TxFifoQueueElmtsNbr = 0;
+  hfdcan1.Init.TxBuffersNbr = 2;
+  hfdcan1.Init.TxFifoQueueElmtsNbr = 8;
   hfdcan1.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
-  hfdcan1.Init.TxElmtSize = FDCAN_DATA_BYTES_8;
+  hfdcan1.Init.TxElmtSize = FDCAN_DATA_BYTES_64;
   if (HAL_FDCAN_Init(&hfdcan1) != HAL_OK)
   {
     Error_Handler();
@@ -527,66 +653,590 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
+/**
+ * @brief  Analog input update task (one frame), publishes the process image
+ * @retval None
+ */
+static void Task_AnalogUpdate(void)
+{
+    uint32_t now = HAL_GetTick();
+    Health_RecordIoSample(ANALOG_FRAME_PERIOD_MS, now - analogUpdateTick);
+    analogUpdateTick = now;
+    
+    uint32_t updateStart = PERF_START();
+    AnalogInput_Update();
+    PERF_STOP(PERF_PROBE_IO_UPDATE, updateStart);
+    
+    uint8_t image[TOTAL_ANALOG_CHANNELS * 2];
+    uint16_t length = Build_AnalogImage(image, sizeof(image));
+    CanFd_PublishImage(image, length);
+    
+    /* Subscribed streams due in this slot, from the fresh sample */
+    Stream_Service();
+}
+
+/**
+ * @brief  Build the process image (CAN-FD image and SYNC snapshot)
+ * @note   Raw 4-20mA then voltage channels, 2 bytes each
+ * @param  buffer: Output buffer (TOTAL_ANALOG_CHANNELS * 2)
+ * @param  bufferSize: Buffer size
+ * @retval Image length, 0 if the buffer is too small
+ */
+static uint16_t Build_AnalogImage(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < TOTAL_ANALOG_CHANNELS * 2) {
+        return 0;
+    }
+    
+    for (uint8_t i = 0; i < NUM_420MA_CHANNELS; i++) {
+        uint16_t raw = AnalogInput_Get420mA_Raw(i);
+        memcpy(&buffer[i * 2], &raw, 2);
+    }
+    for (uint8_t i = 0; i < NUM_VOLTAGE_CHANNELS; i++) {
+        uint16_t raw = AnalogInput_GetVoltage_Raw(i);
+        memcpy(&buffer[(NUM_420MA_CHANNELS + i) * 2], &raw, 2);
+    }
+    return TOTAL_ANALOG_CHANNELS * 2;
+}
+
+/**
+ * @brief  Status LED blink task (500 ms)
+ * @retval None
+ */
+static void Task_StatusLed(void)
+{
+    HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_1); // Status LED
+}
+
+/**
+ * @brief  Periodic heartbeat logging task (10 s)
+ * @retval None
+ */
+static void Task_Heartbeat(void)
+{
+    RS485_Status_t* status = RS485_GetStatus();
+    DEBUG_INFO("Heartbeat: Uptime=%lu RX=%lu TX=%lu Err=%lu Health=%d%%", 
+               status->uptime, status->rxPacketCount, 
+               status->txPacketCount, status->errorCount, status->health);
+}
+
+/**
+ * @brief  UART error callback (debug and RS485 ports)
+ * @param  huart: UART handle
+ * @retval None
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    Debug_UART_ErrorCallback(huart);
+    RS485_UART_ErrorCallback(huart);
+}
+
 /**
  * @brief  Handle Read 4-20mA command
+ * @note   Optional data: [format][flags], see AnalogFormat_t.
+ *         No data selects the legacy raw + float format.
  * @param  packet: Received packet
  * @retval None
  */
 void HandleRead420mA(const RS485_Packet_t* packet)
 {
-    DEBUG_INFO("READ_420MA command from 0x%02X", packet->srcAddr);
+    AnalogFormat_t format = (packet->length >= 1) ? 
+                            (AnalogFormat_t)packet->data[0] : ANALOG_FORMAT_LEGACY;
+    uint8_t flags = (packet->length >= 2) ? packet->data[1] : 0;
     
-    // Get all 4-20mA values: raw ADC (uint16) + float (26 channels × 6 bytes = 156 bytes)
-    uint8_t analogData[NUM_420MA_CHANNELS * 6];
+    DEBUG_INFO("READ_420MA command from 0x%02X (format %d)", packet->srcAddr, format);
     
-    for (uint8_t i = 0; i < NUM_420MA_CHANNELS; i++) {
-        uint16_t raw = AnalogInput_Get420mA_Raw(i);
-        float value = AnalogInput_Get420mA_Current(i);
-        
-        // Pack: raw (2 bytes) + float (4 bytes)
-        memcpy(&analogData[i * 6], &raw, 2);
-        memcpy(&analogData[i * 6 + 2], &value, 4);
-        
-        if (i < 5) {  // Debug first 5 channels
-            DEBUG_DEBUG("AI%d: RAW=%u, %.2f mA", i, raw, value);
-        }
+    // Largest format is legacy: raw ADC (uint16) + float (26 channels × 6 bytes = 156 bytes)
+    uint8_t analogData[ANALOG_420_MAX_PAYLOAD];
+    uint16_t length = AnalogInput_Encode420mA(format, flags, analogData, sizeof(analogData));
+    
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
     }
     
-    RS485_SendResponse(packet->srcAddr, CMD_ANALOG_420_RESPONSE, 
-                      analogData, sizeof(analogData));
+    for (uint8_t i = 0; i < 5; i++) {  // Debug first 5 channels
+        DEBUG_DEBUG("AI%d: RAW=%u, %.2f mA", i, AnalogInput_Get420mA_Raw(i), 
+                    AnalogInput_Get420mA_Current(i));
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_ANALOG_420_RESPONSE, analogData, length);
     
-    DEBUG_INFO("4-20mA data sent (26 channels, 156 bytes)");
+    DEBUG_INFO("4-20mA data sent (26 channels, %d bytes)", length);
 }
 
 /**
  * @brief  Handle Read Voltage command
+ * @note   Optional data: [format][flags], see AnalogFormat_t.
+ *         No data selects the legacy raw + float format.
  * @param  packet: Received packet
  * @retval None
  */
 void HandleReadVoltage(const RS485_Packet_t* packet)
 {
-    DEBUG_INFO("READ_VOLTAGE command from 0x%02X", packet->srcAddr);
+    AnalogFormat_t format = (packet->length >= 1) ? 
+                            (AnalogFormat_t)packet->data[0] : ANALOG_FORMAT_LEGACY;
+    uint8_t flags = (packet->length >= 2) ? packet->data[1] : 0;
+    
+    DEBUG_INFO("READ_VOLTAGE command from 0x%02X (format %d)", packet->srcAddr, format);
     
-    // Get all 0-10V values: raw ADC (uint16) + float (6 channels × 6 bytes = 36 bytes)
-    uint8_t voltageData[NUM_VOLTAGE_CHANNELS * 6];
+    // Largest format is legacy: raw ADC (uint16) + float (6 channels × 6 bytes = 36 bytes)
+    uint8_t voltageData[ANALOG_VOLTAGE_MAX_PAYLOAD];
+    uint16_t length = AnalogInput_EncodeVoltage(format, flags, voltageData, sizeof(voltageData));
+    
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
     
     for (uint8_t i = 0; i < NUM_VOLTAGE_CHANNELS; i++) {
-        uint16_t raw = AnalogInput_GetVoltage_Raw(i);
-        float value = AnalogInput_GetVoltage_V(i);
+        DEBUG_DEBUG("V%d: RAW=%u, %.2f V", i, AnalogInput_GetVoltage_Raw(i), 
+                    AnalogInput_GetVoltage_V(i));
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_ANALOG_VOLTAGE_RESPONSE, voltageData, length);
+    
+    DEBUG_INFO("0-10V data sent (6 channels, %d bytes)", length);
+}
+
+/**
+ * @brief  Handle Read NTC command
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadNTC(const RS485_Packet_t* packet)
+{
+    DEBUG_INFO("READ_NTC command from 0x%02X", packet->srcAddr);
+    
+    // Raw ADC (uint16) + temperature (float): 4 channels × 6 bytes = 24 bytes
+    uint8_t ntcData[ANALOG_NTC_PAYLOAD];
+    AnalogInput_GetAllNTC(ntcData, sizeof(ntcData));
+    
+    for (uint8_t i = 0; i < NUM_NTC_CHANNELS; i++) {
+        DEBUG_DEBUG("NTC%d: RAW=%u, %.2f C", i, AnalogInput_GetNTC_Raw(i), 
+                    AnalogInput_GetNTC_Temperature(i));
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_NTC_RESPONSE, ntcData, sizeof(ntcData));
+}
+
+/**
+ * @brief  Handle Capture Arm command
+ * @note   Data: CaptureConfig_t (16 bytes), empty data aborts the capture.
+ *         Response carries the capture status.
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleCaptureArm(const RS485_Packet_t* packet)
+{
+    if (packet->length == 0) {
+        AnalogCapture_Abort();
+        DEBUG_INFO("Capture aborted by 0x%02X", packet->srcAddr);
+    } else if (packet->length < CAPTURE_ARM_DATA_SIZE) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    } else {
+        CaptureConfig_t config;
+        memcpy(&config.channelMask, &packet->data[0], 4);
+        memcpy(&config.sampleRateHz, &packet->data[4], 4);
+        memcpy(&config.preTrigger, &packet->data[8], 2);
+        memcpy(&config.postTrigger, &packet->data[10], 2);
+        config.triggerSource = packet->data[12];
+        config.triggerChannel = packet->data[13];
+        memcpy(&config.threshold, &packet->data[14], 2);
+        
+        if (AnalogCapture_Arm(&config) != HAL_OK) {
+            RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+            return;
+        }
+    }
+    
+    uint8_t statusData[CAPTURE_STATUS_DATA_SIZE];
+    uint16_t length = AnalogCapture_GetStatus(statusData, sizeof(statusData));
+    RS485_SendResponse(packet->srcAddr, CMD_CAPTURE_ARM_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle Capture Status command
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleCaptureStatus(const RS485_Packet_t* packet)
+{
+    uint8_t statusData[CAPTURE_STATUS_DATA_SIZE];
+    uint16_t length = AnalogCapture_GetStatus(statusData, sizeof(statusData));
+    RS485_SendResponse(packet->srcAddr, CMD_CAPTURE_STATUS_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle Capture Read command
+ * @note   Data: [offset:4]. Response: [offset:4][length:1][data][crc16:2],
+ *         CRC over offset, length and data. Length 0 marks the end of the capture.
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleCaptureRead(const RS485_Packet_t* packet)
+{
+    if (packet->length < 4) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    if (AnalogCapture_GetState() != CAPTURE_STATE_DONE) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_BUSY);
+        return;
+    }
+    
+    uint32_t offset;
+    memcpy(&offset, &packet->data[0], 4);
+    
+    uint8_t chunkData[4 + 1 + CAPTURE_CHUNK_SIZE + 2];
+    memcpy(&chunkData[0], &offset, 4);
+    uint16_t length = AnalogCapture_ReadChunk(offset, &chunkData[5], CAPTURE_CHUNK_SIZE);
+    chunkData[4] = (uint8_t)length;
+    
+    /* CRC includes the offset so a chunk can't be stored at the wrong place */
+    uint16_t crc = RS485_CalculateCRC(chunkData, 5 + length);
+    chunkData[5 + length] = crc & 0xFF;
+    chunkData[5 + length + 1] = (crc >> 8) & 0xFF;
+    
+    RS485_SendResponse(packet->srcAddr, CMD_CAPTURE_READ_RESPONSE, chunkData, 5 + length + 2);
+}
+
+/**
+ * @brief  Handle Capture Trigger command (external / DI edge trigger)
+ * @note   May be broadcast to trigger several controllers at once;
+ *         broadcasts are not answered
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleCaptureTrigger(const RS485_Packet_t* packet)
+{
+    AnalogCapture_ExternalTrigger();
+    
+    if (packet->destAddr != RS485_ADDR_BROADCAST) {
+        uint8_t state = (uint8_t)AnalogCapture_GetState();
+        RS485_SendResponse(packet->srcAddr, CMD_CAPTURE_TRIGGER_RESPONSE, &state, 1);
+    }
+}
+
+/**
+ * @brief  Handle Read Analog Statistics command (read-and-reset)
+ * @note   Optional data: [first channel][channel count][flags],
+ *         default is channels 0-9 with reset
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadAnalogStats(const RS485_Packet_t* packet)
+{
+    uint8_t first = (packet->length >= 1) ? packet->data[0] : 0;
+    uint8_t count = (packet->length >= 2) ? packet->data[1] : STATS_MAX_CHANNELS_PER_READ;
+    uint8_t flags = (packet->length >= 3) ? packet->data[2] : 0;
+    
+    uint8_t statsData[STATS_HEADER_SIZE + STATS_MAX_CHANNELS_PER_READ * STATS_CHANNEL_SIZE];
+    uint16_t length = AnalogStats_Read(first, count, flags, statsData, sizeof(statsData));
+    
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_ANALOG_STATS_RESPONSE, statsData, length);
+}
+
+/**
+ * @brief  Handle Set Statistics Window command
+ * @note   Optional data: [window ms:4] (0 = accumulate until read).
+ *         Response: current window [window ms:4]
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSetStatsWindow(const RS485_Packet_t* packet)
+{
+    if (packet->length >= 4) {
+        uint32_t window_ms;
+        memcpy(&window_ms, &packet->data[0], 4);
+        AnalogStats_SetWindow(window_ms);
+        DEBUG_INFO("Statistics window set to %lu ms", window_ms);
+    }
+    
+    uint32_t current = AnalogStats_GetWindow();
+    RS485_SendResponse(packet->srcAddr, CMD_STATS_WINDOW_RESPONSE, (uint8_t*)&current, 4);
+}
+
+/**
+ * @brief  Handle Spectrum Config command
+ * @note   Data: SpectrumConfig_t header (12 bytes) + [low Hz:2][high Hz:2]
+ *         per band, empty data disables the analysis.
+ *         Response: current configuration (12 bytes)
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSpectrumConfig(const RS485_Packet_t* packet)
+{
+    if (packet->length == 0) {
+        AnalogSpectrum_Disable();
+        DEBUG_INFO("Spectrum disabled");
+    } else {
+        SpectrumConfig_t config;
+        memset(&config, 0, sizeof(config));
+        
+        if (packet->length < SPECTRUM_CONFIG_HEADER_SIZE) {
+            RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+            return;
+        }
+        
+        memcpy(&config, packet->data, SPECTRUM_CONFIG_HEADER_SIZE);
+        
+        if (config.numBands > SPECTRUM_MAX_BANDS ||
+            packet->length != SPECTRUM_CONFIG_HEADER_SIZE + config.numBands * SPECTRUM_BAND_SIZE) {
+            RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+            return;
+        }
         
-        // Pack: raw (2 bytes) + float (4 bytes)
-        memcpy(&voltageData[i * 6], &raw, 2);
-        memcpy(&voltageData[i * 6 + 2], &value, 4);
+        memcpy(config.bands, &packet->data[SPECTRUM_CONFIG_HEADER_SIZE],
+               config.numBands * SPECTRUM_BAND_SIZE);
         
-        DEBUG_DEBUG("V%d: RAW=%u, %.2f V", i, raw, value);
+        if (AnalogSpectrum_Configure(&config) != HAL_OK) {
+            RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+            return;
+        }
+    }
+    
+    uint8_t configData[SPECTRUM_CONFIG_HEADER_SIZE];
+    uint16_t length = AnalogSpectrum_GetConfig(configData, sizeof(configData));
+    RS485_SendResponse(packet->srcAddr, CMD_SPECTRUM_CONFIG_RESPONSE, configData, length);
+}
+
+/**
+ * @brief  Handle Read Spectrum command
+ * @note   Response: latest analysis of all configured channels
+ *         (see AnalogSpectrum_Read)
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadSpectrum(const RS485_Packet_t* packet)
+{
+    uint8_t spectrumData[SPECTRUM_RESULT_MAX_SIZE];
+    uint16_t length = AnalogSpectrum_Read(spectrumData, sizeof(spectrumData));
+    
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_BUSY);  // Not configured
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SPECTRUM_RESPONSE, spectrumData, length);
+}
+
+/**
+ * @brief  Handle Read History command (backfill after communication loss)
+ * @note   Data: [from sequence:4] optional [max records].
+ *         Response: see History_Read
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadHistory(const RS485_Packet_t* packet)
+{
+    uint32_t fromSequence = 0;
+    uint8_t maxRecords = (packet->length >= 5) ? packet->data[4] : 0;
+    
+    if (packet->length >= 4) {
+        memcpy(&fromSequence, &packet->data[0], 4);
+    }
+    
+    uint8_t historyData[HISTORY_MAX_RESPONSE];
+    uint16_t length = History_Read(fromSequence, maxRecords, historyData, sizeof(historyData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_HISTORY_RESPONSE, historyData, length);
+}
+
+/**
+ * @brief  Handle Get Routes command (CAN-FD gateway routing table)
+ * @note   Data: optional [flags] [first route]; GATEWAY_ROUTES_FLAG_DISCOVER
+ *         broadcasts a discovery, its answers show in the next read.
+ *         Response: see Gateway_ReadRoutes
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleGetRoutes(const RS485_Packet_t* packet)
+{
+    uint8_t flags = (packet->length >= 1) ? packet->data[0] : 0;
+    uint8_t start = (packet->length >= 2) ? packet->data[1] : 0;
+    
+    if (flags & GATEWAY_ROUTES_FLAG_DISCOVER) {
+        Gateway_Discover();
+    }
+    
+    uint8_t routesData[GATEWAY_ROUTES_RESPONSE_SIZE];
+    uint16_t length = Gateway_ReadRoutes(routesData, sizeof(routesData), start);
+    
+    RS485_SendResponse(packet->srcAddr, CMD_ROUTES_RESPONSE, routesData, length);
+}
+
+/**
+ * @brief  Handle SYNC broadcast (latch the snapshot)
+ * @note   Data: [sequence:2]. No response: sent to all nodes at once
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSync(const RS485_Packet_t* packet)
+{
+    BusSync_Latch(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Read Snapshot command (image frozen by the last SYNC)
+ * @note   Response: see BusSync_ReadSnapshot
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadSnapshot(const RS485_Packet_t* packet)
+{
+    uint8_t snapshotData[BUS_SYNC_SNAPSHOT_SIZE];
+    uint16_t length = BusSync_ReadSnapshot(snapshotData, sizeof(snapshotData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SNAPSHOT_RESPONSE, snapshotData, length);
+}
+
+/**
+ * @brief  Handle SYNC Mode command (output mode and sync statistics)
+ * @note   Data: empty to read, or [mode] (BUS_SYNC_MODE_xxx).
+ *         Response: see BusSync_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSyncMode(const RS485_Packet_t* packet)
+{
+    if (packet->length > 0 && !BusSync_SetMode(packet->data[0])) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
     }
     
-    RS485_SendResponse(packet->srcAddr, CMD_ANALOG_VOLTAGE_RESPONSE, 
-                      voltageData, sizeof(voltageData));
+    uint8_t statusData[BUS_SYNC_STATUS_SIZE];
+    uint16_t length = BusSync_ReadStatus(statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SYNC_MODE_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle TIME_SYNC broadcast (master time for the bus clock)
+ * @note   Data: [sequence][flags][master time us:8]. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleTimeSync(const RS485_Packet_t* packet)
+{
+    TimeSync_HandleFrame(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle BUS_BEACON broadcast (TDMA cycle and slots)
+ * @note   Data: see BusAccess_HandleBeacon. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleBusBeacon(const RS485_Packet_t* packet)
+{
+    BusAccess_HandleBeacon(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Stream Subscribe command (subscribe, renew, cancel)
+ * @note   Data/response: see Stream_Subscribe
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleStreamSubscribe(const RS485_Packet_t* packet)
+{
+    uint8_t subscribeData[STREAM_SUBSCRIBE_SIZE];
+    uint16_t length = Stream_Subscribe(packet->data, packet->length, packet->srcAddr,
+                                       subscribeData, sizeof(subscribeData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_STREAM_SUBSCRIBE_RESPONSE, subscribeData, length);
+}
+
+/**
+ * @brief  Handle Stream Status command (active streams, renews leases)
+ * @note   Response: see Stream_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleStreamStatus(const RS485_Packet_t* packet)
+{
+    uint8_t statusData[STREAM_STATUS_SIZE];
+    uint16_t length = Stream_ReadStatus(packet->srcAddr, statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_STREAM_STATUS_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle Segmented Transfer Open command
+ * @note   Data/response: see SegTransfer_Open
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegOpen(const RS485_Packet_t* packet)
+{
+    uint8_t openData[SEG_TRANSFER_OPEN_SIZE];
+    uint16_t length = SegTransfer_Open(packet->data, packet->length, openData, sizeof(openData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
     
-    DEBUG_INFO("0-10V data sent (6 channels, 36 bytes)");
+    RS485_SendResponse(packet->srcAddr, CMD_SEG_OPEN_RESPONSE, openData, length);
 }
 
+/**
+ * @brief  Handle Segmented Transfer Read command (acknowledge + request window)
+ * @note   Data: see SegTransfer_RequestWindow. Answered with CMD_SEG_DATA
+ *         segments from the seg_transfer task, errors right away
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegRead(const RS485_Packet_t* packet)
+{
+    uint8_t result = SegTransfer_RequestWindow(packet->data, packet->length, packet->srcAddr);
+    if (result == SEG_RESULT_SIZE) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+    } else if (result != SEG_RESULT_OK) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+    }
+}
+
+/**
+ * @brief  Handle Segmented Transfer Data (write segment from the master)
+ * @note   Data: [transfer id][offset:4][data]. No response: segments are
+ *         streamed, CMD_SEG_ACK reports what arrived
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegData(const RS485_Packet_t* packet)
+{
+    SegTransfer_ReceiveData(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Segmented Transfer Acknowledge command
+ * @note   Data/response: see SegTransfer_Acknowledge
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegAck(const RS485_Packet_t* packet)
+{
+    uint8_t ackData[SEG_TRANSFER_ACK_SIZE];
+    uint16_t length = SegTransfer_Acknowledge(packet->data, packet->length, ackData, sizeof(ackData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SEG_ACK_RESPONSE, ackData, length);
+}
 
 /* USER CODE END 4 */
 
@@ -613,6 +1263,21 @@ void MPU_Config(void)
   MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
   MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
 
+  HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /** Initializes and configures the Region and the memory to be protected
+  */
+  MPU_InitStruct.Number = MPU_REGION_NUMBER1;
+  MPU_InitStruct.BaseAddress = 0x30000000;
+  MPU_InitStruct.Size = MPU_REGION_SIZE_32KB;
+  MPU_InitStruct.SubRegionDisable = 0x0;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+  MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+
   HAL_MPU_ConfigRegion(&MPU_InitStruct);
   /* Enables the MPU */
   HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * @file           : ntc_table.c
+ * @brief          : NTC Lookup Table (generated by Scripts/gen_ntc_table.py)
+ ******************************************************************************
+ */
+
+#include "ntc_table.h"
+
+const int16_t ntcTable[NTC_TABLE_SIZE] = {
+     15000,  15000,  15000,  15000,  15000,  15000,  14182,  13504,
+     12932,  12439,  12006,  11620,  11274,  10959,  10671,  10406,
+     10160,   9931,   9717,   9516,   9326,   9147,   8976,   8815,
+      8660,   8513,   8372,   8237,   8107,   7982,   7862,   7745,
+      7633,   7524,   7419,   7317,   7218,   7122,   7028,   6937,
+      6849,   6762,   6678,   6596,   6515,   6436,   6360,   6284,
+      6211,   6138,   6068,   5998,   5930,   5863,   5797,   5733,
+      5669,   5607,   5545,   5485,   5425,   5367,   5309,   5252,
+      5196,   5141,   5086,   5032,   4979,   4926,   4874,   4823,
+      4772,   4722,   4673,   4624,   4575,   4527,   4480,   4433,
+      4387,   4341,   4295,   4250,   4205,   4161,   4117,   4073,
+      4030,   3987,   3944,   3902,   3860,   3819,   3777,   3736,
+      3696,   3655,   3615,   3575,   3535,   3496,   3457,   3418,
+      3379,   3341,   3302,   3264,   3226,   3189,   3151,   3114,
+      3076,   3039,   3003,   2966,   2929,   2893,   2857,   2820,
+      2784,   2748,   2713,   2677,   2641,   2606,   2570,   2535,
+      2500,   2465,   2430,   2395,   2360,   2325,   2290,   2256,
+      2221,   2186,   2152,   2117,   2083,   2048,   2014,   1979,
+      1945,   1910,   1876,   1842,   1807,   1773,   1739,   1704,
+      1670,   1635,   1601,   1566,   1532,   1497,   1462,   1428,
+      1393,   1358,   1323,   1288,   1253,   1218,   1183,   1148,
+      1112,   1077,   1041,   1006,    970,    934,    898,    862,
+       825,    789,    752,    715,    678,    641,    603,    566,
+       528,    490,    452,    413,    374,    335,    296,    257,
+       217,    177,    136,     95,     54,     13,    -29,    -71,
+      -114,   -157,   -200,   -244,   -289,   -333,   -379,   -425,
+      -471,   -518,   -566,   -614,   -663,   -713,   -764,   -815,
+      -867,   -920,   -974,  -1028,  -1084,  -1141,  -1199,  -1258,
+     -1319,  -1380,  -1444,  -1508,  -1575,  -1643,  -1713,  -1785,
+     -1859,  -1936,  -2015,  -2097,  -2182,  -2271,  -2363,  -2459,
+     -2560,  -2667,  -2779,  -2897,  -3024,  -3159,  -3305,  -3464,
+     -3638,  -3832,  -4051,  -4303,  -4604,  -4979,  -5485,  -5500,
+     -5500
+};
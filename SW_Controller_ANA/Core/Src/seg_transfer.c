@@ -0,0 +1,475 @@
+/**
+ ******************************************************************************
+ * @file           : seg_transfer.c
+ * @brief          : Segmented Transfer of Large Objects Implementation
+ ******************************************************************************
+ * @attention
+ *
+ * One transfer is open at a time; opening another one closes it. Read
+ * segments are sent from SegTransfer_Process, one per call, so a window
+ * does not block the scheduler for its whole duration. On RS485 each
+ * segment waits for the line to be idle, like the gateway relay.
+ *
+ ******************************************************************************
+ */
+
+#include "seg_transfer.h"
+#include "rs485_protocol.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Transfer State */
+typedef struct {
+    const SegTransfer_Object_t* object;
+    uint8_t id;                     // 0 = no transfer open
+    uint8_t direction;
+    uint32_t size;
+    uint32_t crc;
+    uint16_t segments;
+    uint32_t lastTick;
+    /* Read */
+    uint16_t windowBase;
+    uint16_t pendingMask;           // Bit n: segment windowBase + n still to send
+    uint16_t sentHigh;              // Segments below this were sent at least once
+    uint8_t peer;
+    RS485_Transport_t transport;
+    /* Write */
+    uint8_t received[SEG_TRANSFER_MAX_SEGMENTS / 8];
+    uint16_t receivedCount;
+} SegTransfer_State_t;
+
+/* Private Variables */
+static const SegTransfer_Object_t* objects[SEG_TRANSFER_MAX_OBJECTS];
+static uint8_t objectCount = 0;
+static SegTransfer_State_t transfer = {0};
+static uint8_t nextId = 1;
+static uint8_t closedId = 0;               // Last closed write transfer (repeated ACK)
+static uint8_t closedResult = SEG_RESULT_NO_TRANSFER;
+static uint8_t closedCode = 0;
+static uint32_t crcTable[256];
+static SegTransfer_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static const SegTransfer_Object_t* Find_Object(uint8_t id);
+static uint32_t Object_Crc32(const SegTransfer_Object_t* object, uint32_t size);
+static uint16_t Next_Missing(void);
+static void Close_Transfer(uint8_t result, uint8_t code);
+
+/**
+ * @brief  Initialize segmented transfers (no object registered)
+ * @retval None
+ */
+void SegTransfer_Init(void)
+{
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320U : (crc >> 1);
+        }
+        crcTable[n] = crc;
+    }
+
+    objectCount = 0;
+    memset(&transfer, 0, sizeof(transfer));
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief  Register an object for transfers
+ * @param  object: Descriptor, must stay valid (static)
+ * @retval 1 if registered, 0 if the table is full
+ */
+uint8_t SegTransfer_Register(const SegTransfer_Object_t* object)
+{
+    if (objectCount >= SEG_TRANSFER_MAX_OBJECTS) {
+        return 0;
+    }
+
+    objects[objectCount++] = object;
+    return 1;
+}
+
+/**
+ * @brief  Send the next requested read segment, close idle transfers
+ *         (periodic task, 1 ms)
+ * @retval None
+ */
+void SegTransfer_Process(void)
+{
+    if (transfer.id == 0) {
+        return;
+    }
+
+    if ((HAL_GetTick() - transfer.lastTick) > SEG_TRANSFER_TIMEOUT_MS) {
+        DEBUG_WARNING("Seg transfer %d: timed out", transfer.id);
+        stats.timeouts++;
+        Close_Transfer(SEG_RESULT_NO_TRANSFER, 0);
+        return;
+    }
+
+    if (transfer.direction != SEG_DIR_READ || transfer.pendingMask == 0) {
+        return;
+    }
+    if (transfer.transport == RS485_TRANSPORT_SERIAL && !RS485_IsLineIdle()) {
+        return;
+    }
+
+    uint8_t slot = 0;
+    while (!(transfer.pendingMask & (1U << slot))) {
+        slot++;
+    }
+    transfer.pendingMask &= (uint16_t)~(1U << slot);
+
+    uint16_t segment = transfer.windowBase + slot;
+    uint32_t offset = (uint32_t)segment * SEG_TRANSFER_SEGMENT_SIZE;
+    uint32_t length = transfer.size - offset;
+    if (length > SEG_TRANSFER_SEGMENT_SIZE) {
+        length = SEG_TRANSFER_SEGMENT_SIZE;
+    }
+
+    uint8_t frame[SEG_TRANSFER_DATA_HEADER + SEG_TRANSFER_SEGMENT_SIZE];
+    frame[0] = transfer.id;
+    memcpy(&frame[1], &offset, 4);
+    length = transfer.object->read(offset, &frame[SEG_TRANSFER_DATA_HEADER], (uint16_t)length);
+
+    if (segment < transfer.sentHigh) {
+        stats.retransmissions++;
+    } else {
+        transfer.sentHigh = segment + 1;
+    }
+    stats.segmentsSent++;
+
+    RS485_SendPacketVia(transfer.transport, transfer.peer, CMD_SEG_DATA, frame,
+                        (uint8_t)(SEG_TRANSFER_DATA_HEADER + length));
+}
+
+/**
+ * @brief  Open a transfer (CMD_SEG_OPEN)
+ * @note   Read: the CRC32 of the object is computed here, a later change of
+ *         the object shows as a CRC mismatch on the master
+ * @param  data: [object][direction][size:4][crc32:4], size and CRC for writes only
+ * @param  length: Data length
+ * @param  response: [result][transfer id][size:4][crc32:4][segment size][window]
+ * @param  responseSize: Response buffer size (SEG_TRANSFER_OPEN_SIZE)
+ * @retval Response length, 0 on a malformed request
+ */
+uint16_t SegTransfer_Open(const uint8_t* data, uint16_t length, uint8_t* response, uint16_t responseSize)
+{
+    if (length < 2 || responseSize < SEG_TRANSFER_OPEN_SIZE) {
+        return 0;
+    }
+
+    uint8_t direction = data[1];
+    if (direction == SEG_DIR_WRITE && length < 10) {
+        return 0;
+    }
+
+    if (transfer.id != 0) {
+        Close_Transfer(SEG_RESULT_NO_TRANSFER, 0);
+    }
+
+    const SegTransfer_Object_t* object = Find_Object(data[0]);
+    uint8_t result = SEG_RESULT_OK;
+    uint32_t size = 0;
+    uint32_t crc = 0;
+
+    if (object == NULL ||
+        (direction == SEG_DIR_READ && (object->size == NULL || object->read == NULL)) ||
+        (direction == SEG_DIR_WRITE && (object->buffer == NULL || object->commit == NULL)) ||
+        direction > SEG_DIR_WRITE) {
+        result = SEG_RESULT_NO_OBJECT;
+    } else if (direction == SEG_DIR_READ) {
+        size = object->size();
+        if (size == 0 || size > (uint32_t)UINT16_MAX * SEG_TRANSFER_SEGMENT_SIZE) {
+            result = SEG_RESULT_SIZE;
+        } else {
+            crc = Object_Crc32(object, size);
+        }
+    } else {
+        memcpy(&size, &data[2], 4);
+        memcpy(&crc, &data[6], 4);
+        if (size == 0 || size > object->capacity ||
+            size > (uint32_t)SEG_TRANSFER_MAX_SEGMENTS * SEG_TRANSFER_SEGMENT_SIZE) {
+            result = SEG_RESULT_SIZE;
+        }
+    }
+
+    if (result == SEG_RESULT_OK) {
+        memset(&transfer, 0, sizeof(transfer));
+        transfer.object = object;
+        transfer.id = nextId;
+        transfer.direction = direction;
+        transfer.size = size;
+        transfer.crc = crc;
+        transfer.segments = (uint16_t)((size + SEG_TRANSFER_SEGMENT_SIZE - 1) / SEG_TRANSFER_SEGMENT_SIZE);
+        transfer.lastTick = HAL_GetTick();
+
+        nextId = (nextId == UINT8_MAX) ? 1 : nextId + 1;
+        stats.transfers++;
+        DEBUG_INFO("Seg transfer %d: %s object 0x%02X, %lu bytes", transfer.id,
+                   (direction == SEG_DIR_READ) ? "read" : "write", object->id, size);
+    }
+
+    response[0] = result;
+    response[1] = transfer.id;
+    memcpy(&response[2], &size, 4);
+    memcpy(&response[6], &crc, 4);
+    response[10] = SEG_TRANSFER_SEGMENT_SIZE;
+    response[11] = SEG_TRANSFER_WINDOW;
+
+    return SEG_TRANSFER_OPEN_SIZE;
+}
+
+/**
+ * @brief  Acknowledge and request read segments (CMD_SEG_READ)
+ * @note   Replaces the previous window. A first segment past the end
+ *         completes the transfer.
+ * @param  data: [transfer id][first segment:2][bitmap:2], bit n = segment first + n
+ * @param  length: Data length
+ * @param  srcAddr: Requesting node, receives the CMD_SEG_DATA segments
+ * @retval SEG_RESULT_OK, SEG_RESULT_NO_TRANSFER or SEG_RESULT_SIZE (malformed)
+ */
+uint8_t SegTransfer_RequestWindow(const uint8_t* data, uint16_t length, uint8_t srcAddr)
+{
+    if (length < 5) {
+        return SEG_RESULT_SIZE;
+    }
+    if (transfer.id == 0 || data[0] != transfer.id || transfer.direction != SEG_DIR_READ) {
+        return SEG_RESULT_NO_TRANSFER;
+    }
+
+    uint16_t first;
+    uint16_t bitmap;
+    memcpy(&first, &data[1], 2);
+    memcpy(&bitmap, &data[3], 2);
+
+    if (first >= transfer.segments) {
+        stats.completed++;
+        DEBUG_INFO("Seg transfer %d: read complete", transfer.id);
+        Close_Transfer(SEG_RESULT_OK, 0);
+        return SEG_RESULT_OK;
+    }
+
+    /* Drop bits past the last segment */
+    uint16_t remaining = transfer.segments - first;
+    if (remaining < SEG_TRANSFER_WINDOW) {
+        bitmap &= (uint16_t)((1U << remaining) - 1);
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    transfer.windowBase = first;
+    transfer.pendingMask = bitmap;
+    __set_PRIMASK(primask);
+
+    transfer.peer = srcAddr;
+    transfer.transport = RS485_GetReplyTransport();
+    transfer.lastTick = HAL_GetTick();
+    return SEG_RESULT_OK;
+}
+
+/**
+ * @brief  Store a write segment (CMD_SEG_DATA from the master, no response)
+ * @note   Segments of other transfers or off the segment grid are dropped
+ * @param  data: [transfer id][offset:4][data]
+ * @param  length: Data length
+ * @retval None
+ */
+void SegTransfer_ReceiveData(const uint8_t* data, uint16_t length)
+{
+    if (length <= SEG_TRANSFER_DATA_HEADER || transfer.id == 0 ||
+        data[0] != transfer.id || transfer.direction != SEG_DIR_WRITE) {
+        return;
+    }
+
+    uint32_t offset;
+    memcpy(&offset, &data[1], 4);
+    uint16_t payload = length - SEG_TRANSFER_DATA_HEADER;
+
+    if ((offset % SEG_TRANSFER_SEGMENT_SIZE) != 0 || offset >= transfer.size ||
+        payload != ((transfer.size - offset < SEG_TRANSFER_SEGMENT_SIZE) ?
+                    transfer.size - offset : SEG_TRANSFER_SEGMENT_SIZE)) {
+        return;
+    }
+
+    uint16_t segment = offset / SEG_TRANSFER_SEGMENT_SIZE;
+    transfer.lastTick = HAL_GetTick();
+
+    if (transfer.received[segment / 8] & (1U << (segment % 8))) {
+        stats.duplicates++;
+        return;
+    }
+
+    memcpy(&transfer.object->buffer[offset], &data[SEG_TRANSFER_DATA_HEADER], payload);
+    transfer.received[segment / 8] |= (uint8_t)(1U << (segment % 8));
+    transfer.receivedCount++;
+    stats.segmentsReceived++;
+}
+
+/**
+ * @brief  Report received write segments, commit a complete object (CMD_SEG_ACK)
+ * @note   The result of the last committed transfer is repeated if the
+ *         response was lost. Abort closes the transfer (any direction).
+ * @param  data: [transfer id][flags]
+ * @param  length: Data length
+ * @param  response: [result][transfer id][next missing:2][received bitmap:2][object code],
+ *         bit n = segment next + 1 + n received
+ * @param  responseSize: Response buffer size (SEG_TRANSFER_ACK_SIZE)
+ * @retval Response length, 0 on a malformed request
+ */
+uint16_t SegTransfer_Acknowledge(const uint8_t* data, uint16_t length, uint8_t* response, uint16_t responseSize)
+{
+    if (length < 2 || responseSize < SEG_TRANSFER_ACK_SIZE) {
+        return 0;
+    }
+
+    uint8_t id = data[0];
+    uint8_t result = SEG_RESULT_PENDING;
+    uint8_t code = 0;
+    uint16_t next = 0;
+    uint16_t bitmap = 0;
+
+    if (transfer.id == 0 || id != transfer.id) {
+        result = (id != 0 && id == closedId) ? closedResult : SEG_RESULT_NO_TRANSFER;
+        code = (id == closedId) ? closedCode : 0;
+    } else if (data[1] & SEG_ACK_FLAG_ABORT) {
+        DEBUG_INFO("Seg transfer %d: aborted", transfer.id);
+        Close_Transfer(SEG_RESULT_NO_TRANSFER, 0);
+        result = SEG_RESULT_NO_TRANSFER;
+    } else if (transfer.direction == SEG_DIR_READ) {
+        next = transfer.windowBase;
+    } else if (transfer.receivedCount < transfer.segments) {
+        next = Next_Missing();
+        for (uint8_t n = 0; n < 16 && next + 1 + n < transfer.segments; n++) {
+            uint16_t segment = next + 1 + n;
+            if (transfer.received[segment / 8] & (1U << (segment % 8))) {
+                bitmap |= (uint16_t)(1U << n);
+            }
+        }
+        transfer.lastTick = HAL_GetTick();
+    } else {
+        next = transfer.segments;
+        if (SegTransfer_Crc32(0, transfer.object->buffer, transfer.size) != transfer.crc) {
+            stats.crcErrors++;
+            result = SEG_RESULT_CRC;
+            DEBUG_WARNING("Seg transfer %d: CRC32 mismatch", transfer.id);
+        } else {
+            code = transfer.object->commit(transfer.object->buffer, transfer.size);
+            result = (code == 0) ? SEG_RESULT_OK : SEG_RESULT_REJECTED;
+            if (code == 0) {
+                stats.completed++;
+            }
+            DEBUG_INFO("Seg transfer %d: write complete, object code %d", transfer.id, code);
+        }
+        Close_Transfer(result, code);
+    }
+
+    response[0] = result;
+    response[1] = id;
+    memcpy(&response[2], &next, 2);
+    memcpy(&response[4], &bitmap, 2);
+    response[6] = code;
+
+    return SEG_TRANSFER_ACK_SIZE;
+}
+
+/**
+ * @brief  Update a CRC32 (IEEE 802.3, same as zlib.crc32)
+ * @param  crc: CRC of the data so far, 0 to start
+ * @param  data: Data
+ * @param  length: Data length
+ * @retval Updated CRC
+ */
+uint32_t SegTransfer_Crc32(uint32_t crc, const uint8_t* data, uint32_t length)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief  Get transfer statistics
+ * @retval Statistics
+ */
+const SegTransfer_Stats_t* SegTransfer_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Find a registered object
+ * @param  id: SEG_OBJECT_xxx
+ * @retval Object, NULL if not registered
+ */
+static const SegTransfer_Object_t* Find_Object(uint8_t id)
+{
+    for (uint8_t i = 0; i < objectCount; i++) {
+        if (objects[i]->id == id) {
+            return objects[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  CRC32 of a read object, read in segment-sized pieces
+ * @param  object: Read object
+ * @param  size: Object size
+ * @retval CRC32
+ */
+static uint32_t Object_Crc32(const SegTransfer_Object_t* object, uint32_t size)
+{
+    uint8_t chunk[SEG_TRANSFER_SEGMENT_SIZE];
+    uint32_t crc = 0;
+
+    for (uint32_t offset = 0; offset < size; ) {
+        uint32_t length = size - offset;
+        if (length > sizeof(chunk)) {
+            length = sizeof(chunk);
+        }
+        uint16_t got = object->read(offset, chunk, (uint16_t)length);
+        if (got == 0) {
+            break;
+        }
+        crc = SegTransfer_Crc32(crc, chunk, got);
+        offset += got;
+    }
+    return crc;
+}
+
+/**
+ * @brief  First write segment not received yet
+ * @retval Segment index, transfer.segments if complete
+ */
+static uint16_t Next_Missing(void)
+{
+    for (uint16_t segment = 0; segment < transfer.segments; segment++) {
+        if (!(transfer.received[segment / 8] & (1U << (segment % 8)))) {
+            return segment;
+        }
+    }
+    return transfer.segments;
+}
+
+/**
+ * @brief  Close the open transfer, keep its result for a repeated ACK
+ * @param  result: SEG_RESULT_xxx
+ * @param  code: Object code
+ * @retval None
+ */
+static void Close_Transfer(uint8_t result, uint8_t code)
+{
+    closedId = transfer.id;
+    closedResult = result;
+    closedCode = code;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    transfer.id = 0;
+    transfer.pendingMask = 0;
+    __set_PRIMASK(primask);
+}
@@ -21,6 +21,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 /* USER CODE BEGIN Includes */
+#include "scheduler.h"
 
 /* USER CODE END Includes */
 
@@ -368,6 +369,11 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
     /* USER CODE BEGIN USART2_MspInit 1 */
 
     /* NVIC already configured by CubeMX above */
+#if SCHED_USE_FREERTOS
+    /* The RX interrupt posts scheduler events: keep it within the kernel's
+     * syscall priority range */
+    HAL_NVIC_SetPriority(USART2_IRQn, SCHED_RTOS_IRQ_PRIORITY, 0);
+#endif
 
     /* USER CODE END USART2_MspInit 1 */
   }
@@ -22,6 +22,12 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "perf_monitor.h"
+#include "scheduler.h"
+#if SCHED_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -41,11 +47,17 @@
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN PV */
+#if SCHED_USE_FREERTOS
+extern void xPortSysTickHandler(void);
+#endif
 
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
+/* Interrupt entry of the RS485 byte path and the tick: run from ITCM */
+ITCM_TEXT void USART2_IRQHandler(void);
+ITCM_TEXT void SysTick_Handler(void);
 
 /* USER CODE END PFP */
 
@@ -58,6 +70,8 @@
 extern UART_HandleTypeDef huart1;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
+extern FDCAN_HandleTypeDef hfdcan1;
+extern DMA_HandleTypeDef hdma_usart1_tx;
 
 /* USER CODE END EV */
 
@@ -139,6 +153,7 @@ void UsageFault_Handler(void)
   }
 }
 
+#if !SCHED_USE_FREERTOS
 /**
   * @brief This function handles System service call via SWI instruction.
   */
@@ -151,6 +166,7 @@ void SVC_Handler(void)
 
   /* USER CODE END SVCall_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles Debug monitor.
@@ -165,6 +181,7 @@ void DebugMon_Handler(void)
   /* USER CODE END DebugMonitor_IRQn 1 */
 }
 
+#if !SCHED_USE_FREERTOS
 /**
   * @brief This function handles Pendable request for system service.
   */
@@ -177,6 +194,7 @@ void PendSV_Handler(void)
 
   /* USER CODE END PendSV_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles System tick timer.
@@ -184,11 +202,16 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+#if SCHED_USE_FREERTOS
+  /* Kernel tick once the scheduler runs */
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    xPortSysTickHandler();
+  }
+#endif
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  Sched_TickHandler();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -219,11 +242,12 @@ void USART1_IRQHandler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
+  uint32_t isrStart = PERF_START();
 
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
-
+  PERF_STOP(PERF_PROBE_RS485_ISR, isrStart);
   /* USER CODE END USART2_IRQn 1 */
 }
 
@@ -231,4 +255,20 @@ void USART2_IRQHandler(void)
 
 /* USART2_IRQHandler already generated by CubeMX above */
 
+/**
+  * @brief This function handles DMA1 stream0 global interrupt (debug UART TX).
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart1_tx);
+}
+
+/**
+  * @brief This function handles FDCAN1 interrupt 0 (controller protocol over CAN-FD).
+  */
+void FDCAN1_IT0_IRQHandler(void)
+{
+  HAL_FDCAN_IRQHandler(&hfdcan1);
+}
+
 /* USER CODE END 1 */
@@ -0,0 +1,296 @@
+/**
+ ******************************************************************************
+ * @file           : time_sync.c
+ * @brief          : Bus-Wide Time Synchronization Implementation
+ ******************************************************************************
+ * @attention
+ *
+ * Bus time = anchorBusUs + elapsed + elapsed * ratePpb / 1e9, with elapsed
+ * the local microseconds since anchorLocalUs. Each sample moves the anchor
+ * to the sample instant (keeping the bus time continuous) and sets the rate.
+ * The model is read from any task, so it is updated and read with
+ * interrupts disabled.
+ *
+ ******************************************************************************
+ */
+
+#include "time_sync.h"
+#include "rs485_protocol.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Ignore samples closer than this (frequency estimate too coarse) */
+#define TIME_SYNC_MIN_INTERVAL_US   100000
+
+/* Private Variables */
+static uint32_t cyclesPerUs = 1;
+static uint32_t lastCycles = 0;            // 64-bit extension of DWT->CYCCNT
+static uint32_t cyclesHigh = 0;
+static uint64_t anchorLocalUs = 0;
+static uint64_t anchorBusUs = 0;
+static int32_t ratePpb = 0;
+static uint8_t state = TIME_SYNC_STATE_FREE;
+static uint8_t lockCount = 0;
+static uint64_t lastSampleLocalUs = 0;
+static uint32_t lastSampleTick = 0;
+static uint8_t pendingValid = 0;           // Two-step: reception of the previous frame
+static uint8_t pendingSequence = 0;
+static uint64_t pendingLocalUs = 0;
+static TimeSync_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static uint64_t Local_Us(uint32_t cycles);
+static uint64_t Bus_Time(uint64_t localUs);
+static void Apply_Sample(uint64_t localUs, uint64_t masterUs);
+static int32_t Clamp_Ppb(int64_t ppb);
+
+/**
+ * @brief  Initialize the bus clock (free running on local time)
+ * @retval None
+ */
+void TimeSync_Init(void)
+{
+    cyclesPerUs = SystemCoreClock / 1000000U;
+    lastCycles = DWT->CYCCNT;
+    cyclesHigh = 0;
+    anchorLocalUs = 0;
+    anchorBusUs = 0;
+    ratePpb = 0;
+    state = TIME_SYNC_STATE_FREE;
+    lockCount = 0;
+    pendingValid = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief  Keep the 64-bit cycle count and watch for a silent master (periodic task, 1 s)
+ * @retval None
+ */
+void TimeSync_Process(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    (void)Local_Us(DWT->CYCCNT);
+    __set_PRIMASK(primask);
+
+    if ((state == TIME_SYNC_STATE_SYNCED || state == TIME_SYNC_STATE_LOCKING) &&
+        (HAL_GetTick() - lastSampleTick) > TIME_SYNC_HOLDOVER_MS) {
+        state = TIME_SYNC_STATE_HOLDOVER;
+        DEBUG_WARNING("Time sync: master silent, holdover (drift %ld ppb)", stats.driftPpb);
+    }
+}
+
+/**
+ * @brief  Take a CMD_TIME_SYNC frame
+ * @note   Reception time: end byte of the frame (RS485_GetRequestCycles)
+ * @param  data: [sequence][flags][master time us:8]
+ * @param  length: Data length
+ * @retval None
+ */
+void TimeSync_HandleFrame(const uint8_t* data, uint16_t length)
+{
+    if (length < TIME_SYNC_FRAME_SIZE) {
+        return;
+    }
+
+    uint8_t sequence = data[0];
+    uint8_t flags = data[1];
+    uint64_t masterUs;
+    memcpy(&masterUs, &data[2], 8);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint64_t receivedUs = Local_Us(RS485_GetRequestCycles());
+    __set_PRIMASK(primask);
+
+    /* Follow-up time zero: first frame of a master, nothing to follow up */
+    if (!(flags & TIME_SYNC_FLAG_FOLLOW_UP)) {
+        Apply_Sample(receivedUs, masterUs);
+    } else if (masterUs != 0 && pendingValid && pendingSequence == (uint8_t)(sequence - 1)) {
+        Apply_Sample(pendingLocalUs, masterUs);
+    }
+
+    pendingValid = 1;
+    pendingSequence = sequence;
+    pendingLocalUs = receivedUs;
+}
+
+/**
+ * @brief  Get the bus time
+ * @retval Microseconds (master time base once synchronized, else since boot)
+ */
+uint64_t TimeSync_Now(void)
+{
+    return TimeSync_FromCycles(DWT->CYCCNT);
+}
+
+/**
+ * @brief  Convert a recent DWT timestamp to bus time (event logs, captures)
+ * @param  cycles: DWT->CYCCNT value, less than one wrap old
+ * @retval Bus time in microseconds
+ */
+uint64_t TimeSync_FromCycles(uint32_t cycles)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint64_t busUs = Bus_Time(Local_Us(cycles));
+    __set_PRIMASK(primask);
+
+    return busUs;
+}
+
+/**
+ * @brief  Get the synchronization state
+ * @retval TIME_SYNC_STATE_xxx
+ */
+uint8_t TimeSync_GetState(void)
+{
+    return state;
+}
+
+/**
+ * @brief  Read the telemetry section (RS485_TELEMETRY_SECTION_TIME)
+ * @note   Layout: [state][samples:4][steps:4][last error us:4 signed]
+ *         [max error us:4][drift ppb:4 signed][bus time us:8][last sample age ms:4]
+ * @param  buffer: Output buffer (TIME_SYNC_TELEMETRY_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t TimeSync_ReadTelemetry(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < TIME_SYNC_TELEMETRY_SIZE) {
+        return 0;
+    }
+
+    uint64_t busUs = TimeSync_Now();
+    uint32_t age = (state == TIME_SYNC_STATE_FREE) ? 0 : (HAL_GetTick() - lastSampleTick);
+
+    buffer[0] = state;
+    memcpy(&buffer[1], &stats.samples, 4);
+    memcpy(&buffer[5], &stats.steps, 4);
+    memcpy(&buffer[9], &stats.lastErrorUs, 4);
+    memcpy(&buffer[13], &stats.maxErrorUs, 4);
+    memcpy(&buffer[17], &stats.driftPpb, 4);
+    memcpy(&buffer[21], &busUs, 8);
+    memcpy(&buffer[29], &age, 4);
+
+    return TIME_SYNC_TELEMETRY_SIZE;
+}
+
+/**
+ * @brief  Get time sync statistics
+ * @retval Statistics
+ */
+const TimeSync_Stats_t* TimeSync_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Extend a DWT timestamp to 64-bit local microseconds
+ * @note   Interrupts disabled by the caller
+ * @param  cycles: DWT->CYCCNT value, less than one wrap old
+ * @retval Local microseconds since boot
+ */
+static uint64_t Local_Us(uint32_t cycles)
+{
+    uint32_t now = DWT->CYCCNT;
+    if (now < lastCycles) {
+        cyclesHigh++;
+    }
+    lastCycles = now;
+
+    uint64_t nowCycles = ((uint64_t)cyclesHigh << 32) | now;
+    return (nowCycles - (uint32_t)(now - cycles)) / cyclesPerUs;
+}
+
+/**
+ * @brief  Bus time of a local time
+ * @note   Interrupts disabled by the caller
+ * @param  localUs: Local microseconds
+ * @retval Bus microseconds
+ */
+static uint64_t Bus_Time(uint64_t localUs)
+{
+    int64_t elapsed = (int64_t)(localUs - anchorLocalUs);
+    return anchorBusUs + (uint64_t)(elapsed + elapsed * ratePpb / 1000000000LL);
+}
+
+/**
+ * @brief  Discipline the bus clock with one master timestamp
+ * @param  localUs: Local time of the timestamped frame
+ * @param  masterUs: Master time of the same frame
+ * @retval None
+ */
+static void Apply_Sample(uint64_t localUs, uint64_t masterUs)
+{
+    uint8_t stepped = 0;
+    uint8_t wasFree = (state == TIME_SYNC_STATE_FREE);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint64_t estimate = Bus_Time(localUs);
+    int64_t error = (int64_t)(masterUs - estimate);
+    int64_t interval = (int64_t)(localUs - lastSampleLocalUs);
+
+    if (state == TIME_SYNC_STATE_FREE || error > TIME_SYNC_STEP_US || error < -TIME_SYNC_STEP_US) {
+        /* Step: take the master time as is, keep the drift estimate */
+        anchorLocalUs = localUs;
+        anchorBusUs = masterUs;
+        ratePpb = stats.driftPpb;
+        state = TIME_SYNC_STATE_LOCKING;
+        lockCount = 0;
+        stats.steps++;
+        stepped = 1;
+    } else if (interval >= TIME_SYNC_MIN_INTERVAL_US) {
+        /* Frequency from the rate error, phase slewed out over the next interval */
+        int64_t rateError = error * 1000000000LL / interval;
+        stats.driftPpb = Clamp_Ppb(stats.driftPpb + rateError / TIME_SYNC_DRIFT_GAIN);
+        anchorLocalUs = localUs;
+        anchorBusUs = estimate;
+        ratePpb = Clamp_Ppb(stats.driftPpb + rateError / TIME_SYNC_PHASE_GAIN);
+
+        if (state != TIME_SYNC_STATE_SYNCED && ++lockCount >= TIME_SYNC_LOCK_SAMPLES) {
+            state = TIME_SYNC_STATE_SYNCED;
+        }
+        uint32_t magnitude = (uint32_t)((error < 0) ? -error : error);
+        if (state == TIME_SYNC_STATE_SYNCED && magnitude > stats.maxErrorUs) {
+            stats.maxErrorUs = magnitude;
+        }
+    } else {
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    stats.samples++;
+    stats.lastErrorUs = (error > INT32_MAX) ? INT32_MAX : (error < INT32_MIN) ? INT32_MIN : (int32_t)error;
+    lastSampleLocalUs = localUs;
+    lastSampleTick = HAL_GetTick();
+
+    __set_PRIMASK(primask);
+
+    if (wasFree) {
+        DEBUG_INFO("Time sync: clock set from master");
+    } else if (stepped) {
+        DEBUG_WARNING("Time sync: clock stepped by %ld us", stats.lastErrorUs);
+    }
+}
+
+/**
+ * @brief  Limit a rate correction to TIME_SYNC_MAX_DRIFT_PPB
+ * @param  ppb: Correction in parts per billion
+ * @retval Limited correction
+ */
+static int32_t Clamp_Ppb(int64_t ppb)
+{
+    if (ppb > TIME_SYNC_MAX_DRIFT_PPB) {
+        return TIME_SYNC_MAX_DRIFT_PPB;
+    }
+    if (ppb < -TIME_SYNC_MAX_DRIFT_PPB) {
+        return -TIME_SYNC_MAX_DRIFT_PPB;
+    }
+    return (int32_t)ppb;
+}
@@ -60,6 +60,20 @@ defined in linker script */
 Reset_Handler:
   ldr   sp, =_estack      /* set stack pointer */
 
+/* Start the DWT cycle counter from zero: boot phase timestamps */
+  ldr   r0, =0xE000EDFC   /* CoreDebug DEMCR */
+  ldr   r1, [r0]
+  orr   r1, r1, #0x01000000 /* TRCENA */
+  str   r1, [r0]
+  ldr   r0, =0xE0001000   /* DWT CTRL */
+  ldr   r1, =0xC5ACCE55
+  str   r1, [r0, #0xFB0]  /* DWT LAR: unlock */
+  movs  r1, #0
+  str   r1, [r0, #4]      /* CYCCNT */
+  ldr   r1, [r0]
+  orr   r1, r1, #1        /* CYCCNTENA */
+  str   r1, [r0]
+
 /* Call the ExitRun0Mode function to configure the power supply */
   bl  ExitRun0Mode
 /* Call the clock system initialization function.*/
@@ -81,6 +95,43 @@ LoopCopyDataInit:
   adds r4, r0, r3
   cmp r4, r1
   bcc CopyDataInit
+
+/* Copy the hot code to ITCM and the hot data to DTCM */
+  ldr r0, =_sitcm_text
+  ldr r1, =_eitcm_text
+  ldr r2, =_siitcm_text
+  movs r3, #0
+  b LoopCopyItcmInit
+
+CopyItcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyItcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyItcmInit
+
+  ldr r0, =_sdtcm_data
+  ldr r1, =_edtcm_data
+  ldr r2, =_sidtcm_data
+  movs r3, #0
+  b LoopCopyDtcmInit
+
+CopyDtcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyDtcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyDtcmInit
+/* Complete the ITCM writes before any code runs from there */
+  dsb
+  isb
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
@@ -0,0 +1,173 @@
+"""
+******************************************************************************
+@file           : gen_ntc_table.py
+@brief          : NTC Lookup Table Generator
+******************************************************************************
+@attention
+
+Generates Core/Inc/ntc_table.h and Core/Src/ntc_table.c for the ANA
+controller: ADC count -> temperature in 0.01 degC, uniformly indexed by
+the upper ADC bits so the firmware only needs a shift, two loads and one
+multiply per channel (linear interpolation, no logf at runtime).
+
+Circuit: NTC to GND, pull-up resistor to VREF, ADC measures the NTC node.
+
+Usage:
+    python gen_ntc_table.py            # regenerate table sources
+    python gen_ntc_table.py --verify   # compare against exact formula
+
+******************************************************************************
+"""
+
+import argparse
+import math
+import os
+import sys
+
+# NTC / circuit parameters (must match the hardware)
+NTC_R0_OHM = 10000.0        # NTC resistance at T0
+NTC_T0_C = 25.0             # Reference temperature
+NTC_BETA = 3950.0           # Beta coefficient (K)
+NTC_PULLUP_OHM = 10000.0    # Pull-up resistor
+ADC_MAX = 65535             # 16-bit ADC
+
+# Table layout
+TABLE_SHIFT = 8                             # ADC bits below the table index
+TABLE_SIZE = (ADC_MAX >> TABLE_SHIFT) + 2   # 257 entries, last one for interpolation
+TEMP_MIN_C = -55.0                          # Clamp range (sensor limits)
+TEMP_MAX_C = 150.0
+
+# Accuracy guaranteed by --verify in this range
+VERIFY_MIN_C = -40.0
+VERIFY_MAX_C = 125.0
+VERIFY_TOLERANCE_C = 0.1
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+HEADER_PATH = os.path.join(SCRIPT_DIR, '..', 'Core', 'Inc', 'ntc_table.h')
+SOURCE_PATH = os.path.join(SCRIPT_DIR, '..', 'Core', 'Src', 'ntc_table.c')
+
+
+def exact_temperature(adc: float) -> float:
+    """Exact Beta-equation temperature for an ADC count (degC)"""
+    if adc <= 0:
+        return TEMP_MAX_C
+    if adc >= ADC_MAX:
+        return TEMP_MIN_C
+
+    ratio = adc / ADC_MAX
+    resistance = NTC_PULLUP_OHM * ratio / (1.0 - ratio)
+    t0_k = NTC_T0_C + 273.15
+    temp_c = 1.0 / (1.0 / t0_k + math.log(resistance / NTC_R0_OHM) / NTC_BETA) - 273.15
+    return min(max(temp_c, TEMP_MIN_C), TEMP_MAX_C)
+
+
+def build_table() -> list:
+    """Table of temperatures in 0.01 degC"""
+    return [int(round(exact_temperature(i << TABLE_SHIFT) * 100.0))
+            for i in range(TABLE_SIZE)]
+
+
+def interpolate(table: list, adc: int) -> int:
+    """Bit-exact model of the firmware interpolation (0.01 degC)"""
+    index = adc >> TABLE_SHIFT
+    frac = adc & ((1 << TABLE_SHIFT) - 1)
+    t0 = table[index]
+    t1 = table[index + 1]
+    return t0 + (((t1 - t0) * frac) >> TABLE_SHIFT)
+
+
+def verify(table: list) -> bool:
+    """Compare interpolated values with the exact formula for every ADC count"""
+    worst = 0.0
+    worst_adc = 0
+    for adc in range(ADC_MAX + 1):
+        exact = exact_temperature(adc)
+        if not (VERIFY_MIN_C <= exact <= VERIFY_MAX_C):
+            continue
+        error = abs(interpolate(table, adc) / 100.0 - exact)
+        if error > worst:
+            worst, worst_adc = error, adc
+
+    ok = worst <= VERIFY_TOLERANCE_C
+    print(f"Max error {worst:.4f} degC at ADC {worst_adc} "
+          f"({exact_temperature(worst_adc):.2f} degC), "
+          f"tolerance {VERIFY_TOLERANCE_C} degC in "
+          f"{VERIFY_MIN_C:g}..{VERIFY_MAX_C:g} degC: {'PASS' if ok else 'FAIL'}")
+    return ok
+
+
+def write_sources(table: list):
+    """Write ntc_table.h / ntc_table.c"""
+    params = (f"R0={NTC_R0_OHM:g} Ohm, T0={NTC_T0_C:g} degC, Beta={NTC_BETA:g} K, "
+              f"pull-up={NTC_PULLUP_OHM:g} Ohm")
+
+    with open(HEADER_PATH, 'w', newline='\n') as f:
+        f.write(f"""/**
+ ******************************************************************************
+ * @file           : ntc_table.h
+ * @brief          : NTC Lookup Table (generated by Scripts/gen_ntc_table.py)
+ ******************************************************************************
+ * @attention
+ *
+ * DO NOT EDIT - regenerate with Scripts/gen_ntc_table.py
+ * {params}
+ * Max interpolation error <= {VERIFY_TOLERANCE_C} degC in {VERIFY_MIN_C:g}..{VERIFY_MAX_C:g} degC
+ *
+ ******************************************************************************
+ */
+
+#ifndef NTC_TABLE_H
+#define NTC_TABLE_H
+
+#include <stdint.h>
+
+/* Table Layout */
+#define NTC_TABLE_SHIFT         {TABLE_SHIFT}       // ADC bits below the table index
+#define NTC_TABLE_SIZE          {TABLE_SIZE}     // Entries (0.01 degC)
+#define NTC_TEMP_MIN_CENTI      ({int(TEMP_MIN_C * 100)})
+#define NTC_TEMP_MAX_CENTI      ({int(TEMP_MAX_C * 100)})
+
+/* Temperature in 0.01 degC, indexed by ADC >> NTC_TABLE_SHIFT */
+extern const int16_t ntcTable[NTC_TABLE_SIZE];
+
+#endif /* NTC_TABLE_H */
+""")
+
+    with open(SOURCE_PATH, 'w', newline='\n') as f:
+        f.write("""/**
+ ******************************************************************************
+ * @file           : ntc_table.c
+ * @brief          : NTC Lookup Table (generated by Scripts/gen_ntc_table.py)
+ ******************************************************************************
+ */
+
+#include "ntc_table.h"
+
+const int16_t ntcTable[NTC_TABLE_SIZE] = {
+""")
+        for i in range(0, TABLE_SIZE, 8):
+            row = ', '.join(f"{v:6d}" for v in table[i:i+8])
+            comma = ',' if i + 8 < TABLE_SIZE else ''
+            f.write(f"    {row}{comma}\n")
+        f.write("};\n")
+
+    print(f"Wrote {os.path.normpath(HEADER_PATH)}")
+    print(f"Wrote {os.path.normpath(SOURCE_PATH)}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="NTC lookup table generator")
+    parser.add_argument('--verify', action='store_true',
+                        help="verify interpolation against the exact formula")
+    args = parser.parse_args()
+
+    table = build_table()
+    if args.verify:
+        sys.exit(0 if verify(table) else 1)
+
+    write_sources(table)
+    verify(table)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,58 @@
+/**
+ ******************************************************************************
+ * @file           : boot_profile.h
+ * @brief          : Boot Phase Timestamps
+ ******************************************************************************
+ * @attention
+ *
+ * The startup code starts the DWT cycle counter from zero in Reset_Handler,
+ * each boot phase is stamped once with Boot_Mark(). Times are microseconds
+ * since Reset_Handler; each interval is converted with the core clock at
+ * its start, so the switch in SystemClock_Config is accounted for.
+ * Intervals of BOOT_TICK_GUARD_MS or more (CYCCNT wraps after about 9 s at
+ * 480 MHz) are taken from HAL_GetTick() instead.
+ *
+ * Fast start: main() brings up the debug ring, the cycle counter and the
+ * RS485 link right after the peripherals. The banner, the application
+ * modules and their command handlers follow, with RS485_Process() called
+ * between the steps, so PING is answered while the rest initializes.
+ * Target: BOOT_TARGET_US from reset to the first response.
+ *
+ * Not covered: the time from the reset pin or power-up to Reset_Handler
+ * (regulator, option byte load and boot ROM).
+ *
+ * Read over RS485 with CMD_GET_BOOT_TIMES, logged once init is done.
+ *
+ ******************************************************************************
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include "main.h"
+
+/* Boot Profile Configuration */
+#define BOOT_TARGET_US              20000   // Reset to first RS485 response
+#define BOOT_TICK_GUARD_MS          1000    // Longer intervals are timed with HAL_GetTick()
+#define BOOT_TIME_NONE              0xFFFFFFFFU  // Phase not reached yet
+#define BOOT_RESPONSE_SIZE          (9 + BOOT_PHASE_COUNT * 4)  // See Boot_Read
+
+/* Boot Phases (in boot order, time 0 is Reset_Handler) */
+typedef enum {
+    BOOT_PHASE_MAIN = 0,            // main() entered: memory initialized
+    BOOT_PHASE_CLOCKS,              // SystemClock_Config done
+    BOOT_PHASE_PERIPHERALS,         // MX_xxx_Init done
+    BOOT_PHASE_PROTOCOL_READY,      // RS485 receiving, PING answered from here on
+    BOOT_PHASE_FIRST_RESPONSE,      // First RS485 frame sent
+    BOOT_PHASE_INIT_DONE,           // Deferred init done, scheduler about to start
+    BOOT_PHASE_COUNT
+} BootPhase_t;
+
+/* Function Prototypes */
+void Boot_Init(void);
+void Boot_Mark(BootPhase_t phase);
+uint32_t Boot_GetTime(BootPhase_t phase);
+void Boot_Log(void);
+uint16_t Boot_Read(uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* BOOT_PROFILE_H */
@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file           : bus_access.h
+ * @brief          : RS485 Bus Access for Unsolicited Frames (TDMA / CSMA)
+ ******************************************************************************
+ * @attention
+ *
+ * Responses need no arbitration: the master owns the bus and a controller
+ * only answers its requests. Frames a controller sends on its own (stream
+ * publications) do, or two nodes talking at once corrupt each other's
+ * frames. Before such a frame the sender calls BusAccess_Acquire, which
+ * grants the bus in one of two modes:
+ *
+ * - TDMA: the master broadcasts CMD_BUS_BEACON frames defining a cycle and
+ *   the slots of each node. The cycle starts at the end byte of the beacon
+ *   (every beacon realigns it). A node sends only within its own slots, and
+ *   only frames that end before the slot does; a node without a slot holds
+ *   its frames.
+ * - CSMA: before any beacon, after a beacon with cycle 0, or when beacons
+ *   stop for BUS_ACCESS_BEACON_LOSS cycles. Carrier sense on the RX line
+ *   (RS485_IsLineIdle: no byte for RS485_LINE_GUARD_MS, USART receiver not
+ *   busy). A busy line starts a random back-off, its window doubling with
+ *   each retry up to 2^BUS_ACCESS_MAX_BACKOFF_EXP slots.
+ *
+ * Collisions: a sender cannot hear its own frame (half duplex), but every
+ * other node sees a collided frame fail its CRC or end-byte check. These
+ * are counted as collisions of the current mode; in CSMA each one also
+ * widens the back-off window and forces a back-off before the next frame.
+ *
+ * Beacon: [cycle ms:2][slot count], slot count x [address][start ms:2]
+ * [length ms:2], broadcast, no response. Start is from the end of the
+ * beacon; the master leaves itself the time not given to a node.
+ *
+ * Counters are read with CMD_GET_TELEMETRY, section
+ * RS485_TELEMETRY_SECTION_BUS.
+ *
+ ******************************************************************************
+ */
+
+#ifndef BUS_ACCESS_H
+#define BUS_ACCESS_H
+
+#include "main.h"
+
+/* Bus Access Configuration */
+#define BUS_ACCESS_MAX_SLOTS        4       // Own slots kept from a beacon
+#define BUS_ACCESS_BEACON_LOSS      4       // Cycles without beacon before CSMA
+#define BUS_ACCESS_BACKOFF_SLOT_MS  2       // Back-off unit, >= RS485_LINE_GUARD_MS
+#define BUS_ACCESS_MAX_BACKOFF_EXP  5       // Window up to 32 back-off slots
+#define BUS_ACCESS_TX_OVERHEAD_MS   2       // Transceiver switching in RS485_Transmit
+
+/* Modes */
+#define BUS_ACCESS_MODE_CSMA        0
+#define BUS_ACCESS_MODE_TDMA        1
+
+/* Layouts */
+#define BUS_ACCESS_BEACON_HEADER    3       // [cycle ms:2][slot count]
+#define BUS_ACCESS_BEACON_SLOT      5       // [address][start ms:2][length ms:2]
+#define BUS_ACCESS_TELEMETRY_SIZE   36      // See BusAccess_ReadTelemetry
+
+/* Bus Access Statistics */
+typedef struct {
+    uint32_t beacons;               // Valid beacons received
+    uint32_t fallbacks;             // TDMA to CSMA on beacon loss
+    uint32_t slotFrames;            // Frames sent in an own TDMA slot
+    uint32_t csmaFrames;            // Frames sent after carrier sense
+    uint32_t backoffs;              // Random back-offs started
+    uint32_t collisionsTdma;        // Corrupted frames seen in TDMA
+    uint32_t collisionsCsma;        // Corrupted frames seen in CSMA
+} BusAccess_Stats_t;
+
+/* Function Prototypes */
+void BusAccess_Init(uint8_t address);
+void BusAccess_HandleBeacon(const uint8_t* data, uint16_t length);
+uint8_t BusAccess_Acquire(uint16_t length);
+uint8_t BusAccess_GetMode(void);
+uint16_t BusAccess_ReadTelemetry(uint8_t* buffer, uint16_t bufferSize);
+const BusAccess_Stats_t* BusAccess_GetStats(void);
+
+#endif /* BUS_ACCESS_H */
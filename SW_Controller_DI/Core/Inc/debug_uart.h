@@ -8,6 +8,21 @@
  * Hardware Abstraction Layer for UART debug output
  * USART1 @ 115200 baud for debug messages
  *
+ * Messages are formatted on the caller's stack and queued in a lock-free
+ * multi-producer ring buffer that USART1 TX DMA drains in the background:
+ * - DEBUG_* never waits for the UART and is safe from interrupt context
+ * - Messages that do not fit are dropped whole and counted
+ * - Avoid %f in ISRs: newlib may allocate while formatting floats
+ *
+ * With DEBUG_BINARY_ENABLED the DEBUG_* macros skip formatting entirely:
+ * the format string is placed in the .trace_fmt section, and a record of
+ * its offset (message ID), the tick and the raw arguments is queued
+ * instead. Scripts/debug_log_decode.py rebuilds the text from the ELF.
+ * Record: [0xA5][length][level][id:2][tick:4][args][checksum]
+ * - %d/%u/%x/%c/%p: 4 bytes, %ll*: 8 bytes, %f/%e/%g: float32
+ * - %s: [length][characters] (max DEBUG_TRACE_MAX_STRING)
+ * Debug_PrintRaw/Debug_PrintHex stay text; the decoder passes it through.
+ *
  ******************************************************************************
  */
 
@@ -31,16 +46,55 @@ typedef enum {
 #define DEBUG_DEFAULT_LEVEL     DEBUG_LEVEL_INFO
 #define DEBUG_BUFFER_SIZE       256
 #define DEBUG_TIMESTAMP_ENABLED 1
+#define DEBUG_RING_SIZE         4096        // TX ring (power of two, max 32K)
+#define DEBUG_DMA_IRQ_PRIORITY  6           // Below the RS485 UART
+#define DEBUG_BINARY_ENABLED    0           // 1 = binary trace records instead of text
+
+/* Binary Trace Records */
+#define DEBUG_TRACE_SYNC        0xA5
+#define DEBUG_TRACE_HEADER_SIZE 9           // [sync][length][level][id:2][tick:4]
+#define DEBUG_TRACE_MAX_SIZE    64
+#define DEBUG_TRACE_MAX_STRING  24
+
+/* Ring placement: non-cacheable D2 SRAM, DMA1 reads it in both linker
+ * layouts without cache maintenance */
+#define DEBUG_RING_SECTION      DMA_BUFFER
+
+/* Trace format strings: kept in flash, offset in the section is the message ID */
+#define DEBUG_FORMAT_SECTION    __attribute__((section(".trace_fmt")))
+
+/* Logger Statistics */
+typedef struct {
+    uint32_t droppedMessages;       // Messages discarded because the ring was full
+    uint32_t droppedBytes;
+    uint16_t highWater;             // Maximum ring fill level (bytes)
+    uint16_t pending;               // Bytes not yet transmitted
+} DebugStats_t;
 
 /* Function Prototypes */
 void Debug_Init(void);
 void Debug_SetLevel(DebugLevel_t level);
 void Debug_Print(DebugLevel_t level, const char* format, ...);
+void Debug_Trace(DebugLevel_t level, const char* format, ...);
 void Debug_PrintRaw(const char* str);
 void Debug_PrintHex(const uint8_t* data, uint16_t length);
+void Debug_Flush(uint32_t timeout_ms);
+void Debug_GetStats(DebugStats_t* stats);
+void Debug_UART_ErrorCallback(UART_HandleTypeDef *huart);
 
 /* Convenience Macros */
-#if DEBUG_ENABLED
+#if DEBUG_ENABLED && DEBUG_BINARY_ENABLED
+    #define DEBUG_TRACE(level, format, ...) do { \
+        static const char debugFormat[] DEBUG_FORMAT_SECTION = format; \
+        Debug_Trace(level, debugFormat, ##__VA_ARGS__); \
+    } while (0)
+
+    #define DEBUG_ERROR(...)    DEBUG_TRACE(DEBUG_LEVEL_ERROR, __VA_ARGS__)
+    #define DEBUG_WARNING(...)  DEBUG_TRACE(DEBUG_LEVEL_WARNING, __VA_ARGS__)
+    #define DEBUG_INFO(...)     DEBUG_TRACE(DEBUG_LEVEL_INFO, __VA_ARGS__)
+    #define DEBUG_DEBUG(...)    DEBUG_TRACE(DEBUG_LEVEL_DEBUG, __VA_ARGS__)
+    #define DEBUG_VERBOSE(...)  DEBUG_TRACE(DEBUG_LEVEL_VERBOSE, __VA_ARGS__)
+#elif DEBUG_ENABLED
     #define DEBUG_ERROR(...)    Debug_Print(DEBUG_LEVEL_ERROR, __VA_ARGS__)
     #define DEBUG_WARNING(...)  Debug_Print(DEBUG_LEVEL_WARNING, __VA_ARGS__)
     #define DEBUG_INFO(...)     Debug_Print(DEBUG_LEVEL_INFO, __VA_ARGS__)
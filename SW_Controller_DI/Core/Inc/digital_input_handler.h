@@ -22,6 +22,16 @@
 /* Debounce time in milliseconds */
 #define DEBOUNCE_TIME_MS        20
 
+/* Sampling (di_sample task): 1 ms so routed inputs reach the outputs within
+ * a few ms, the CAN-FD process image is published every DI_IMAGE_PERIOD_MS */
+#define DI_SAMPLE_PERIOD_MS     1
+#define DI_IMAGE_PERIOD_MS      10
+
+/* Trend History (CMD_READ_HISTORY record payload) */
+#define DI_STATE_BYTES          7           // 56 inputs = 7 bytes
+#define DI_HISTORY_INTERVAL_MS  1000
+#define DI_HISTORY_PAYLOAD_SIZE (DI_STATE_BYTES * 2)    // [states][changed in interval]
+
 /* Digital Input Structure */
 typedef struct {
     GPIO_TypeDef* port;
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @file           : input_routing.h
+ * @brief          : Peer-to-Peer Input Routing (DI -> DO over CAN-FD)
+ ******************************************************************************
+ * @attention
+ *
+ * Sends input changes straight to other controllers, without the PC in the
+ * loop. Each route has a destination (node, group or broadcast) and a mask
+ * of the inputs it carries. When a masked input changes, a CMD_DI_CHANGE
+ * event frame [input states:7][changed inputs:7] is sent to the destination
+ * in the same sample (priority CANFD_PRIORITY_EVENT, so it never waits behind
+ * bulk traffic); the output controller applies its mapping on receipt.
+ *
+ * Every route is also refreshed every INPUT_ROUTING_REFRESH_MS (changed mask
+ * zero), so a restarted receiver catches up and can detect a lost sender.
+ *
+ * The table starts from INPUT_ROUTING_DEFAULTS and is replaced at run time
+ * with CMD_DI_ROUTES (RAM only).
+ *
+ ******************************************************************************
+ */
+
+#ifndef INPUT_ROUTING_H
+#define INPUT_ROUTING_H
+
+#include "main.h"
+#include "digital_input_handler.h"
+
+/* Input Routing Configuration */
+#define INPUT_ROUTING_MAX_ROUTES    8
+#define INPUT_ROUTING_REFRESH_MS    100     // Receivers time out after several missed refreshes
+
+/* Routes at start: { destination, { input mask, DI0 = bit 0 of byte 0 } } */
+#define INPUT_ROUTING_DEFAULTS      { { 0 } }
+#define INPUT_ROUTING_DEFAULT_COUNT 0
+
+/* CMD_DI_CHANGE Layout */
+#define INPUT_ROUTING_CHANGE_SIZE   (DI_STATE_BYTES * 2)    // [states][changed]
+
+/* CMD_DI_ROUTES Layout: [count] then per route [destination][mask:7] */
+#define INPUT_ROUTING_ENTRY_SIZE    (1 + DI_STATE_BYTES)
+#define INPUT_ROUTING_HEADER_SIZE   13      // [count][changes:4][refreshes:4][send errors:4]
+#define INPUT_ROUTING_RESPONSE_SIZE \
+    (INPUT_ROUTING_HEADER_SIZE + INPUT_ROUTING_MAX_ROUTES * INPUT_ROUTING_ENTRY_SIZE)
+
+/* Route */
+typedef struct {
+    uint8_t dest;
+    uint8_t mask[DI_STATE_BYTES];
+} InputRoute_t;
+
+/* Routing Statistics */
+typedef struct {
+    uint32_t changes;               // Change frames sent
+    uint32_t refreshes;             // Refresh frames sent
+    uint32_t sendErrors;
+} InputRouting_Stats_t;
+
+/* Function Prototypes */
+void InputRouting_Init(uint8_t myAddress);
+void InputRouting_Process(void);
+uint8_t InputRouting_SetRoutes(const uint8_t* data, uint16_t length);
+uint16_t InputRouting_ReadRoutes(uint8_t* buffer, uint16_t bufferSize);
+const InputRouting_Stats_t* InputRouting_GetStats(void);
+
+#endif /* INPUT_ROUTING_H */
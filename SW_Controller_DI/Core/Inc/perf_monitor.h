@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * @file           : perf_monitor.h
+ * @brief          : DWT Cycle Counter Profiling
+ ******************************************************************************
+ * @attention
+ *
+ * Named probe points timed with the Cortex-M7 DWT cycle counter:
+ * - Per probe: count, min, max, total cycles and a log2 histogram
+ * - Fixed probes for the main loop, the RS485 ISR and packet path and the
+ *   I/O update, plus one probe per RS485 command (allocated on first use)
+ * - Read and reset over RS485 with CMD_GET_PERF
+ *
+ * A probe costs two CYCCNT reads and a short IRQ-masked update. Set
+ * PERF_ENABLED to 0 to compile all probes out.
+ *
+ ******************************************************************************
+ */
+
+#ifndef PERF_MONITOR_H
+#define PERF_MONITOR_H
+
+#include "main.h"
+
+/* Profiling Configuration */
+#define PERF_ENABLED                1
+#define PERF_MAX_PROBES             24
+#define PERF_HISTOGRAM_BINS         28              // Bin n: [2^(n-1), 2^n) cycles, last bin open
+#define PERF_RESPONSE_HEADER_SIZE   27              // See Perf_Read
+#define PERF_RESPONSE_SIZE          (PERF_RESPONSE_HEADER_SIZE + PERF_HISTOGRAM_BINS * 4)
+#define PERF_FLAG_RESET             0x01            // CMD_GET_PERF: reset all probes after reading
+
+/* Fixed Probes */
+typedef enum {
+    PERF_PROBE_MAIN_LOOP = 0,       // One scheduler pass that ran tasks (without idle sleep)
+    PERF_PROBE_RS485_ISR,           // USART2 interrupt handler
+    PERF_PROBE_RS485_PACKET,        // Packet check and dispatch (incl. handler)
+    PERF_PROBE_IO_UPDATE,           // AnalogInput_Update / DigitalInput_Update
+    PERF_PROBE_LOGIC_SCAN,          // Logic_Scan (OUT logic engine)
+    PERF_PROBE_FIXED_COUNT,
+    PERF_PROBE_COMMAND = 0xFF       // Reported id of per-command probes
+} PerfProbeId_t;
+
+/* Probe Statistics */
+typedef struct {
+    uint8_t id;                     // PerfProbeId_t
+    uint8_t command;                // RS485 command (PERF_PROBE_COMMAND only)
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[PERF_HISTOGRAM_BINS];
+} PerfProbe_t;
+
+/* Function Prototypes */
+void Perf_Init(void);
+void Perf_Record(uint8_t probe, uint32_t startCycles);
+void Perf_RecordCommand(uint8_t command, uint32_t startCycles);
+void Perf_Reset(void);
+uint8_t Perf_GetProbeCount(void);
+uint16_t Perf_Read(uint8_t index, uint8_t* buffer, uint16_t bufferSize);
+
+/* Probe Macros */
+#if PERF_ENABLED
+    #define PERF_START()                    (DWT->CYCCNT)
+    #define PERF_STOP(probe, start)         Perf_Record((probe), (start))
+    #define PERF_STOP_COMMAND(cmd, start)   Perf_RecordCommand((cmd), (start))
+#else
+    #define PERF_START()                    (0U)
+    #define PERF_STOP(probe, start)         ((void)(start))
+    #define PERF_STOP_COMMAND(cmd, start)   ((void)(start))
+#endif
+
+#endif /* PERF_MONITOR_H */
@@ -23,6 +23,19 @@
 #define RS485_MAX_PACKET_SIZE   256
 #define RS485_RX_BUFFER_SIZE    512
 #define RS485_TX_BUFFER_SIZE    512
+#define RS485_FRAME_QUEUE_SIZE  4       // Received frames waiting for RS485_Process
+#define RS485_INTERBYTE_TIMEOUT_MS  500     // Partial frame discarded after this gap
+#define RS485_LINE_GUARD_MS     2       // Quiet time before an unsolicited frame
+
+/* Telemetry Configuration */
+#define RS485_TELEMETRY_VERSION     1
+#define RS485_TURNAROUND_BINS       16      // Bin n: [2^(n-1), 2^n) us, last bin open
+#define RS485_TELEMETRY_SECTION_COUNTERS    0
+#define RS485_TELEMETRY_SECTION_COMMANDS    1
+#define RS485_TELEMETRY_SECTION_TURNAROUND  2
+#define RS485_TELEMETRY_SECTION_TIME        3
+#define RS485_TELEMETRY_SECTION_BUS         4
+#define RS485_TELEMETRY_MAX_COMMANDS        48  // Per-command entries per response
 
 /* MCU Address Definitions */
 #define RS485_ADDR_BROADCAST    0x00
@@ -39,15 +52,58 @@ typedef enum {
     CMD_VERSION_RESPONSE    = 0x04,
     CMD_HEARTBEAT           = 0x05,
     CMD_HEARTBEAT_RESPONSE  = 0x06,
+    CMD_SYNC                = 0x07,     // Broadcast: latch snapshots, no response (bus_sync.h)
+    CMD_TIME_SYNC           = 0x08,     // Broadcast: master time, no response (time_sync.h)
+    CMD_BUS_BEACON          = 0x09,     // Broadcast: TDMA slots, no response (bus_access.h)
+    CMD_READ_SNAPSHOT       = 0x0A,
+    CMD_SNAPSHOT_RESPONSE   = 0x0B,
+    CMD_SYNC_MODE           = 0x0C,     // Read/set the SYNC output mode
+    CMD_SYNC_MODE_RESPONSE  = 0x0D,
     CMD_GET_STATUS          = 0x10,
     CMD_STATUS_RESPONSE     = 0x11,
+    CMD_GET_PERF            = 0x12,
+    CMD_PERF_RESPONSE       = 0x13,
+    CMD_GET_TELEMETRY       = 0x14,
+    CMD_TELEMETRY_RESPONSE  = 0x15,
+    CMD_GET_HEALTH          = 0x16,
+    CMD_HEALTH_RESPONSE     = 0x17,
+    CMD_GET_TASKS           = 0x18,
+    CMD_TASKS_RESPONSE      = 0x19,
+    CMD_GET_BOOT_TIMES      = 0x1A,
+    CMD_BOOT_TIMES_RESPONSE = 0x1B,
     CMD_READ_DI             = 0x20,
     CMD_DI_RESPONSE         = 0x21,
+    CMD_DI_ROUTES           = 0x22,     // DI: read/replace peer routes
+    CMD_DI_ROUTES_RESPONSE  = 0x23,
     CMD_WRITE_DO            = 0x30,
     CMD_DO_RESPONSE         = 0x31,
     CMD_READ_DO             = 0x32,
+    CMD_DI_CHANGE           = 0x33,     // DI -> OUT event (CAN-FD), no response
+    CMD_DO_MAP              = 0x34,     // OUT: read/replace input mapping
+    CMD_DO_MAP_RESPONSE     = 0x35,
     CMD_READ_ANALOG         = 0x40,
     CMD_ANALOG_RESPONSE     = 0x41,
+    CMD_READ_HISTORY        = 0x60,
+    CMD_HISTORY_RESPONSE    = 0x61,
+    CMD_LOGIC_DOWNLOAD      = 0x70,     // OUT logic engine, see logic_engine.h
+    CMD_LOGIC_DOWNLOAD_RESPONSE = 0x71,
+    CMD_LOGIC_ACTIVATE      = 0x72,
+    CMD_LOGIC_ACTIVATE_RESPONSE = 0x73,
+    CMD_LOGIC_STATUS        = 0x74,
+    CMD_LOGIC_STATUS_RESPONSE = 0x75,
+    CMD_LOGIC_BENCH         = 0x76,
+    CMD_LOGIC_BENCH_RESPONSE = 0x77,
+    CMD_SEG_OPEN            = 0x80,     // Segmented transfer, see seg_transfer.h
+    CMD_SEG_OPEN_RESPONSE   = 0x81,
+    CMD_SEG_READ            = 0x82,     // Answered with CMD_SEG_DATA segments
+    CMD_SEG_DATA            = 0x83,     // Segment, both directions, no response
+    CMD_SEG_ACK             = 0x84,
+    CMD_SEG_ACK_RESPONSE    = 0x85,
+    CMD_STREAM_SUBSCRIBE    = 0x90,     // Data streams, see data_stream.h
+    CMD_STREAM_SUBSCRIBE_RESPONSE = 0x91,
+    CMD_STREAM_STATUS       = 0x92,
+    CMD_STREAM_STATUS_RESPONSE = 0x93,
+    CMD_STREAM_DATA         = 0x94,     // Publication, no response
     CMD_ERROR_RESPONSE      = 0xFF
 } RS485_Command_t;
 
@@ -59,7 +115,8 @@ typedef enum {
     RS485_ERR_INVALID_COMMAND   = 0x03,
     RS485_ERR_INVALID_LENGTH    = 0x04,
     RS485_ERR_TIMEOUT           = 0x05,
-    RS485_ERR_BUSY              = 0x06
+    RS485_ERR_BUSY              = 0x06,
+    RS485_ERR_INVALID_PARAM     = 0x07
 } RS485_Error_t;
 
 /* Packet Structure */
@@ -74,6 +131,15 @@ typedef struct {
     uint8_t endByte;        // 0x55
 } __attribute__((packed)) RS485_Packet_t;
 
+/* Transports (responses go back over the transport of the request) */
+typedef enum {
+    RS485_TRANSPORT_SERIAL = 0,     // RS485 on USART2
+    RS485_TRANSPORT_CANFD           // FDCAN1, see canfd_transport.h
+} RS485_Transport_t;
+
+/* Handler for valid frames addressed to other nodes (gateway forwarding) */
+typedef void (*RS485_ForwardHandler_t)(const RS485_Packet_t* packet);
+
 /* Status Structure */
 typedef struct {
     uint8_t mcuId;
@@ -84,17 +150,54 @@ typedef struct {
     uint32_t txPacketCount;
 } RS485_Status_t;
 
+/* Protocol Telemetry (CMD_GET_TELEMETRY) */
+typedef struct {
+    uint32_t rxFrames;              // Valid frames addressed to this node
+    uint32_t txFrames;
+    uint32_t crcErrors;
+    uint32_t framingErrors;         // UART FE
+    uint32_t noiseErrors;           // UART NE
+    uint32_t overrunErrors;         // UART ORE
+    uint32_t parityErrors;          // UART PE
+    uint32_t endByteErrors;
+    uint32_t parserTimeouts;        // Partial frame discarded after inter-byte timeout
+    uint32_t bufferOverflows;
+    uint32_t foreignFrames;         // Valid frames addressed to other nodes
+    uint32_t broadcastFrames;
+    uint32_t rxDuringTx;            // Bytes ignored while transmitting
+    uint32_t txErrors;
+    uint32_t unknownCommands;
+    uint16_t rxBufferHighWater;     // Longest frame buffered (bytes)
+    uint8_t frameQueueHighWater;    // Most received frames waiting for RS485_Process
+    uint32_t commandCounts[256];    // Requests per command code
+    uint32_t turnaroundHistogram[RS485_TURNAROUND_BINS];
+    uint32_t turnaroundMin;         // us, request end to first response byte
+    uint32_t turnaroundMax;
+    uint64_t turnaroundTotal;
+    uint32_t turnaroundCount;
+} RS485_Telemetry_t;
+
 /* Function Prototypes */
 void RS485_Init(uint8_t myAddress);
 void RS485_Process(void);
 HAL_StatusTypeDef RS485_SendPacket(uint8_t destAddr, RS485_Command_t cmd, 
                                    const uint8_t* data, uint8_t length);
+HAL_StatusTypeDef RS485_SendPacketVia(RS485_Transport_t transport, uint8_t destAddr,
+                                      RS485_Command_t cmd, const uint8_t* data, uint8_t length);
 HAL_StatusTypeDef RS485_SendResponse(uint8_t destAddr, RS485_Command_t cmd, 
                                      const uint8_t* data, uint8_t length);
 HAL_StatusTypeDef RS485_SendError(uint8_t destAddr, RS485_Error_t error);
+HAL_StatusTypeDef RS485_RelayPacket(const RS485_Packet_t* packet);
+uint8_t RS485_IsLineIdle(void);
+void RS485_SetForwardHandler(RS485_ForwardHandler_t handler);
 void RS485_RegisterCommandHandler(RS485_Command_t cmd, 
                                   void (*handler)(const RS485_Packet_t* packet));
+void RS485_DispatchPacket(const RS485_Packet_t* packet, RS485_Transport_t transport);
 RS485_Status_t* RS485_GetStatus(void);
+const RS485_Telemetry_t* RS485_GetTelemetry(void);
+uint32_t RS485_GetRequestCycles(void);
+RS485_Transport_t RS485_GetReplyTransport(void);
+void RS485_UART_ErrorCallback(UART_HandleTypeDef *huart);
 uint16_t RS485_CalculateCRC(const uint8_t* data, uint16_t length);
 
 #endif /* RS485_PROTOCOL_H */
@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file           : time_sync.h
+ * @brief          : Bus-Wide Time Synchronization (64-bit microsecond clock)
+ ******************************************************************************
+ * @attention
+ *
+ * Gives all controllers one time base: a 64-bit microsecond bus clock,
+ * disciplined to the master's clock by broadcast CMD_TIME_SYNC frames.
+ *
+ * Local clock: the DWT cycle counter extended to 64 bits (TimeSync_Process
+ * must run more often than the 32-bit wrap, ~8.9 s at 480 MHz). Each frame
+ * is timestamped at its end byte in the RS485 RX interrupt
+ * (RS485_GetRequestCycles), so handler latency does not enter the estimate.
+ *
+ * Frame: [sequence][flags][master time us:8], broadcast, no response.
+ * - TIME_SYNC_FLAG_FOLLOW_UP clear: the time is that of this frame's end
+ *   byte (one-step, for masters that can stamp ahead of sending).
+ * - TIME_SYNC_FLAG_FOLLOW_UP set (two-step): the time is the precise send
+ *   time of the previous frame (sequence - 1), measured by the master after
+ *   sending it. This frame's own reception time is kept for the next one.
+ *
+ * Discipline: the first sample (or an error above TIME_SYNC_STEP_US) steps
+ * the clock. After that, each sample corrects the frequency (drift, integral
+ * term) and slews out the phase error over the next interval, so the bus
+ * clock stays continuous and monotonic. Without samples for
+ * TIME_SYNC_HOLDOVER_MS the clock runs on the last drift estimate.
+ *
+ * Sync error, drift and step counts are read with CMD_GET_TELEMETRY,
+ * section RS485_TELEMETRY_SECTION_TIME.
+ *
+ ******************************************************************************
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include "main.h"
+
+/* Time Sync Configuration */
+#define TIME_SYNC_STEP_US           10000   // Larger errors step the clock
+#define TIME_SYNC_MAX_DRIFT_PPB     500000  // +/- 500 ppm
+#define TIME_SYNC_DRIFT_GAIN        8       // Frequency: 1/8 of the measured rate error per sample
+#define TIME_SYNC_PHASE_GAIN        2       // Phase: 1/2 of the error slewed out per interval
+#define TIME_SYNC_LOCK_SAMPLES      3       // Samples within TIME_SYNC_STEP_US before SYNCED
+#define TIME_SYNC_HOLDOVER_MS       30000
+
+/* CMD_TIME_SYNC Layout */
+#define TIME_SYNC_FRAME_SIZE        10      // [sequence][flags][master time us:8]
+#define TIME_SYNC_FLAG_FOLLOW_UP    0x01
+
+/* States */
+#define TIME_SYNC_STATE_FREE        0       // Never synchronized (local time)
+#define TIME_SYNC_STATE_LOCKING     1
+#define TIME_SYNC_STATE_SYNCED      2
+#define TIME_SYNC_STATE_HOLDOVER    3       // Master silent, running on the drift estimate
+
+/* Telemetry Section Layout */
+#define TIME_SYNC_TELEMETRY_SIZE    33      // See TimeSync_ReadTelemetry
+
+/* Time Sync Statistics */
+typedef struct {
+    uint32_t samples;               // Timestamps used
+    uint32_t steps;                 // Clock steps (first sample included)
+    int32_t lastErrorUs;            // Master minus bus clock at the last sample
+    uint32_t maxErrorUs;            // Largest |error| while synced
+    int32_t driftPpb;               // Local oscillator correction
+} TimeSync_Stats_t;
+
+/* Function Prototypes */
+void TimeSync_Init(void);
+void TimeSync_Process(void);
+void TimeSync_HandleFrame(const uint8_t* data, uint16_t length);
+uint64_t TimeSync_Now(void);
+uint64_t TimeSync_FromCycles(uint32_t cycles);
+uint8_t TimeSync_GetState(void);
+uint16_t TimeSync_ReadTelemetry(uint8_t* buffer, uint16_t bufferSize);
+const TimeSync_Stats_t* TimeSync_GetStats(void);
+
+#endif /* TIME_SYNC_H */
@@ -6,12 +6,15 @@
  */
 
 #include "digital_input_handler.h"
+#include "history_buffer.h"
 #include "debug_uart.h"
 #include <string.h>
 
 /* Digital Input Configuration */
-static DigitalInput_t digitalInputs[NUM_DIGITAL_INPUTS];
-static uint8_t inputStates[NUM_DIGITAL_INPUTS];
+/* Debounce state in DTCM: scanned every sample period */
+static DigitalInput_t digitalInputs[NUM_DIGITAL_INPUTS] DTCM_DATA;
+static uint8_t inputStates[NUM_DIGITAL_INPUTS] DTCM_DATA;
+static uint8_t changedMask[DI_STATE_BYTES] DTCM_DATA;  // Inputs toggled since last history record
 
 /* Input pin mapping - MUST match main.h MCU_DI0-DI55 definitions exactly */
 static const struct {
@@ -107,6 +110,9 @@ static const struct {
 
 #define NUM_INPUT_PINS (sizeof(inputPinMap) / sizeof(inputPinMap[0]))
 
+/* Private Function Prototypes */
+static void Record_History(void);
+
 /**
  * @brief  Initialize digital input handler
  * @retval None
@@ -115,6 +121,7 @@ void DigitalInput_Init(void)
 {
     memset(digitalInputs, 0, sizeof(digitalInputs));
     memset(inputStates, 0, sizeof(inputStates));
+    memset(changedMask, 0, sizeof(changedMask));
     
     /* Configure input structures */
     for (uint8_t i = 0; i < NUM_INPUT_PINS && i < NUM_DIGITAL_INPUTS; i++) {
@@ -132,7 +139,7 @@ void DigitalInput_Init(void)
  * @brief  Update digital inputs (call periodically)
  * @retval None
  */
-void DigitalInput_Update(void)
+ITCM_TEXT void DigitalInput_Update(void)
 {
     uint32_t currentTime = HAL_GetTick();
     
@@ -152,10 +159,13 @@ void DigitalInput_Update(void)
                     digitalInputs[i].lastChangeTime = currentTime;
                     
                     inputStates[i] = newState;
+                    changedMask[i / 8] |= (1 << (i % 8));
                 }
             }
         }
     }
+    
+    Record_History();
 }
 
 /**
@@ -208,3 +218,25 @@ uint8_t DigitalInput_HasChanged(uint8_t inputNum)
     return 0;
 }
 
+/* Private Functions */
+
+/**
+ * @brief  Append a trend record when due
+ * @note   Record payload: input states at the end of the interval followed by
+ *         the mask of inputs that toggled during it, so short pulses between
+ *         two records are not lost
+ * @retval None
+ */
+static void Record_History(void)
+{
+    if (!History_IsDue()) {
+        return;
+    }
+    
+    uint8_t payload[DI_HISTORY_PAYLOAD_SIZE];
+    DigitalInput_GetAll(payload, DI_STATE_BYTES);
+    memcpy(&payload[DI_STATE_BYTES], changedMask, DI_STATE_BYTES);
+    memset(changedMask, 0, sizeof(changedMask));
+    
+    History_Append(payload);
+}
@@ -0,0 +1,163 @@
+/**
+ ******************************************************************************
+ * @file           : history_buffer.c
+ * @brief          : Store-and-Forward Trend History Implementation
+ ******************************************************************************
+ */
+
+#include "history_buffer.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* History buffer: ring of fixed-size records, placed and sized by the
+ * linker script (.history, uninitialized) */
+extern uint8_t _shistory[];
+extern uint8_t _ehistory[];
+static uint8_t* const historyBuffer = _shistory;
+
+/* Private Variables */
+static uint16_t recordSize = 0;         // Header + payload
+static uint32_t capacity = 0;           // Records in the ring
+static uint32_t writeIndex = 0;         // Next record slot
+static uint32_t recordCount = 0;        // Records stored (saturates at capacity)
+static uint32_t nextSequence = 1;       // Sequence of the next record (0 = none)
+static uint32_t interval = 1000;
+static uint32_t lastRecordTime = 0;
+
+/**
+ * @brief  Initialize trend history
+ * @param  payloadSize: Application payload bytes per record
+ * @param  interval_ms: Record interval in ms
+ * @retval None
+ */
+void History_Init(uint16_t payloadSize, uint32_t interval_ms)
+{
+    recordSize = HISTORY_RECORD_HEADER_SIZE + payloadSize;
+    capacity = (uint32_t)(_ehistory - _shistory) / recordSize;
+    writeIndex = 0;
+    recordCount = 0;
+    nextSequence = 1;
+    interval = interval_ms;
+    lastRecordTime = HAL_GetTick();
+
+    DEBUG_INFO("History initialized: %lu records x %u bytes, %lu s",
+               capacity, recordSize, (capacity * interval_ms) / 1000U);
+}
+
+/**
+ * @brief  Check whether the next record is due (call once per update)
+ * @retval 1 once per interval, 0 otherwise
+ */
+uint8_t History_IsDue(void)
+{
+    if ((HAL_GetTick() - lastRecordTime) < interval) {
+        return 0;
+    }
+
+    lastRecordTime += interval;
+    return 1;
+}
+
+/**
+ * @brief  Append one record (overwrites the oldest when full)
+ * @param  payload: Application payload (payloadSize bytes)
+ * @retval None
+ */
+void History_Append(const uint8_t* payload)
+{
+    uint8_t* record = &historyBuffer[writeIndex * recordSize];
+    uint32_t timestamp = HAL_GetTick();
+
+    memcpy(&record[0], &nextSequence, 4);
+    memcpy(&record[4], &timestamp, 4);
+    memcpy(&record[HISTORY_RECORD_HEADER_SIZE], payload,
+           recordSize - HISTORY_RECORD_HEADER_SIZE);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    nextSequence++;     // 32 bits: > 100 years at 1 record/s
+    writeIndex++;
+    if (writeIndex >= capacity) {
+        writeIndex = 0;
+    }
+    if (recordCount < capacity) {
+        recordCount++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Read records starting at a sequence number
+ * @note   Layout: [oldest seq:4][newest seq:4][record size][count], then
+ *         count records. Reading starts at the oldest record still stored
+ *         if fromSequence has been overwritten (gap visible to the host).
+ * @param  fromSequence: First sequence wanted (0 = oldest)
+ * @param  maxRecords: Maximum records to return (0 = as many as fit)
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written
+ */
+uint16_t History_Read(uint32_t fromSequence, uint8_t maxRecords,
+                      uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < HISTORY_RESPONSE_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint16_t fit = (bufferSize - HISTORY_RESPONSE_HEADER_SIZE) / recordSize;
+    if (maxRecords == 0 || maxRecords > fit) {
+        maxRecords = (uint8_t)((fit > 255) ? 255 : fit);
+    }
+
+    /* Appends may run from the ADC path: copy with IRQs off */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t newest = nextSequence - 1;
+    uint32_t oldest = (recordCount > 0) ? (nextSequence - recordCount) : 0;
+    uint8_t count = 0;
+
+    if (recordCount > 0) {
+        if (fromSequence < oldest) {
+            fromSequence = oldest;
+        }
+
+        if (fromSequence <= newest) {
+            uint32_t available = newest - fromSequence + 1;
+            count = (uint8_t)((available < maxRecords) ? available : maxRecords);
+
+            /* Slot of fromSequence, counted back from the write position */
+            uint32_t back = nextSequence - fromSequence;
+            uint32_t slot = (writeIndex + capacity - back) % capacity;
+
+            for (uint8_t i = 0; i < count; i++) {
+                memcpy(&buffer[HISTORY_RESPONSE_HEADER_SIZE + i * recordSize],
+                       &historyBuffer[slot * recordSize], recordSize);
+                slot++;
+                if (slot >= capacity) {
+                    slot = 0;
+                }
+            }
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    memcpy(&buffer[0], &oldest, 4);
+    memcpy(&buffer[4], &newest, 4);
+    buffer[8] = (uint8_t)recordSize;
+    buffer[9] = count;
+
+    return HISTORY_RESPONSE_HEADER_SIZE + count * recordSize;
+}
+
+/**
+ * @brief  Get sequence number of the newest record
+ * @retval Sequence number (0 = no record yet)
+ */
+uint32_t History_GetNewestSequence(void)
+{
+    return nextSequence - 1;
+}
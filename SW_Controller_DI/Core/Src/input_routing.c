@@ -0,0 +1,198 @@
+/**
+ ******************************************************************************
+ * @file           : input_routing.c
+ * @brief          : Peer-to-Peer Input Routing Implementation
+ ******************************************************************************
+ */
+
+#include "input_routing.h"
+#include "canfd_transport.h"
+#include "rs485_protocol.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Private Variables */
+static const InputRoute_t defaultRoutes[] = INPUT_ROUTING_DEFAULTS;
+static InputRoute_t routes[INPUT_ROUTING_MAX_ROUTES];
+static uint8_t routeCount = 0;
+static uint8_t myAddr = 0;
+static uint8_t lastStates[DI_STATE_BYTES];
+static uint32_t lastRefreshTick = 0;
+static uint8_t refreshRequested = 0;
+static InputRouting_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static void Send_Change(const InputRoute_t* route, const uint8_t* states, const uint8_t* changed,
+                        uint8_t refresh);
+
+/**
+ * @brief  Load the default routes (after DigitalInput_Init and CanFd_Init)
+ * @param  myAddress: This MCU's address (not a valid destination)
+ * @retval None
+ */
+void InputRouting_Init(uint8_t myAddress)
+{
+    myAddr = myAddress;
+    memset(routes, 0, sizeof(routes));
+    memset(&stats, 0, sizeof(stats));
+
+    routeCount = INPUT_ROUTING_DEFAULT_COUNT;
+    if (routeCount > INPUT_ROUTING_MAX_ROUTES) {
+        routeCount = INPUT_ROUTING_MAX_ROUTES;
+    }
+    memcpy(routes, defaultRoutes, routeCount * sizeof(InputRoute_t));
+
+    DigitalInput_GetAll(lastStates, sizeof(lastStates));
+    refreshRequested = 1;
+
+    DEBUG_INFO("Input routing: %d route(s)", routeCount);
+}
+
+/**
+ * @brief  Send changed inputs to their routes (after every DigitalInput_Update)
+ * @retval None
+ */
+ITCM_TEXT void InputRouting_Process(void)
+{
+    if (routeCount == 0) {
+        return;
+    }
+
+    uint8_t states[DI_STATE_BYTES];
+    uint8_t changed[DI_STATE_BYTES];
+    uint8_t anyChange = 0;
+
+    DigitalInput_GetAll(states, sizeof(states));
+    for (uint8_t i = 0; i < DI_STATE_BYTES; i++) {
+        changed[i] = states[i] ^ lastStates[i];
+        anyChange |= changed[i];
+    }
+    memcpy(lastStates, states, sizeof(lastStates));
+
+    uint32_t now = HAL_GetTick();
+    uint8_t refresh = refreshRequested || (now - lastRefreshTick >= INPUT_ROUTING_REFRESH_MS);
+
+    if (!anyChange && !refresh) {
+        return;
+    }
+
+    for (uint8_t r = 0; r < routeCount; r++) {
+        uint8_t routeChanged[DI_STATE_BYTES];
+        uint8_t relevant = 0;
+
+        for (uint8_t i = 0; i < DI_STATE_BYTES; i++) {
+            routeChanged[i] = changed[i] & routes[r].mask[i];
+            relevant |= routeChanged[i];
+        }
+        if (relevant || refresh) {
+            Send_Change(&routes[r], states, routeChanged, !relevant);
+        }
+    }
+
+    if (refresh) {
+        lastRefreshTick = now;
+        refreshRequested = 0;
+    }
+}
+
+/**
+ * @brief  Replace the routing table (CMD_DI_ROUTES)
+ * @param  data: [count] then per route [destination][mask:7]
+ * @param  length: Data length
+ * @retval 1 if applied, 0 if invalid (table unchanged)
+ */
+uint8_t InputRouting_SetRoutes(const uint8_t* data, uint16_t length)
+{
+    if (length < 1 || data[0] > INPUT_ROUTING_MAX_ROUTES ||
+        length != 1U + (uint16_t)data[0] * INPUT_ROUTING_ENTRY_SIZE) {
+        return 0;
+    }
+
+    uint8_t count = data[0];
+    for (uint8_t r = 0; r < count; r++) {
+        if (data[1 + r * INPUT_ROUTING_ENTRY_SIZE] == myAddr) {
+            return 0;
+        }
+    }
+
+    /* The sampling task may preempt the command task (RTOS variant) */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t r = 0; r < count; r++) {
+        const uint8_t* entry = &data[1 + r * INPUT_ROUTING_ENTRY_SIZE];
+        routes[r].dest = entry[0];
+        memcpy(routes[r].mask, &entry[1], DI_STATE_BYTES);
+    }
+    routeCount = count;
+    refreshRequested = 1;
+    __set_PRIMASK(primask);
+
+    DEBUG_INFO("Input routing: %d route(s) set", routeCount);
+    return 1;
+}
+
+/**
+ * @brief  Read the routing table (CMD_DI_ROUTES_RESPONSE)
+ * @note   Layout: [count][changes:4][refreshes:4][send errors:4]
+ *         then per route [destination][mask:7]
+ * @param  buffer: Output buffer (INPUT_ROUTING_RESPONSE_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t InputRouting_ReadRoutes(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < INPUT_ROUTING_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    uint16_t length = INPUT_ROUTING_HEADER_SIZE;
+
+    buffer[0] = routeCount;
+    memcpy(&buffer[1], &stats.changes, 4);
+    memcpy(&buffer[5], &stats.refreshes, 4);
+    memcpy(&buffer[9], &stats.sendErrors, 4);
+
+    for (uint8_t r = 0; r < routeCount; r++) {
+        buffer[length] = routes[r].dest;
+        memcpy(&buffer[length + 1], routes[r].mask, DI_STATE_BYTES);
+        length += INPUT_ROUTING_ENTRY_SIZE;
+    }
+
+    return length;
+}
+
+/**
+ * @brief  Get routing statistics
+ * @retval Statistics
+ */
+const InputRouting_Stats_t* InputRouting_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Send one CMD_DI_CHANGE event frame
+ * @param  route: Route
+ * @param  states: All input states
+ * @param  changed: Changed inputs of this route (all zero for a refresh)
+ * @param  refresh: 1 for a refresh frame (statistics only)
+ * @retval None
+ */
+static void Send_Change(const InputRoute_t* route, const uint8_t* states, const uint8_t* changed,
+                        uint8_t refresh)
+{
+    uint8_t data[INPUT_ROUTING_CHANGE_SIZE];
+
+    memcpy(data, states, DI_STATE_BYTES);
+    memcpy(&data[DI_STATE_BYTES], changed, DI_STATE_BYTES);
+
+    if (CanFd_SendEvent(route->dest, CMD_DI_CHANGE, data, sizeof(data)) != HAL_OK) {
+        stats.sendErrors++;
+    } else if (refresh) {
+        stats.refreshes++;
+    } else {
+        stats.changes++;
+    }
+}
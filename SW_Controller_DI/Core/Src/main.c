@@ -21,10 +21,23 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include <string.h>
 #include "version.h"
 #include "debug_uart.h"
 #include "rs485_protocol.h"
+#include "perf_monitor.h"
+#include "mem_benchmark.h"
+#include "boot_profile.h"
+#include "canfd_transport.h"
+#include "health_monitor.h"
+#include "scheduler.h"
 #include "digital_input_handler.h"
+#include "history_buffer.h"
+#include "input_routing.h"
+#include "bus_sync.h"
+#include "time_sync.h"
+#include "data_stream.h"
+#include "bus_access.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -51,13 +64,29 @@ UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
-static uint32_t heartbeatTimer = 0;
-static uint32_t statusLedTimer = 0;
-static uint32_t inputUpdateTimer = 0;
+static uint32_t inputUpdateTick = 0;
+static uint8_t imageCountdown = 0;
 static char versionString[VERSION_STRING_SIZE];
 
 /* Command handler for reading digital inputs */
 void HandleReadDI(const RS485_Packet_t* packet);
+
+/* Command handler for trend history */
+void HandleReadHistory(const RS485_Packet_t* packet);
+
+/* Command handler for the peer routing table */
+void HandleDiRoutes(const RS485_Packet_t* packet);
+
+/* Command handlers for SYNC snapshots */
+void HandleSync(const RS485_Packet_t* packet);
+void HandleReadSnapshot(const RS485_Packet_t* packet);
+void HandleSyncMode(const RS485_Packet_t* packet);
+void HandleTimeSync(const RS485_Packet_t* packet);
+void HandleBusBeacon(const RS485_Packet_t* packet);
+
+/* Command handlers for data streams */
+void HandleStreamSubscribe(const RS485_Packet_t* packet);
+void HandleStreamStatus(const RS485_Packet_t* packet);
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -69,7 +98,17 @@ static void MX_FDCAN1_Init(void);
 static void MX_USART1_UART_Init(void);
 static void MX_USART2_UART_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void Task_InputUpdate(void);
+static void Task_StatusLed(void);
+static uint16_t Capture_SyncImage(uint8_t* buffer, uint16_t bufferSize);
+
+/* Input states, published from the sampling task */
+static const Stream_DataSet_t streamDataSet = {
+    .id = STREAM_SET_DI,
+    .elementSize = 1,
+    .scanPeriodMs = DI_SAMPLE_PERIOD_MS,
+    .capture = Capture_SyncImage,
+};
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -85,12 +124,20 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  Boot_Init();
   /* USER CODE END 1 */
 
   /* MPU Configuration--------------------------------------------------------*/
   MPU_Config();
 
+  /* Enable the CPU Cache */
+
+  /* Enable I-Cache---------------------------------------------------------*/
+  SCB_EnableICache();
+
+  /* Enable D-Cache---------------------------------------------------------*/
+  SCB_EnableDCache();
+
   /* MCU Configuration--------------------------------------------------------*/
 
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
@@ -104,7 +151,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  Boot_Mark(BOOT_PHASE_CLOCKS);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -114,31 +161,78 @@ int main(void)
   MX_USART1_UART_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
+  Boot_Mark(BOOT_PHASE_PERIPHERALS);
   
-  /* Initialize hierarchical layers */
+  /* Fast start: only the RS485 link and what it depends on come up before
+   * the node answers, the rest is initialized afterwards */
   Debug_Init();
   
-  /* Print startup banner */
+  /* Enable cycle counter profiling */
+  Perf_Init();
+  
+  /* Bus clock (DWT based): local time until the first TIME_SYNC */
+  TimeSync_Init();
+  
+  /* Log flash/ITCM, SRAM/DTCM/DMA region and cache timings (before RS485 RX starts) */
+  MemBench_Run();
+  
+  /* RS485 task first: frame events posted during the deferred init are kept */
+  Sched_Init();
+  Sched_AddEvent("rs485", RS485_Process, SCHED_EVENT_RS485_FRAME, SCHED_PRIORITY_COMM);
+  
+  /* Initialize RS485 protocol layer */
+  RS485_Init(RS485_ADDR_CONTROLLER_DIO);
+  Boot_Mark(BOOT_PHASE_PROTOCOL_READY);
+  
+  /* Same command set over CAN-FD (FDCAN1) */
+  CanFd_Init(RS485_ADDR_CONTROLLER_DIO, CANFD_GROUP_DIGITAL_IN);
+  Sched_AddEvent("canfd", CanFd_Process, SCHED_EVENT_CANFD_FRAME, SCHED_PRIORITY_COMM);
+  
+  /* Deferred init: frames received meanwhile are served between the steps,
+   * input commands once their handlers are registered */
   Version_GetString(versionString, VERSION_STRING_SIZE);
   DEBUG_INFO("===========================================");
   DEBUG_INFO("  %s", versionString);
   DEBUG_INFO("===========================================");
+  RS485_Process();
   
   /* Initialize digital input handler */
   DigitalInput_Init();
+  History_Init(DI_HISTORY_PAYLOAD_SIZE, DI_HISTORY_INTERVAL_MS);
+  InputRouting_Init(RS485_ADDR_CONTROLLER_DIO);
+  BusSync_Init(Capture_SyncImage, NULL);
+  BusAccess_Init(RS485_ADDR_CONTROLLER_DIO);
+  Stream_Init();
+  Stream_RegisterDataSet(&streamDataSet);
+  RS485_Process();
   
-  /* Initialize RS485 protocol layer */
-  RS485_Init(RS485_ADDR_CONTROLLER_DIO);
+  /* Compute health from live metrics (after RS485_Init) */
+  Health_Init();
   
   /* Register digital input command handler */
   RS485_RegisterCommandHandler(CMD_READ_DI, HandleReadDI);
+  RS485_RegisterCommandHandler(CMD_READ_HISTORY, HandleReadHistory);
+  RS485_RegisterCommandHandler(CMD_DI_ROUTES, HandleDiRoutes);
+  RS485_RegisterCommandHandler(CMD_SYNC, HandleSync);
+  RS485_RegisterCommandHandler(CMD_READ_SNAPSHOT, HandleReadSnapshot);
+  RS485_RegisterCommandHandler(CMD_SYNC_MODE, HandleSyncMode);
+  RS485_RegisterCommandHandler(CMD_TIME_SYNC, HandleTimeSync);
+  RS485_RegisterCommandHandler(CMD_BUS_BEACON, HandleBusBeacon);
+  RS485_RegisterCommandHandler(CMD_STREAM_SUBSCRIBE, HandleStreamSubscribe);
+  RS485_RegisterCommandHandler(CMD_STREAM_STATUS, HandleStreamStatus);
+  
+  /* Remaining tasks, all periodic */
+  Sched_AddPeriodic("health", Health_Process, 1, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("time_sync", TimeSync_Process, 1000, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("stream", Stream_Process, 1, SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("di_sample", Task_InputUpdate, DI_SAMPLE_PERIOD_MS, SCHED_PRIORITY_IO);
+  Sched_AddPeriodic("status_led", Task_StatusLed, 500, SCHED_PRIORITY_HOUSEKEEPING);
+  inputUpdateTick = HAL_GetTick();
   
+  Boot_Mark(BOOT_PHASE_INIT_DONE);
+  Boot_Log();
   DEBUG_INFO("System initialization complete");
   DEBUG_INFO("Entering main loop...");
-  
-  heartbeatTimer = HAL_GetTick();
-  statusLedTimer = HAL_GetTick();
-  inputUpdateTimer = HAL_GetTick();
 
   /* USER CODE END 2 */
 
@@ -149,30 +243,8 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    
-    /* Process RS485 communication */
-    RS485_Process();
-    
-    /* Update digital inputs every 10ms */
-    if (HAL_GetTick() - inputUpdateTimer >= 10) {
-      inputUpdateTimer = HAL_GetTick();
-      DigitalInput_Update();
-    }
-    
-    /* Status LED blink (every 500ms) */
-    if (HAL_GetTick() - statusLedTimer >= 500) {
-      statusLedTimer = HAL_GetTick();
-      HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_1); // Status LED
-    }
-    
-    /* Periodic heartbeat (verbose output disabled) */
-    if (HAL_GetTick() - heartbeatTimer >= 10000) {
-      heartbeatTimer = HAL_GetTick();
-      // Heartbeat silently tracked
-    }
-    
-    /* Small delay to prevent CPU hogging */
-    HAL_Delay(1);
+    /* Run the task scheduler (does not return) */
+    Sched_Run();
   }
   /* USER CODE END 3 */
 }
@@ -317,33 +389,33 @@ static void MX_FDCAN1_Init(void)
 
   /* USER CODE END FDCAN1_Init 1 */
   hfdcan1.Instance = FDCAN1;
-  hfdcan1.Init.FrameFormat = FDCAN_FRAME_CLASSIC;
+  hfdcan1.Init.FrameFormat = FDCAN_FRAME_FD_BRS;
   hfdcan1.Init.Mode = FDCAN_MODE_NORMAL;
-  hfdcan1.Init.AutoRetransmission = DISABLE;
-  hfdcan1.Init.TransmitPause = DISABLE;
+  hfdcan1.Init.AutoRetransmission = ENABLE;
+  hfdcan1.Init.TransmitPause = ENABLE;
   hfdcan1.Init.ProtocolException = DISABLE;
-  hfdcan1.Init.NominalPrescaler = 16;
-  hfdcan1.Init.NominalSyncJumpWidth = 1;
-  hfdcan1.Init.NominalTimeSeg1 = 1;
-  hfdcan1.Init.NominalTimeSeg2 = 1;
+  hfdcan1.Init.NominalPrescaler = 1;
+  hfdcan1.Init.NominalSyncJumpWidth = 10;
+  hfdcan1.Init.NominalTimeSeg1 = 39;
+  hfdcan1.Init.NominalTimeSeg2 = 10;
   hfdcan1.Init.DataPrescaler = 1;
-  hfdcan1.Init.DataSyncJumpWidth = 1;
-  hfdcan1.Init.DataTimeSeg1 = 1;
-  hfdcan1.Init.DataTimeSeg2 = 1;
+  hfdcan1.Init.DataSyncJumpWidth = 2;
+  hfdcan1.Init.DataTimeSeg1 = 7;
+  hfdcan1.Init.DataTimeSeg2 = 2;
   hfdcan1.Init.MessageRAMOffset = 0;
-  hfdcan1.Init.StdFiltersNbr = 0;
-  hfdcan1.Init.ExtFiltersNbr = 0;
-  hfdcan1.Init.RxFifo0ElmtsNbr = 0;
-  hfdcan1.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_8;
-  hfdcan1.Init.RxFifo1ElmtsNbr = 0;
-  hfdcan1.Init.RxFifo1ElmtSize = FDCAN_DATA_BYTES_8;
+  hfdcan1.Init.StdFiltersNbr = 4;
+  hfdcan1.Init.ExtFiltersNbr = 10;
+  hfdcan1.Init.RxFifo0ElmtsNbr = 32;
+  hfdcan1.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_64;
+  hfdcan1.Init.RxFifo1ElmtsNbr = 8;
+  hfdcan1.Init.RxFifo1ElmtSize = FDCAN_DATA_BYTES_64;
   hfdcan1.Init.RxBuffersNbr = 0;
   hfdcan1.Init.RxBufferSize = FDCAN_DATA_BYTES_8;
   hfdcan1.Init.TxEventsNbr = 0;
-  hfdcan1.Init.TxBuffersNbr = 0;
-  hfdcan1.Init.TxFifoQueueElmtsNbr = 0;
+  hfdcan1.Init.TxBuffersNbr = 2;
+  hfdcan1.Init.TxFifoQueueElmtsNbr = 8;
   hfdcan1.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
-  hfdcan1.Init.TxElmtSize = FDCAN_DATA_BYTES_8;
+  hfdcan1.Init.TxElmtSize = FDCAN_DATA_BYTES_64;
   if (HAL_FDCAN_Init(&hfdcan1) != HAL_OK)
   {
     Error_Handler();
@@ -549,6 +621,59 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
+/**
+ * @brief  Digital input sampling task (DI_SAMPLE_PERIOD_MS): sends routed
+ *         changes, publishes the process image every DI_IMAGE_PERIOD_MS
+ * @retval None
+ */
+static void Task_InputUpdate(void)
+{
+    uint32_t now = HAL_GetTick();
+    Health_RecordIoSample(DI_SAMPLE_PERIOD_MS, now - inputUpdateTick);
+    inputUpdateTick = now;
+    
+    uint32_t updateStart = PERF_START();
+    DigitalInput_Update();
+    PERF_STOP(PERF_PROBE_IO_UPDATE, updateStart);
+    
+    /* Peer routes: changed inputs straight to the output controllers */
+    InputRouting_Process();
+    
+    /* Subscribed streams due in this slot, from the fresh sample */
+    Stream_Service();
+    
+    if (imageCountdown > 0) {
+        imageCountdown--;
+        return;
+    }
+    imageCountdown = (DI_IMAGE_PERIOD_MS / DI_SAMPLE_PERIOD_MS) - 1;
+    
+    /* CAN-FD process image: input states */
+    uint8_t image[7]; // 56 inputs = 7 bytes
+    DigitalInput_GetAll(image, sizeof(image));
+    CanFd_PublishImage(image, sizeof(image));
+}
+
+/**
+ * @brief  Status LED blink task (500 ms)
+ * @retval None
+ */
+static void Task_StatusLed(void)
+{
+    HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_1); // Status LED
+}
+
+/**
+ * @brief  UART error callback (debug and RS485 ports)
+ * @param  huart: UART handle
+ * @retval None
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    Debug_UART_ErrorCallback(huart);
+    RS485_UART_ErrorCallback(huart);
+}
+
 /**
  * @brief  Handle Read Digital Input command
  * @param  packet: Received packet
@@ -562,6 +687,161 @@ void HandleReadDI(const RS485_Packet_t* packet)
     RS485_SendResponse(packet->srcAddr, CMD_DI_RESPONSE, inputData, sizeof(inputData));
 }
 
+/**
+ * @brief  Handle Read History command (backfill after communication loss)
+ * @note   Data: [from sequence:4] optional [max records].
+ *         Response: see History_Read
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadHistory(const RS485_Packet_t* packet)
+{
+    uint32_t fromSequence = 0;
+    uint8_t maxRecords = (packet->length >= 5) ? packet->data[4] : 0;
+    
+    if (packet->length >= 4) {
+        memcpy(&fromSequence, &packet->data[0], 4);
+    }
+    
+    uint8_t historyData[HISTORY_MAX_RESPONSE];
+    uint16_t length = History_Read(fromSequence, maxRecords, historyData, sizeof(historyData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_HISTORY_RESPONSE, historyData, length);
+}
+
+/**
+ * @brief  Handle DI Routes command (peer-to-peer routing table)
+ * @note   Data: empty to read, or [count] then per route [destination][mask:7]
+ *         to replace the table. Response: see InputRouting_ReadRoutes
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleDiRoutes(const RS485_Packet_t* packet)
+{
+    if (packet->length > 0 && !InputRouting_SetRoutes(packet->data, packet->length)) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    uint8_t routesData[INPUT_ROUTING_RESPONSE_SIZE];
+    uint16_t length = InputRouting_ReadRoutes(routesData, sizeof(routesData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_DI_ROUTES_RESPONSE, routesData, length);
+}
+
+/**
+ * @brief  Handle SYNC broadcast (latch the snapshot)
+ * @note   Data: [sequence:2]. No response: sent to all nodes at once
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSync(const RS485_Packet_t* packet)
+{
+    BusSync_Latch(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Read Snapshot command (image frozen by the last SYNC)
+ * @note   Response: see BusSync_ReadSnapshot
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadSnapshot(const RS485_Packet_t* packet)
+{
+    uint8_t snapshotData[BUS_SYNC_SNAPSHOT_SIZE];
+    uint16_t length = BusSync_ReadSnapshot(snapshotData, sizeof(snapshotData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SNAPSHOT_RESPONSE, snapshotData, length);
+}
+
+/**
+ * @brief  Handle SYNC Mode command (output mode and sync statistics)
+ * @note   Data: empty to read, or [mode] (BUS_SYNC_MODE_xxx).
+ *         Response: see BusSync_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSyncMode(const RS485_Packet_t* packet)
+{
+    if (packet->length > 0 && !BusSync_SetMode(packet->data[0])) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    uint8_t statusData[BUS_SYNC_STATUS_SIZE];
+    uint16_t length = BusSync_ReadStatus(statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SYNC_MODE_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle TIME_SYNC broadcast (master time for the bus clock)
+ * @note   Data: [sequence][flags][master time us:8]. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleTimeSync(const RS485_Packet_t* packet)
+{
+    TimeSync_HandleFrame(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle BUS_BEACON broadcast (TDMA cycle and slots)
+ * @note   Data: see BusAccess_HandleBeacon. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleBusBeacon(const RS485_Packet_t* packet)
+{
+    BusAccess_HandleBeacon(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Stream Subscribe command (subscribe, renew, cancel)
+ * @note   Data/response: see Stream_Subscribe
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleStreamSubscribe(const RS485_Packet_t* packet)
+{
+    uint8_t subscribeData[STREAM_SUBSCRIBE_SIZE];
+    uint16_t length = Stream_Subscribe(packet->data, packet->length, packet->srcAddr,
+                                       subscribeData, sizeof(subscribeData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_STREAM_SUBSCRIBE_RESPONSE, subscribeData, length);
+}
+
+/**
+ * @brief  Handle Stream Status command (active streams, renews leases)
+ * @note   Response: see Stream_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleStreamStatus(const RS485_Packet_t* packet)
+{
+    uint8_t statusData[STREAM_STATUS_SIZE];
+    uint16_t length = Stream_ReadStatus(packet->srcAddr, statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_STREAM_STATUS_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Capture the SYNC snapshot: input states (56 inputs = 7 bytes)
+ * @param  buffer: Output buffer
+ * @param  bufferSize: Buffer size
+ * @retval Image length
+ */
+static uint16_t Capture_SyncImage(uint8_t* buffer, uint16_t bufferSize)
+{
+    uint16_t length = (bufferSize < DI_STATE_BYTES) ? bufferSize : DI_STATE_BYTES;
+    DigitalInput_GetAll(buffer, length);
+    return length;
+}
+
 /* USER CODE END 4 */
 
  /* MPU Configuration */
@@ -587,6 +867,21 @@ void MPU_Config(void)
   MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
   MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
 
+  HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /** Initializes and configures the Region and the memory to be protected
+  */
+  MPU_InitStruct.Number = MPU_REGION_NUMBER1;
+  MPU_InitStruct.BaseAddress = 0x30000000;
+  MPU_InitStruct.Size = MPU_REGION_SIZE_32KB;
+  MPU_InitStruct.SubRegionDisable = 0x0;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+  MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+
   HAL_MPU_ConfigRegion(&MPU_InitStruct);
   /* Enables the MPU */
   HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
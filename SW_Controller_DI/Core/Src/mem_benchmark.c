@@ -0,0 +1,175 @@
+/**
+ ******************************************************************************
+ * @file           : mem_benchmark.c
+ * @brief          : Memory Placement and Cache Benchmark Implementation
+ ******************************************************************************
+ */
+
+#include "mem_benchmark.h"
+#include "debug_uart.h"
+
+/* Kernel under test: returns a value so the work cannot be optimized away */
+typedef uint32_t (*BenchKernel_t)(const uint8_t* data);
+
+/* One Placement */
+typedef struct {
+    const char* name;
+    BenchKernel_t kernel;
+    const uint8_t* data;
+} BenchCase_t;
+
+/* Private Variables */
+static uint8_t sramBuffer[MEM_BENCH_DATA_SIZE] __attribute__((aligned(32)));
+static uint8_t dtcmBuffer[MEM_BENCH_DATA_SIZE] DTCM_DATA __attribute__((aligned(32)));
+static uint8_t dmaBuffer[MEM_BENCH_DATA_SIZE] DMA_BUFFER;
+static volatile uint32_t benchSink = 0;
+
+/* Private Function Prototypes */
+static uint32_t Crc_Flash(const uint8_t* data);
+static uint32_t Crc_Itcm(const uint8_t* data);
+static uint32_t Sum_Words(const uint8_t* data);
+static uint32_t Measure(BenchKernel_t kernel, const uint8_t* data);
+static void Run_Case(const BenchCase_t* benchCase);
+
+/**
+ * @brief  Run the benchmark and log the results (call after Perf_Init)
+ * @retval None
+ */
+void MemBench_Run(void)
+{
+#if MEM_BENCH_ENABLED
+    const BenchCase_t cases[] = {
+        { "crc flash",     Crc_Flash, dtcmBuffer },
+        { "crc itcm",      Crc_Itcm,  dtcmBuffer },
+        { "sum sram",      Sum_Words, sramBuffer },
+        { "sum dtcm",      Sum_Words, dtcmBuffer },
+        { "sum dma ncache", Sum_Words, dmaBuffer },
+    };
+
+    for (uint32_t i = 0; i < MEM_BENCH_DATA_SIZE; i++) {
+        sramBuffer[i] = (uint8_t)i;
+        dtcmBuffer[i] = (uint8_t)i;
+        dmaBuffer[i] = (uint8_t)i;
+    }
+
+    DEBUG_INFO("Memory benchmark (cycles: caches off / cold / warm):");
+
+    /* Caches are switched off and back on: no interrupt may see memory
+     * while dirty lines are being written back */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Run_Case(&cases[i]);
+    }
+    __set_PRIMASK(primask);
+#endif
+}
+
+/* Private Functions */
+
+/**
+ * @brief  CRC-16 of one frame (RS485_CalculateCRC algorithm)
+ * @param  data: Frame
+ * @param  length: Frame length
+ * @retval CRC16 value
+ */
+static inline __attribute__((always_inline)) uint32_t Crc_Kernel(const uint8_t* data, uint16_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t j = 0; j < 8; j++) {
+            if (crc & 0x0001) {
+                crc = (crc >> 1) ^ 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief  CRC kernel executed from flash
+ * @param  data: Frame
+ * @retval CRC16 value
+ */
+static __attribute__((noinline)) uint32_t Crc_Flash(const uint8_t* data)
+{
+    return Crc_Kernel(data, MEM_BENCH_CRC_SIZE);
+}
+
+/**
+ * @brief  CRC kernel executed from ITCM
+ * @param  data: Frame
+ * @retval CRC16 value
+ */
+static ITCM_TEXT uint32_t Crc_Itcm(const uint8_t* data)
+{
+    return Crc_Kernel(data, MEM_BENCH_CRC_SIZE);
+}
+
+/**
+ * @brief  Sum all words of a buffer (executed from ITCM)
+ * @param  data: Buffer (MEM_BENCH_DATA_SIZE bytes, word aligned)
+ * @retval Sum
+ */
+static ITCM_TEXT uint32_t Sum_Words(const uint8_t* data)
+{
+    const uint32_t* words = (const uint32_t*)data;
+    uint32_t sum = 0;
+
+    for (uint32_t i = 0; i < MEM_BENCH_DATA_SIZE / 4U; i++) {
+        sum += words[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief  Time one kernel run
+ * @param  kernel: Kernel
+ * @param  data: Kernel input
+ * @retval Cycles
+ */
+static uint32_t Measure(BenchKernel_t kernel, const uint8_t* data)
+{
+    uint32_t start = DWT->CYCCNT;
+    benchSink += kernel(data);
+    return DWT->CYCCNT - start;
+}
+
+/**
+ * @brief  Measure one placement in all cache states and log it
+ * @param  benchCase: Placement
+ * @retval None
+ */
+static void Run_Case(const BenchCase_t* benchCase)
+{
+    uint32_t off = UINT32_MAX;
+    uint32_t warm = UINT32_MAX;
+
+    SCB_DisableICache();
+    SCB_DisableDCache();
+    for (uint8_t run = 0; run < MEM_BENCH_RUNS; run++) {
+        uint32_t cycles = Measure(benchCase->kernel, benchCase->data);
+        if (cycles < off) {
+            off = cycles;
+        }
+    }
+
+    /* Enabling invalidates both caches: the first run is cold */
+    SCB_EnableICache();
+    SCB_EnableDCache();
+    uint32_t cold = Measure(benchCase->kernel, benchCase->data);
+    for (uint8_t run = 0; run < MEM_BENCH_RUNS; run++) {
+        uint32_t cycles = Measure(benchCase->kernel, benchCase->data);
+        if (cycles < warm) {
+            warm = cycles;
+        }
+    }
+
+    DEBUG_INFO("  %-15s %7lu %7lu %7lu  (data @0x%08lX)", benchCase->name,
+               off, cold, warm, (uint32_t)(uintptr_t)benchCase->data);
+}
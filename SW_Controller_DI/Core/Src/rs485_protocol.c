@@ -8,6 +8,13 @@
 #include "rs485_protocol.h"
 #include "debug_uart.h"
 #include "version.h"
+#include "perf_monitor.h"
+#include "health_monitor.h"
+#include "scheduler.h"
+#include "boot_profile.h"
+#include "canfd_transport.h"
+#include "time_sync.h"
+#include "bus_access.h"
 #include <string.h>
 
 /* External UART Handle */
@@ -19,10 +26,27 @@ extern UART_HandleTypeDef huart2;
 
 /* Private Variables */
 static uint8_t myAddress = RS485_ADDR_CONTROLLER_OUT;
-static uint8_t rxBuffer[RS485_RX_BUFFER_SIZE];
-static uint16_t rxIndex = 0;
+static uint8_t rxBuffer[RS485_RX_BUFFER_SIZE] DTCM_DATA;
+static uint16_t rxIndex DTCM_DATA = 0;
 static RS485_Status_t status = {0};
 static volatile uint8_t txInProgress = 0;  // Flag to prevent TX during RX interrupt
+static RS485_Telemetry_t telemetry = {0};
+static uint32_t packetEndCycles = 0;       // DWT cycles at the end byte of the last frame
+static uint32_t turnaroundStart = 0;
+static uint8_t turnaroundPending = 0;      // Request being handled, first response not sent yet
+static RS485_Transport_t replyTransport = RS485_TRANSPORT_SERIAL;  // Transport of the request being handled
+static RS485_ForwardHandler_t forwardHandler = NULL;  // Frames for other nodes (gateway)
+static volatile uint32_t rxLastByteTick = 0;
+static volatile uint8_t rxInFrame = 0;     // Parser inside a frame
+
+/* Received Frame Queue (filled in the USART2 interrupt, drained by RS485_Process) */
+typedef struct {
+    uint8_t data[RS485_MAX_PACKET_SIZE];
+    uint32_t endCycles;                    // DWT cycles at the end byte
+} RS485_Frame_t;
+static RS485_Frame_t frameQueue[RS485_FRAME_QUEUE_SIZE] DTCM_DATA;
+static volatile uint8_t frameHead DTCM_DATA = 0;
+static volatile uint8_t frameTail DTCM_DATA = 0;
 
 /* Command Handler Array */
 typedef void (*CommandHandler_t)(const RS485_Packet_t*);
@@ -31,10 +55,18 @@ static CommandHandler_t commandHandlers[256] = {0};
 /* Private Function Prototypes */
 static void RS485_ProcessReceivedByte(uint8_t byte);
 static void RS485_ProcessPacket(const uint8_t* buffer);
+static HAL_StatusTypeDef RS485_Transmit(uint8_t destAddr, uint8_t srcAddr, uint8_t cmd,
+                                        const uint8_t* data, uint8_t length);
 static void RS485_HandlePing(const RS485_Packet_t* packet);
 static void RS485_HandleGetVersion(const RS485_Packet_t* packet);
 static void RS485_HandleHeartbeat(const RS485_Packet_t* packet);
 static void RS485_HandleGetStatus(const RS485_Packet_t* packet);
+static void RS485_HandleGetPerf(const RS485_Packet_t* packet);
+static void RS485_HandleGetTelemetry(const RS485_Packet_t* packet);
+static void RS485_HandleGetHealth(const RS485_Packet_t* packet);
+static void RS485_HandleGetTasks(const RS485_Packet_t* packet);
+static void RS485_HandleGetBootTimes(const RS485_Packet_t* packet);
+static void RS485_RecordTurnaround(void);
 
 /**
  * @brief  Initialize RS485 protocol
@@ -45,7 +77,11 @@ void RS485_Init(uint8_t myAddr)
 {
     myAddress = myAddr;
     rxIndex = 0;
+    frameHead = 0;
+    frameTail = 0;
     memset(&status, 0, sizeof(status));
+    memset(&telemetry, 0, sizeof(telemetry));
+    telemetry.turnaroundMin = UINT32_MAX;
     
     status.mcuId = myAddress;
     status.health = 100;
@@ -58,6 +94,11 @@ void RS485_Init(uint8_t myAddr)
     RS485_RegisterCommandHandler(CMD_GET_VERSION, RS485_HandleGetVersion);
     RS485_RegisterCommandHandler(CMD_HEARTBEAT, RS485_HandleHeartbeat);
     RS485_RegisterCommandHandler(CMD_GET_STATUS, RS485_HandleGetStatus);
+    RS485_RegisterCommandHandler(CMD_GET_PERF, RS485_HandleGetPerf);
+    RS485_RegisterCommandHandler(CMD_GET_TELEMETRY, RS485_HandleGetTelemetry);
+    RS485_RegisterCommandHandler(CMD_GET_HEALTH, RS485_HandleGetHealth);
+    RS485_RegisterCommandHandler(CMD_GET_TASKS, RS485_HandleGetTasks);
+    RS485_RegisterCommandHandler(CMD_GET_BOOT_TIMES, RS485_HandleGetBootTimes);
     
     /* Start receiving in interrupt mode */
     HAL_UART_Receive_IT(&huart2, rxBuffer, 1);
@@ -66,13 +107,25 @@ void RS485_Init(uint8_t myAddr)
 }
 
 /**
- * @brief  Process RS485 communication (call in main loop)
+ * @brief  Process received frames (SCHED_EVENT_RS485_FRAME task)
+ * @note   Command handlers run here in thread mode, not in the interrupt
  * @retval None
  */
 void RS485_Process(void)
 {
     /* Update uptime */
     status.uptime = HAL_GetTick() / 1000;
+    
+    while (frameTail != frameHead) {
+        RS485_Frame_t* frame = &frameQueue[frameTail];
+        
+        packetEndCycles = frame->endCycles;
+        uint32_t packetStart = PERF_START();
+        RS485_ProcessPacket(frame->data);
+        PERF_STOP(PERF_PROBE_RS485_PACKET, packetStart);
+        
+        frameTail = (frameTail + 1) % RS485_FRAME_QUEUE_SIZE;
+    }
 }
 
 /**
@@ -85,15 +138,102 @@ void RS485_Process(void)
  */
 HAL_StatusTypeDef RS485_SendPacket(uint8_t destAddr, RS485_Command_t cmd, 
                                    const uint8_t* data, uint8_t length)
+{
+    return RS485_SendPacketVia(replyTransport, destAddr, cmd, data, length);
+}
+
+/**
+ * @brief  Send RS485 packet over a given transport
+ * @note   For frames sent outside the handler of the request (streamed
+ *         segments), with the transport saved by RS485_GetReplyTransport
+ * @param  transport: Transport
+ * @param  destAddr: Destination address
+ * @param  cmd: Command code
+ * @param  data: Data payload
+ * @param  length: Data length
+ * @retval HAL status
+ */
+HAL_StatusTypeDef RS485_SendPacketVia(RS485_Transport_t transport, uint8_t destAddr,
+                                      RS485_Command_t cmd, const uint8_t* data, uint8_t length)
 {
     if (length > 250) {
         return HAL_ERROR;
     }
     
+#if CANFD_ENABLED
+    if (transport == RS485_TRANSPORT_CANFD) {
+        return CanFd_Send(destAddr, cmd, data, length);
+    }
+#else
+    (void)transport;
+#endif
+    
+    return RS485_Transmit(destAddr, myAddress, cmd, data, length);
+}
+
+/**
+ * @brief  Relay a packet from another node over RS485 (gateway)
+ * @note   Always serial; the packet's source address is kept
+ * @param  packet: Packet (destAddr, srcAddr, command, length, data)
+ * @retval HAL status
+ */
+HAL_StatusTypeDef RS485_RelayPacket(const RS485_Packet_t* packet)
+{
+    if (packet->length > 250) {
+        return HAL_ERROR;
+    }
+    
+    return RS485_Transmit(packet->destAddr, packet->srcAddr, packet->command,
+                          packet->data, packet->length);
+}
+
+/**
+ * @brief  Check that no frame is being received on RS485
+ * @note   Half duplex: a node sending unsolicited frames (gateway relay,
+ *         bus_access.h) waits for this so it does not collide with the master.
+ *         Also false while the USART receives a byte (carrier sense)
+ * @retval 1 if the line has been quiet for RS485_LINE_GUARD_MS
+ */
+uint8_t RS485_IsLineIdle(void)
+{
+    uint32_t quiet = HAL_GetTick() - rxLastByteTick;
+    
+    if (rxInFrame && quiet <= RS485_INTERBYTE_TIMEOUT_MS) {
+        return 0;
+    }
+    /* Carrier sense: a byte is being received right now */
+    if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_BUSY)) {
+        return 0;
+    }
+    return quiet >= RS485_LINE_GUARD_MS;
+}
+
+/**
+ * @brief  Register the handler for valid frames addressed to other nodes
+ * @param  handler: Forward handler (thread mode), NULL to ignore them
+ * @retval None
+ */
+void RS485_SetForwardHandler(RS485_ForwardHandler_t handler)
+{
+    forwardHandler = handler;
+}
+
+/**
+ * @brief  Send one frame on USART2
+ * @param  destAddr: Destination address
+ * @param  srcAddr: Source address
+ * @param  cmd: Command code
+ * @param  data: Data payload
+ * @param  length: Data length (max 250)
+ * @retval HAL status
+ */
+static HAL_StatusTypeDef RS485_Transmit(uint8_t destAddr, uint8_t srcAddr, uint8_t cmd,
+                                        const uint8_t* data, uint8_t length)
+{
     RS485_Packet_t packet;
     packet.startByte = RS485_START_BYTE;
     packet.destAddr = destAddr;
-    packet.srcAddr = myAddress;
+    packet.srcAddr = srcAddr;
     packet.command = cmd;
     packet.length = length;
     
@@ -150,12 +290,21 @@ HAL_StatusTypeDef RS485_SendPacket(uint8_t destAddr, RS485_Command_t cmd,
         __NOP();
     }
     
+    /* Turnaround: end of request to first response byte */
+    if (turnaroundPending) {
+        turnaroundPending = 0;
+        RS485_RecordTurnaround();
+    }
+    
     /* Transmit packet */
     HAL_StatusTypeDef result = HAL_UART_Transmit(&huart2, txBuffer, 
                                                   packetSize, RS485_TIMEOUT_MS);
     
     /* Wait for transmission complete */
     while(__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC) == RESET);
+    if (result == HAL_OK) {
+        Boot_Mark(BOOT_PHASE_FIRST_RESPONSE);
+    }
     // DEBUG_INFO("UART TX complete");
     
     /* Small delay before switching back - busy wait instead of HAL_Delay */
@@ -177,9 +326,11 @@ HAL_StatusTypeDef RS485_SendPacket(uint8_t destAddr, RS485_Command_t cmd,
     
     if (result == HAL_OK) {
         status.txPacketCount++;
+        telemetry.txFrames++;
         DEBUG_DEBUG("TX: Addr=0x%02X Cmd=0x%02X Len=%d", destAddr, cmd, length);
     } else {
         status.errorCount++;
+        telemetry.txErrors++;
         DEBUG_ERROR("TX Failed: Addr=0x%02X Cmd=0x%02X", destAddr, cmd);
     }
     
@@ -233,16 +384,45 @@ void RS485_RegisterCommandHandler(RS485_Command_t cmd,
  */
 RS485_Status_t* RS485_GetStatus(void)
 {
+    status.uptime = HAL_GetTick() / 1000;
     return &status;
 }
 
+/**
+ * @brief  Get protocol telemetry
+ * @retval Pointer to telemetry counters
+ */
+const RS485_Telemetry_t* RS485_GetTelemetry(void)
+{
+    return &telemetry;
+}
+
+/**
+ * @brief  Get the reception time of the request being handled
+ * @note   RS485: end byte of the frame (RX interrupt). CAN-FD: now
+ * @retval DWT cycles
+ */
+uint32_t RS485_GetRequestCycles(void)
+{
+    return (replyTransport == RS485_TRANSPORT_SERIAL) ? packetEndCycles : DWT->CYCCNT;
+}
+
+/**
+ * @brief  Get the transport of the request being handled
+ * @retval Transport (RS485_TRANSPORT_SERIAL outside a command handler)
+ */
+RS485_Transport_t RS485_GetReplyTransport(void)
+{
+    return replyTransport;
+}
+
 /**
  * @brief  Calculate CRC16 checksum
  * @param  data: Data buffer
  * @param  length: Data length
  * @retval CRC16 value
  */
-uint16_t RS485_CalculateCRC(const uint8_t* data, uint16_t length)
+ITCM_TEXT uint16_t RS485_CalculateCRC(const uint8_t* data, uint16_t length)
 {
     uint16_t crc = 0xFFFF;
     
@@ -298,7 +478,12 @@ static void RS485_ProcessPacket(const uint8_t* buffer)
         DEBUG_ERROR("CRC Error: Expected 0x%04X, Got 0x%04X", 
                    calculatedCRC, receivedCRC);
         status.errorCount++;
-        RS485_SendError(srcAddr, RS485_ERR_INVALID_CHECKSUM);
+        telemetry.crcErrors++;
+        /* Only the addressed node answers: a collided frame would otherwise
+           be answered by every node */
+        if (destAddr == myAddress) {
+            RS485_SendError(srcAddr, RS485_ERR_INVALID_CHECKSUM);
+        }
         return;
     }
     
@@ -306,11 +491,26 @@ static void RS485_ProcessPacket(const uint8_t* buffer)
     
     /* Check if packet is for us */
     if (destAddr != myAddress && destAddr != RS485_ADDR_BROADCAST) {
-        // Not for us - ignore silently
+        telemetry.foreignFrames++;
+        if (forwardHandler != NULL) {
+            RS485_Packet_t foreign;
+            foreign.destAddr = destAddr;
+            foreign.srcAddr = srcAddr;
+            foreign.command = command;
+            foreign.length = length;
+            memcpy(foreign.data, data, length);
+            forwardHandler(&foreign);
+        }
+        // Not for us - forwarded (gateway) or ignored silently
         return; // Not for us
     }
     
     status.rxPacketCount++;
+    telemetry.rxFrames++;
+    telemetry.commandCounts[command]++;
+    if (destAddr == RS485_ADDR_BROADCAST) {
+        telemetry.broadcastFrames++;
+    }
     // DEBUG_INFO("RX: From=0x%02X Cmd=0x%02X Len=%d", srcAddr, command, length);
     
     /* Build packet structure for handler */
@@ -323,14 +523,44 @@ static void RS485_ProcessPacket(const uint8_t* buffer)
         memcpy(packet.data, data, length);
     }
     
+    RS485_DispatchPacket(&packet, RS485_TRANSPORT_SERIAL);
+}
+
+/**
+ * @brief  Run the command handler of a received packet (all transports)
+ * @note   Thread mode only. Responses sent by the handler go back over the
+ *         transport of the request.
+ * @param  packet: Packet addressed to this node (destAddr, srcAddr, command, length, data)
+ * @param  transport: Transport the packet was received on
+ * @retval None
+ */
+void RS485_DispatchPacket(const RS485_Packet_t* packet, RS485_Transport_t transport)
+{
+    uint8_t command = packet->command;
+    
+    if (transport != RS485_TRANSPORT_SERIAL) {
+        status.rxPacketCount++;
+        telemetry.commandCounts[command]++;
+    }
+    
     /* Call command handler if registered */
+    replyTransport = transport;
     if (commandHandlers[command] != NULL) {
         // DEBUG_INFO("Calling handler for cmd=0x%02X", command);
-        commandHandlers[command](&packet);
+        uint32_t handlerStart = PERF_START();
+        if (transport == RS485_TRANSPORT_SERIAL) {
+            turnaroundStart = packetEndCycles;
+            turnaroundPending = 1;
+        }
+        commandHandlers[command](packet);
+        turnaroundPending = 0;
+        PERF_STOP_COMMAND(command, handlerStart);
     } else {
         DEBUG_WARNING("Unhandled command: 0x%02X", command);
-        RS485_SendError(srcAddr, RS485_ERR_INVALID_COMMAND);
+        telemetry.unknownCommands++;
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_COMMAND);
     }
+    replyTransport = RS485_TRANSPORT_SERIAL;
 }
 
 /**
@@ -372,34 +602,198 @@ static void RS485_HandleGetVersion(const RS485_Packet_t* packet)
 
 /**
  * @brief  Handle HEARTBEAT command
+ * @note   Response: [address][health][component count][component scores]
  * @param  packet: Received packet
  * @retval None
  */
 static void RS485_HandleHeartbeat(const RS485_Packet_t* packet)
 {
-    uint8_t heartbeatData[2];
+    uint8_t heartbeatData[3 + HEALTH_COMPONENT_COUNT];
     heartbeatData[0] = myAddress;
     heartbeatData[1] = status.health;
+    heartbeatData[2] = HEALTH_COMPONENT_COUNT;
+    for (uint8_t i = 0; i < HEALTH_COMPONENT_COUNT; i++) {
+        heartbeatData[3 + i] = Health_GetScore((HealthComponent_t)i);
+    }
     
-    RS485_SendResponse(packet->srcAddr, CMD_HEARTBEAT_RESPONSE, heartbeatData, 2);
+    RS485_SendResponse(packet->srcAddr, CMD_HEARTBEAT_RESPONSE, heartbeatData, sizeof(heartbeatData));
 }
 
 /**
  * @brief  Handle GET_STATUS command
+ * @note   Response: [MCU ID][health][uptime s:4][errors:4][rx packets:4][tx packets:4]
  * @param  packet: Received packet
  * @retval None
  */
 static void RS485_HandleGetStatus(const RS485_Packet_t* packet)
 {
-    uint8_t statusData[16];
+    uint8_t statusData[18];
     statusData[0] = status.mcuId;
     statusData[1] = status.health;
     memcpy(&statusData[2], &status.uptime, 4);
     memcpy(&statusData[6], &status.errorCount, 4);
     memcpy(&statusData[10], &status.rxPacketCount, 4);
-    memcpy(&statusData[14], &status.txPacketCount, 2);
+    memcpy(&statusData[14], &status.txPacketCount, 4);
     
-    RS485_SendResponse(packet->srcAddr, CMD_STATUS_RESPONSE, statusData, 16);
+    RS485_SendResponse(packet->srcAddr, CMD_STATUS_RESPONSE, statusData, sizeof(statusData));
+}
+
+/**
+ * @brief  Handle GET_PERF command
+ * @note   Request: [probe index][flags] (both optional), one probe per response
+ * @param  packet: Received packet
+ * @retval None
+ */
+static void RS485_HandleGetPerf(const RS485_Packet_t* packet)
+{
+    uint8_t index = (packet->length >= 1) ? packet->data[0] : 0;
+    uint8_t flags = (packet->length >= 2) ? packet->data[1] : 0;
+    uint8_t perfData[PERF_RESPONSE_SIZE];
+    
+    uint16_t length = Perf_Read(index, perfData, sizeof(perfData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    if (flags & PERF_FLAG_RESET) {
+        Perf_Reset();
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_PERF_RESPONSE, perfData, (uint8_t)length);
+}
+
+/**
+ * @brief  Handle GET_TELEMETRY command
+ * @note   Request: [section][first command] (both optional).
+ *         Response: [version][section], then
+ *         - counters: 17 x u32 (rx, tx, crc, framing, noise, overrun, parity,
+ *           end byte, timeouts, overflows, foreign, broadcast, rx during tx,
+ *           tx errors, unknown commands, uptime s, debug dropped),
+ *           [rx buffer high-water:2][debug ring high-water:2]
+ *           [frame queue high-water][CAN-FD event queue high-water]
+ *         - commands: [count], count x [command][requests:4] (from first command)
+ *         - turnaround: [bins][count:4][min us:4][max us:4][total us:8], bins x u32
+ *         - time: bus clock synchronization, see TimeSync_ReadTelemetry
+ *         - bus: TDMA/CSMA access and collisions, see BusAccess_ReadTelemetry
+ * @param  packet: Received packet
+ * @retval None
+ */
+static void RS485_HandleGetTelemetry(const RS485_Packet_t* packet)
+{
+    uint8_t section = (packet->length >= 1) ? packet->data[0] : RS485_TELEMETRY_SECTION_COUNTERS;
+    uint8_t first = (packet->length >= 2) ? packet->data[1] : 0;
+    uint8_t response[250];
+    uint8_t length = 0;
+    
+    response[length++] = RS485_TELEMETRY_VERSION;
+    response[length++] = section;
+    
+    if (section == RS485_TELEMETRY_SECTION_COUNTERS) {
+        DebugStats_t debugStats;
+        Debug_GetStats(&debugStats);
+        
+        const uint32_t counters[] = {
+            telemetry.rxFrames, telemetry.txFrames, telemetry.crcErrors,
+            telemetry.framingErrors, telemetry.noiseErrors, telemetry.overrunErrors,
+            telemetry.parityErrors, telemetry.endByteErrors, telemetry.parserTimeouts,
+            telemetry.bufferOverflows, telemetry.foreignFrames, telemetry.broadcastFrames,
+            telemetry.rxDuringTx, telemetry.txErrors, telemetry.unknownCommands,
+            status.uptime, debugStats.droppedMessages
+        };
+        memcpy(&response[length], counters, sizeof(counters));
+        length += sizeof(counters);
+        memcpy(&response[length], &telemetry.rxBufferHighWater, 2);
+        memcpy(&response[length + 2], &debugStats.highWater, 2);
+        length += 4;
+        response[length++] = telemetry.frameQueueHighWater;
+        response[length++] = (uint8_t)CanFd_GetStats()->eventQueueHighWater;
+    } else if (section == RS485_TELEMETRY_SECTION_COMMANDS) {
+        uint8_t countIndex = length++;
+        uint8_t count = 0;
+        
+        for (uint16_t cmd = first; cmd < 256 && count < RS485_TELEMETRY_MAX_COMMANDS; cmd++) {
+            if (telemetry.commandCounts[cmd] > 0) {
+                response[length] = (uint8_t)cmd;
+                memcpy(&response[length + 1], &telemetry.commandCounts[cmd], 4);
+                length += 5;
+                count++;
+            }
+        }
+        response[countIndex] = count;
+    } else if (section == RS485_TELEMETRY_SECTION_TURNAROUND) {
+        uint32_t minimum = (telemetry.turnaroundCount > 0) ? telemetry.turnaroundMin : 0;
+        
+        response[length++] = RS485_TURNAROUND_BINS;
+        memcpy(&response[length], &telemetry.turnaroundCount, 4);
+        memcpy(&response[length + 4], &minimum, 4);
+        memcpy(&response[length + 8], &telemetry.turnaroundMax, 4);
+        memcpy(&response[length + 12], &telemetry.turnaroundTotal, 8);
+        length += 20;
+        memcpy(&response[length], telemetry.turnaroundHistogram, sizeof(telemetry.turnaroundHistogram));
+        length += sizeof(telemetry.turnaroundHistogram);
+    } else if (section == RS485_TELEMETRY_SECTION_TIME) {
+        length += TimeSync_ReadTelemetry(&response[length], sizeof(response) - length);
+    } else if (section == RS485_TELEMETRY_SECTION_BUS) {
+        length += BusAccess_ReadTelemetry(&response[length], sizeof(response) - length);
+    } else {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_TELEMETRY_RESPONSE, response, length);
+}
+
+/**
+ * @brief  Handle GET_HEALTH command
+ * @note   Response layout: see Health_Read
+ * @param  packet: Received packet
+ * @retval None
+ */
+static void RS485_HandleGetHealth(const RS485_Packet_t* packet)
+{
+    uint8_t healthData[HEALTH_RESPONSE_SIZE];
+    
+    uint16_t length = Health_Read(healthData, sizeof(healthData));
+    RS485_SendResponse(packet->srcAddr, CMD_HEALTH_RESPONSE, healthData, (uint8_t)length);
+}
+
+/**
+ * @brief  Handle GET_TASKS command
+ * @note   Request: [task index][flags] (both optional), one task per response
+ * @param  packet: Received packet
+ * @retval None
+ */
+static void RS485_HandleGetTasks(const RS485_Packet_t* packet)
+{
+    uint8_t index = (packet->length >= 1) ? packet->data[0] : 0;
+    uint8_t flags = (packet->length >= 2) ? packet->data[1] : 0;
+    uint8_t taskData[SCHED_RESPONSE_SIZE];
+    
+    uint16_t length = Sched_Read(index, taskData, sizeof(taskData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    if (flags & SCHED_FLAG_RESET) {
+        Sched_ResetStats();
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_TASKS_RESPONSE, taskData, (uint8_t)length);
+}
+
+/**
+ * @brief  Handle GET_BOOT_TIMES command
+ * @param  packet: Received packet
+ * @retval None
+ */
+static void RS485_HandleGetBootTimes(const RS485_Packet_t* packet)
+{
+    uint8_t bootData[BOOT_RESPONSE_SIZE];
+    
+    uint16_t length = Boot_Read(bootData, sizeof(bootData));
+    RS485_SendResponse(packet->srcAddr, CMD_BOOT_TIMES_RESPONSE, bootData, (uint8_t)length);
 }
 
 /**
@@ -407,11 +801,12 @@ static void RS485_HandleGetStatus(const RS485_Packet_t* packet)
  * @param  huart: UART handle
  * @retval None
  */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+ITCM_TEXT void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
     if (huart->Instance == USART2) {
         /* Ignore RX during TX (loopback prevention) */
         if (txInProgress) {
+            telemetry.rxDuringTx++;
             HAL_UART_Receive_IT(&huart2, rxBuffer, 1);
             return;
         }
@@ -424,12 +819,42 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
     }
 }
 
+/**
+ * @brief  UART error handling for the RS485 port (called from HAL_UART_ErrorCallback)
+ * @note   Overrun aborts the interrupt reception in HAL, restart it here
+ * @param  huart: UART handle
+ * @retval None
+ */
+void RS485_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART2) {
+        uint32_t error = huart->ErrorCode;
+        
+        if (error & HAL_UART_ERROR_FE) {
+            telemetry.framingErrors++;
+        }
+        if (error & HAL_UART_ERROR_NE) {
+            telemetry.noiseErrors++;
+        }
+        if (error & HAL_UART_ERROR_ORE) {
+            telemetry.overrunErrors++;
+        }
+        if (error & HAL_UART_ERROR_PE) {
+            telemetry.parityErrors++;
+        }
+        
+        if (huart->RxState == HAL_UART_STATE_READY) {
+            HAL_UART_Receive_IT(&huart2, rxBuffer, 1);
+        }
+    }
+}
+
 /**
  * @brief  Process received byte
  * @param  byte: Received byte
  * @retval None
  */
-static void RS485_ProcessReceivedByte(uint8_t byte)
+static ITCM_TEXT void RS485_ProcessReceivedByte(uint8_t byte)
 {
     static uint8_t packetBuffer[RS485_MAX_PACKET_SIZE];
     static uint16_t packetIndex = 0;
@@ -438,9 +863,12 @@ static void RS485_ProcessReceivedByte(uint8_t byte)
     
     /* Reset parser if no byte received for >500ms (inter-packet timeout) */
     uint32_t now = HAL_GetTick();
-    if (now - lastByteTime > 500 && packetIndex > 0) {
+    rxLastByteTick = now;
+    if (now - lastByteTime > RS485_INTERBYTE_TIMEOUT_MS && packetIndex > 0) {
+        telemetry.parserTimeouts++;
         packetIndex = 0;
         expectedLength = 0;
+        rxInFrame = 0;
     }
     lastByteTime = now;
     
@@ -449,6 +877,9 @@ static void RS485_ProcessReceivedByte(uint8_t byte)
     }
     
     packetBuffer[packetIndex++] = byte;
+    if (packetIndex > telemetry.rxBufferHighWater) {
+        telemetry.rxBufferHighWater = packetIndex;
+    }
     
     /* Get expected length from packet header */
     if (packetIndex == 5) {
@@ -459,9 +890,23 @@ static void RS485_ProcessReceivedByte(uint8_t byte)
     if (packetIndex >= 8 && packetIndex >= (5 + expectedLength + 3)) {
         /* Verify end byte */
         if (packetBuffer[packetIndex - 1] == RS485_END_BYTE) {
-            RS485_ProcessPacket(packetBuffer);
+            uint8_t next = (frameHead + 1) % RS485_FRAME_QUEUE_SIZE;
+            if (next != frameTail) {
+                frameQueue[frameHead].endCycles = DWT->CYCCNT;
+                memcpy(frameQueue[frameHead].data, packetBuffer, packetIndex);
+                frameHead = next;
+                uint8_t waiting = (uint8_t)((next + RS485_FRAME_QUEUE_SIZE - frameTail) % RS485_FRAME_QUEUE_SIZE);
+                if (waiting > telemetry.frameQueueHighWater) {
+                    telemetry.frameQueueHighWater = waiting;
+                }
+                Sched_PostEvent(SCHED_EVENT_RS485_FRAME);
+            } else {
+                status.errorCount++;
+                telemetry.bufferOverflows++;
+            }
         } else {
             status.errorCount++;
+            telemetry.endByteErrors++;
         }
         packetIndex = 0;
         expectedLength = 0;
@@ -469,9 +914,35 @@ static void RS485_ProcessReceivedByte(uint8_t byte)
     
     /* Prevent buffer overflow */
     if (packetIndex >= RS485_MAX_PACKET_SIZE) {
+        telemetry.bufferOverflows++;
         packetIndex = 0;
         expectedLength = 0;
         status.errorCount++;
     }
+    
+    rxInFrame = (packetIndex > 0);
 }
 
+/**
+ * @brief  Record request-to-response turnaround (first response byte)
+ * @retval None
+ */
+static void RS485_RecordTurnaround(void)
+{
+    uint32_t us = (DWT->CYCCNT - turnaroundStart) / (SystemCoreClock / 1000000U);
+    uint32_t bin = 32U - __CLZ(us);
+    
+    if (bin >= RS485_TURNAROUND_BINS) {
+        bin = RS485_TURNAROUND_BINS - 1;
+    }
+    
+    telemetry.turnaroundHistogram[bin]++;
+    telemetry.turnaroundCount++;
+    telemetry.turnaroundTotal += us;
+    if (us < telemetry.turnaroundMin) {
+        telemetry.turnaroundMin = us;
+    }
+    if (us > telemetry.turnaroundMax) {
+        telemetry.turnaroundMax = us;
+    }
+}
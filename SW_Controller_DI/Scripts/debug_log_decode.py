@@ -0,0 +1,257 @@
+"""
+******************************************************************************
+@file           : debug_log_decode.py
+@brief          : Binary Trace Log Decoder
+******************************************************************************
+@attention
+
+Decodes the debug UART stream of a firmware built with
+DEBUG_BINARY_ENABLED (see Core/Inc/debug_uart.h) back into text.
+
+The dictionary is the .trace_fmt section of the firmware ELF: every
+DEBUG_* format string is stored there and its offset is the message ID
+sent in each record. Text output (Debug_PrintRaw, Debug_PrintHex, drop
+notices) is passed through unchanged.
+
+Record: [0xA5][length][level][id:2][tick:4][args][checksum]
+
+Usage:
+    python debug_log_decode.py dict firmware.elf -o trace_dict.json
+    python debug_log_decode.py decode --elf firmware.elf --port COM5
+    python debug_log_decode.py decode --dict trace_dict.json --input log.bin
+
+******************************************************************************
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+TRACE_SYNC = 0xA5
+TRACE_HEADER_SIZE = 9
+TRACE_SECTION = ".trace_fmt"
+LEVEL_NAMES = ["ERROR", "WARN ", "INFO ", "DEBUG", "VERB "]
+
+# printf conversion: flags, width, precision, length, conversion
+FORMAT_SPEC = re.compile(
+    r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|L|j|z|t)?([diouxXcsfFeEgGp%])")
+
+
+def read_elf_section(path, name):
+    """Return the contents of a section of a 32-bit little-endian ELF."""
+    with open(path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        raise ValueError(f"{path}: not a 32-bit little-endian ELF file")
+
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(index):
+        # name, type, flags, addr, offset, size
+        return struct.unpack_from("<IIIIII", elf, shoff + index * shentsize)
+
+    strtab_offset = section(shstrndx)[4]
+    for index in range(shnum):
+        sh_name, _, _, _, sh_offset, sh_size = section(index)
+        end = elf.index(b"\0", strtab_offset + sh_name)
+        if elf[strtab_offset + sh_name:end].decode() == name:
+            return elf[sh_offset:sh_offset + sh_size]
+
+    raise ValueError(f"{path}: no {name} section (built without trace support?)")
+
+
+def build_dictionary(section):
+    """Map message ID (offset in the section) to format string."""
+    dictionary = {}
+    offset = 0
+    while offset < len(section):
+        end = section.find(b"\0", offset)
+        if end < 0:
+            end = len(section)
+        if end > offset:
+            dictionary[offset] = section[offset:end].decode("utf-8", "replace")
+        offset = end + 1
+    return dictionary
+
+
+def load_dictionary(args):
+    if args.elf:
+        return build_dictionary(read_elf_section(args.elf, TRACE_SECTION))
+    with open(args.dict, "r") as f:
+        return {int(key): value for key, value in json.load(f).items()}
+
+
+def format_message(fmt, data):
+    """Apply a C format string to the raw argument bytes of a record."""
+    position = 0
+
+    def take(size, code):
+        nonlocal position
+        if position + size > len(data):
+            raise IndexError
+        value, = struct.unpack_from(code, data, position)
+        position += size
+        return value
+
+    def convert(match):
+        nonlocal position
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+
+        try:
+            if width == "*":
+                width = str(take(4, "<i"))
+            if precision == "*":
+                precision = str(take(4, "<i"))
+
+            if conversion in "fFeEgG":
+                value = take(4, "<f")
+            elif conversion == "s":
+                size = take(1, "<B")
+                value = data[position:position + size].decode("utf-8", "replace")
+                if len(value) < size:
+                    raise IndexError
+                position += size
+            elif conversion == "p":
+                return "0x%08x" % take(4, "<I")
+            elif length == "ll":
+                value = take(8, "<q" if conversion in "di" else "<Q")
+            else:
+                value = take(4, "<i" if conversion in "di" else "<I")
+        except IndexError:
+            return "?"         # Argument did not fit in the record
+
+        spec = "%" + flags + (width or "")
+        if precision is not None:
+            spec += "." + precision
+        if conversion == "u":
+            conversion = "d"
+        elif conversion == "c":
+            value &= 0xFF
+        return (spec + conversion) % value
+
+    return FORMAT_SPEC.sub(convert, fmt)
+
+
+class TraceDecoder:
+    """Splits the byte stream into trace records and pass-through text."""
+
+    def __init__(self, dictionary, output):
+        self.dictionary = dictionary
+        self.output = output
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        self.buffer.extend(data)
+
+        while self.buffer:
+            sync = self.buffer.find(bytes([TRACE_SYNC]))
+            if sync != 0:
+                text = self.buffer if sync < 0 else self.buffer[:sync]
+                self.output.write(text.decode("ascii", "replace"))
+                del self.buffer[:len(text)]
+                continue
+
+            if len(self.buffer) < 2:
+                return
+            length = self.buffer[1]
+            if length < TRACE_HEADER_SIZE + 1:
+                self._skip_sync()
+                continue
+            if len(self.buffer) < length:
+                return
+
+            record = bytes(self.buffer[:length])
+            checksum = 0
+            for byte in record[1:-1]:
+                checksum ^= byte
+            if checksum != record[-1]:
+                self._skip_sync()
+                continue
+
+            del self.buffer[:length]
+            self.output.write(self.decode_record(record))
+
+        self.output.flush()
+
+    def decode_record(self, record):
+        level, message_id, tick = struct.unpack_from("<BHI", record, 2)
+        level_name = LEVEL_NAMES[level] if level < len(LEVEL_NAMES) else "?????"
+        fmt = self.dictionary.get(message_id)
+
+        if fmt is None:
+            text = f"<unknown message id 0x{message_id:04X}> " \
+                   f"{record[TRACE_HEADER_SIZE:-1].hex()}"
+        else:
+            text = format_message(fmt, record[TRACE_HEADER_SIZE:-1])
+
+        return f"[{tick:8d}] [{level_name}] {text}\r\n"
+
+    def _skip_sync(self):
+        # Not a valid record: show the byte and resynchronize after it
+        self.output.write("\ufffd")
+        del self.buffer[:1]
+
+
+def command_dict(args):
+    dictionary = build_dictionary(read_elf_section(args.elf, TRACE_SECTION))
+    with open(args.output, "w") as f:
+        json.dump({str(key): value for key, value in sorted(dictionary.items())},
+                  f, indent=1)
+    print(f"{len(dictionary)} format strings written to {args.output}")
+
+
+def command_decode(args):
+    decoder = TraceDecoder(load_dictionary(args), sys.stdout)
+
+    if args.port:
+        import serial
+        port = serial.Serial(args.port, args.baudrate, timeout=0.1)
+        try:
+            while True:
+                decoder.feed(port.read(4096))
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.close()
+    else:
+        source = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+        with source:
+            while True:
+                chunk = source.read(4096)
+                if not chunk:
+                    break
+                decoder.feed(chunk)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Binary trace log decoder")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    dict_parser = commands.add_parser("dict", help="extract the dictionary from an ELF")
+    dict_parser.add_argument("elf")
+    dict_parser.add_argument("-o", "--output", default="trace_dict.json")
+    dict_parser.set_defaults(handler=command_dict)
+
+    decode_parser = commands.add_parser("decode", help="decode a trace stream")
+    source = decode_parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--elf", help="firmware ELF (dictionary source)")
+    source.add_argument("--dict", help="dictionary JSON from the dict command")
+    decode_parser.add_argument("--port", help="serial port of the debug UART")
+    decode_parser.add_argument("--baudrate", type=int, default=115200)
+    decode_parser.add_argument("--input", default="-",
+                               help="captured binary log file (default: stdin)")
+    decode_parser.set_defaults(handler=command_decode)
+
+    args = parser.parse_args()
+    args.handler(args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file           : FreeRTOSConfig.h
+ * @brief          : FreeRTOS Configuration (SCHED_USE_FREERTOS variant)
+ ******************************************************************************
+ * @attention
+ *
+ * Only used by the FreeRTOS build variant of the scheduler; the kernel
+ * sources (Middlewares/Third_Party/FreeRTOS, ARM_CM7 r0p1 port) are added
+ * by enabling the FreeRTOS middleware in CubeMX. The bare-metal build does
+ * not include this file.
+ *
+ * - Static allocation only: no heap_x.c, all task memory is in .bss
+ * - Tickless idle: the tick is suppressed while all tasks are blocked
+ * - 1 ms tick: kernel ticks and HAL_GetTick() milliseconds are the same
+ *
+ ******************************************************************************
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+void Error_Handler(void);
+#endif
+
+/* Scheduler */
+#define configUSE_PREEMPTION                    1
+#define configUSE_TIME_SLICING                  0       // Class tasks have distinct priorities
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 1
+#define configUSE_TICKLESS_IDLE                 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+#define configCPU_CLOCK_HZ                      (SystemCoreClock)
+#define configTICK_RATE_HZ                      ((TickType_t)1000)
+#define configMAX_PRIORITIES                    5
+#define configMINIMAL_STACK_SIZE                ((uint16_t)256)
+#define configMAX_TASK_NAME_LEN                 16
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+
+/* Memory: static allocation only */
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        0
+#define configTOTAL_HEAP_SIZE                   0
+
+/* Hooks */
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configCHECK_FOR_STACK_OVERFLOW          2
+
+/* Features not used */
+#define configUSE_MUTEXES                       0
+#define configUSE_RECURSIVE_MUTEXES             0
+#define configUSE_COUNTING_SEMAPHORES           0
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_TIMERS                        0
+#define configUSE_CO_ROUTINES                   0
+#define configUSE_TRACE_FACILITY                0
+#define configGENERATE_RUN_TIME_STATS           0
+
+/* API */
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+
+/* Interrupt priorities (4 priority bits on the STM32H7) */
+#ifdef __NVIC_PRIO_BITS
+#define configPRIO_BITS                         __NVIC_PRIO_BITS
+#else
+#define configPRIO_BITS                         4
+#endif
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY         15
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY    5   // SCHED_RTOS_IRQ_PRIORITY
+#define configKERNEL_INTERRUPT_PRIORITY \
+    (configLIBRARY_LOWEST_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY \
+    (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+
+#define configASSERT(x) if ((x) == 0) { taskDISABLE_INTERRUPTS(); Error_Handler(); }
+
+/* Port handlers: SVC and PendSV are not generated in stm32h7xx_it.c for this
+ * variant, SysTick_Handler forwards to xPortSysTickHandler */
+#define vPortSVCHandler                         SVC_Handler
+#define xPortPendSVHandler                      PendSV_Handler
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file           : data_stream.h
+ * @brief          : Publish/Subscribe Periodic Data Streams
+ ******************************************************************************
+ * @attention
+ *
+ * The master subscribes once to a data set (CMD_STREAM_SUBSCRIBE) instead
+ * of polling it: the controller then publishes CMD_STREAM_DATA frames on
+ * its own, without request frames and turnarounds.
+ *
+ * - Slots: a stream is due when the bus time (time_sync.h, in ms) modulo the
+ *   period equals the slot offset. With the bus clocks synchronized, the
+ *   master can give each controller its own offset so publications of
+ *   different nodes do not overlap.
+ * - Sampling: Stream_Service runs at the end of the I/O task, so each
+ *   publication is taken from the sample just acquired. Frames are sent
+ *   from Stream_Process (communication task) when bus access is granted
+ *   (bus_access.h: own TDMA slot, or carrier sense and back-off).
+ * - Deadband: an unchanged data set (analog values within the deadband,
+ *   digital states equal) is not published, except every
+ *   STREAM_KEEPALIVE_PERIODS periods.
+ * - Loss detection: the sequence number counts publications per stream; a
+ *   publication overwritten before it could be sent still uses one.
+ * - Lease: a subscription not renewed for STREAM_LEASE_MS (any subscribe or
+ *   status request from the subscriber) ends.
+ *
+ ******************************************************************************
+ */
+
+#ifndef DATA_STREAM_H
+#define DATA_STREAM_H
+
+#include "main.h"
+
+/* Stream Configuration */
+#define STREAM_MAX_STREAMS          4
+#define STREAM_MAX_DATA_SETS        4
+#define STREAM_MAX_DATA             96      // Data set bytes per publication
+#define STREAM_KEEPALIVE_PERIODS    10      // Unchanged data still published this often
+#define STREAM_LEASE_MS             60000
+
+/* Data Set IDs */
+#define STREAM_SET_DI               0x01    // DIO: input states, 1 bit per input
+#define STREAM_SET_DO               0x02    // OUT: output states, 1 bit per output
+#define STREAM_SET_ANALOG           0x03    // 420: raw 4-20mA then voltage channels, 2 bytes each
+
+/* Results (CMD_STREAM_SUBSCRIBE_RESPONSE) */
+#define STREAM_OK                   0x00
+#define STREAM_ERR_NO_SET           0x01    // Data set not on this controller
+#define STREAM_ERR_FULL             0x02    // STREAM_MAX_STREAMS active
+#define STREAM_ERR_PARAM            0x03    // Slot offset not within the period
+
+/* Layouts */
+#define STREAM_DATA_HEADER_SIZE     11      // [data set][sequence:2][sample time us:8]
+#define STREAM_SUBSCRIBE_SIZE       7       // [result][data set][period:2][offset:2][active streams]
+#define STREAM_STATUS_ENTRY_SIZE    22      // See Stream_ReadStatus
+#define STREAM_STATUS_SIZE          (1 + STREAM_MAX_STREAMS * STREAM_STATUS_ENTRY_SIZE)
+
+/* Data Set Capture (same form as BusSync_Capture_t) */
+typedef uint16_t (*Stream_Capture_t)(uint8_t* buffer, uint16_t bufferSize);
+
+/* Data Set Descriptor */
+typedef struct {
+    uint8_t id;                     // STREAM_SET_xxx
+    uint8_t elementSize;            // 1: bit states (change detection), 2: uint16 values (deadband)
+    uint16_t scanPeriodMs;          // I/O task period, shortest stream period
+    Stream_Capture_t capture;
+} Stream_DataSet_t;
+
+/* Function Prototypes */
+void Stream_Init(void);
+uint8_t Stream_RegisterDataSet(const Stream_DataSet_t* dataSet);
+void Stream_Service(void);
+void Stream_Process(void);
+uint16_t Stream_Subscribe(const uint8_t* data, uint16_t length, uint8_t srcAddr,
+                          uint8_t* response, uint16_t responseSize);
+uint16_t Stream_ReadStatus(uint8_t srcAddr, uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* DATA_STREAM_H */
@@ -0,0 +1,91 @@
+/**
+ ******************************************************************************
+ * @file           : health_monitor.h
+ * @brief          : Computed System Health Score
+ ******************************************************************************
+ * @attention
+ *
+ * Health is derived from measured signals instead of a fixed value:
+ * - RX errors: CRC/UART/framing errors per received frame
+ * - Loop overruns: 1 ms health task runs more than HEALTH_LOOP_DEADLINE_MS
+ *   apart (scheduler blocked by a long task or interrupt)
+ * - Queue overflows: RS485 RX buffer overflows and dropped debug messages
+ * - Stack: high-water mark of the reserved MSP stack (painted at init)
+ * - I/O: missed sample slots of the periodic input update (ADC scan on
+ *   the analog controller, DI sampler on the digital input controller)
+ *
+ * Rates are taken over a sliding window of HEALTH_WINDOW_SECONDS. Each
+ * component is scored 0-100 and the overall health (status.health) is the
+ * lowest component, so one failing signal is never averaged away.
+ *
+ * Stack budget (_Min_Stack_Size, 8 KB in the linker scripts): the deepest
+ * path is a request forwarded over CAN-FD, dispatched and answered with a
+ * debug trace on the way, about 4.5 KB:
+ *   Sched_Run / CanFd_Process / Dispatch_Message             ~0.6 KB
+ *   RS485_ProcessPacket (frame copy, CRC buffer up to 260 B)  ~0.6 KB
+ *   command handler response buffer                          ~0.3 KB
+ *   RS485_SendPacket / RS485_Transmit (TX and CRC buffers)   ~0.9 KB
+ *   Debug_Print line buffer (DEBUG_BUFFER_SIZE) + vsnprintf  ~1.5 KB
+ *   nested interrupts (FPU frames, RX / CAN callbacks)       ~0.6 KB
+ * The high-water mark is painted and scored against the whole budget: the
+ * score drops once use passes HEALTH_STACK_WARN_PERCENT (4.8 KB), beyond
+ * the estimate.
+ *
+ ******************************************************************************
+ */
+
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include "main.h"
+
+/* Health Configuration */
+#define HEALTH_WINDOW_SECONDS       10
+#define HEALTH_LOOP_DEADLINE_MS     10      // Health task interval counted as overrun
+#define HEALTH_STACK_PAINT          0xDEADBEEFU
+#define HEALTH_STACK_WARN_PERCENT   60      // Stack use below this scores 100
+#define HEALTH_RESPONSE_SIZE        44      // See Health_Read
+
+/* Score per fault: 1% RX errors or 1% loop overruns costs 10 points, one
+ * queue overflow costs 10 points, 1% missed I/O slots costs 5 points */
+#define HEALTH_RX_ERROR_WEIGHT      10
+#define HEALTH_LOOP_OVERRUN_WEIGHT  10
+#define HEALTH_OVERFLOW_WEIGHT      10
+#define HEALTH_IO_FAULT_WEIGHT      5
+
+/* Health Components */
+typedef enum {
+    HEALTH_RX_ERRORS = 0,
+    HEALTH_LOOP_OVERRUNS,
+    HEALTH_QUEUE_OVERFLOWS,
+    HEALTH_STACK,
+    HEALTH_IO,
+    HEALTH_COMPONENT_COUNT
+} HealthComponent_t;
+
+/* Health Metrics (sliding window totals) */
+typedef struct {
+    uint8_t overall;                            // 0-100%, lowest component
+    uint8_t scores[HEALTH_COMPONENT_COUNT];     // 0-100% per component
+    uint32_t rxFrames;
+    uint32_t rxErrors;
+    uint32_t loopPasses;
+    uint32_t loopOverruns;
+    uint32_t queueOverflows;
+    uint32_t ioSamples;
+    uint32_t ioMissed;                          // Missed I/O sample slots
+    uint16_t maxLoopIntervalMs;                 // Since boot
+    uint16_t maxIoLagMs;                        // Since boot, beyond the period
+    uint16_t stackUsed;                         // Bytes, high-water mark
+    uint16_t stackSize;                         // Bytes, _Min_Stack_Size
+} HealthMetrics_t;
+
+/* Function Prototypes */
+void Health_Init(void);
+void Health_Process(void);
+void Health_RecordIoSample(uint32_t periodMs, uint32_t elapsedMs);
+uint8_t Health_GetScore(HealthComponent_t component);
+void Health_GetMetrics(HealthMetrics_t* metrics);
+uint16_t Health_Read(uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* HEALTH_MONITOR_H */
@@ -0,0 +1,154 @@
+/**
+ ******************************************************************************
+ * @file           : logic_engine.h
+ * @brief          : On-Controller Logic Engine (bytecode VM)
+ ******************************************************************************
+ * @attention
+ *
+ * Runs a downloaded logic program once per scan (LOGIC_SCAN_PERIOD_MS), so
+ * interlocks and sequences no longer depend on the PC and the bus latency.
+ *
+ * Machine: a stack of bits (LOGIC_STACK_DEPTH). Straight-line code, no
+ * jumps: every scan executes the whole program, so the stack depth at each
+ * instruction and the instruction count are fixed and checked once, when the
+ * program is activated; the scan loop does no bounds checking.
+ *
+ * Bit areas (LD/LDN/ST/SET/RST operand [area][index]):
+ * - LOGIC_AREA_DO      outputs DO0-55 (read/write)
+ * - LOGIC_AREA_DI      inputs of the DIO controller (read, CAN-FD image
+ *                      and CMD_DI_CHANGE frames)
+ * - LOGIC_AREA_MARKER  M0-255 (read/write, kept across program swaps)
+ * - LOGIC_AREA_TIMER   timer outputs (read)
+ * - LOGIC_AREA_COUNTER counter outputs (read)
+ * - LOGIC_AREA_SYSTEM  LOGIC_SYS_xxx (read)
+ * ACMP compares a raw analog value of the 4-20mA controller (CAN-FD image,
+ * channels 0-31) with a constant.
+ *
+ * Inputs are copied at the start of the scan, outputs written at the end,
+ * only those the program writes (ST/SET/RST to DO). These belong to the
+ * program: CMD_WRITE_DO leaves them unchanged. Stopping the program sets
+ * them to 0.
+ *
+ * Download: CMD_LOGIC_DOWNLOAD fills the staging buffer in sequence,
+ * CMD_LOGIC_ACTIVATE checks the CRC16 (RS485_CalculateCRC) and the program,
+ * then the buffers are swapped at the next scan boundary (hot swap: timers,
+ * counters, edges and markers keep their state).
+ *
+ ******************************************************************************
+ */
+
+#ifndef LOGIC_ENGINE_H
+#define LOGIC_ENGINE_H
+
+#include "main.h"
+
+/* Logic Engine Configuration */
+#define LOGIC_ENABLED               1
+#define LOGIC_SCAN_PERIOD_MS        10
+#define LOGIC_PROGRAM_SIZE          4096    // Bytes per buffer (active + staging)
+#define LOGIC_STACK_DEPTH           16
+#define LOGIC_NUM_MARKERS           256
+#define LOGIC_NUM_TIMERS            32
+#define LOGIC_NUM_COUNTERS          32
+#define LOGIC_NUM_EDGES             64      // R_TRIG / F_TRIG memories
+#define LOGIC_NUM_DI                56
+#define LOGIC_NUM_DO                56
+#define LOGIC_NUM_ANALOG            32
+#define LOGIC_INPUT_TIMEOUT_MS      500     // Image age before LOGIC_SYS_xx_ONLINE drops
+#define LOGIC_BENCH_INSTRUCTIONS    1000
+
+/* Opcodes ([operands]) */
+#define LOGIC_OP_END                0x00
+#define LOGIC_OP_LD                 0x01    // [area][index]      push bit
+#define LOGIC_OP_LDN                0x02    // [area][index]      push !bit
+#define LOGIC_OP_AND                0x03
+#define LOGIC_OP_OR                 0x04
+#define LOGIC_OP_XOR                0x05
+#define LOGIC_OP_NOT                0x06
+#define LOGIC_OP_DUP                0x07
+#define LOGIC_OP_ST                 0x08    // [area][index]      pop to bit
+#define LOGIC_OP_SET                0x09    // [area][index]      pop, set bit if 1
+#define LOGIC_OP_RST                0x0A    // [area][index]      pop, clear bit if 1
+#define LOGIC_OP_R_TRIG             0x0B    // [edge]             rising edge of top
+#define LOGIC_OP_F_TRIG             0x0C    // [edge]             falling edge of top
+#define LOGIC_OP_TON                0x0D    // [timer][preset ms:4] in -> Q
+#define LOGIC_OP_TOF                0x0E    // [timer][preset ms:4] in -> Q
+#define LOGIC_OP_TP                 0x0F    // [timer][preset ms:4] in -> Q
+#define LOGIC_OP_CTU                0x10    // [counter][preset:2] count, reset -> Q
+#define LOGIC_OP_ACMP               0x11    // [compare][channel][value:2] push
+#define LOGIC_OP_COUNT              0x12
+
+/* Bit Areas */
+#define LOGIC_AREA_DO               0
+#define LOGIC_AREA_DI               1
+#define LOGIC_AREA_MARKER           2
+#define LOGIC_AREA_TIMER            3
+#define LOGIC_AREA_COUNTER          4
+#define LOGIC_AREA_SYSTEM           5
+#define LOGIC_AREA_COUNT            6
+
+/* System Bits */
+#define LOGIC_SYS_ALWAYS_ON         0
+#define LOGIC_SYS_FIRST_SCAN        1       // First scan after activation or run
+#define LOGIC_SYS_DI_ONLINE         2
+#define LOGIC_SYS_AI_ONLINE         3
+#define LOGIC_SYS_CLOCK_1HZ         4
+#define LOGIC_NUM_SYSTEM            5
+
+/* ACMP Comparisons */
+#define LOGIC_CMP_GT                0
+#define LOGIC_CMP_LT                1
+#define LOGIC_CMP_GE                2
+#define LOGIC_CMP_LE                3
+#define LOGIC_CMP_EQ                4
+#define LOGIC_CMP_NE                5
+
+/* Engine States */
+#define LOGIC_STATE_EMPTY           0
+#define LOGIC_STATE_RUNNING         1
+#define LOGIC_STATE_STOPPED         2
+
+/* Result Codes (download / activate responses) */
+#define LOGIC_OK                    0x00
+#define LOGIC_ERR_SIZE              0x01    // Program too long or empty
+#define LOGIC_ERR_OFFSET            0x02    // Download block out of sequence
+#define LOGIC_ERR_CRC               0x03
+#define LOGIC_ERR_OPCODE            0x04
+#define LOGIC_ERR_OPERAND           0x05    // Area, index, channel or comparison out of range
+#define LOGIC_ERR_STACK             0x06    // Stack underflow/overflow or not empty at END
+#define LOGIC_ERR_END               0x07    // END missing or not last
+#define LOGIC_ERR_BUSY              0x08    // Previous activation not yet swapped in
+
+/* CMD_LOGIC_STATUS Operations */
+#define LOGIC_CTRL_READ             0x00
+#define LOGIC_CTRL_RUN              0x01
+#define LOGIC_CTRL_STOP             0x02
+#define LOGIC_CTRL_RESET_STATS      0x03
+
+/* Response Layouts */
+#define LOGIC_STATUS_HEADER_SIZE    31      // See Logic_ReadStatus
+#define LOGIC_STATUS_SIZE           (LOGIC_STATUS_HEADER_SIZE + LOGIC_NUM_MARKERS / 8)
+#define LOGIC_BENCH_SIZE            12      // [instructions:4][cycles:4][core clock Hz:4]
+
+/* Engine Statistics */
+typedef struct {
+    uint32_t scans;
+    uint32_t lastCycles;            // DWT cycles of the last scan
+    uint32_t maxCycles;
+    uint16_t swaps;                 // Programs activated
+    uint16_t rejected;              // Activations refused
+} Logic_Stats_t;
+
+/* Function Prototypes */
+void Logic_Init(void);
+void Logic_Scan(void);
+void Logic_UpdateInputs(uint8_t source, const uint8_t* data, uint16_t length);
+uint8_t Logic_Download(uint16_t offset, const uint8_t* data, uint16_t length, uint16_t* nextOffset);
+uint8_t Logic_Activate(uint16_t length, uint16_t crc, uint16_t* errorOffset);
+void Logic_Control(uint8_t operation);
+void Logic_FilterWrite(uint8_t* states, uint16_t size);
+uint16_t Logic_ReadStatus(uint8_t* buffer, uint16_t bufferSize);
+uint16_t Logic_Benchmark(uint8_t* buffer, uint16_t bufferSize);
+const Logic_Stats_t* Logic_GetStats(void);
+
+#endif /* LOGIC_ENGINE_H */
@@ -41,12 +41,20 @@ extern "C" {
 
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
-
+/* Non-cacheable DMA region: start of D2 SRAM (.dma_buffer, MPU region 1) */
+#define DMA_REGION_BASE     0x30000000U
+#define DMA_REGION_SIZE     (32U * 1024U)
 /* USER CODE END EC */
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
-
+/* Memory placement (see STM32H753ZITX_FLASH.ld):
+ * ITCM_TEXT   function copied to ITCM at startup (zero wait states)
+ * DTCM_DATA   variable in DTCM, initialized at startup (zero wait states)
+ * DMA_BUFFER  non-cacheable D2 SRAM, no cache maintenance around DMA */
+#define ITCM_TEXT           __attribute__((section(".itcm_text"), noinline))
+#define DTCM_DATA           __attribute__((section(".dtcm_data")))
+#define DMA_BUFFER          __attribute__((section(".dma_buffer"), aligned(32)))
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file           : output_mapping.h
+ * @brief          : Peer-to-Peer Output Mapping (DI -> DO over CAN-FD)
+ ******************************************************************************
+ * @attention
+ *
+ * Drives outputs straight from the inputs of other controllers, without the
+ * PC in the loop. Input controllers send CMD_DI_CHANGE event frames
+ * [input states:7][changed inputs:7] (see input_routing.h on the DI
+ * controller); every mapping entry whose source matches is applied on
+ * receipt, in the canfd task:
+ * - Plain: output = input (OUTPUT_MAP_INVERT: output = !input)
+ * - OUTPUT_MAP_LATCH: the output is set when the (inverted) input is 1 and
+ *   stays set until cleared by CMD_WRITE_DO or CMD_DO_MAP (clear latches)
+ *
+ * Outputs with a plain entry belong to the mapping: CMD_WRITE_DO leaves them
+ * unchanged. When a source sends nothing for OUTPUT_MAP_SOURCE_TIMEOUT_MS
+ * (missed refreshes: sender off or bus lost), its plain outputs go to 0, the
+ * safe state; latched outputs are kept.
+ *
+ * One entry per output. The table starts from OUTPUT_MAP_DEFAULTS and is
+ * replaced at run time with CMD_DO_MAP (RAM only).
+ *
+ ******************************************************************************
+ */
+
+#ifndef OUTPUT_MAPPING_H
+#define OUTPUT_MAPPING_H
+
+#include "main.h"
+#include "digital_output_handler.h"
+
+/* Output Mapping Configuration */
+#define OUTPUT_MAP_MAX_ENTRIES      32
+#define OUTPUT_MAP_SOURCE_TIMEOUT_MS 500    // Five missed input refreshes (100 ms)
+#define OUTPUT_MAP_STATE_BYTES      7       // CMD_DI_CHANGE: 56 inputs per source
+
+/* Entry Flags */
+#define OUTPUT_MAP_INVERT           0x01
+#define OUTPUT_MAP_LATCH            0x02
+#define OUTPUT_MAP_ONLINE           0x80    // Response only: source heard within the timeout
+
+/* Entries at start: { source, input, output, flags } */
+#define OUTPUT_MAP_DEFAULTS         { { 0 } }
+#define OUTPUT_MAP_DEFAULT_COUNT    0
+
+/* CMD_DO_MAP Layout
+ * Request:  [operation] (OUTPUT_MAP_OP_xxx), for SET [count] then per entry
+ *           [source][input][output][flags]
+ * Response: [count][frames:4][applied:4][timeouts:4][ignored:4]
+ *           then per entry [source][input][output][flags | OUTPUT_MAP_ONLINE] */
+#define OUTPUT_MAP_OP_READ          0x00
+#define OUTPUT_MAP_OP_SET           0x01
+#define OUTPUT_MAP_OP_CLEAR_LATCHES 0x02
+#define OUTPUT_MAP_ENTRY_SIZE       4
+#define OUTPUT_MAP_HEADER_SIZE      17
+#define OUTPUT_MAP_RESPONSE_SIZE \
+    (OUTPUT_MAP_HEADER_SIZE + OUTPUT_MAP_MAX_ENTRIES * OUTPUT_MAP_ENTRY_SIZE)
+
+/* Mapping Entry */
+typedef struct {
+    uint8_t source;                 // Input controller address
+    uint8_t input;                  // 0-55
+    uint8_t output;                 // 0-55
+    uint8_t flags;                  // OUTPUT_MAP_INVERT | OUTPUT_MAP_LATCH
+} OutputMapEntry_t;
+
+/* Mapping Statistics */
+typedef struct {
+    uint32_t frames;                // CMD_DI_CHANGE frames received from mapped sources
+    uint32_t applied;               // Output changes made by the mapping
+    uint32_t timeouts;              // Source timeouts (outputs to safe state)
+    uint32_t ignored;               // Frames from unmapped sources or too short
+} OutputMap_Stats_t;
+
+/* Function Prototypes */
+void OutputMap_Init(void);
+void OutputMap_Process(void);
+void OutputMap_Apply(uint8_t source, const uint8_t* data, uint16_t length);
+uint8_t OutputMap_SetEntries(const uint8_t* data, uint16_t length);
+void OutputMap_ClearLatches(void);
+void OutputMap_FilterWrite(uint8_t* states, uint16_t size);
+uint16_t OutputMap_Read(uint8_t* buffer, uint16_t bufferSize);
+const OutputMap_Stats_t* OutputMap_GetStats(void);
+
+#endif /* OUTPUT_MAPPING_H */
@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ * @file           : scheduler.h
+ * @brief          : Event-Driven Cooperative Scheduler
+ ******************************************************************************
+ * @attention
+ *
+ * Replaces the polled HAL_GetTick()/HAL_Delay(1) main loop:
+ * - Periodic tasks run at a fixed rate: the next release is the previous
+ *   release plus the period, so a slow pass does not shift the schedule.
+ *   A late task catches up with back-to-back runs (at most
+ *   SCHED_MAX_CATCHUP extra), older periods are counted as missed.
+ * - Event tasks run when an interrupt posts one of their events with
+ *   Sched_PostEvent(); the posting interrupt wakes the loop directly.
+ * - When nothing is due the core sleeps in WFI until the next interrupt
+ *   (SysTick at the latest).
+ * - Per task: runs, missed periods, worst release lateness, worst
+ *   response latency and execution cycles (DWT), read over RS485 with
+ *   CMD_GET_TASKS.
+ *
+ * Every task belongs to a priority class (I/O, communication,
+ * housekeeping). Bare-metal (default): tasks run to completion in thread
+ * mode, higher classes first in every pass.
+ *
+ * FreeRTOS variant (build with SCHED_USE_FREERTOS=1 and the FreeRTOS
+ * middleware enabled in CubeMX): one kernel task per used class, so an I/O
+ * release preempts a long command or log flush. Tasks of the same class
+ * still run to completion one after another, which keeps everything that
+ * shares data with the command handlers in the communication class.
+ * Static allocation only, tickless idle (see FreeRTOSConfig.h). Execution
+ * cycles then include time preempted by higher classes; the response
+ * latency is directly comparable between the two builds.
+ *
+ ******************************************************************************
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "main.h"
+
+/* Scheduler Configuration */
+#ifndef SCHED_USE_FREERTOS
+#define SCHED_USE_FREERTOS          0       // 1 = preemptive FreeRTOS variant (build define)
+#endif
+#define SCHED_MAX_TASKS             12
+#define SCHED_MAX_CATCHUP           4       // Extra back-to-back runs of a late periodic task
+#define SCHED_IDLE_SLEEP            1       // 0 = busy-wait instead of WFI
+#define SCHED_MAX_EVENTS            8       // Event bits with post timestamps
+#define SCHED_NAME_SIZE             12      // Including terminator
+#define SCHED_RESPONSE_HEADER_SIZE  43      // See Sched_Read
+#define SCHED_RESPONSE_SIZE         (SCHED_RESPONSE_HEADER_SIZE + SCHED_NAME_SIZE - 1)
+#define SCHED_FLAG_RESET            0x01    // CMD_GET_TASKS: reset statistics after reading
+
+/* FreeRTOS Variant */
+#define SCHED_RTOS_STACK_WORDS      512     // Stack of each class task
+#define SCHED_RTOS_IRQ_PRIORITY     5       // Highest NVIC priority allowed to post events
+
+/* Kernel (CMD_GET_TASKS) */
+#define SCHED_KERNEL_BARE_METAL     0
+#define SCHED_KERNEL_FREERTOS       1
+
+/* Events (bit masks, posted from interrupts) */
+#define SCHED_EVENT_RS485_FRAME     (1UL << 0)  // Complete RS485 frame queued
+#define SCHED_EVENT_CANFD_FRAME     (1UL << 2)  // CAN-FD frame queued
+
+/* Task Priority Classes (highest first) */
+typedef enum {
+    SCHED_PRIORITY_IO = 0,          // Input sampling, output update
+    SCHED_PRIORITY_COMM,            // RS485 frames and command handlers
+    SCHED_PRIORITY_HOUSEKEEPING,    // Health, status LED, logging
+    SCHED_PRIORITY_COUNT
+} SchedPriority_t;
+
+/* Task Function */
+typedef void (*SchedTaskFunction_t)(void);
+
+/* Task Statistics */
+typedef struct {
+    uint32_t runs;
+    uint32_t missed;                // Periodic: skipped periods
+    uint32_t maxLateMs;             // Periodic: release to start
+    uint32_t maxLatencyCycles;      // Release / event post to start
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+} SchedTaskStats_t;
+
+/* Function Prototypes */
+void Sched_Init(void);
+int8_t Sched_AddPeriodic(const char* name, SchedTaskFunction_t function, uint32_t periodMs,
+                         SchedPriority_t priority);
+int8_t Sched_AddEvent(const char* name, SchedTaskFunction_t function, uint32_t events,
+                      SchedPriority_t priority);
+void Sched_PostEvent(uint32_t events);
+void Sched_TickHandler(void);
+void Sched_Run(void);
+uint8_t Sched_GetTaskCount(void);
+void Sched_ResetStats(void);
+uint16_t Sched_Read(uint8_t index, uint8_t* buffer, uint16_t bufferSize);
+
+#endif /* SCHEDULER_H */
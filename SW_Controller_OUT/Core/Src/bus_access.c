@@ -0,0 +1,329 @@
+/**
+ ******************************************************************************
+ * @file           : bus_access.c
+ * @brief          : RS485 Bus Access Implementation (TDMA / CSMA)
+ ******************************************************************************
+ * @attention
+ *
+ * The beacon is handled in the RS485 task, BusAccess_Acquire is called from
+ * the senders' tasks, so the schedule and back-off state are updated and
+ * read with interrupts disabled. Collisions are taken from the RS485
+ * telemetry (CRC and end-byte errors since the last look) each time the
+ * state is used, before any mode change, so they count in the right mode.
+ *
+ ******************************************************************************
+ */
+
+#include "bus_access.h"
+#include "rs485_protocol.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Own Slot (ms from the end of the beacon) */
+typedef struct {
+    uint16_t startMs;
+    uint16_t lengthMs;
+} BusAccess_Slot_t;
+
+/* Private Variables */
+static uint8_t myAddress = 0;
+static uint8_t mode = BUS_ACCESS_MODE_CSMA;
+static uint16_t cycleMs = 0;
+static uint32_t cycleStartTick = 0;        // End byte of the last beacon
+static BusAccess_Slot_t slots[BUS_ACCESS_MAX_SLOTS];
+static uint8_t slotCount = 0;
+static uint8_t backoffActive = 0;
+static uint32_t backoffUntil = 0;
+static uint8_t retries = 0;                // Busy line retries of the waiting frame
+static uint8_t contention = 0;             // Raised by collisions, lowered by frames sent
+static uint8_t collisionPending = 0;       // Back off before the next frame
+static uint32_t corruptSeen = 0;           // CRC + end-byte errors already counted
+static uint32_t randomState = 1;
+static BusAccess_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static void Update_State(uint32_t now);
+static uint8_t Grant(uint32_t now, uint16_t length);
+static void Start_Backoff(uint32_t now);
+static uint32_t Frame_Ms(uint16_t length);
+static uint32_t Next_Random(void);
+
+/**
+ * @brief  Initialize bus access (CSMA until a beacon arrives)
+ * @note   After RS485_Init (telemetry counters cleared)
+ * @param  address: This node's RS485 address (slot owner in beacons)
+ * @retval None
+ */
+void BusAccess_Init(uint8_t address)
+{
+    const RS485_Telemetry_t* telemetry = RS485_GetTelemetry();
+
+    myAddress = address;
+    mode = BUS_ACCESS_MODE_CSMA;
+    cycleMs = 0;
+    slotCount = 0;
+    backoffActive = 0;
+    retries = 0;
+    contention = 0;
+    collisionPending = 0;
+    corruptSeen = telemetry->crcErrors + telemetry->endByteErrors;
+    memset(&stats, 0, sizeof(stats));
+
+    /* Seed from the unique device ID so nodes draw different back-offs */
+    randomState = HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2() ^
+                  ((uint32_t)address << 24) ^ DWT->CYCCNT;
+    if (randomState == 0) {
+        randomState = address | 1U;
+    }
+}
+
+/**
+ * @brief  Handle a CMD_BUS_BEACON frame (RS485 only)
+ * @note   The cycle starts at the end byte of the beacon (RX interrupt
+ *         time), not when the handler runs. Cycle 0 ends TDMA.
+ * @param  data: [cycle ms:2][slot count], slot count x [address][start ms:2][length ms:2]
+ * @param  length: Data length
+ * @retval None
+ */
+void BusAccess_HandleBeacon(const uint8_t* data, uint16_t length)
+{
+    if (length < BUS_ACCESS_BEACON_HEADER ||
+        length < BUS_ACCESS_BEACON_HEADER + data[2] * BUS_ACCESS_BEACON_SLOT ||
+        RS485_GetReplyTransport() != RS485_TRANSPORT_SERIAL) {
+        return;
+    }
+
+    uint16_t cycle;
+    memcpy(&cycle, &data[0], 2);
+
+    BusAccess_Slot_t own[BUS_ACCESS_MAX_SLOTS];
+    uint8_t ownCount = 0;
+    for (uint8_t i = 0; i < data[2]; i++) {
+        const uint8_t* entry = &data[BUS_ACCESS_BEACON_HEADER + i * BUS_ACCESS_BEACON_SLOT];
+        BusAccess_Slot_t slot;
+        memcpy(&slot.startMs, &entry[1], 2);
+        memcpy(&slot.lengthMs, &entry[3], 2);
+        if (entry[0] != myAddress || slot.lengthMs == 0 ||
+            (uint32_t)slot.startMs + slot.lengthMs > cycle || ownCount >= BUS_ACCESS_MAX_SLOTS) {
+            continue;
+        }
+        own[ownCount++] = slot;
+    }
+
+    uint32_t elapsedMs = (DWT->CYCCNT - RS485_GetRequestCycles()) / (SystemCoreClock / 1000U);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t now = HAL_GetTick();
+    Update_State(now);
+    if (cycle == 0) {
+        mode = BUS_ACCESS_MODE_CSMA;
+        cycleMs = 0;
+        slotCount = 0;
+    } else {
+        mode = BUS_ACCESS_MODE_TDMA;
+        cycleMs = cycle;
+        cycleStartTick = now - elapsedMs;
+        memcpy(slots, own, sizeof(own[0]) * ownCount);
+        slotCount = ownCount;
+        stats.beacons++;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Ask for the bus before an unsolicited frame
+ * @note   Call again (next task run) until granted, then send at once.
+ *         Responses to requests do not need it.
+ * @param  length: Frame data length (payload bytes)
+ * @retval 1 if the frame may be sent now
+ */
+uint8_t BusAccess_Acquire(uint16_t length)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t granted = Grant(HAL_GetTick(), length);
+    __set_PRIMASK(primask);
+
+    return granted;
+}
+
+/**
+ * @brief  Get the current access mode
+ * @retval BUS_ACCESS_MODE_xxx
+ */
+uint8_t BusAccess_GetMode(void)
+{
+    return mode;
+}
+
+/**
+ * @brief  Read the telemetry section (RS485_TELEMETRY_SECTION_BUS)
+ * @note   Layout: [mode][own slots][cycle ms:2][beacon age ms:4][beacons:4]
+ *         [fallbacks:4][slot frames:4][CSMA frames:4][back-offs:4]
+ *         [collisions TDMA:4][collisions CSMA:4]
+ * @param  buffer: Output buffer (BUS_ACCESS_TELEMETRY_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t BusAccess_ReadTelemetry(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < BUS_ACCESS_TELEMETRY_SIZE) {
+        return 0;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t now = HAL_GetTick();
+    Update_State(now);
+    uint32_t age = (stats.beacons > 0) ? (now - cycleStartTick) : 0;
+    buffer[0] = mode;
+    buffer[1] = slotCount;
+    memcpy(&buffer[2], &cycleMs, 2);
+    memcpy(&buffer[4], &age, 4);
+    memcpy(&buffer[8], &stats, sizeof(stats));
+    __set_PRIMASK(primask);
+
+    return BUS_ACCESS_TELEMETRY_SIZE;
+}
+
+/**
+ * @brief  Get bus access statistics
+ * @retval Statistics
+ */
+const BusAccess_Stats_t* BusAccess_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Count new collisions and check for beacon loss
+ * @note   Interrupts disabled by the caller
+ * @param  now: HAL tick
+ * @retval None
+ */
+static void Update_State(uint32_t now)
+{
+    const RS485_Telemetry_t* telemetry = RS485_GetTelemetry();
+    uint32_t corrupt = telemetry->crcErrors + telemetry->endByteErrors;
+    uint32_t collisions = corrupt - corruptSeen;
+
+    if (collisions > 0) {
+        corruptSeen = corrupt;
+        if (mode == BUS_ACCESS_MODE_TDMA) {
+            stats.collisionsTdma += collisions;
+        } else {
+            stats.collisionsCsma += collisions;
+            if (contention < BUS_ACCESS_MAX_BACKOFF_EXP) {
+                contention++;
+            }
+            collisionPending = 1;
+        }
+    }
+
+    if (mode == BUS_ACCESS_MODE_TDMA &&
+        now - cycleStartTick > (uint32_t)cycleMs * BUS_ACCESS_BEACON_LOSS) {
+        mode = BUS_ACCESS_MODE_CSMA;
+        cycleMs = 0;
+        slotCount = 0;
+        stats.fallbacks++;
+    }
+}
+
+/**
+ * @brief  Decide whether a frame may start now
+ * @note   Interrupts disabled by the caller
+ * @param  now: HAL tick
+ * @param  length: Frame data length
+ * @retval 1 if granted
+ */
+static uint8_t Grant(uint32_t now, uint16_t length)
+{
+    Update_State(now);
+
+    if (mode == BUS_ACCESS_MODE_TDMA) {
+        uint32_t position = (now - cycleStartTick) % cycleMs;
+        uint32_t frameMs = Frame_Ms(length);
+
+        for (uint8_t i = 0; i < slotCount; i++) {
+            if (position >= slots[i].startMs &&
+                position + frameMs <= (uint32_t)slots[i].startMs + slots[i].lengthMs) {
+                /* Own slot, unless the previous owner overran into it */
+                if (!RS485_IsLineIdle()) {
+                    return 0;
+                }
+                stats.slotFrames++;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    if (backoffActive && (int32_t)(now - backoffUntil) < 0) {
+        return 0;
+    }
+    backoffActive = 0;
+
+    if (!RS485_IsLineIdle() || collisionPending) {
+        collisionPending = 0;
+        Start_Backoff(now);
+        return 0;
+    }
+
+    retries = 0;
+    if (contention > 0) {
+        contention--;
+    }
+    stats.csmaFrames++;
+    return 1;
+}
+
+/**
+ * @brief  Start a random back-off (binary exponential)
+ * @note   Window 2^(retries + contention) back-off slots, capped at
+ *         2^BUS_ACCESS_MAX_BACKOFF_EXP; the wait is 1 to window slots.
+ * @param  now: HAL tick
+ * @retval None
+ */
+static void Start_Backoff(uint32_t now)
+{
+    if (retries < BUS_ACCESS_MAX_BACKOFF_EXP) {
+        retries++;
+    }
+
+    uint8_t exponent = retries + contention;
+    if (exponent > BUS_ACCESS_MAX_BACKOFF_EXP) {
+        exponent = BUS_ACCESS_MAX_BACKOFF_EXP;
+    }
+
+    uint32_t wait = 1U + Next_Random() % (1UL << exponent);
+    backoffUntil = now + wait * BUS_ACCESS_BACKOFF_SLOT_MS;
+    backoffActive = 1;
+    stats.backoffs++;
+}
+
+/**
+ * @brief  Bus time of a frame, transceiver switching included
+ * @param  length: Frame data length
+ * @retval Milliseconds, rounded up
+ */
+static uint32_t Frame_Ms(uint16_t length)
+{
+    /* Start, header, CRC and end bytes; 10 bits per byte */
+    uint32_t bits = (length + 8U) * 10U;
+
+    return (bits * 1000U + RS485_BAUD_RATE - 1U) / RS485_BAUD_RATE + BUS_ACCESS_TX_OVERHEAD_MS;
+}
+
+/**
+ * @brief  Next pseudo-random number (xorshift32)
+ * @retval Random value
+ */
+static uint32_t Next_Random(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
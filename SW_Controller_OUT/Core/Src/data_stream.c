@@ -0,0 +1,369 @@
+/**
+ ******************************************************************************
+ * @file           : data_stream.c
+ * @brief          : Publish/Subscribe Periodic Data Streams Implementation
+ ******************************************************************************
+ * @attention
+ *
+ * Stream_Service (I/O priority) fills a per-stream publication buffer,
+ * Stream_Process (communication priority) sends it. The buffer changes
+ * hands with interrupts disabled, the I/O task may preempt the sender.
+ *
+ ******************************************************************************
+ */
+
+#include "data_stream.h"
+#include "rs485_protocol.h"
+#include "bus_access.h"
+#include "time_sync.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Stream State */
+typedef struct {
+    const Stream_DataSet_t* dataSet;    // NULL = slot free
+    uint8_t subscriber;
+    RS485_Transport_t transport;
+    uint16_t periodMs;
+    uint16_t offsetMs;
+    uint16_t deadband;
+    uint64_t nextDueMs;             // Bus time of the next slot
+    uint32_t leaseTick;
+    uint8_t idlePeriods;            // Periods since the last publication
+    uint16_t sequence;
+    uint8_t pending;                // Publication waiting for the line
+    uint16_t length;
+    uint8_t frame[STREAM_DATA_HEADER_SIZE + STREAM_MAX_DATA];
+    uint8_t last[STREAM_MAX_DATA];  // Last published data (deadband)
+    uint16_t lastLength;
+    uint32_t published;
+    uint32_t suppressed;            // Within the deadband
+    uint32_t overruns;              // Overwritten before sent
+} Stream_t;
+
+/* Private Variables */
+static const Stream_DataSet_t* dataSets[STREAM_MAX_DATA_SETS];
+static uint8_t dataSetCount = 0;
+static Stream_t streams[STREAM_MAX_STREAMS];
+static uint8_t nextStream = 0;             // Round robin in Stream_Process
+
+/* Private Function Prototypes */
+static const Stream_DataSet_t* Find_DataSet(uint8_t id);
+static uint64_t Next_Slot(uint64_t nowMs, uint16_t periodMs, uint16_t offsetMs);
+static uint8_t Has_Changed(const Stream_t* stream, const uint8_t* data, uint16_t length);
+
+/**
+ * @brief  Initialize streams (no data set registered, no subscription)
+ * @retval None
+ */
+void Stream_Init(void)
+{
+    dataSetCount = 0;
+    nextStream = 0;
+    memset(streams, 0, sizeof(streams));
+}
+
+/**
+ * @brief  Register a data set for subscriptions
+ * @param  dataSet: Descriptor, must stay valid (static)
+ * @retval 1 if registered, 0 if the table is full
+ */
+uint8_t Stream_RegisterDataSet(const Stream_DataSet_t* dataSet)
+{
+    if (dataSetCount >= STREAM_MAX_DATA_SETS) {
+        return 0;
+    }
+
+    dataSets[dataSetCount++] = dataSet;
+    return 1;
+}
+
+/**
+ * @brief  Sample the streams due in this slot (end of the I/O task)
+ * @retval None
+ */
+void Stream_Service(void)
+{
+    uint64_t sampleUs = TimeSync_Now();
+    uint64_t nowMs = sampleUs / 1000U;
+    uint8_t data[STREAM_MAX_DATA];
+
+    for (uint8_t i = 0; i < STREAM_MAX_STREAMS; i++) {
+        Stream_t* stream = &streams[i];
+        if (stream->dataSet == NULL) {
+            continue;
+        }
+
+        if ((HAL_GetTick() - stream->leaseTick) > STREAM_LEASE_MS) {
+            DEBUG_INFO("Stream 0x%02X: lease of 0x%02X expired", stream->dataSet->id, stream->subscriber);
+            stream->dataSet = NULL;
+            continue;
+        }
+
+        /* Bus clock stepped (first sync, large correction): realign */
+        if (stream->nextDueMs > nowMs + stream->periodMs ||
+            nowMs >= stream->nextDueMs + stream->periodMs) {
+            stream->nextDueMs = Next_Slot(nowMs, stream->periodMs, stream->offsetMs);
+        }
+        if (nowMs < stream->nextDueMs) {
+            continue;
+        }
+        stream->nextDueMs += stream->periodMs;
+
+        uint16_t length = stream->dataSet->capture(data, sizeof(data));
+        if (++stream->idlePeriods < STREAM_KEEPALIVE_PERIODS && !Has_Changed(stream, data, length)) {
+            stream->suppressed++;
+            continue;
+        }
+        stream->idlePeriods = 0;
+        memcpy(stream->last, data, length);
+        stream->lastLength = length;
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (stream->pending) {
+            stream->overruns++;
+        }
+        stream->sequence++;
+        stream->frame[0] = stream->dataSet->id;
+        memcpy(&stream->frame[1], &stream->sequence, 2);
+        memcpy(&stream->frame[3], &sampleUs, 8);
+        memcpy(&stream->frame[STREAM_DATA_HEADER_SIZE], data, length);
+        stream->length = STREAM_DATA_HEADER_SIZE + length;
+        stream->pending = 1;
+        stream->published++;
+        __set_PRIMASK(primask);
+    }
+}
+
+/**
+ * @brief  Send one waiting publication (periodic task, 1 ms)
+ * @note   On RS485 only when bus access is granted (TDMA slot or CSMA)
+ * @retval None
+ */
+void Stream_Process(void)
+{
+    for (uint8_t n = 0; n < STREAM_MAX_STREAMS; n++) {
+        Stream_t* stream = &streams[(nextStream + n) % STREAM_MAX_STREAMS];
+        if (!stream->pending) {
+            continue;
+        }
+        if (stream->transport == RS485_TRANSPORT_SERIAL && !BusAccess_Acquire(stream->length)) {
+            return;
+        }
+
+        uint8_t frame[STREAM_DATA_HEADER_SIZE + STREAM_MAX_DATA];
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint16_t length = stream->length;
+        memcpy(frame, stream->frame, length);
+        stream->pending = 0;
+        __set_PRIMASK(primask);
+
+        RS485_SendPacketVia(stream->transport, stream->subscriber, CMD_STREAM_DATA, frame, (uint8_t)length);
+        nextStream = (uint8_t)((nextStream + n + 1) % STREAM_MAX_STREAMS);
+        return;
+    }
+}
+
+/**
+ * @brief  Subscribe, renew or cancel a stream (CMD_STREAM_SUBSCRIBE)
+ * @note   One stream per data set: a new subscription replaces the old one.
+ *         The period is rounded up to a multiple of the data set's scan
+ *         period; the reply goes to the transport of the request.
+ * @param  data: [data set][period ms:2][slot offset ms:2][deadband:2], period 0 cancels.
+ *         Deadband: 0 publishes every period, else analog steps / any bit change
+ * @param  length: Data length
+ * @param  srcAddr: Subscriber, receives the CMD_STREAM_DATA frames
+ * @param  response: [result][data set][period:2][offset:2][active streams]
+ * @param  responseSize: Response buffer size (STREAM_SUBSCRIBE_SIZE)
+ * @retval Response length, 0 on a malformed request
+ */
+uint16_t Stream_Subscribe(const uint8_t* data, uint16_t length, uint8_t srcAddr,
+                          uint8_t* response, uint16_t responseSize)
+{
+    if (length < 7 || responseSize < STREAM_SUBSCRIBE_SIZE) {
+        return 0;
+    }
+
+    uint16_t periodMs;
+    uint16_t offsetMs;
+    uint16_t deadband;
+    memcpy(&periodMs, &data[1], 2);
+    memcpy(&offsetMs, &data[3], 2);
+    memcpy(&deadband, &data[5], 2);
+
+    const Stream_DataSet_t* dataSet = Find_DataSet(data[0]);
+    Stream_t* stream = NULL;
+    Stream_t* freeStream = NULL;
+    uint8_t result = STREAM_OK;
+
+    for (uint8_t i = 0; i < STREAM_MAX_STREAMS; i++) {
+        if (streams[i].dataSet == NULL) {
+            if (freeStream == NULL) {
+                freeStream = &streams[i];
+            }
+        } else if (streams[i].dataSet->id == data[0]) {
+            stream = &streams[i];
+        }
+    }
+
+    if (dataSet == NULL) {
+        result = STREAM_ERR_NO_SET;
+    } else if (periodMs == 0) {
+        if (stream != NULL) {
+            DEBUG_INFO("Stream 0x%02X: cancelled by 0x%02X", dataSet->id, srcAddr);
+            stream->dataSet = NULL;
+        }
+    } else {
+        uint16_t scan = (dataSet->scanPeriodMs > 0) ? dataSet->scanPeriodMs : 1;
+        periodMs = (uint16_t)(((periodMs + scan - 1) / scan) * scan);
+        if (offsetMs >= periodMs) {
+            result = STREAM_ERR_PARAM;
+        } else if (stream == NULL && freeStream == NULL) {
+            result = STREAM_ERR_FULL;
+        } else {
+            uint8_t renewal = (stream != NULL && stream->subscriber == srcAddr &&
+                               stream->periodMs == periodMs && stream->offsetMs == offsetMs &&
+                               stream->deadband == deadband);
+            if (stream == NULL) {
+                stream = freeStream;
+            }
+
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            if (!renewal) {
+                memset(stream, 0, sizeof(*stream));
+                stream->subscriber = srcAddr;
+                stream->periodMs = periodMs;
+                stream->offsetMs = offsetMs;
+                stream->deadband = deadband;
+                stream->nextDueMs = Next_Slot(TimeSync_Now() / 1000U, periodMs, offsetMs);
+                stream->idlePeriods = STREAM_KEEPALIVE_PERIODS;     // First slot always published
+            }
+            stream->transport = RS485_GetReplyTransport();
+            stream->leaseTick = HAL_GetTick();
+            stream->dataSet = dataSet;
+            __set_PRIMASK(primask);
+
+            if (!renewal) {
+                DEBUG_INFO("Stream 0x%02X: to 0x%02X every %d ms at +%d ms, deadband %d",
+                           dataSet->id, srcAddr, periodMs, offsetMs, deadband);
+            }
+        }
+    }
+
+    uint8_t active = 0;
+    for (uint8_t i = 0; i < STREAM_MAX_STREAMS; i++) {
+        active += (streams[i].dataSet != NULL);
+    }
+
+    response[0] = result;
+    response[1] = data[0];
+    memcpy(&response[2], &periodMs, 2);
+    memcpy(&response[4], &offsetMs, 2);
+    response[6] = active;
+
+    return STREAM_SUBSCRIBE_SIZE;
+}
+
+/**
+ * @brief  Read the active streams (CMD_STREAM_STATUS), renews the
+ *         requester's subscriptions
+ * @note   Layout: [count] then per stream [data set][subscriber][period:2]
+ *         [offset:2][deadband:2][sequence:2][published:4][suppressed:4][overruns:4]
+ * @param  srcAddr: Requesting node
+ * @param  buffer: Output buffer (STREAM_STATUS_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t Stream_ReadStatus(uint8_t srcAddr, uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < STREAM_STATUS_SIZE) {
+        return 0;
+    }
+
+    uint16_t length = 1;
+    buffer[0] = 0;
+    for (uint8_t i = 0; i < STREAM_MAX_STREAMS; i++) {
+        Stream_t* stream = &streams[i];
+        if (stream->dataSet == NULL) {
+            continue;
+        }
+        if (stream->subscriber == srcAddr) {
+            stream->leaseTick = HAL_GetTick();
+        }
+
+        uint8_t* entry = &buffer[length];
+        entry[0] = stream->dataSet->id;
+        entry[1] = stream->subscriber;
+        memcpy(&entry[2], &stream->periodMs, 2);
+        memcpy(&entry[4], &stream->offsetMs, 2);
+        memcpy(&entry[6], &stream->deadband, 2);
+        memcpy(&entry[8], &stream->sequence, 2);
+        memcpy(&entry[10], &stream->published, 4);
+        memcpy(&entry[14], &stream->suppressed, 4);
+        memcpy(&entry[18], &stream->overruns, 4);
+        length += STREAM_STATUS_ENTRY_SIZE;
+        buffer[0]++;
+    }
+
+    return length;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Find a registered data set
+ * @param  id: STREAM_SET_xxx
+ * @retval Data set, NULL if not registered
+ */
+static const Stream_DataSet_t* Find_DataSet(uint8_t id)
+{
+    for (uint8_t i = 0; i < dataSetCount; i++) {
+        if (dataSets[i]->id == id) {
+            return dataSets[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  First slot after a bus time
+ * @param  nowMs: Bus time in ms
+ * @param  periodMs: Stream period
+ * @param  offsetMs: Slot offset within the period
+ * @retval Bus time of the slot in ms
+ */
+static uint64_t Next_Slot(uint64_t nowMs, uint16_t periodMs, uint16_t offsetMs)
+{
+    uint64_t slot = nowMs - (nowMs % periodMs) + offsetMs;
+    return (slot > nowMs) ? slot : slot + periodMs;
+}
+
+/**
+ * @brief  Check a sample against the last publication
+ * @param  stream: Stream
+ * @param  data: New sample
+ * @param  length: Sample length
+ * @retval 1 if it must be published
+ */
+static uint8_t Has_Changed(const Stream_t* stream, const uint8_t* data, uint16_t length)
+{
+    if (stream->deadband == 0 || length != stream->lastLength) {
+        return 1;
+    }
+    if (stream->dataSet->elementSize != 2) {
+        return memcmp(data, stream->last, length) != 0;
+    }
+
+    for (uint16_t i = 0; i + 1 < length; i += 2) {
+        uint16_t value = (uint16_t)(data[i] | (data[i + 1] << 8));
+        uint16_t last = (uint16_t)(stream->last[i] | (stream->last[i + 1] << 8));
+        uint16_t delta = (value > last) ? (value - last) : (last - value);
+        if (delta > stream->deadband) {
+            return 1;
+        }
+    }
+    return 0;
+}
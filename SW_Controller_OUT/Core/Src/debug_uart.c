@@ -12,10 +12,27 @@
 /* External UART Handle */
 extern UART_HandleTypeDef huart1;
 
+/* Start of the trace format string section (linker script) */
+extern const char __trace_fmt_start[];
+
+/* USART1 TX DMA (not in the CubeMX configuration, set up in Debug_Init) */
+DMA_HandleTypeDef hdma_usart1_tx;
+
+/* TX ring: free-running 16-bit indices, position = index & (DEBUG_RING_SIZE - 1) */
+static uint8_t debugRing[DEBUG_RING_SIZE] DEBUG_RING_SECTION;
+
 /* Private Variables */
 static DebugLevel_t currentDebugLevel = DEBUG_DEFAULT_LEVEL;
-static char debugBuffer[DEBUG_BUFFER_SIZE];
-static uint32_t systemTicks = 0;
+static volatile uint32_t ringState = 0;         // [writers in progress:16][reserve head:16]
+static volatile uint32_t ringCommit = 0;        // Bytes before this index are complete
+static volatile uint32_t ringTail = 0;          // Next byte to transmit
+static volatile uint32_t txBusy = 0;            // Owner flag of the DMA transfer
+static volatile uint16_t txLength = 0;          // Bytes in the current DMA transfer
+static volatile uint8_t dmaReady = 0;           // 0 = blocking fallback
+static volatile uint32_t droppedMessages = 0;
+static volatile uint32_t droppedBytes = 0;
+static volatile uint32_t droppedUnreported = 0; // Drops not yet announced in the log
+static volatile uint16_t highWater = 0;
 
 /* Level Names */
 static const char* levelNames[] = {
@@ -26,14 +43,55 @@ static const char* levelNames[] = {
     "VERB "
 };
 
+/* Private Function Prototypes */
+static void Debug_Output(const char* data, uint16_t length);
+static void Report_Dropped(void);
+static uint8_t Trace_Append(uint8_t* record, uint16_t* length, const void* data, uint16_t size);
+static uint8_t Ring_Write(const uint8_t* data, uint16_t length);
+static void Ring_Publish(uint32_t head);
+static void Start_Transmit(void);
+static uint8_t Try_Lock(volatile uint32_t* lock);
+static void Atomic_Add(volatile uint32_t* value, uint32_t delta);
+static uint32_t Atomic_Exchange(volatile uint32_t* value, uint32_t newValue);
+
 /**
  * @brief  Initialize debug UART interface
+ * @note   Call after MX_USART1_UART_Init
  * @retval None
  */
 void Debug_Init(void)
 {
     currentDebugLevel = DEBUG_DEFAULT_LEVEL;
-    DEBUG_INFO("Debug UART initialized");
+    ringState = 0;
+    ringCommit = 0;
+    ringTail = 0;
+    txBusy = 0;
+    txLength = 0;
+
+    /* USART1 TX DMA: DMA1 Stream0, normal mode, byte transfers */
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    hdma_usart1_tx.Instance = DMA1_Stream0;
+    hdma_usart1_tx.Init.Request = DMA_REQUEST_USART1_TX;
+    hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+    if (HAL_DMA_Init(&hdma_usart1_tx) == HAL_OK) {
+        __HAL_LINKDMA(&huart1, hdmatx, hdma_usart1_tx);
+        HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, DEBUG_DMA_IRQ_PRIORITY, 0);
+        HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+        dmaReady = 1;
+        DEBUG_INFO("Debug UART initialized (DMA, %u byte ring)", DEBUG_RING_SIZE);
+    } else {
+        dmaReady = 0;
+        DEBUG_WARNING("Debug UART initialized (DMA init failed, blocking output)");
+    }
 }
 
 /**
@@ -47,7 +105,7 @@ void Debug_SetLevel(DebugLevel_t level)
 }
 
 /**
- * @brief  Print formatted debug message
+ * @brief  Print formatted debug message (ISR safe, non-blocking)
  * @param  level: Debug level
  * @param  format: Printf-style format string
  * @retval None
@@ -58,38 +116,150 @@ void Debug_Print(DebugLevel_t level, const char* format, ...)
         return;
     }
 
+    /* Format on the caller's stack so concurrent callers don't share a buffer */
+    char line[DEBUG_BUFFER_SIZE];
+    int offset = 0;
+    int written;
     va_list args;
-    va_start(args, format);
 
-    /* Get system tick for timestamp */
-    systemTicks = HAL_GetTick();
+    Report_Dropped();
 
-    /* Format message */
-    int offset = 0;
-    
 #if DEBUG_TIMESTAMP_ENABLED
-    offset = snprintf(debugBuffer, DEBUG_BUFFER_SIZE, "[%8lu] ", systemTicks);
+    offset = snprintf(line, sizeof(line), "[%8lu] ", HAL_GetTick());
 #endif
 
     /* Add level */
-    offset += snprintf(debugBuffer + offset, DEBUG_BUFFER_SIZE - offset, 
+    offset += snprintf(line + offset, sizeof(line) - offset,
                        "[%s] ", levelNames[level]);
 
-    /* Add user message */
-    offset += vsnprintf(debugBuffer + offset, DEBUG_BUFFER_SIZE - offset, 
-                        format, args);
+    /* Add user message (truncated to leave room for the newline) */
+    va_start(args, format);
+    written = vsnprintf(line + offset, sizeof(line) - offset, format, args);
+    va_end(args);
+
+    if (written > 0) {
+        offset += written;
+    }
+    if (offset > DEBUG_BUFFER_SIZE - 3) {
+        offset = DEBUG_BUFFER_SIZE - 3;
+    }
 
     /* Add newline */
-    if (offset < DEBUG_BUFFER_SIZE - 2) {
-        debugBuffer[offset++] = '\r';
-        debugBuffer[offset++] = '\n';
-        debugBuffer[offset] = '\0';
+    line[offset++] = '\r';
+    line[offset++] = '\n';
+    line[offset] = '\0';
+
+    Debug_Output(line, (uint16_t)offset);
+}
+
+/**
+ * @brief  Queue a binary trace record (deferred formatting)
+ * @note   Called by the DEBUG_* macros when DEBUG_BINARY_ENABLED is set.
+ *         Only the conversion specifiers are scanned to fetch the raw
+ *         arguments; the host decoder applies the format string.
+ * @param  level: Debug level
+ * @param  format: Format string located in the .trace_fmt section
+ * @retval None
+ */
+void Debug_Trace(DebugLevel_t level, const char* format, ...)
+{
+    if (level > currentDebugLevel) {
+        return;
     }
 
+    uint8_t record[DEBUG_TRACE_MAX_SIZE];
+    uint16_t length = DEBUG_TRACE_HEADER_SIZE;
+    uint16_t id = (uint16_t)(format - __trace_fmt_start);
+    uint32_t tick = HAL_GetTick();
+    uint8_t space = 1;
+    va_list args;
+
+    Report_Dropped();
+
+    record[0] = DEBUG_TRACE_SYNC;
+    record[2] = (uint8_t)level;
+    memcpy(&record[3], &id, 2);
+    memcpy(&record[5], &tick, 4);
+
+    /* Arguments that don't fit are left out, the decoder shows them as '?' */
+    va_start(args, format);
+    for (const char* p = format; *p != '\0' && space; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+
+        /* Flags, width and precision ('*' takes an int argument) */
+        while (*p != '\0' && strchr("-+ #0123456789.*", *p) != NULL) {
+            if (*p == '*' && space) {
+                int32_t value = va_arg(args, int);
+                space = Trace_Append(record, &length, &value, 4);
+            }
+            p++;
+        }
+
+        /* Length modifiers */
+        uint8_t longLong = 0;
+        while (*p != '\0' && strchr("hlLjzt", *p) != NULL) {
+            if (p[0] == 'l' && p[1] == 'l') {
+                longLong = 1;
+            }
+            p++;
+        }
+
+        if (*p == '\0' || !space) {
+            break;
+        }
+
+        switch (*p) {
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+                float value = (float)va_arg(args, double);
+                space = Trace_Append(record, &length, &value, 4);
+                break;
+            }
+
+            case 's': {
+                const char* str = va_arg(args, const char*);
+                uint8_t strLength = 0;
+                while (strLength < DEBUG_TRACE_MAX_STRING && str[strLength] != '\0') {
+                    strLength++;
+                }
+                space = Trace_Append(record, &length, &strLength, 1) &&
+                        Trace_Append(record, &length, str, strLength);
+                break;
+            }
+
+            case 'p': {
+                uint32_t value = (uint32_t)(uintptr_t)va_arg(args, void*);
+                space = Trace_Append(record, &length, &value, 4);
+                break;
+            }
+
+            default:
+                if (longLong) {
+                    uint64_t value = va_arg(args, unsigned long long);
+                    space = Trace_Append(record, &length, &value, 8);
+                } else {
+                    uint32_t value = va_arg(args, unsigned int);
+                    space = Trace_Append(record, &length, &value, 4);
+                }
+                break;
+        }
+    }
     va_end(args);
 
-    /* Transmit via UART */
-    HAL_UART_Transmit(&huart1, (uint8_t*)debugBuffer, offset, 100);
+    /* Length covers the whole record, checksum is the XOR after the sync byte */
+    record[1] = (uint8_t)(length + 1);
+    uint8_t checksum = 0;
+    for (uint16_t i = 1; i < length; i++) {
+        checksum ^= record[i];
+    }
+    record[length++] = checksum;
+
+    Debug_Output((const char*)record, length);
 }
 
 /**
@@ -99,7 +269,7 @@ void Debug_Print(DebugLevel_t level, const char* format, ...)
  */
 void Debug_PrintRaw(const char* str)
 {
-    HAL_UART_Transmit(&huart1, (uint8_t*)str, strlen(str), 100);
+    Debug_Output(str, (uint16_t)strlen(str));
 }
 
 /**
@@ -110,18 +280,312 @@ void Debug_PrintRaw(const char* str)
  */
 void Debug_PrintHex(const uint8_t* data, uint16_t length)
 {
-    char hexStr[8];
-    Debug_PrintRaw("HEX: ");
-    
+    /* One queued message per row keeps rows intact between other messages */
+    char row[64];
+    int offset = snprintf(row, sizeof(row), "HEX: ");
+
     for (uint16_t i = 0; i < length; i++) {
-        snprintf(hexStr, sizeof(hexStr), "%02X ", data[i]);
-        Debug_PrintRaw(hexStr);
-        
+        offset += snprintf(row + offset, sizeof(row) - offset, "%02X ", data[i]);
+
         if ((i + 1) % 16 == 0) {
-            Debug_PrintRaw("\r\n     ");
+            offset += snprintf(row + offset, sizeof(row) - offset, "\r\n     ");
+            Debug_Output(row, (uint16_t)offset);
+            offset = 0;
+        }
+    }
+
+    offset += snprintf(row + offset, sizeof(row) - offset, "\r\n");
+    Debug_Output(row, (uint16_t)offset);
+}
+
+/**
+ * @brief  Wait until all queued output has been transmitted
+ * @note   Needs interrupts enabled (e.g. before a software reset)
+ * @param  timeout_ms: Maximum wait time
+ * @retval None
+ */
+void Debug_Flush(uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (dmaReady && (txBusy || (uint16_t)(ringCommit - ringTail) != 0)) {
+        if ((HAL_GetTick() - start) >= timeout_ms) {
+            break;
         }
     }
-    
-    Debug_PrintRaw("\r\n");
 }
 
+/**
+ * @brief  Get logger statistics
+ * @param  stats: Output statistics
+ * @retval None
+ */
+void Debug_GetStats(DebugStats_t* stats)
+{
+    stats->droppedMessages = droppedMessages;
+    stats->droppedBytes = droppedBytes;
+    stats->highWater = highWater;
+    stats->pending = (uint16_t)((ringState & 0xFFFFU) - ringTail);
+}
+
+/**
+ * @brief  UART TX Complete Callback (debug DMA transfer finished)
+ * @param  huart: UART handle
+ * @retval None
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART1) {
+        ringTail = (ringTail + txLength) & 0xFFFFU;
+        txLength = 0;
+        __DMB();
+        txBusy = 0;
+
+        /* Continue with anything queued meanwhile */
+        Start_Transmit();
+    }
+}
+
+/**
+ * @brief  UART error handling for the debug port (called from HAL_UART_ErrorCallback)
+ * @param  huart: UART handle
+ * @retval None
+ */
+void Debug_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    /* Aborted debug transfer: skip the chunk rather than stalling the logger */
+    if (huart->Instance == USART1 && txBusy && huart->gState == HAL_UART_STATE_READY) {
+        HAL_UART_TxCpltCallback(huart);
+    }
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Queue output, or transmit blocking if DMA is unavailable
+ * @param  data: Characters to output
+ * @param  length: Number of characters
+ * @retval None
+ */
+static void Debug_Output(const char* data, uint16_t length)
+{
+    if (!dmaReady) {
+        HAL_UART_Transmit(&huart1, (uint8_t*)data, length, 100);
+        return;
+    }
+
+    if (!Ring_Write((const uint8_t*)data, length)) {
+        Atomic_Add(&droppedMessages, 1);
+        Atomic_Add(&droppedBytes, length);
+        Atomic_Add(&droppedUnreported, 1);
+    }
+}
+
+/**
+ * @brief  Announce messages lost since the last successful one
+ * @retval None
+ */
+static void Report_Dropped(void)
+{
+    uint32_t dropped = Atomic_Exchange(&droppedUnreported, 0);
+
+    if (dropped > 0) {
+        char note[48];
+        int written = snprintf(note, sizeof(note), "[%lu debug messages dropped]\r\n", dropped);
+        if (!dmaReady || !Ring_Write((const uint8_t*)note, (uint16_t)written)) {
+            Atomic_Add(&droppedUnreported, dropped);
+        }
+    }
+}
+
+/**
+ * @brief  Append an argument to a trace record
+ * @param  record: Record buffer (DEBUG_TRACE_MAX_SIZE)
+ * @param  length: Current record length, updated
+ * @param  data: Argument bytes
+ * @param  size: Number of bytes
+ * @retval 1 if appended, 0 if the record is full (checksum byte reserved)
+ */
+static uint8_t Trace_Append(uint8_t* record, uint16_t* length, const void* data, uint16_t size)
+{
+    if ((*length + size) > (DEBUG_TRACE_MAX_SIZE - 1)) {
+        return 0;
+    }
+
+    memcpy(&record[*length], data, size);
+    *length += size;
+    return 1;
+}
+
+/**
+ * @brief  Copy a message into the ring (lock-free, multi-producer)
+ * @note   Space is reserved with LDREX/STREX. A writer count in the same
+ *         word lets the last writer to finish publish all reserved bytes,
+ *         so an interrupted writer never exposes a half-written message
+ *         and no producer ever waits for another.
+ * @param  data: Message bytes
+ * @param  length: Message length
+ * @retval 1 if queued, 0 if the ring is full (message dropped)
+ */
+static uint8_t Ring_Write(const uint8_t* data, uint16_t length)
+{
+    uint32_t state;
+    uint32_t next;
+    uint32_t head;
+    uint32_t used;
+
+    if (length == 0 || length > DEBUG_RING_SIZE) {
+        return 0;
+    }
+
+    /* Reserve: advance head and count this writer in one atomic step */
+    do {
+        state = __LDREXW(&ringState);
+        head = state & 0xFFFFU;
+        used = (uint16_t)(head - ringTail);
+
+        if ((used + length) > DEBUG_RING_SIZE) {
+            __CLREX();
+            return 0;
+        }
+
+        next = ((state & 0xFFFF0000U) + 0x10000U) | ((head + length) & 0xFFFFU);
+    } while (__STREXW(next, &ringState));
+
+    /* Copy, wrapping at the end of the ring */
+    uint32_t pos = head & (DEBUG_RING_SIZE - 1U);
+    uint32_t first = DEBUG_RING_SIZE - pos;
+
+    if (first >= length) {
+        memcpy(&debugRing[pos], data, length);
+    } else {
+        memcpy(&debugRing[pos], data, first);
+        memcpy(debugRing, &data[first], length - first);
+    }
+
+    if ((used + length) > highWater) {
+        highWater = (uint16_t)(used + length);
+    }
+
+    __DMB();
+
+    /* Commit: drop the writer count, the last writer publishes */
+    do {
+        state = __LDREXW(&ringState);
+        next = state - 0x10000U;
+    } while (__STREXW(next, &ringState));
+
+    if ((next >> 16) == 0) {
+        Ring_Publish(next & 0xFFFFU);
+    }
+
+    Start_Transmit();
+    return 1;
+}
+
+/**
+ * @brief  Advance the commit index (never backwards)
+ * @param  head: Reserve head at a moment with no writer in progress
+ * @retval None
+ */
+static void Ring_Publish(uint32_t head)
+{
+    uint32_t commit;
+
+    do {
+        commit = __LDREXW(&ringCommit);
+
+        /* A later writer may already have published further */
+        if ((int16_t)(uint16_t)(head - commit) <= 0) {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(head, &ringCommit));
+}
+
+/**
+ * @brief  Start a DMA transfer of committed bytes if the UART is idle
+ * @retval None
+ */
+static void Start_Transmit(void)
+{
+    while (Try_Lock(&txBusy)) {
+        uint32_t tail = ringTail;
+        uint16_t available = (uint16_t)(ringCommit - tail);
+
+        if (available > 0) {
+            /* Contiguous part up to the end of the ring */
+            uint32_t pos = tail & (DEBUG_RING_SIZE - 1U);
+            uint16_t length = (available < (DEBUG_RING_SIZE - pos)) ?
+                              available : (uint16_t)(DEBUG_RING_SIZE - pos);
+
+            txLength = length;
+            __DSB();
+
+            if (HAL_UART_Transmit_DMA(&huart1, &debugRing[pos], length) != HAL_OK) {
+                /* UART busy: retried by the next message */
+                txLength = 0;
+                txBusy = 0;
+            }
+            return;
+        }
+
+        txBusy = 0;
+        __DMB();
+
+        /* Data may have been published while the lock was held */
+        if ((uint16_t)(ringCommit - ringTail) == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief  Try to take a lock flag
+ * @param  lock: Lock flag
+ * @retval 1 if taken, 0 if already held
+ */
+static uint8_t Try_Lock(volatile uint32_t* lock)
+{
+    do {
+        if (__LDREXW(lock) != 0) {
+            __CLREX();
+            return 0;
+        }
+    } while (__STREXW(1, lock));
+
+    __DMB();
+    return 1;
+}
+
+/**
+ * @brief  Atomically add to a counter
+ * @param  value: Counter
+ * @param  delta: Value to add
+ * @retval None
+ */
+static void Atomic_Add(volatile uint32_t* value, uint32_t delta)
+{
+    uint32_t next;
+
+    do {
+        next = __LDREXW(value) + delta;
+    } while (__STREXW(next, value));
+}
+
+/**
+ * @brief  Atomically replace a value
+ * @param  value: Variable
+ * @param  newValue: New value
+ * @retval Previous value
+ */
+static uint32_t Atomic_Exchange(volatile uint32_t* value, uint32_t newValue)
+{
+    uint32_t previous;
+
+    do {
+        previous = __LDREXW(value);
+    } while (__STREXW(newValue, value));
+
+    return previous;
+}
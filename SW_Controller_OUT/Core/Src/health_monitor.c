@@ -0,0 +1,366 @@
+/**
+ ******************************************************************************
+ * @file           : health_monitor.c
+ * @brief          : Computed System Health Score Implementation
+ ******************************************************************************
+ */
+
+#include "health_monitor.h"
+#include "rs485_protocol.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Linker Symbols */
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+/* One Second of Samples */
+typedef struct {
+    uint32_t rxFrames;
+    uint32_t rxErrors;
+    uint32_t loopPasses;
+    uint32_t loopOverruns;
+    uint32_t queueOverflows;
+    uint32_t ioSamples;
+    uint32_t ioMissed;
+} HealthBucket_t;
+
+/* Private Variables */
+static HealthBucket_t buckets[HEALTH_WINDOW_SECONDS];
+static HealthBucket_t current;                  // Second in progress
+static uint8_t bucketIndex = 0;
+static uint32_t bucketTick = 0;
+static uint32_t lastPassTick = 0;
+static uint8_t firstPass = 1;
+static uint32_t lastRxFrames = 0;               // Counter snapshots for deltas
+static uint32_t lastRxErrors = 0;
+static uint32_t lastOverflows = 0;
+static uint8_t scores[HEALTH_COMPONENT_COUNT];
+static uint8_t overall = 100;
+static uint16_t maxLoopIntervalMs = 0;
+static uint16_t maxIoLagMs = 0;
+static uint32_t* stackBottom = NULL;
+static uint16_t stackSize = 0;
+static uint16_t stackUsed = 0;
+
+/* Private Function Prototypes */
+static uint32_t Count_RxErrors(const RS485_Telemetry_t* telemetry);
+static uint32_t Count_Overflows(void);
+static void Sum_Window(HealthBucket_t* total);
+static uint8_t Score_Rate(uint32_t faults, uint32_t samples, uint32_t weight);
+static void Update_Stack(void);
+static void Update_Scores(void);
+
+/**
+ * @brief  Initialize health monitoring (call after RS485_Init)
+ * @note   Paints the unused part of the reserved stack for the high-water
+ *         mark; the heap is not touched.
+ * @retval None
+ */
+void Health_Init(void)
+{
+    const RS485_Telemetry_t* telemetry = RS485_GetTelemetry();
+
+    memset(buckets, 0, sizeof(buckets));
+    memset(&current, 0, sizeof(current));
+    memset(scores, 100, sizeof(scores));
+    overall = 100;
+    bucketIndex = 0;
+    bucketTick = HAL_GetTick();
+    firstPass = 1;
+    maxLoopIntervalMs = 0;
+    maxIoLagMs = 0;
+
+    lastRxFrames = telemetry->rxFrames + telemetry->foreignFrames;
+    lastRxErrors = Count_RxErrors(telemetry);
+    lastOverflows = Count_Overflows();
+
+    /* Paint from the bottom of the reserved stack up to below the current frame */
+    stackSize = (uint16_t)(uintptr_t)&_Min_Stack_Size;
+    stackBottom = (uint32_t*)((uintptr_t)&_estack - stackSize);
+    uint32_t* paintEnd = (uint32_t*)(uintptr_t)((__get_MSP() - 64U) & ~3U);
+    for (uint32_t* word = stackBottom; word < paintEnd; word++) {
+        *word = HEALTH_STACK_PAINT;
+    }
+    Update_Stack();
+
+    RS485_GetStatus()->health = overall;
+
+    DEBUG_INFO("Health monitor initialized, stack %u/%u bytes", stackUsed, stackSize);
+}
+
+/**
+ * @brief  Update health (1 ms scheduler task)
+ * @note   A run more than HEALTH_LOOP_DEADLINE_MS after the previous one
+ *         means the scheduler was blocked (loop overrun).
+ * @retval None
+ */
+void Health_Process(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    /* Scheduler latency */
+    if (!firstPass) {
+        uint32_t interval = now - lastPassTick;
+        if (interval > HEALTH_LOOP_DEADLINE_MS) {
+            current.loopOverruns++;
+        }
+        if (interval > maxLoopIntervalMs) {
+            maxLoopIntervalMs = (interval > UINT16_MAX) ? UINT16_MAX : (uint16_t)interval;
+        }
+    }
+    firstPass = 0;
+    lastPassTick = now;
+    current.loopPasses++;
+
+    if (now - bucketTick < 1000) {
+        return;
+    }
+    bucketTick = now;
+
+    /* Close the second: counter deltas since the previous one */
+    const RS485_Telemetry_t* telemetry = RS485_GetTelemetry();
+    uint32_t rxFrames = telemetry->rxFrames + telemetry->foreignFrames;
+    uint32_t rxErrors = Count_RxErrors(telemetry);
+    uint32_t overflows = Count_Overflows();
+
+    current.rxFrames = rxFrames - lastRxFrames;
+    current.rxErrors = rxErrors - lastRxErrors;
+    current.queueOverflows = overflows - lastOverflows;
+    lastRxFrames = rxFrames;
+    lastRxErrors = rxErrors;
+    lastOverflows = overflows;
+
+    buckets[bucketIndex] = current;
+    bucketIndex = (bucketIndex + 1) % HEALTH_WINDOW_SECONDS;
+    memset(&current, 0, sizeof(current));
+
+    Update_Stack();
+    Update_Scores();
+}
+
+/**
+ * @brief  Record one run of a periodic I/O update
+ * @note   Every full period beyond the scheduled one is a missed slot
+ *         (skipped ADC conversion / DI sample).
+ * @param  periodMs: Scheduled update period
+ * @param  elapsedMs: Time since the previous update
+ * @retval None
+ */
+void Health_RecordIoSample(uint32_t periodMs, uint32_t elapsedMs)
+{
+    if (periodMs == 0) {
+        return;
+    }
+
+    current.ioSamples++;
+    if (elapsedMs >= 2U * periodMs) {
+        current.ioMissed += (elapsedMs / periodMs) - 1U;
+    }
+
+    if (elapsedMs > periodMs) {
+        uint32_t lag = elapsedMs - periodMs;
+        if (lag > maxIoLagMs) {
+            maxIoLagMs = (lag > UINT16_MAX) ? UINT16_MAX : (uint16_t)lag;
+        }
+    }
+}
+
+/**
+ * @brief  Get the score of one component
+ * @param  component: Health component
+ * @retval Score 0-100 (overall health for an invalid component)
+ */
+uint8_t Health_GetScore(HealthComponent_t component)
+{
+    if (component >= HEALTH_COMPONENT_COUNT) {
+        return overall;
+    }
+    return scores[component];
+}
+
+/**
+ * @brief  Get scores and window totals
+ * @param  metrics: Output metrics
+ * @retval None
+ */
+void Health_GetMetrics(HealthMetrics_t* metrics)
+{
+    HealthBucket_t total;
+    Sum_Window(&total);
+
+    metrics->overall = overall;
+    memcpy(metrics->scores, scores, sizeof(scores));
+    metrics->rxFrames = total.rxFrames;
+    metrics->rxErrors = total.rxErrors;
+    metrics->loopPasses = total.loopPasses;
+    metrics->loopOverruns = total.loopOverruns;
+    metrics->queueOverflows = total.queueOverflows;
+    metrics->ioSamples = total.ioSamples;
+    metrics->ioMissed = total.ioMissed;
+    metrics->maxLoopIntervalMs = maxLoopIntervalMs;
+    metrics->maxIoLagMs = maxIoLagMs;
+    metrics->stackUsed = stackUsed;
+    metrics->stackSize = stackSize;
+}
+
+/**
+ * @brief  Read health (CMD_GET_HEALTH response)
+ * @note   Layout: [window s][overall][count][count x score], then u32 rx
+ *         frames, rx errors, loop passes, loop overruns, queue overflows,
+ *         I/O samples, I/O missed, then u16 max loop interval ms, max I/O
+ *         lag ms, stack used, stack size.
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 = buffer too small)
+ */
+uint16_t Health_Read(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < HEALTH_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    HealthMetrics_t metrics;
+    Health_GetMetrics(&metrics);
+
+    const uint32_t totals[] = {
+        metrics.rxFrames, metrics.rxErrors, metrics.loopPasses, metrics.loopOverruns,
+        metrics.queueOverflows, metrics.ioSamples, metrics.ioMissed
+    };
+    const uint16_t values[] = {
+        metrics.maxLoopIntervalMs, metrics.maxIoLagMs, metrics.stackUsed, metrics.stackSize
+    };
+    uint16_t length = 0;
+
+    buffer[length++] = HEALTH_WINDOW_SECONDS;
+    buffer[length++] = metrics.overall;
+    buffer[length++] = HEALTH_COMPONENT_COUNT;
+    memcpy(&buffer[length], metrics.scores, HEALTH_COMPONENT_COUNT);
+    length += HEALTH_COMPONENT_COUNT;
+    memcpy(&buffer[length], totals, sizeof(totals));
+    length += sizeof(totals);
+    memcpy(&buffer[length], values, sizeof(values));
+    length += sizeof(values);
+
+    return length;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Sum of all RX error counters
+ * @param  telemetry: RS485 telemetry
+ * @retval Error count
+ */
+static uint32_t Count_RxErrors(const RS485_Telemetry_t* telemetry)
+{
+    return telemetry->crcErrors + telemetry->framingErrors + telemetry->noiseErrors +
+           telemetry->overrunErrors + telemetry->parityErrors + telemetry->endByteErrors +
+           telemetry->parserTimeouts;
+}
+
+/**
+ * @brief  Sum of all queue overflow counters
+ * @retval Overflow count
+ */
+static uint32_t Count_Overflows(void)
+{
+    DebugStats_t debugStats;
+    Debug_GetStats(&debugStats);
+
+    return RS485_GetTelemetry()->bufferOverflows + debugStats.droppedMessages;
+}
+
+/**
+ * @brief  Sum the buckets of the sliding window
+ * @param  total: Output totals
+ * @retval None
+ */
+static void Sum_Window(HealthBucket_t* total)
+{
+    memset(total, 0, sizeof(*total));
+
+    for (uint8_t i = 0; i < HEALTH_WINDOW_SECONDS; i++) {
+        total->rxFrames += buckets[i].rxFrames;
+        total->rxErrors += buckets[i].rxErrors;
+        total->loopPasses += buckets[i].loopPasses;
+        total->loopOverruns += buckets[i].loopOverruns;
+        total->queueOverflows += buckets[i].queueOverflows;
+        total->ioSamples += buckets[i].ioSamples;
+        total->ioMissed += buckets[i].ioMissed;
+    }
+}
+
+/**
+ * @brief  Score a fault rate: 100 - weight x percent, clamped to 0
+ * @param  faults: Faults in the window
+ * @param  samples: Samples in the window (faults included)
+ * @param  weight: Points per percent
+ * @retval Score 0-100
+ */
+static uint8_t Score_Rate(uint32_t faults, uint32_t samples, uint32_t weight)
+{
+    if (samples == 0 || faults == 0) {
+        return 100;
+    }
+
+    uint64_t penalty = ((uint64_t)faults * 100U * weight) / samples;
+    return (penalty >= 100U) ? 0 : (uint8_t)(100U - penalty);
+}
+
+/**
+ * @brief  Scan the painted stack for the high-water mark
+ * @retval None
+ */
+static void Update_Stack(void)
+{
+    uint32_t untouched = 0;
+    uint32_t words = stackSize / 4U;
+
+    while (untouched < words && stackBottom[untouched] == HEALTH_STACK_PAINT) {
+        untouched++;
+    }
+    stackUsed = (uint16_t)(stackSize - untouched * 4U);
+}
+
+/**
+ * @brief  Recompute the component scores and the overall health
+ * @retval None
+ */
+static void Update_Scores(void)
+{
+    HealthBucket_t total;
+    Sum_Window(&total);
+
+    scores[HEALTH_RX_ERRORS] = Score_Rate(total.rxErrors, total.rxFrames + total.rxErrors,
+                                          HEALTH_RX_ERROR_WEIGHT);
+    scores[HEALTH_LOOP_OVERRUNS] = Score_Rate(total.loopOverruns, total.loopPasses,
+                                              HEALTH_LOOP_OVERRUN_WEIGHT);
+    scores[HEALTH_IO] = Score_Rate(total.ioMissed, total.ioSamples + total.ioMissed,
+                                   HEALTH_IO_FAULT_WEIGHT);
+
+    if (total.queueOverflows >= (100U + HEALTH_OVERFLOW_WEIGHT - 1U) / HEALTH_OVERFLOW_WEIGHT) {
+        scores[HEALTH_QUEUE_OVERFLOWS] = 0;
+    } else {
+        scores[HEALTH_QUEUE_OVERFLOWS] = (uint8_t)(100U - total.queueOverflows * HEALTH_OVERFLOW_WEIGHT);
+    }
+
+    /* Stack: full score up to the warning level, then linear down to 0 at full */
+    uint32_t stackPercent = (stackSize > 0) ? ((uint32_t)stackUsed * 100U / stackSize) : 0;
+    if (stackPercent <= HEALTH_STACK_WARN_PERCENT) {
+        scores[HEALTH_STACK] = 100;
+    } else if (stackPercent >= 100U) {
+        scores[HEALTH_STACK] = 0;
+    } else {
+        scores[HEALTH_STACK] = (uint8_t)((100U - stackPercent) * 100U / (100U - HEALTH_STACK_WARN_PERCENT));
+    }
+
+    overall = 100;
+    for (uint8_t i = 0; i < HEALTH_COMPONENT_COUNT; i++) {
+        if (scores[i] < overall) {
+            overall = scores[i];
+        }
+    }
+
+    RS485_GetStatus()->health = overall;
+}
@@ -0,0 +1,796 @@
+/**
+ ******************************************************************************
+ * @file           : logic_engine.c
+ * @brief          : On-Controller Logic Engine Implementation
+ ******************************************************************************
+ * @attention
+ *
+ * Logic_Scan runs in the logic task (SCHED_PRIORITY_IO), the command and
+ * input functions in the communication tasks. Input images are copied
+ * under PRIMASK; a program is handed over with swapPending: the staging
+ * buffer is not written until the scan has taken it.
+ *
+ ******************************************************************************
+ */
+
+#include "logic_engine.h"
+#include "digital_output_handler.h"
+#include "canfd_transport.h"
+#include "rs485_protocol.h"
+#include "perf_monitor.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Bit Area Size In Bytes (all areas share one layout for fast addressing) */
+#define AREA_BYTES                  (LOGIC_NUM_MARKERS / 8)
+
+/* Timer */
+typedef struct {
+    uint32_t start;
+    uint8_t running;
+    uint8_t previousIn;             // TP: start on the rising edge only
+} Logic_Timer_t;
+
+/* Counter */
+typedef struct {
+    uint16_t count;
+    uint8_t previousCount;          // Count on the rising edge
+} Logic_Counter_t;
+
+/* Execution Context (live scan or benchmark) */
+typedef struct {
+    uint8_t bits[LOGIC_AREA_COUNT][AREA_BYTES];
+    uint8_t edges[LOGIC_NUM_EDGES / 8];
+    uint16_t analog[LOGIC_NUM_ANALOG];
+    Logic_Timer_t timers[LOGIC_NUM_TIMERS];
+    Logic_Counter_t counters[LOGIC_NUM_COUNTERS];
+    uint32_t now;
+} Logic_Context_t;
+
+/* Program Buffer */
+typedef struct {
+    uint8_t code[LOGIC_PROGRAM_SIZE];
+    uint16_t length;
+    uint16_t crc;
+    uint32_t instructions;
+    uint8_t ownedOutputs[(LOGIC_NUM_DO + 7) / 8];   // DO written by the program
+} Logic_Program_t;
+
+/* Operand bytes per opcode */
+static const uint8_t operandSize[LOGIC_OP_COUNT] = {
+    [LOGIC_OP_END] = 0, [LOGIC_OP_LD] = 2, [LOGIC_OP_LDN] = 2, [LOGIC_OP_AND] = 0,
+    [LOGIC_OP_OR] = 0, [LOGIC_OP_XOR] = 0, [LOGIC_OP_NOT] = 0, [LOGIC_OP_DUP] = 0,
+    [LOGIC_OP_ST] = 2, [LOGIC_OP_SET] = 2, [LOGIC_OP_RST] = 2, [LOGIC_OP_R_TRIG] = 1,
+    [LOGIC_OP_F_TRIG] = 1, [LOGIC_OP_TON] = 5, [LOGIC_OP_TOF] = 5, [LOGIC_OP_TP] = 5,
+    [LOGIC_OP_CTU] = 3, [LOGIC_OP_ACMP] = 4,
+};
+
+/* Readable bits per area */
+static const uint16_t areaSize[LOGIC_AREA_COUNT] = {
+    [LOGIC_AREA_DO] = LOGIC_NUM_DO, [LOGIC_AREA_DI] = LOGIC_NUM_DI,
+    [LOGIC_AREA_MARKER] = LOGIC_NUM_MARKERS, [LOGIC_AREA_TIMER] = LOGIC_NUM_TIMERS,
+    [LOGIC_AREA_COUNTER] = LOGIC_NUM_COUNTERS, [LOGIC_AREA_SYSTEM] = LOGIC_NUM_SYSTEM,
+};
+
+/* Private Variables */
+static Logic_Program_t programs[2];
+static Logic_Program_t* activeProgram = &programs[0];
+static Logic_Program_t* stagingProgram = &programs[1];
+static uint16_t stagedLength = 0;
+static volatile uint8_t swapPending = 0;
+static volatile uint8_t requestedState = LOGIC_STATE_EMPTY;
+static uint8_t state = LOGIC_STATE_EMPTY;
+static uint8_t firstScan = 0;
+static Logic_Context_t context DTCM_DATA;     // Scan state, touched every scan
+
+/* Input images, written by the communication tasks */
+static uint8_t diImage[LOGIC_NUM_DI / 8];
+static uint16_t analogImage[LOGIC_NUM_ANALOG];
+static uint32_t diTick = 0;
+static uint32_t analogTick = 0;
+static uint8_t diReceived = 0;
+static uint8_t analogReceived = 0;
+
+static uint8_t benchCode[LOGIC_PROGRAM_SIZE];
+static Logic_Context_t benchContext;
+static Logic_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static void Image_Handler(uint8_t source, const uint8_t* data, uint8_t length);
+static void Load_Inputs(void);
+static void Write_Outputs(const Logic_Program_t* program);
+static void Clear_Outputs(const Logic_Program_t* program);
+static uint8_t Verify_Program(Logic_Program_t* program, uint16_t* errorOffset);
+static uint16_t Build_Benchmark(uint8_t* code, uint16_t size, uint32_t instructions);
+static void Run_Program(const uint8_t* code, Logic_Context_t* ctx);
+
+/**
+ * @brief  Start the logic engine (after DigitalOutput_Init and CanFd_Init)
+ * @note   Subscribes to the DIO and 4-20mA process images; no program
+ * @retval None
+ */
+void Logic_Init(void)
+{
+#if LOGIC_ENABLED
+    memset(programs, 0, sizeof(programs));
+    memset(&context, 0, sizeof(context));
+    memset(&stats, 0, sizeof(stats));
+    activeProgram = &programs[0];
+    stagingProgram = &programs[1];
+    stagedLength = 0;
+    swapPending = 0;
+    state = LOGIC_STATE_EMPTY;
+    requestedState = LOGIC_STATE_EMPTY;
+
+    CanFd_SubscribeImage(RS485_ADDR_CONTROLLER_DIO, Image_Handler);
+    CanFd_SubscribeImage(RS485_ADDR_CONTROLLER_420, Image_Handler);
+
+    DEBUG_INFO("Logic engine ready, %d byte programs, %d ms scan",
+               LOGIC_PROGRAM_SIZE, LOGIC_SCAN_PERIOD_MS);
+#endif
+}
+
+/**
+ * @brief  One logic scan (logic task, LOGIC_SCAN_PERIOD_MS)
+ * @note   Takes over an activated program, copies the inputs, runs the
+ *         program and writes the outputs it owns
+ * @retval None
+ */
+ITCM_TEXT void Logic_Scan(void)
+{
+    if (swapPending) {
+        Logic_Program_t* previous = activeProgram;
+        activeProgram = stagingProgram;
+        stagingProgram = previous;
+        stagedLength = 0;
+        stats.swaps++;
+        firstScan = 1;
+        state = LOGIC_STATE_RUNNING;
+        requestedState = LOGIC_STATE_RUNNING;
+        swapPending = 0;
+    }
+
+    if (requestedState != state && state != LOGIC_STATE_EMPTY) {
+        if (requestedState == LOGIC_STATE_STOPPED) {
+            Clear_Outputs(activeProgram);
+        } else {
+            firstScan = 1;
+        }
+        state = requestedState;
+    }
+
+    if (state != LOGIC_STATE_RUNNING) {
+        return;
+    }
+
+    uint32_t scanStart = DWT->CYCCNT;    // Runs from reset, also without PERF_MONITOR
+
+    Load_Inputs();
+    Run_Program(activeProgram->code, &context);
+    Write_Outputs(activeProgram);
+    firstScan = 0;
+
+    uint32_t cycles = DWT->CYCCNT - scanStart;
+    PERF_STOP(PERF_PROBE_LOGIC_SCAN, scanStart);
+    stats.scans++;
+    stats.lastCycles = cycles;
+    if (cycles > stats.maxCycles) {
+        stats.maxCycles = cycles;
+    }
+}
+
+/**
+ * @brief  Take a digital input image (CMD_DI_CHANGE frame or process image)
+ * @param  source: Sender (only the DIO controller is used)
+ * @param  data: [input states:7] ...
+ * @param  length: Data length
+ * @retval None
+ */
+void Logic_UpdateInputs(uint8_t source, const uint8_t* data, uint16_t length)
+{
+    if (source != RS485_ADDR_CONTROLLER_DIO || length < sizeof(diImage)) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(diImage, data, sizeof(diImage));
+    diTick = HAL_GetTick();
+    diReceived = 1;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Store a block of the next program (CMD_LOGIC_DOWNLOAD)
+ * @note   Offset 0 starts a new program; blocks must follow each other
+ * @param  offset: Byte offset of the block
+ * @param  data: Bytecode
+ * @param  length: Block length
+ * @param  nextOffset: Offset expected next
+ * @retval LOGIC_OK or LOGIC_ERR_xxx
+ */
+uint8_t Logic_Download(uint16_t offset, const uint8_t* data, uint16_t length, uint16_t* nextOffset)
+{
+    if (swapPending) {
+        *nextOffset = stagedLength;
+        return LOGIC_ERR_BUSY;
+    }
+    if (offset == 0) {
+        stagedLength = 0;
+    }
+    *nextOffset = stagedLength;
+
+    if (offset != stagedLength) {
+        return LOGIC_ERR_OFFSET;
+    }
+    if ((uint32_t)offset + length > LOGIC_PROGRAM_SIZE) {
+        return LOGIC_ERR_SIZE;
+    }
+
+    memcpy(&stagingProgram->code[offset], data, length);
+    stagedLength += length;
+    *nextOffset = stagedLength;
+    return LOGIC_OK;
+}
+
+/**
+ * @brief  Check the downloaded program and swap it in (CMD_LOGIC_ACTIVATE)
+ * @param  length: Program length
+ * @param  crc: CRC16 of the program (RS485_CalculateCRC)
+ * @param  errorOffset: Offset of the offending instruction on LOGIC_ERR_xxx
+ * @retval LOGIC_OK (running from the next scan) or LOGIC_ERR_xxx
+ */
+uint8_t Logic_Activate(uint16_t length, uint16_t crc, uint16_t* errorOffset)
+{
+    uint8_t result;
+
+    *errorOffset = 0;
+    if (swapPending) {
+        result = LOGIC_ERR_BUSY;
+    } else if (length == 0 || length != stagedLength) {
+        result = LOGIC_ERR_SIZE;
+    } else if (RS485_CalculateCRC(stagingProgram->code, length) != crc) {
+        result = LOGIC_ERR_CRC;
+    } else {
+        stagingProgram->length = length;
+        stagingProgram->crc = crc;
+        result = Verify_Program(stagingProgram, errorOffset);
+    }
+
+    if (result != LOGIC_OK) {
+        stats.rejected++;
+        DEBUG_WARNING("Logic program rejected: error %d at %d", result, *errorOffset);
+        return result;
+    }
+
+    swapPending = 1;
+    DEBUG_INFO("Logic program activated: %d bytes, %lu instructions, CRC 0x%04X",
+               length, stagingProgram->instructions, crc);
+    return LOGIC_OK;
+}
+
+/**
+ * @brief  Run, stop or reset statistics (CMD_LOGIC_STATUS)
+ * @note   Takes effect at the next scan; stopping sets the program's
+ *         outputs to 0
+ * @param  operation: LOGIC_CTRL_xxx
+ * @retval None
+ */
+void Logic_Control(uint8_t operation)
+{
+    if (operation == LOGIC_CTRL_RUN && state != LOGIC_STATE_EMPTY) {
+        requestedState = LOGIC_STATE_RUNNING;
+    } else if (operation == LOGIC_CTRL_STOP && state != LOGIC_STATE_EMPTY) {
+        requestedState = LOGIC_STATE_STOPPED;
+    } else if (operation == LOGIC_CTRL_RESET_STATS) {
+        stats.scans = 0;
+        stats.maxCycles = 0;
+    }
+}
+
+/**
+ * @brief  Keep program outputs out of a CMD_WRITE_DO image
+ * @param  states: Output image, 1 bit per output
+ * @param  size: Image size in bytes
+ * @retval None
+ */
+void Logic_FilterWrite(uint8_t* states, uint16_t size)
+{
+    if (state == LOGIC_STATE_EMPTY) {
+        return;
+    }
+
+    for (uint8_t output = 0; output < LOGIC_NUM_DO && output / 8 < size; output++) {
+        uint8_t bit = (uint8_t)(1 << (output % 8));
+        if (!(activeProgram->ownedOutputs[output / 8] & bit)) {
+            continue;
+        }
+        if (DigitalOutput_Get(output)) {
+            states[output / 8] |= bit;
+        } else {
+            states[output / 8] &= (uint8_t)~bit;
+        }
+    }
+}
+
+/**
+ * @brief  Read the engine status (CMD_LOGIC_STATUS_RESPONSE)
+ * @note   Layout: [state][length:2][crc:2][staged:2][swaps:2][rejected:2]
+ *         [scans:4][instructions per scan:4][last cycles:4][max cycles:4]
+ *         [core clock Hz:4] then the markers M0-255 (32 bytes)
+ * @param  buffer: Output buffer (LOGIC_STATUS_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t Logic_ReadStatus(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < LOGIC_STATUS_SIZE) {
+        return 0;
+    }
+
+    uint32_t instructions = (state == LOGIC_STATE_EMPTY) ? 0 : activeProgram->instructions;
+    uint16_t length = (state == LOGIC_STATE_EMPTY) ? 0 : activeProgram->length;
+    uint16_t crc = (state == LOGIC_STATE_EMPTY) ? 0 : activeProgram->crc;
+
+    buffer[0] = state;
+    memcpy(&buffer[1], &length, 2);
+    memcpy(&buffer[3], &crc, 2);
+    memcpy(&buffer[5], &stagedLength, 2);
+    memcpy(&buffer[7], &stats.swaps, 2);
+    memcpy(&buffer[9], &stats.rejected, 2);
+    memcpy(&buffer[11], &stats.scans, 4);
+    memcpy(&buffer[15], &instructions, 4);
+    memcpy(&buffer[19], &stats.lastCycles, 4);
+    memcpy(&buffer[23], &stats.maxCycles, 4);
+    memcpy(&buffer[27], &SystemCoreClock, 4);
+    memcpy(&buffer[LOGIC_STATUS_HEADER_SIZE], context.bits[LOGIC_AREA_MARKER],
+           LOGIC_NUM_MARKERS / 8);
+
+    return LOGIC_STATUS_SIZE;
+}
+
+/**
+ * @brief  Time LOGIC_BENCH_INSTRUCTIONS instructions (CMD_LOGIC_BENCH)
+ * @note   Fixed mix of loads, logic, analog compares, edges, timers and
+ *         stores, run on a scratch context: no effect on the live program
+ *         or the outputs. Response: [instructions:4][cycles:4][core clock Hz:4]
+ * @param  buffer: Output buffer (LOGIC_BENCH_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t Logic_Benchmark(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < LOGIC_BENCH_SIZE) {
+        return 0;
+    }
+
+    uint32_t instructions = LOGIC_BENCH_INSTRUCTIONS;
+    Build_Benchmark(benchCode, sizeof(benchCode), instructions);
+    memcpy(&benchContext, &context, sizeof(benchContext));
+    benchContext.now = HAL_GetTick();
+
+    /* Warm the caches, then time the second run */
+    Run_Program(benchCode, &benchContext);
+    uint32_t start = DWT->CYCCNT;
+    Run_Program(benchCode, &benchContext);
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    memcpy(&buffer[0], &instructions, 4);
+    memcpy(&buffer[4], &cycles, 4);
+    memcpy(&buffer[8], &SystemCoreClock, 4);
+    return LOGIC_BENCH_SIZE;
+}
+
+/**
+ * @brief  Get engine statistics
+ * @retval Statistics
+ */
+const Logic_Stats_t* Logic_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Process image handler (DIO inputs, 4-20mA raw values)
+ * @param  source: Publishing controller
+ * @param  data: Image
+ * @param  length: Image length
+ * @retval None
+ */
+static void Image_Handler(uint8_t source, const uint8_t* data, uint8_t length)
+{
+    if (source == RS485_ADDR_CONTROLLER_DIO) {
+        Logic_UpdateInputs(source, data, length);
+        return;
+    }
+
+    uint8_t count = length / 2;
+    if (count > LOGIC_NUM_ANALOG) {
+        count = LOGIC_NUM_ANALOG;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(analogImage, data, count * 2U);
+    analogTick = HAL_GetTick();
+    analogReceived = 1;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Copy the inputs into the scan context
+ * @retval None
+ */
+static void Load_Inputs(void)
+{
+    uint32_t now = HAL_GetTick();
+    uint8_t system = (1U << LOGIC_SYS_ALWAYS_ON);
+
+    context.now = now;
+    DigitalOutput_GetAll(context.bits[LOGIC_AREA_DO], LOGIC_NUM_DO / 8);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(context.bits[LOGIC_AREA_DI], diImage, sizeof(diImage));
+    memcpy(context.analog, analogImage, sizeof(analogImage));
+    if (diReceived && (now - diTick) < LOGIC_INPUT_TIMEOUT_MS) {
+        system |= (1U << LOGIC_SYS_DI_ONLINE);
+    }
+    if (analogReceived && (now - analogTick) < LOGIC_INPUT_TIMEOUT_MS) {
+        system |= (1U << LOGIC_SYS_AI_ONLINE);
+    }
+    __set_PRIMASK(primask);
+
+    if (firstScan) {
+        system |= (1U << LOGIC_SYS_FIRST_SCAN);
+    }
+    if ((now / 500U) & 1U) {
+        system |= (1U << LOGIC_SYS_CLOCK_1HZ);
+    }
+    context.bits[LOGIC_AREA_SYSTEM][0] = system;
+}
+
+/**
+ * @brief  Drive the outputs owned by the program from the scan result
+ * @param  program: Running program
+ * @retval None
+ */
+static void Write_Outputs(const Logic_Program_t* program)
+{
+    for (uint8_t output = 0; output < LOGIC_NUM_DO; output++) {
+        if (!(program->ownedOutputs[output / 8] & (1 << (output % 8)))) {
+            continue;
+        }
+        uint8_t value = (context.bits[LOGIC_AREA_DO][output / 8] >> (output % 8)) & 0x01;
+        if (DigitalOutput_Get(output) != value) {
+            DigitalOutput_Set(output, value);
+        }
+    }
+}
+
+/**
+ * @brief  Set the outputs owned by the program to 0 (stop)
+ * @param  program: Stopped program
+ * @retval None
+ */
+static void Clear_Outputs(const Logic_Program_t* program)
+{
+    for (uint8_t output = 0; output < LOGIC_NUM_DO; output++) {
+        if (program->ownedOutputs[output / 8] & (1 << (output % 8))) {
+            DigitalOutput_Set(output, 0);
+        }
+    }
+}
+
+/**
+ * @brief  Check a program once, so the scan needs no checks
+ * @note   Opcodes, operand ranges, writable areas, stack depth at every
+ *         instruction (straight-line code), END as the last byte. Fills
+ *         the instruction count and the owned outputs.
+ * @param  program: Program (code and length set)
+ * @param  errorOffset: Offset of the offending instruction
+ * @retval LOGIC_OK or LOGIC_ERR_xxx
+ */
+static uint8_t Verify_Program(Logic_Program_t* program, uint16_t* errorOffset)
+{
+    static const int8_t stackEffect[LOGIC_OP_COUNT] = {
+        [LOGIC_OP_LD] = 1, [LOGIC_OP_LDN] = 1, [LOGIC_OP_AND] = -1, [LOGIC_OP_OR] = -1,
+        [LOGIC_OP_XOR] = -1, [LOGIC_OP_DUP] = 1, [LOGIC_OP_ST] = -1, [LOGIC_OP_SET] = -1,
+        [LOGIC_OP_RST] = -1, [LOGIC_OP_CTU] = -1, [LOGIC_OP_ACMP] = 1,
+    };
+    static const uint8_t stackNeeded[LOGIC_OP_COUNT] = {
+        [LOGIC_OP_AND] = 2, [LOGIC_OP_OR] = 2, [LOGIC_OP_XOR] = 2, [LOGIC_OP_NOT] = 1,
+        [LOGIC_OP_DUP] = 1, [LOGIC_OP_ST] = 1, [LOGIC_OP_SET] = 1, [LOGIC_OP_RST] = 1,
+        [LOGIC_OP_R_TRIG] = 1, [LOGIC_OP_F_TRIG] = 1, [LOGIC_OP_TON] = 1, [LOGIC_OP_TOF] = 1,
+        [LOGIC_OP_TP] = 1, [LOGIC_OP_CTU] = 2,
+    };
+    const uint8_t* code = program->code;
+    uint16_t pc = 0;
+    int16_t depth = 0;
+
+    program->instructions = 0;
+    memset(program->ownedOutputs, 0, sizeof(program->ownedOutputs));
+
+    while (pc < program->length) {
+        uint8_t op = code[pc];
+        *errorOffset = pc;
+
+        if (op >= LOGIC_OP_COUNT) {
+            return LOGIC_ERR_OPCODE;
+        }
+        if (pc + 1U + operandSize[op] > program->length) {
+            return LOGIC_ERR_END;
+        }
+
+        const uint8_t* operand = &code[pc + 1];
+        switch (op) {
+            case LOGIC_OP_LD:
+            case LOGIC_OP_LDN:
+                if (operand[0] >= LOGIC_AREA_COUNT || operand[1] >= areaSize[operand[0]]) {
+                    return LOGIC_ERR_OPERAND;
+                }
+                break;
+            case LOGIC_OP_ST:
+            case LOGIC_OP_SET:
+            case LOGIC_OP_RST:
+                if (operand[0] == LOGIC_AREA_DO && operand[1] < LOGIC_NUM_DO) {
+                    program->ownedOutputs[operand[1] / 8] |= (uint8_t)(1 << (operand[1] % 8));
+                } else if (operand[0] != LOGIC_AREA_MARKER) {
+                    return LOGIC_ERR_OPERAND;
+                }
+                break;
+            case LOGIC_OP_R_TRIG:
+            case LOGIC_OP_F_TRIG:
+                if (operand[0] >= LOGIC_NUM_EDGES) {
+                    return LOGIC_ERR_OPERAND;
+                }
+                break;
+            case LOGIC_OP_TON:
+            case LOGIC_OP_TOF:
+            case LOGIC_OP_TP:
+                if (operand[0] >= LOGIC_NUM_TIMERS) {
+                    return LOGIC_ERR_OPERAND;
+                }
+                break;
+            case LOGIC_OP_CTU:
+                if (operand[0] >= LOGIC_NUM_COUNTERS) {
+                    return LOGIC_ERR_OPERAND;
+                }
+                break;
+            case LOGIC_OP_ACMP:
+                if (operand[0] > LOGIC_CMP_NE || operand[1] >= LOGIC_NUM_ANALOG) {
+                    return LOGIC_ERR_OPERAND;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (depth < stackNeeded[op] || depth + stackEffect[op] > LOGIC_STACK_DEPTH) {
+            return LOGIC_ERR_STACK;
+        }
+        depth += stackEffect[op];
+        program->instructions++;
+
+        if (op == LOGIC_OP_END) {
+            if (pc + 1U != program->length) {
+                return LOGIC_ERR_END;
+            }
+            return (depth == 0) ? LOGIC_OK : LOGIC_ERR_STACK;
+        }
+        pc += 1U + operandSize[op];
+    }
+
+    *errorOffset = pc;
+    return LOGIC_ERR_END;
+}
+
+/**
+ * @brief  Generate the benchmark program
+ * @note   Groups of 8: LD DI, LDN M, AND, ACMP, OR, R_TRIG, TON, ST M
+ * @param  code: Output buffer
+ * @param  size: Buffer size
+ * @param  instructions: Instructions before END (multiple of 8)
+ * @retval Program length
+ */
+static uint16_t Build_Benchmark(uint8_t* code, uint16_t size, uint32_t instructions)
+{
+    uint16_t pc = 0;
+    uint32_t preset = 100;
+
+    for (uint32_t group = 0; group < instructions / 8U && pc + 25U < size; group++) {
+        uint8_t n = (uint8_t)group;
+        code[pc++] = LOGIC_OP_LD;     code[pc++] = LOGIC_AREA_DI;     code[pc++] = n % LOGIC_NUM_DI;
+        code[pc++] = LOGIC_OP_LDN;    code[pc++] = LOGIC_AREA_MARKER; code[pc++] = n;
+        code[pc++] = LOGIC_OP_AND;
+        code[pc++] = LOGIC_OP_ACMP;   code[pc++] = LOGIC_CMP_GT;      code[pc++] = n % LOGIC_NUM_ANALOG;
+        code[pc++] = 0x00;            code[pc++] = 0x80;
+        code[pc++] = LOGIC_OP_OR;
+        code[pc++] = LOGIC_OP_R_TRIG; code[pc++] = n % LOGIC_NUM_EDGES;
+        code[pc++] = LOGIC_OP_TON;    code[pc++] = n % LOGIC_NUM_TIMERS;
+        memcpy(&code[pc], &preset, 4);
+        pc += 4;
+        code[pc++] = LOGIC_OP_ST;     code[pc++] = LOGIC_AREA_MARKER; code[pc++] = (uint8_t)(n + 128);
+    }
+    code[pc++] = LOGIC_OP_END;
+    return pc;
+}
+
+/**
+ * @brief  Execute a verified program once
+ * @param  code: Bytecode (Verify_Program passed)
+ * @param  ctx: Execution context
+ * @retval None
+ */
+static ITCM_TEXT void Run_Program(const uint8_t* code, Logic_Context_t* ctx)
+{
+    uint8_t stack[LOGIC_STACK_DEPTH + 1];
+    uint8_t sp = 0;             // Next free entry; top is stack[sp - 1]
+    uint32_t pc = 0;
+
+    for (;;) {
+        const uint8_t* operand = &code[pc + 1];
+        uint8_t op = code[pc];
+        pc += 1U + operandSize[op];
+
+        switch (op) {
+            case LOGIC_OP_END:
+                return;
+
+            case LOGIC_OP_LD:
+                stack[sp++] = (ctx->bits[operand[0]][operand[1] >> 3] >> (operand[1] & 7)) & 1U;
+                break;
+
+            case LOGIC_OP_LDN:
+                stack[sp++] = ((ctx->bits[operand[0]][operand[1] >> 3] >> (operand[1] & 7)) & 1U) ^ 1U;
+                break;
+
+            case LOGIC_OP_AND:
+                sp--;
+                stack[sp - 1] &= stack[sp];
+                break;
+
+            case LOGIC_OP_OR:
+                sp--;
+                stack[sp - 1] |= stack[sp];
+                break;
+
+            case LOGIC_OP_XOR:
+                sp--;
+                stack[sp - 1] ^= stack[sp];
+                break;
+
+            case LOGIC_OP_NOT:
+                stack[sp - 1] ^= 1U;
+                break;
+
+            case LOGIC_OP_DUP:
+                stack[sp] = stack[sp - 1];
+                sp++;
+                break;
+
+            case LOGIC_OP_ST: {
+                uint8_t* byte = &ctx->bits[operand[0]][operand[1] >> 3];
+                uint8_t mask = (uint8_t)(1U << (operand[1] & 7));
+                *byte = stack[--sp] ? (uint8_t)(*byte | mask) : (uint8_t)(*byte & ~mask);
+                break;
+            }
+
+            case LOGIC_OP_SET:
+                if (stack[--sp]) {
+                    ctx->bits[operand[0]][operand[1] >> 3] |= (uint8_t)(1U << (operand[1] & 7));
+                }
+                break;
+
+            case LOGIC_OP_RST:
+                if (stack[--sp]) {
+                    ctx->bits[operand[0]][operand[1] >> 3] &= (uint8_t)~(1U << (operand[1] & 7));
+                }
+                break;
+
+            case LOGIC_OP_R_TRIG:
+            case LOGIC_OP_F_TRIG: {
+                uint8_t mask = (uint8_t)(1U << (operand[0] & 7));
+                uint8_t previous = (ctx->edges[operand[0] >> 3] & mask) != 0;
+                uint8_t in = stack[sp - 1];
+                ctx->edges[operand[0] >> 3] = in ? (uint8_t)(ctx->edges[operand[0] >> 3] | mask)
+                                                 : (uint8_t)(ctx->edges[operand[0] >> 3] & ~mask);
+                stack[sp - 1] = (op == LOGIC_OP_R_TRIG) ? (in && !previous) : (!in && previous);
+                break;
+            }
+
+            case LOGIC_OP_TON:
+            case LOGIC_OP_TOF:
+            case LOGIC_OP_TP: {
+                Logic_Timer_t* timer = &ctx->timers[operand[0]];
+                uint32_t preset;
+                memcpy(&preset, &operand[1], 4);
+                uint8_t in = stack[sp - 1];
+                uint8_t q;
+
+                if (op == LOGIC_OP_TON) {
+                    if (!in) {
+                        timer->running = 0;
+                    } else if (!timer->running) {
+                        timer->running = 1;
+                        timer->start = ctx->now;
+                    }
+                    q = in && (ctx->now - timer->start) >= preset;
+                } else if (op == LOGIC_OP_TOF) {
+                    if (in) {
+                        timer->running = 0;
+                        timer->start = ctx->now;
+                    } else if (!timer->running && timer->previousIn) {
+                        timer->running = 1;
+                        timer->start = ctx->now;
+                    }
+                    if (timer->running && (ctx->now - timer->start) >= preset) {
+                        timer->running = 0;
+                    }
+                    q = in || timer->running;
+                } else {
+                    if (in && !timer->previousIn && !timer->running) {
+                        timer->running = 1;
+                        timer->start = ctx->now;
+                    }
+                    if (timer->running && (ctx->now - timer->start) >= preset) {
+                        timer->running = 0;
+                    }
+                    q = timer->running;
+                }
+                timer->previousIn = in;
+
+                uint8_t mask = (uint8_t)(1U << (operand[0] & 7));
+                uint8_t* byte = &ctx->bits[LOGIC_AREA_TIMER][operand[0] >> 3];
+                *byte = q ? (uint8_t)(*byte | mask) : (uint8_t)(*byte & ~mask);
+                stack[sp - 1] = q;
+                break;
+            }
+
+            case LOGIC_OP_CTU: {
+                Logic_Counter_t* counter = &ctx->counters[operand[0]];
+                uint16_t preset;
+                memcpy(&preset, &operand[1], 2);
+                uint8_t reset = stack[--sp];
+                uint8_t count = stack[sp - 1];
+
+                if (reset) {
+                    counter->count = 0;
+                } else if (count && !counter->previousCount && counter->count < 0xFFFF) {
+                    counter->count++;
+                }
+                counter->previousCount = count;
+
+                uint8_t q = counter->count >= preset;
+                uint8_t mask = (uint8_t)(1U << (operand[0] & 7));
+                uint8_t* byte = &ctx->bits[LOGIC_AREA_COUNTER][operand[0] >> 3];
+                *byte = q ? (uint8_t)(*byte | mask) : (uint8_t)(*byte & ~mask);
+                stack[sp - 1] = q;
+                break;
+            }
+
+            case LOGIC_OP_ACMP: {
+                uint16_t value;
+                memcpy(&value, &operand[2], 2);
+                uint16_t input = ctx->analog[operand[1]];
+                uint8_t result;
+
+                switch (operand[0]) {
+                    case LOGIC_CMP_GT: result = input > value;  break;
+                    case LOGIC_CMP_LT: result = input < value;  break;
+                    case LOGIC_CMP_GE: result = input >= value; break;
+                    case LOGIC_CMP_LE: result = input <= value; break;
+                    case LOGIC_CMP_EQ: result = input == value; break;
+                    default:           result = input != value; break;
+                }
+                stack[sp++] = result;
+                break;
+            }
+
+            default:
+                return;
+        }
+    }
+}
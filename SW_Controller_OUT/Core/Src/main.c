@@ -21,10 +21,24 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include <string.h>
 #include "version.h"
 #include "debug_uart.h"
 #include "rs485_protocol.h"
+#include "perf_monitor.h"
+#include "mem_benchmark.h"
+#include "boot_profile.h"
+#include "canfd_transport.h"
+#include "health_monitor.h"
+#include "scheduler.h"
 #include "digital_output_handler.h"
+#include "output_mapping.h"
+#include "logic_engine.h"
+#include "bus_sync.h"
+#include "time_sync.h"
+#include "data_stream.h"
+#include "bus_access.h"
+#include "seg_transfer.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -50,13 +64,37 @@ UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
-static uint32_t heartbeatTimer = 0;
-static uint32_t statusLedTimer = 0;
 static char versionString[VERSION_STRING_SIZE];
+static uint8_t heldOutputs[7];          // WRITE_DO image waiting for the next SYNC
+static uint8_t heldLength = 0;
+static uint8_t logicTransferBuffer[LOGIC_PROGRAM_SIZE];  // Program received by segmented transfer
 
 /* Command handlers */
 void HandleWriteDO(const RS485_Packet_t* packet);
 void HandleReadDO(const RS485_Packet_t* packet);
+void HandleDiChange(const RS485_Packet_t* packet);
+void HandleDoMap(const RS485_Packet_t* packet);
+void HandleLogicDownload(const RS485_Packet_t* packet);
+void HandleLogicActivate(const RS485_Packet_t* packet);
+void HandleLogicStatus(const RS485_Packet_t* packet);
+void HandleLogicBench(const RS485_Packet_t* packet);
+
+/* Command handlers for SYNC snapshots */
+void HandleSync(const RS485_Packet_t* packet);
+void HandleReadSnapshot(const RS485_Packet_t* packet);
+void HandleSyncMode(const RS485_Packet_t* packet);
+void HandleTimeSync(const RS485_Packet_t* packet);
+void HandleBusBeacon(const RS485_Packet_t* packet);
+
+/* Command handlers for segmented transfers */
+void HandleSegOpen(const RS485_Packet_t* packet);
+void HandleSegRead(const RS485_Packet_t* packet);
+void HandleSegData(const RS485_Packet_t* packet);
+void HandleSegAck(const RS485_Packet_t* packet);
+
+/* Command handlers for data streams */
+void HandleStreamSubscribe(const RS485_Packet_t* packet);
+void HandleStreamStatus(const RS485_Packet_t* packet);
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -67,7 +105,28 @@ static void MX_FDCAN1_Init(void);
 static void MX_USART1_UART_Init(void);
 static void MX_USART2_UART_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void Task_OutputImage(void);
+static void Task_StatusLed(void);
+static void Write_Outputs(uint8_t* states, uint16_t length);
+static uint16_t Capture_SyncImage(uint8_t* buffer, uint16_t bufferSize);
+static void Apply_SyncOutputs(void);
+static uint8_t Commit_LogicProgram(const uint8_t* data, uint32_t size);
+
+/* Logic program, written with segmented transfers */
+static const SegTransfer_Object_t logicObject = {
+    .id = SEG_OBJECT_LOGIC,
+    .buffer = logicTransferBuffer,
+    .capacity = sizeof(logicTransferBuffer),
+    .commit = Commit_LogicProgram,
+};
+
+/* Output states, published from the output image task */
+static const Stream_DataSet_t streamDataSet = {
+    .id = STREAM_SET_DO,
+    .elementSize = 1,
+    .scanPeriodMs = 100,
+    .capture = Capture_SyncImage,
+};
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -83,12 +142,20 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  Boot_Init();
   /* USER CODE END 1 */
 
   /* MPU Configuration--------------------------------------------------------*/
   MPU_Config();
 
+  /* Enable the CPU Cache */
+
+  /* Enable I-Cache---------------------------------------------------------*/
+  SCB_EnableICache();
+
+  /* Enable D-Cache---------------------------------------------------------*/
+  SCB_EnableDCache();
+
   /* MCU Configuration--------------------------------------------------------*/
 
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
@@ -102,7 +169,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  Boot_Mark(BOOT_PHASE_CLOCKS);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -111,31 +178,92 @@ int main(void)
   MX_USART1_UART_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
+  Boot_Mark(BOOT_PHASE_PERIPHERALS);
   
-  /* Initialize hierarchical layers */
+  /* Fast start: only the RS485 link and what it depends on come up before
+   * the node answers, the rest is initialized afterwards */
   Debug_Init();
   
-  /* Print startup banner */
+  /* Outputs to their safe state before any command can arrive */
+  DigitalOutput_Init();
+  OutputMap_Init();
+  
+  /* Enable cycle counter profiling */
+  Perf_Init();
+  
+  /* Bus clock (DWT based): local time until the first TIME_SYNC */
+  TimeSync_Init();
+  
+  /* Log flash/ITCM, SRAM/DTCM/DMA region and cache timings (before RS485 RX starts) */
+  MemBench_Run();
+  
+  /* RS485 task first: frame events posted during the deferred init are kept */
+  Sched_Init();
+  Sched_AddEvent("rs485", RS485_Process, SCHED_EVENT_RS485_FRAME, SCHED_PRIORITY_COMM);
+  
+  /* Initialize RS485 protocol layer */
+  RS485_Init(RS485_ADDR_CONTROLLER_OUT);
+  Boot_Mark(BOOT_PHASE_PROTOCOL_READY);
+  
+  /* Same command set over CAN-FD (FDCAN1) */
+  CanFd_Init(RS485_ADDR_CONTROLLER_OUT, CANFD_GROUP_DIGITAL_OUT);
+  Sched_AddEvent("canfd", CanFd_Process, SCHED_EVENT_CANFD_FRAME, SCHED_PRIORITY_COMM);
+  
+  /* Deferred init: frames received meanwhile are served between the steps,
+   * output commands once their handlers are registered */
   Version_GetString(versionString, VERSION_STRING_SIZE);
   DEBUG_INFO("===========================================");
   DEBUG_INFO("  %s", versionString);
   DEBUG_INFO("===========================================");
+  RS485_Process();
   
-  /* Initialize digital output handler */
-  DigitalOutput_Init();
+  /* Compute health from live metrics (after RS485_Init) */
+  Health_Init();
   
-  /* Initialize RS485 protocol layer */
-  RS485_Init(RS485_ADDR_CONTROLLER_OUT);
+  /* Logic engine (after CanFd_Init: subscribes to the input images) */
+  Logic_Init();
+  BusSync_Init(Capture_SyncImage, Apply_SyncOutputs);
+  SegTransfer_Init();
+  SegTransfer_Register(&logicObject);
+  BusAccess_Init(RS485_ADDR_CONTROLLER_OUT);
+  Stream_Init();
+  Stream_RegisterDataSet(&streamDataSet);
   
   /* Register command handlers */
   RS485_RegisterCommandHandler(CMD_WRITE_DO, HandleWriteDO);
   RS485_RegisterCommandHandler(CMD_READ_DO, HandleReadDO);
+  RS485_RegisterCommandHandler(CMD_DI_CHANGE, HandleDiChange);
+  RS485_RegisterCommandHandler(CMD_DO_MAP, HandleDoMap);
+  RS485_RegisterCommandHandler(CMD_LOGIC_DOWNLOAD, HandleLogicDownload);
+  RS485_RegisterCommandHandler(CMD_LOGIC_ACTIVATE, HandleLogicActivate);
+  RS485_RegisterCommandHandler(CMD_LOGIC_STATUS, HandleLogicStatus);
+  RS485_RegisterCommandHandler(CMD_LOGIC_BENCH, HandleLogicBench);
+  RS485_RegisterCommandHandler(CMD_SYNC, HandleSync);
+  RS485_RegisterCommandHandler(CMD_READ_SNAPSHOT, HandleReadSnapshot);
+  RS485_RegisterCommandHandler(CMD_SYNC_MODE, HandleSyncMode);
+  RS485_RegisterCommandHandler(CMD_TIME_SYNC, HandleTimeSync);
+  RS485_RegisterCommandHandler(CMD_BUS_BEACON, HandleBusBeacon);
+  RS485_RegisterCommandHandler(CMD_STREAM_SUBSCRIBE, HandleStreamSubscribe);
+  RS485_RegisterCommandHandler(CMD_STREAM_STATUS, HandleStreamStatus);
+  RS485_RegisterCommandHandler(CMD_SEG_OPEN, HandleSegOpen);
+  RS485_RegisterCommandHandler(CMD_SEG_READ, HandleSegRead);
+  RS485_RegisterCommandHandler(CMD_SEG_DATA, HandleSegData);
+  RS485_RegisterCommandHandler(CMD_SEG_ACK, HandleSegAck);
   
+  /* Remaining tasks, all periodic */
+  Sched_AddPeriodic("health", Health_Process, 1, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("time_sync", TimeSync_Process, 1000, SCHED_PRIORITY_HOUSEKEEPING);
+  Sched_AddPeriodic("stream", Stream_Process, 1, SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("seg_xfer", SegTransfer_Process, 1, SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("do_image", Task_OutputImage, 100, SCHED_PRIORITY_IO);
+  Sched_AddPeriodic("do_map", OutputMap_Process, 10, SCHED_PRIORITY_COMM);
+  Sched_AddPeriodic("logic", Logic_Scan, LOGIC_SCAN_PERIOD_MS, SCHED_PRIORITY_IO);
+  Sched_AddPeriodic("status_led", Task_StatusLed, 500, SCHED_PRIORITY_HOUSEKEEPING);
+  
+  Boot_Mark(BOOT_PHASE_INIT_DONE);
+  Boot_Log();
   DEBUG_INFO("System initialization complete");
   DEBUG_INFO("Entering main loop...");
-  
-  heartbeatTimer = HAL_GetTick();
-  statusLedTimer = HAL_GetTick();
 
   /* USER CODE END 2 */
 
@@ -146,24 +274,8 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    
-    /* Process RS485 communication */
-    RS485_Process();
-    
-    /* Status LED blink (every 500ms) */
-    if (HAL_GetTick() - statusLedTimer >= 500) {
-      statusLedTimer = HAL_GetTick();
-      HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_1); // Status LED
-    }
-    
-    /* Periodic heartbeat (verbose output disabled) */
-    if (HAL_GetTick() - heartbeatTimer >= 10000) {
-      heartbeatTimer = HAL_GetTick();
-      // Heartbeat silently tracked
-    }
-    
-    /* Small delay to prevent CPU hogging */
-    HAL_Delay(1);
+    /* Run the task scheduler (does not return) */
+    Sched_Run();
   }
   /* USER CODE END 3 */
 }
@@ -235,33 +347,33 @@ static void MX_FDCAN1_Init(void)
 
   /* USER CODE END FDCAN1_Init 1 */
   hfdcan1.Instance = FDCAN1;
-  hfdcan1.Init.FrameFormat = FDCAN_FRAME_CLASSIC;
+  hfdcan1.Init.FrameFormat = FDCAN_FRAME_FD_BRS;
   hfdcan1.Init.Mode = FDCAN_MODE_NORMAL;
-  hfdcan1.Init.AutoRetransmission = DISABLE;
-  hfdcan1.Init.TransmitPause = DISABLE;
+  hfdcan1.Init.AutoRetransmission = ENABLE;
+  hfdcan1.Init.TransmitPause = ENABLE;
   hfdcan1.Init.ProtocolException = DISABLE;
-  hfdcan1.Init.NominalPrescaler = 16;
-  hfdcan1.Init.NominalSyncJumpWidth = 1;
-  hfdcan1.Init.NominalTimeSeg1 = 1;
-  hfdcan1.Init.NominalTimeSeg2 = 1;
+  hfdcan1.Init.NominalPrescaler = 1;
+  hfdcan1.Init.NominalSyncJumpWidth = 10;
+  hfdcan1.Init.NominalTimeSeg1 = 39;
+  hfdcan1.Init.NominalTimeSeg2 = 10;
   hfdcan1.Init.DataPrescaler = 1;
-  hfdcan1.Init.DataSyncJumpWidth = 1;
-  hfdcan1.Init.DataTimeSeg1 = 1;
-  hfdcan1.Init.DataTimeSeg2 = 1;
+  hfdcan1.Init.DataSyncJumpWidth = 2;
+  hfdcan1.Init.DataTimeSeg1 = 7;
+  hfdcan1.Init.DataTimeSeg2 = 2;
   hfdcan1.Init.MessageRAMOffset = 0;
-  hfdcan1.Init.StdFiltersNbr = 0;
-  hfdcan1.Init.ExtFiltersNbr = 0;
-  hfdcan1.Init.RxFifo0ElmtsNbr = 0;
-  hfdcan1.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_8;
-  hfdcan1.Init.RxFifo1ElmtsNbr = 0;
-  hfdcan1.Init.RxFifo1ElmtSize = FDCAN_DATA_BYTES_8;
+  hfdcan1.Init.StdFiltersNbr = 4;
+  hfdcan1.Init.ExtFiltersNbr = 10;
+  hfdcan1.Init.RxFifo0ElmtsNbr = 32;
+  hfdcan1.Init.RxFifo0ElmtSize = FDCAN_DATA_BYTES_64;
+  hfdcan1.Init.RxFifo1ElmtsNbr = 8;
+  hfdcan1.Init.RxFifo1ElmtSize = FDCAN_DATA_BYTES_64;
   hfdcan1.Init.RxBuffersNbr = 0;
   hfdcan1.Init.RxBufferSize = FDCAN_DATA_BYTES_8;
   hfdcan1.Init.TxEventsNbr = 0;
-  hfdcan1.Init.TxBuffersNbr = 0;
-  hfdcan1.Init.TxFifoQueueElmtsNbr = 0;
+  hfdcan1.Init.TxBuffersNbr = 2;
+  hfdcan1.Init.TxFifoQueueElmtsNbr = 8;
   hfdcan1.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
-  hfdcan1.Init.TxElmtSize = FDCAN_DATA_BYTES_8;
+  hfdcan1.Init.TxElmtSize = FDCAN_DATA_BYTES_64;
   if (HAL_FDCAN_Init(&hfdcan1) != HAL_OK)
   {
     Error_Handler();
@@ -512,6 +624,40 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
+/**
+ * @brief  CAN-FD process image task (100 ms): output states
+ * @retval None
+ */
+static void Task_OutputImage(void)
+{
+    uint8_t image[7]; // 56 outputs = 7 bytes
+    DigitalOutput_GetAll(image, sizeof(image));
+    CanFd_PublishImage(image, sizeof(image));
+    
+    /* Subscribed streams due in this slot */
+    Stream_Service();
+}
+
+/**
+ * @brief  Status LED blink task (500 ms)
+ * @retval None
+ */
+static void Task_StatusLed(void)
+{
+    HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_1); // Status LED
+}
+
+/**
+ * @brief  UART error callback (debug and RS485 ports)
+ * @param  huart: UART handle
+ * @retval None
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    Debug_UART_ErrorCallback(huart);
+    RS485_UART_ErrorCallback(huart);
+}
+
 /**
  * @brief  Handle Write Digital Output command
  * @param  packet: Received packet
@@ -519,8 +665,19 @@ static void MX_GPIO_Init(void)
  */
 void HandleWriteDO(const RS485_Packet_t* packet)
 {
-    /* Set outputs from received data */
-    DigitalOutput_SetAll(packet->data, packet->length);
+    uint8_t outputData[7]; // 56 outputs = 7 bytes
+    uint16_t length = (packet->length < sizeof(outputData)) ? packet->length : sizeof(outputData);
+    memcpy(outputData, packet->data, length);
+    
+    if (BusSync_OutputsOnSync()) {
+        /* Held until the next SYNC, later writes replace earlier ones */
+        memcpy(heldOutputs, outputData, length);
+        if (length > heldLength) {
+            heldLength = length;
+        }
+    } else {
+        Write_Outputs(outputData, length);
+    }
     
     /* Send confirmation response */
     RS485_SendResponse(packet->srcAddr, CMD_DO_RESPONSE, NULL, 0);
@@ -539,6 +696,356 @@ void HandleReadDO(const RS485_Packet_t* packet)
     RS485_SendResponse(packet->srcAddr, CMD_DO_RESPONSE, outputData, sizeof(outputData));
 }
 
+/**
+ * @brief  Handle DI Change event (peer input controller, CAN-FD)
+ * @note   Data: [input states:7][changed inputs:7]. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleDiChange(const RS485_Packet_t* packet)
+{
+    OutputMap_Apply(packet->srcAddr, packet->data, packet->length);
+    Logic_UpdateInputs(packet->srcAddr, packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle DO Map command (input to output mapping table)
+ * @note   Data: [operation] (OUTPUT_MAP_OP_xxx), for SET followed by the
+ *         table. Response: see output_mapping.h
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleDoMap(const RS485_Packet_t* packet)
+{
+    uint8_t operation = (packet->length > 0) ? packet->data[0] : OUTPUT_MAP_OP_READ;
+    
+    if (operation == OUTPUT_MAP_OP_SET) {
+        if (!OutputMap_SetEntries(&packet->data[1], packet->length - 1)) {
+            RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+            return;
+        }
+    } else if (operation == OUTPUT_MAP_OP_CLEAR_LATCHES) {
+        OutputMap_ClearLatches();
+    } else if (operation != OUTPUT_MAP_OP_READ) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    uint8_t mapData[OUTPUT_MAP_RESPONSE_SIZE];
+    uint16_t length = OutputMap_Read(mapData, sizeof(mapData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_DO_MAP_RESPONSE, mapData, length);
+}
+
+/**
+ * @brief  Handle Logic Download command (one block of the next program)
+ * @note   Data: [offset:2][bytecode]. Response: [result][next offset:2]
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleLogicDownload(const RS485_Packet_t* packet)
+{
+    uint8_t response[3];
+    uint16_t offset = 0;
+    uint16_t nextOffset = 0;
+    
+    if (packet->length < 2) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    memcpy(&offset, &packet->data[0], 2);
+    response[0] = Logic_Download(offset, &packet->data[2], packet->length - 2, &nextOffset);
+    memcpy(&response[1], &nextOffset, 2);
+    
+    RS485_SendResponse(packet->srcAddr, CMD_LOGIC_DOWNLOAD_RESPONSE, response, sizeof(response));
+}
+
+/**
+ * @brief  Handle Logic Activate command (check and swap in the downloaded program)
+ * @note   Data: [length:2][crc16:2]. Response: [result][error offset:2]
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleLogicActivate(const RS485_Packet_t* packet)
+{
+    uint8_t response[3];
+    uint16_t length = 0;
+    uint16_t crc = 0;
+    uint16_t errorOffset = 0;
+    
+    if (packet->length < 4) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    memcpy(&length, &packet->data[0], 2);
+    memcpy(&crc, &packet->data[2], 2);
+    response[0] = Logic_Activate(length, crc, &errorOffset);
+    memcpy(&response[1], &errorOffset, 2);
+    
+    RS485_SendResponse(packet->srcAddr, CMD_LOGIC_ACTIVATE_RESPONSE, response, sizeof(response));
+}
+
+/**
+ * @brief  Handle Logic Status command (read, run, stop, reset statistics)
+ * @note   Data: optional [operation] (LOGIC_CTRL_xxx). Response: see Logic_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleLogicStatus(const RS485_Packet_t* packet)
+{
+    if (packet->length >= 1) {
+        if (packet->data[0] > LOGIC_CTRL_RESET_STATS) {
+            RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+            return;
+        }
+        Logic_Control(packet->data[0]);
+    }
+    
+    uint8_t statusData[LOGIC_STATUS_SIZE];
+    uint16_t length = Logic_ReadStatus(statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_LOGIC_STATUS_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle Logic Bench command (time 1000 instructions)
+ * @note   Response: see Logic_Benchmark
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleLogicBench(const RS485_Packet_t* packet)
+{
+    uint8_t benchData[LOGIC_BENCH_SIZE];
+    uint16_t length = Logic_Benchmark(benchData, sizeof(benchData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_LOGIC_BENCH_RESPONSE, benchData, length);
+}
+
+/**
+ * @brief  Handle SYNC broadcast (latch the snapshot)
+ * @note   Data: [sequence:2]. No response: sent to all nodes at once
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSync(const RS485_Packet_t* packet)
+{
+    BusSync_Latch(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Read Snapshot command (image frozen by the last SYNC)
+ * @note   Response: see BusSync_ReadSnapshot
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleReadSnapshot(const RS485_Packet_t* packet)
+{
+    uint8_t snapshotData[BUS_SYNC_SNAPSHOT_SIZE];
+    uint16_t length = BusSync_ReadSnapshot(snapshotData, sizeof(snapshotData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SNAPSHOT_RESPONSE, snapshotData, length);
+}
+
+/**
+ * @brief  Handle SYNC Mode command (output mode and sync statistics)
+ * @note   Data: empty to read, or [mode] (BUS_SYNC_MODE_xxx).
+ *         Response: see BusSync_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSyncMode(const RS485_Packet_t* packet)
+{
+    if (packet->length > 0 && !BusSync_SetMode(packet->data[0])) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+        return;
+    }
+    
+    uint8_t statusData[BUS_SYNC_STATUS_SIZE];
+    uint16_t length = BusSync_ReadStatus(statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SYNC_MODE_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle TIME_SYNC broadcast (master time for the bus clock)
+ * @note   Data: [sequence][flags][master time us:8]. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleTimeSync(const RS485_Packet_t* packet)
+{
+    TimeSync_HandleFrame(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle BUS_BEACON broadcast (TDMA cycle and slots)
+ * @note   Data: see BusAccess_HandleBeacon. No response
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleBusBeacon(const RS485_Packet_t* packet)
+{
+    BusAccess_HandleBeacon(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Stream Subscribe command (subscribe, renew, cancel)
+ * @note   Data/response: see Stream_Subscribe
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleStreamSubscribe(const RS485_Packet_t* packet)
+{
+    uint8_t subscribeData[STREAM_SUBSCRIBE_SIZE];
+    uint16_t length = Stream_Subscribe(packet->data, packet->length, packet->srcAddr,
+                                       subscribeData, sizeof(subscribeData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_STREAM_SUBSCRIBE_RESPONSE, subscribeData, length);
+}
+
+/**
+ * @brief  Handle Stream Status command (active streams, renews leases)
+ * @note   Response: see Stream_ReadStatus
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleStreamStatus(const RS485_Packet_t* packet)
+{
+    uint8_t statusData[STREAM_STATUS_SIZE];
+    uint16_t length = Stream_ReadStatus(packet->srcAddr, statusData, sizeof(statusData));
+    
+    RS485_SendResponse(packet->srcAddr, CMD_STREAM_STATUS_RESPONSE, statusData, length);
+}
+
+/**
+ * @brief  Handle Segmented Transfer Open command
+ * @note   Data/response: see SegTransfer_Open
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegOpen(const RS485_Packet_t* packet)
+{
+    uint8_t openData[SEG_TRANSFER_OPEN_SIZE];
+    uint16_t length = SegTransfer_Open(packet->data, packet->length, openData, sizeof(openData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SEG_OPEN_RESPONSE, openData, length);
+}
+
+/**
+ * @brief  Handle Segmented Transfer Read command (acknowledge + request window)
+ * @note   Data: see SegTransfer_RequestWindow. Answered with CMD_SEG_DATA
+ *         segments from the seg_transfer task, errors right away
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegRead(const RS485_Packet_t* packet)
+{
+    uint8_t result = SegTransfer_RequestWindow(packet->data, packet->length, packet->srcAddr);
+    if (result == SEG_RESULT_SIZE) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+    } else if (result != SEG_RESULT_OK) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_PARAM);
+    }
+}
+
+/**
+ * @brief  Handle Segmented Transfer Data (write segment from the master)
+ * @note   Data: [transfer id][offset:4][data]. No response: segments are
+ *         streamed, CMD_SEG_ACK reports what arrived
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegData(const RS485_Packet_t* packet)
+{
+    SegTransfer_ReceiveData(packet->data, packet->length);
+}
+
+/**
+ * @brief  Handle Segmented Transfer Acknowledge command
+ * @note   Data/response: see SegTransfer_Acknowledge
+ * @param  packet: Received packet
+ * @retval None
+ */
+void HandleSegAck(const RS485_Packet_t* packet)
+{
+    uint8_t ackData[SEG_TRANSFER_ACK_SIZE];
+    uint16_t length = SegTransfer_Acknowledge(packet->data, packet->length, ackData, sizeof(ackData));
+    if (length == 0) {
+        RS485_SendError(packet->srcAddr, RS485_ERR_INVALID_LENGTH);
+        return;
+    }
+    
+    RS485_SendResponse(packet->srcAddr, CMD_SEG_ACK_RESPONSE, ackData, length);
+}
+
+/**
+ * @brief  Set outputs from a WRITE_DO image, except those driven by the
+ *         mapping or the logic program
+ * @param  states: Output image, 1 bit per output (filtered in place)
+ * @param  length: Image length in bytes
+ * @retval None
+ */
+static void Write_Outputs(uint8_t* states, uint16_t length)
+{
+    OutputMap_FilterWrite(states, length);
+    Logic_FilterWrite(states, length);
+    DigitalOutput_SetAll(states, length);
+}
+
+/**
+ * @brief  Capture the SYNC snapshot: output states (56 outputs = 7 bytes)
+ * @param  buffer: Output buffer
+ * @param  bufferSize: Buffer size
+ * @retval Image length
+ */
+static uint16_t Capture_SyncImage(uint8_t* buffer, uint16_t bufferSize)
+{
+    uint16_t length = (bufferSize < sizeof(heldOutputs)) ? bufferSize : sizeof(heldOutputs);
+    DigitalOutput_GetAll(buffer, length);
+    return length;
+}
+
+/**
+ * @brief  Apply the WRITE_DO image held since the previous SYNC
+ * @retval None
+ */
+static void Apply_SyncOutputs(void)
+{
+    if (heldLength > 0) {
+        Write_Outputs(heldOutputs, heldLength);
+        heldLength = 0;
+    }
+}
+
+/**
+ * @brief  Download and activate a logic program received by segmented transfer
+ * @note   Same checks as CMD_LOGIC_DOWNLOAD + CMD_LOGIC_ACTIVATE
+ * @param  data: Program
+ * @param  size: Program length
+ * @retval LOGIC_OK or LOGIC_ERR_xxx (object code of the CMD_SEG_ACK response)
+ */
+static uint8_t Commit_LogicProgram(const uint8_t* data, uint32_t size)
+{
+    uint16_t nextOffset;
+    uint16_t errorOffset;
+    
+    uint8_t result = Logic_Download(0, data, (uint16_t)size, &nextOffset);
+    if (result == LOGIC_OK) {
+        result = Logic_Activate((uint16_t)size, RS485_CalculateCRC(data, (uint16_t)size), &errorOffset);
+    }
+    return result;
+}
+
 /* USER CODE END 4 */
 
  /* MPU Configuration */
@@ -564,6 +1071,21 @@ void MPU_Config(void)
   MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
   MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
 
+  HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /** Initializes and configures the Region and the memory to be protected
+  */
+  MPU_InitStruct.Number = MPU_REGION_NUMBER1;
+  MPU_InitStruct.BaseAddress = 0x30000000;
+  MPU_InitStruct.Size = MPU_REGION_SIZE_32KB;
+  MPU_InitStruct.SubRegionDisable = 0x0;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+  MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+
   HAL_MPU_ConfigRegion(&MPU_InitStruct);
   /* Enables the MPU */
   HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
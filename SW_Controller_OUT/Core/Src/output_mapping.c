@@ -0,0 +1,267 @@
+/**
+ ******************************************************************************
+ * @file           : output_mapping.c
+ * @brief          : Peer-to-Peer Output Mapping Implementation
+ ******************************************************************************
+ * @attention
+ *
+ * Apply (canfd task), Process and the command handlers all run at
+ * SCHED_PRIORITY_COMM, so the table and the outputs need no locking.
+ *
+ ******************************************************************************
+ */
+
+#include "output_mapping.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Entry With Its Source State */
+typedef struct {
+    OutputMapEntry_t map;
+    uint8_t online;                 // Source heard within OUTPUT_MAP_SOURCE_TIMEOUT_MS
+    uint32_t lastSeen;
+} OutputMap_Slot_t;
+
+/* Private Variables */
+static const OutputMapEntry_t defaultEntries[] = OUTPUT_MAP_DEFAULTS;
+static OutputMap_Slot_t slots[OUTPUT_MAP_MAX_ENTRIES];
+static uint8_t entryCount = 0;
+static OutputMap_Stats_t stats = {0};
+
+/* Private Function Prototypes */
+static uint8_t Valid_Entry(const OutputMapEntry_t* entry);
+static void Drive_Output(uint8_t output, uint8_t state);
+
+/**
+ * @brief  Load the default mapping (after DigitalOutput_Init)
+ * @retval None
+ */
+void OutputMap_Init(void)
+{
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+    entryCount = 0;
+
+    uint8_t defaults = OUTPUT_MAP_DEFAULT_COUNT;
+    for (uint8_t i = 0; i < defaults && i < OUTPUT_MAP_MAX_ENTRIES; i++) {
+        if (Valid_Entry(&defaultEntries[i])) {
+            slots[entryCount++].map = defaultEntries[i];
+        }
+    }
+
+    DEBUG_INFO("Output mapping: %d entr%s", entryCount, (entryCount == 1) ? "y" : "ies");
+}
+
+/**
+ * @brief  Source timeout check (periodic task)
+ * @note   Plain outputs of a silent source go to 0, latched ones are kept
+ * @retval None
+ */
+void OutputMap_Process(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    for (uint8_t i = 0; i < entryCount; i++) {
+        OutputMap_Slot_t* slot = &slots[i];
+        if (!slot->online || (now - slot->lastSeen) < OUTPUT_MAP_SOURCE_TIMEOUT_MS) {
+            continue;
+        }
+
+        slot->online = 0;
+        stats.timeouts++;
+        if (!(slot->map.flags & OUTPUT_MAP_LATCH)) {
+            Drive_Output(slot->map.output, 0);
+        }
+        DEBUG_WARNING("Output mapping: source 0x%02X silent, DO%d to safe state",
+                      slot->map.source, slot->map.output);
+    }
+}
+
+/**
+ * @brief  Apply a CMD_DI_CHANGE frame
+ * @param  source: Sending input controller
+ * @param  data: [input states:7][changed inputs:7] (only the states are used)
+ * @param  length: Data length
+ * @retval None
+ */
+ITCM_TEXT void OutputMap_Apply(uint8_t source, const uint8_t* data, uint16_t length)
+{
+    uint8_t matched = 0;
+    uint32_t now = HAL_GetTick();
+
+    if (length < OUTPUT_MAP_STATE_BYTES) {
+        stats.ignored++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < entryCount; i++) {
+        OutputMap_Slot_t* slot = &slots[i];
+        if (slot->map.source != source) {
+            continue;
+        }
+
+        uint8_t value = (data[slot->map.input / 8] >> (slot->map.input % 8)) & 0x01;
+        if (slot->map.flags & OUTPUT_MAP_INVERT) {
+            value ^= 0x01;
+        }
+
+        if (!(slot->map.flags & OUTPUT_MAP_LATCH)) {
+            Drive_Output(slot->map.output, value);
+        } else if (value) {
+            Drive_Output(slot->map.output, 1);
+        }
+
+        slot->online = 1;
+        slot->lastSeen = now;
+        matched = 1;
+    }
+
+    if (matched) {
+        stats.frames++;
+    } else {
+        stats.ignored++;
+    }
+}
+
+/**
+ * @brief  Replace the mapping table (CMD_DO_MAP, OUTPUT_MAP_OP_SET)
+ * @note   Outputs no longer mapped keep their state
+ * @param  data: [count] then per entry [source][input][output][flags]
+ * @param  length: Data length
+ * @retval 1 if applied, 0 if invalid (table unchanged)
+ */
+uint8_t OutputMap_SetEntries(const uint8_t* data, uint16_t length)
+{
+    if (length < 1 || data[0] > OUTPUT_MAP_MAX_ENTRIES ||
+        length != 1U + (uint16_t)data[0] * OUTPUT_MAP_ENTRY_SIZE) {
+        return 0;
+    }
+
+    uint8_t count = data[0];
+    uint8_t usedOutputs[(NUM_DIGITAL_OUTPUTS + 7) / 8] = {0};
+
+    for (uint8_t i = 0; i < count; i++) {
+        OutputMapEntry_t entry;
+        memcpy(&entry, &data[1 + i * OUTPUT_MAP_ENTRY_SIZE], OUTPUT_MAP_ENTRY_SIZE);
+        if (!Valid_Entry(&entry) || (usedOutputs[entry.output / 8] & (1 << (entry.output % 8)))) {
+            return 0;
+        }
+        usedOutputs[entry.output / 8] |= (1 << (entry.output % 8));
+    }
+
+    memset(slots, 0, sizeof(slots));
+    for (uint8_t i = 0; i < count; i++) {
+        memcpy(&slots[i].map, &data[1 + i * OUTPUT_MAP_ENTRY_SIZE], OUTPUT_MAP_ENTRY_SIZE);
+    }
+    entryCount = count;
+
+    DEBUG_INFO("Output mapping: %d entr%s set", entryCount, (entryCount == 1) ? "y" : "ies");
+    return 1;
+}
+
+/**
+ * @brief  Clear all latched outputs (CMD_DO_MAP, OUTPUT_MAP_OP_CLEAR_LATCHES)
+ * @retval None
+ */
+void OutputMap_ClearLatches(void)
+{
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (slots[i].map.flags & OUTPUT_MAP_LATCH) {
+            Drive_Output(slots[i].map.output, 0);
+        }
+    }
+}
+
+/**
+ * @brief  Keep mapped outputs out of a CMD_WRITE_DO image
+ * @note   Bits of outputs with a plain (not latched) entry are replaced by
+ *         their current state
+ * @param  states: Output image, 1 bit per output
+ * @param  size: Image size in bytes
+ * @retval None
+ */
+void OutputMap_FilterWrite(uint8_t* states, uint16_t size)
+{
+    for (uint8_t i = 0; i < entryCount; i++) {
+        const OutputMapEntry_t* entry = &slots[i].map;
+        if ((entry->flags & OUTPUT_MAP_LATCH) || entry->output / 8 >= size) {
+            continue;
+        }
+
+        uint8_t bit = (uint8_t)(1 << (entry->output % 8));
+        if (DigitalOutput_Get(entry->output)) {
+            states[entry->output / 8] |= bit;
+        } else {
+            states[entry->output / 8] &= (uint8_t)~bit;
+        }
+    }
+}
+
+/**
+ * @brief  Read the mapping table (CMD_DO_MAP response)
+ * @note   Layout: see output_mapping.h
+ * @param  buffer: Output buffer (OUTPUT_MAP_RESPONSE_SIZE)
+ * @param  bufferSize: Buffer size
+ * @retval Bytes written, 0 if the buffer is too small
+ */
+uint16_t OutputMap_Read(uint8_t* buffer, uint16_t bufferSize)
+{
+    if (bufferSize < OUTPUT_MAP_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    uint16_t length = OUTPUT_MAP_HEADER_SIZE;
+
+    buffer[0] = entryCount;
+    memcpy(&buffer[1], &stats.frames, 4);
+    memcpy(&buffer[5], &stats.applied, 4);
+    memcpy(&buffer[9], &stats.timeouts, 4);
+    memcpy(&buffer[13], &stats.ignored, 4);
+
+    for (uint8_t i = 0; i < entryCount; i++) {
+        memcpy(&buffer[length], &slots[i].map, OUTPUT_MAP_ENTRY_SIZE);
+        if (slots[i].online) {
+            buffer[length + 3] |= OUTPUT_MAP_ONLINE;
+        }
+        length += OUTPUT_MAP_ENTRY_SIZE;
+    }
+
+    return length;
+}
+
+/**
+ * @brief  Get mapping statistics
+ * @retval Statistics
+ */
+const OutputMap_Stats_t* OutputMap_GetStats(void)
+{
+    return &stats;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Check a mapping entry
+ * @param  entry: Entry
+ * @retval 1 if valid
+ */
+static uint8_t Valid_Entry(const OutputMapEntry_t* entry)
+{
+    return entry->input < OUTPUT_MAP_STATE_BYTES * 8 &&
+           entry->output < NUM_DIGITAL_OUTPUTS &&
+           (entry->flags & ~(OUTPUT_MAP_INVERT | OUTPUT_MAP_LATCH)) == 0;
+}
+
+/**
+ * @brief  Set an output if its state changes
+ * @param  output: Output number
+ * @param  state: New state
+ * @retval None
+ */
+static void Drive_Output(uint8_t output, uint8_t state)
+{
+    if (DigitalOutput_Get(output) != state) {
+        DigitalOutput_Set(output, state);
+        stats.applied++;
+    }
+}
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file           : perf_monitor.c
+ * @brief          : DWT Cycle Counter Profiling Implementation
+ ******************************************************************************
+ */
+
+#include "perf_monitor.h"
+#include "debug_uart.h"
+#include <string.h>
+
+/* Private Variables */
+static PerfProbe_t probes[PERF_MAX_PROBES];
+static uint8_t probeCount = PERF_PROBE_FIXED_COUNT;    // Fixed probes + allocated command probes
+static int8_t commandProbe[256];                        // Command -> probe index (-1 = none)
+static uint32_t overheadCycles = 0;                     // Cost of an empty START/STOP pair
+
+/* Private Function Prototypes */
+static void Reset_Probe(PerfProbe_t* probe);
+static void Update_Probe(PerfProbe_t* probe, uint32_t cycles);
+
+/**
+ * @brief  Initialize profiling (enable the DWT cycle counter)
+ * @retval None
+ */
+void Perf_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;          // Unlock DWT (Cortex-M7)
+    /* CYCCNT is not cleared: it runs from Reset_Handler (boot timestamps) */
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    memset(commandProbe, -1, sizeof(commandProbe));
+    probeCount = PERF_PROBE_FIXED_COUNT;
+    for (uint8_t i = 0; i < PERF_PROBE_FIXED_COUNT; i++) {
+        probes[i].id = i;
+        probes[i].command = 0;
+    }
+
+    /* Calibrate the measurement overhead (back-to-back reads, best of 8) */
+    overheadCycles = UINT32_MAX;
+    for (uint8_t i = 0; i < 8; i++) {
+        uint32_t start = DWT->CYCCNT;
+        uint32_t cycles = DWT->CYCCNT - start;
+        if (cycles < overheadCycles) {
+            overheadCycles = cycles;
+        }
+    }
+
+    Perf_Reset();
+
+    DEBUG_INFO("Perf monitor initialized: %lu MHz, overhead %lu cycles",
+               SystemCoreClock / 1000000U, overheadCycles);
+}
+
+/**
+ * @brief  Record one sample of a fixed probe
+ * @param  probe: PerfProbeId_t
+ * @param  startCycles: PERF_START() value at the start of the section
+ * @retval None
+ */
+ITCM_TEXT void Perf_Record(uint8_t probe, uint32_t startCycles)
+{
+    uint32_t cycles = DWT->CYCCNT - startCycles;
+
+    if (probe < PERF_PROBE_FIXED_COUNT) {
+        Update_Probe(&probes[probe], cycles);
+    }
+}
+
+/**
+ * @brief  Record one sample of an RS485 command handler
+ * @note   Probes are allocated on first use; commands beyond
+ *         PERF_MAX_PROBES are not recorded.
+ * @param  command: RS485 command code
+ * @param  startCycles: PERF_START() value before the handler
+ * @retval None
+ */
+void Perf_RecordCommand(uint8_t command, uint32_t startCycles)
+{
+    uint32_t cycles = DWT->CYCCNT - startCycles;
+    int8_t index = commandProbe[command];
+
+    if (index < 0) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        index = commandProbe[command];
+        if (index < 0 && probeCount < PERF_MAX_PROBES) {
+            index = (int8_t)probeCount;
+            probes[index].id = PERF_PROBE_COMMAND;
+            probes[index].command = command;
+            Reset_Probe(&probes[index]);
+            commandProbe[command] = index;
+            probeCount++;
+        }
+
+        __set_PRIMASK(primask);
+
+        if (index < 0) {
+            return;
+        }
+    }
+
+    Update_Probe(&probes[index], cycles);
+}
+
+/**
+ * @brief  Clear the statistics of all probes (allocations are kept)
+ * @retval None
+ */
+void Perf_Reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint8_t i = 0; i < probeCount; i++) {
+        Reset_Probe(&probes[i]);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Get number of probes in use
+ * @retval Probe count
+ */
+uint8_t Perf_GetProbeCount(void)
+{
+    return probeCount;
+}
+
+/**
+ * @brief  Read one probe (CMD_GET_PERF response)
+ * @note   Layout: [index][probe count][CPU MHz:2][id][command][count:4]
+ *         [min:4][max:4][total:8][bins], then bins x [count:4]. Cycles
+ *         are measurement-overhead corrected.
+ * @param  index: Probe index (0 to probe count - 1)
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 = invalid index)
+ */
+uint16_t Perf_Read(uint8_t index, uint8_t* buffer, uint16_t bufferSize)
+{
+    if (index >= probeCount || bufferSize < PERF_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    /* Consistent snapshot: probes are updated from interrupts */
+    PerfProbe_t probe;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    probe = probes[index];
+    __set_PRIMASK(primask);
+
+    uint16_t mhz = (uint16_t)(SystemCoreClock / 1000000U);
+    uint32_t minCycles = (probe.count > 0) ? probe.minCycles : 0;
+
+    buffer[0] = index;
+    buffer[1] = probeCount;
+    memcpy(&buffer[2], &mhz, 2);
+    buffer[4] = probe.id;
+    buffer[5] = probe.command;
+    memcpy(&buffer[6], &probe.count, 4);
+    memcpy(&buffer[10], &minCycles, 4);
+    memcpy(&buffer[14], &probe.maxCycles, 4);
+    memcpy(&buffer[18], &probe.totalCycles, 8);
+    buffer[26] = PERF_HISTOGRAM_BINS;
+    memcpy(&buffer[PERF_RESPONSE_HEADER_SIZE], probe.histogram, PERF_HISTOGRAM_BINS * 4);
+
+    return PERF_RESPONSE_SIZE;
+}
+
+/* Private Functions */
+
+/**
+ * @brief  Clear the statistics of a probe
+ * @param  probe: Probe
+ * @retval None
+ */
+static void Reset_Probe(PerfProbe_t* probe)
+{
+    probe->count = 0;
+    probe->minCycles = UINT32_MAX;
+    probe->maxCycles = 0;
+    probe->totalCycles = 0;
+    memset(probe->histogram, 0, sizeof(probe->histogram));
+}
+
+/**
+ * @brief  Add one sample to a probe
+ * @param  probe: Probe
+ * @param  cycles: Measured cycles (including overhead)
+ * @retval None
+ */
+static void Update_Probe(PerfProbe_t* probe, uint32_t cycles)
+{
+    cycles = (cycles > overheadCycles) ? (cycles - overheadCycles) : 0;
+
+    /* log2 bin: 0 cycles -> bin 0, [2^(n-1), 2^n) -> bin n */
+    uint32_t bin = 32U - __CLZ(cycles);
+    if (bin >= PERF_HISTOGRAM_BINS) {
+        bin = PERF_HISTOGRAM_BINS - 1;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    probe->count++;
+    probe->totalCycles += cycles;
+    if (cycles < probe->minCycles) {
+        probe->minCycles = cycles;
+    }
+    if (cycles > probe->maxCycles) {
+        probe->maxCycles = cycles;
+    }
+    probe->histogram[bin]++;
+
+    __set_PRIMASK(primask);
+}
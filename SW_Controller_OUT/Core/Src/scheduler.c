@@ -0,0 +1,600 @@
+/**
+ ******************************************************************************
+ * @file           : scheduler.c
+ * @brief          : Event-Driven Scheduler Implementation
+ ******************************************************************************
+ */
+
+#include "scheduler.h"
+#include "perf_monitor.h"
+#include "debug_uart.h"
+#include <string.h>
+
+#if SCHED_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+/* Task Control Block */
+typedef struct {
+    const char* name;
+    SchedTaskFunction_t function;
+    uint32_t periodMs;              // 0 = event task
+    uint32_t events;                // Event task: triggering events
+    uint32_t nextRelease;           // Periodic task: tick of the next release
+    SchedPriority_t priority;
+    SchedTaskStats_t stats;
+} SchedTask_t;
+
+/* Private Variables */
+static SchedTask_t tasks[SCHED_MAX_TASKS];
+static uint8_t taskCount = 0;
+static volatile uint32_t pendingEvents = 0;
+static uint32_t eventPostCycles[SCHED_MAX_EVENTS];  // DWT at the first post of a pending event
+static uint32_t classEvents[SCHED_PRIORITY_COUNT];  // Events handled by each class
+static volatile uint32_t tickCycles = 0;            // DWT at the last SysTick
+static volatile uint32_t tickCount = 0;             // HAL tick at the last SysTick
+
+#if SCHED_USE_FREERTOS
+static const char* const classNames[SCHED_PRIORITY_COUNT] = { "io", "comm", "housekeeping" };
+static TaskHandle_t classTasks[SCHED_PRIORITY_COUNT];
+static StaticTask_t classTaskBuffers[SCHED_PRIORITY_COUNT];
+static StackType_t classStacks[SCHED_PRIORITY_COUNT][SCHED_RTOS_STACK_WORDS];
+static StaticTask_t idleTaskBuffer;
+static StackType_t idleStack[configMINIMAL_STACK_SIZE];
+static volatile uint8_t kernelRunning = 0;
+static uint32_t kernelTickOffset = 0;               // HAL tick when the kernel started
+#endif
+
+/* Private Function Prototypes */
+static int8_t Add_Task(const char* name, SchedTaskFunction_t function, uint32_t periodMs,
+                       uint32_t events, SchedPriority_t priority);
+static uint8_t Run_Events(SchedPriority_t priority);
+static uint8_t Run_Periodic(SchedPriority_t priority);
+static uint32_t Event_Latency(uint32_t events, const uint32_t* postCycles, uint32_t now);
+static uint32_t Release_Latency(uint32_t release);
+static void Run_Task(SchedTask_t* task, uint32_t latencyCycles);
+static void Reset_Stats(SchedTaskStats_t* stats);
+#if SCHED_USE_FREERTOS
+static void Class_Task(void* argument);
+static TickType_t Class_Wait(SchedPriority_t priority);
+static void Notify_Classes(uint32_t events);
+#else
+static uint8_t Periodic_Due(uint32_t now);
+#endif
+
+/**
+ * @brief  Initialize the scheduler (call after Perf_Init, uses the DWT counter)
+ * @retval None
+ */
+void Sched_Init(void)
+{
+    /* Pending events are kept: frames may arrive before the tasks exist */
+    memset(tasks, 0, sizeof(tasks));
+    memset(classEvents, 0, sizeof(classEvents));
+    taskCount = 0;
+
+#if SCHED_IDLE_SLEEP
+    /* Keep the debug connection alive during WFI */
+    HAL_DBGMCU_EnableDBGSleepMode();
+#endif
+}
+
+/**
+ * @brief  Register a periodic task
+ * @note   First release one period after registration
+ * @param  name: Task name (string literal, reported by CMD_GET_TASKS)
+ * @param  function: Task function
+ * @param  periodMs: Period (> 0)
+ * @param  priority: Priority class
+ * @retval Task index, -1 if the table is full or the period is 0
+ */
+int8_t Sched_AddPeriodic(const char* name, SchedTaskFunction_t function, uint32_t periodMs,
+                         SchedPriority_t priority)
+{
+    if (periodMs == 0) {
+        return -1;
+    }
+    return Add_Task(name, function, periodMs, 0, priority);
+}
+
+/**
+ * @brief  Register an event task
+ * @param  name: Task name (string literal, reported by CMD_GET_TASKS)
+ * @param  function: Task function
+ * @param  events: SCHED_EVENT_* mask that triggers the task
+ * @param  priority: Priority class
+ * @retval Task index, -1 if the table is full or the mask is empty
+ */
+int8_t Sched_AddEvent(const char* name, SchedTaskFunction_t function, uint32_t events,
+                      SchedPriority_t priority)
+{
+    if (events == 0) {
+        return -1;
+    }
+    return Add_Task(name, function, 0, events, priority);
+}
+
+/**
+ * @brief  Post events (ISR safe)
+ * @note   Bare-metal: the interrupt that posts the event also ends the WFI,
+ *         the event tasks run as soon as the interrupt returns. FreeRTOS:
+ *         the class tasks of the events are notified (interrupts posting
+ *         events need an NVIC priority of SCHED_RTOS_IRQ_PRIORITY or lower).
+ * @param  events: SCHED_EVENT_* mask
+ * @retval None
+ */
+ITCM_TEXT void Sched_PostEvent(uint32_t events)
+{
+    uint32_t now = DWT->CYCCNT;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t newEvents = events & ~pendingEvents;
+    for (uint8_t i = 0; newEvents != 0 && i < SCHED_MAX_EVENTS; i++) {
+        if (newEvents & (1UL << i)) {
+            eventPostCycles[i] = now;
+        }
+    }
+    pendingEvents |= events;
+    __set_PRIMASK(primask);
+
+#if SCHED_USE_FREERTOS
+    Notify_Classes(events);
+#endif
+}
+
+/**
+ * @brief  Timestamp the tick (call from SysTick_Handler after the tick update)
+ * @note   Gives periodic releases, which are tick based, a cycle accurate
+ *         reference for the response latency.
+ * @retval None
+ */
+ITCM_TEXT void Sched_TickHandler(void)
+{
+    tickCycles = DWT->CYCCNT;
+    tickCount = HAL_GetTick();
+}
+
+/**
+ * @brief  Run the scheduler (never returns)
+ * @retval None
+ */
+void Sched_Run(void)
+{
+#if SCHED_USE_FREERTOS
+    DEBUG_INFO("Scheduler started (FreeRTOS), %u tasks", taskCount);
+
+    /* One kernel task per used class, highest class highest priority */
+    for (uint8_t p = 0; p < SCHED_PRIORITY_COUNT; p++) {
+        uint8_t used = 0;
+        for (uint8_t i = 0; i < taskCount; i++) {
+            used |= (tasks[i].priority == p);
+        }
+        if (!used) {
+            continue;
+        }
+        classTasks[p] = xTaskCreateStatic(Class_Task, classNames[p], SCHED_RTOS_STACK_WORDS,
+                                          (void*)(uintptr_t)p,
+                                          tskIDLE_PRIORITY + SCHED_PRIORITY_COUNT - p,
+                                          classStacks[p], &classTaskBuffers[p]);
+    }
+
+    /* Task creation masked the tick: continue the HAL time base from here */
+    kernelTickOffset = uwTick;
+    kernelRunning = 1;
+    vTaskStartScheduler();
+
+    /* Only reached if the idle task could not be created */
+    Error_Handler();
+#else
+    DEBUG_INFO("Scheduler started, %u tasks", taskCount);
+
+    while (1) {
+        uint32_t passStart = PERF_START();
+        uint8_t ran = 0;
+
+        for (uint8_t p = 0; p < SCHED_PRIORITY_COUNT; p++) {
+            ran |= Run_Events((SchedPriority_t)p);
+            ran |= Run_Periodic((SchedPriority_t)p);
+        }
+
+        if (ran) {
+            PERF_STOP(PERF_PROBE_MAIN_LOOP, passStart);
+            continue;
+        }
+
+        /* Idle: sleep unless something became due after the checks above.
+         * With interrupts masked a pending interrupt still ends the WFI,
+         * it is then taken when the mask is restored. */
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (pendingEvents == 0 && !Periodic_Due(HAL_GetTick())) {
+#if SCHED_IDLE_SLEEP
+            __DSB();
+            __WFI();
+#endif
+        }
+        __set_PRIMASK(primask);
+    }
+#endif
+}
+
+/**
+ * @brief  Get number of registered tasks
+ * @retval Task count
+ */
+uint8_t Sched_GetTaskCount(void)
+{
+    return taskCount;
+}
+
+/**
+ * @brief  Clear the statistics of all tasks
+ * @retval None
+ */
+void Sched_ResetStats(void)
+{
+    for (uint8_t i = 0; i < taskCount; i++) {
+        Reset_Stats(&tasks[i].stats);
+    }
+}
+
+/**
+ * @brief  Read one task (CMD_GET_TASKS response)
+ * @note   Layout: [index][task count][CPU MHz:2][type][period ms / event
+ *         mask:4][runs:4][missed:4][max late ms:4][min cycles:4]
+ *         [max cycles:4][total cycles:8][max latency cycles:4][priority]
+ *         [kernel][name]. Type 0 = periodic, 1 = event. Kernel see
+ *         SCHED_KERNEL_*.
+ * @param  index: Task index (0 to task count - 1)
+ * @param  buffer: Buffer to store data
+ * @param  bufferSize: Buffer size
+ * @retval Number of bytes written (0 = invalid index)
+ */
+uint16_t Sched_Read(uint8_t index, uint8_t* buffer, uint16_t bufferSize)
+{
+    if (index >= taskCount || bufferSize < SCHED_RESPONSE_SIZE) {
+        return 0;
+    }
+
+    const SchedTask_t* task = &tasks[index];
+    uint16_t mhz = (uint16_t)(SystemCoreClock / 1000000U);
+    uint32_t parameter = (task->periodMs > 0) ? task->periodMs : task->events;
+    uint32_t minCycles = (task->stats.runs > 0) ? task->stats.minCycles : 0;
+    uint16_t nameLength = (uint16_t)strnlen(task->name, SCHED_NAME_SIZE - 1);
+
+    buffer[0] = index;
+    buffer[1] = taskCount;
+    memcpy(&buffer[2], &mhz, 2);
+    buffer[4] = (task->periodMs > 0) ? 0 : 1;
+    memcpy(&buffer[5], &parameter, 4);
+    memcpy(&buffer[9], &task->stats.runs, 4);
+    memcpy(&buffer[13], &task->stats.missed, 4);
+    memcpy(&buffer[17], &task->stats.maxLateMs, 4);
+    memcpy(&buffer[21], &minCycles, 4);
+    memcpy(&buffer[25], &task->stats.maxCycles, 4);
+    memcpy(&buffer[29], &task->stats.totalCycles, 8);
+    memcpy(&buffer[37], &task->stats.maxLatencyCycles, 4);
+    buffer[41] = (uint8_t)task->priority;
+    buffer[42] = SCHED_USE_FREERTOS ? SCHED_KERNEL_FREERTOS : SCHED_KERNEL_BARE_METAL;
+    memcpy(&buffer[SCHED_RESPONSE_HEADER_SIZE], task->name, nameLength);
+
+    return SCHED_RESPONSE_HEADER_SIZE + nameLength;
+}
+
+#if SCHED_USE_FREERTOS
+/**
+ * @brief  HAL time base (overrides the weak HAL function)
+ * @note   With tickless idle SysTick stops between releases and uwTick
+ *         lags, the kernel tick count is stepped over the suppressed ticks.
+ *         The 32-bit read is atomic on the Cortex-M7, also from interrupts.
+ * @retval Milliseconds since boot
+ */
+uint32_t HAL_GetTick(void)
+{
+    if (!kernelRunning) {
+        return uwTick;
+    }
+    return kernelTickOffset + (uint32_t)xTaskGetTickCount();
+}
+
+/**
+ * @brief  Idle task memory (static allocation only)
+ * @param  taskBuffer: Output task control block
+ * @param  stackBuffer: Output stack
+ * @param  stackSize: Output stack size in words
+ * @retval None
+ */
+void vApplicationGetIdleTaskMemory(StaticTask_t** taskBuffer, StackType_t** stackBuffer,
+                                   uint32_t* stackSize)
+{
+    *taskBuffer = &idleTaskBuffer;
+    *stackBuffer = idleStack;
+    *stackSize = configMINIMAL_STACK_SIZE;
+}
+
+/**
+ * @brief  Task stack overflow (configCHECK_FOR_STACK_OVERFLOW)
+ * @param  task: Overflowing task
+ * @param  name: Task name
+ * @retval None
+ */
+void vApplicationStackOverflowHook(TaskHandle_t task, char* name)
+{
+    (void)task;
+    (void)name;
+    Error_Handler();
+}
+#endif
+
+/* Private Functions */
+
+/**
+ * @brief  Add a task to the table
+ * @param  name: Task name
+ * @param  function: Task function
+ * @param  periodMs: Period (0 = event task)
+ * @param  events: Triggering events (event task)
+ * @param  priority: Priority class
+ * @retval Task index, -1 if the table is full
+ */
+static int8_t Add_Task(const char* name, SchedTaskFunction_t function, uint32_t periodMs,
+                       uint32_t events, SchedPriority_t priority)
+{
+    if (taskCount >= SCHED_MAX_TASKS || function == NULL || priority >= SCHED_PRIORITY_COUNT) {
+        DEBUG_ERROR("Scheduler: cannot add task %s", name);
+        return -1;
+    }
+
+    SchedTask_t* task = &tasks[taskCount];
+    task->name = name;
+    task->function = function;
+    task->periodMs = periodMs;
+    task->events = events;
+    task->nextRelease = HAL_GetTick() + periodMs;
+    task->priority = priority;
+    Reset_Stats(&task->stats);
+    classEvents[priority] |= events;
+
+    return (int8_t)taskCount++;
+}
+
+/**
+ * @brief  Run the event tasks of one class for its pending events
+ * @param  priority: Priority class
+ * @retval 1 if a task ran
+ */
+static uint8_t Run_Events(SchedPriority_t priority)
+{
+    uint32_t postCycles[SCHED_MAX_EVENTS];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t events = pendingEvents & classEvents[priority];
+    pendingEvents &= ~events;
+    memcpy(postCycles, eventPostCycles, sizeof(postCycles));
+    __set_PRIMASK(primask);
+
+    if (events == 0) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        SchedTask_t* task = &tasks[i];
+        if (task->priority == priority && (task->events & events)) {
+            Run_Task(task, Event_Latency(task->events & events, postCycles, DWT->CYCCNT));
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief  Run every periodic task of one class that is due (once per pass)
+ * @param  priority: Priority class
+ * @retval 1 if a task ran
+ */
+static uint8_t Run_Periodic(SchedPriority_t priority)
+{
+    uint8_t ran = 0;
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        SchedTask_t* task = &tasks[i];
+        uint32_t now = HAL_GetTick();
+
+        if (task->periodMs == 0 || task->priority != priority ||
+            (int32_t)(now - task->nextRelease) < 0) {
+            continue;
+        }
+
+        /* Too far behind: skip the oldest periods, catch up the rest */
+        uint32_t behind = (now - task->nextRelease) / task->periodMs;
+        if (behind > SCHED_MAX_CATCHUP) {
+            uint32_t skipped = behind - SCHED_MAX_CATCHUP;
+            task->stats.missed += skipped;
+            task->nextRelease += skipped * task->periodMs;
+        }
+
+        uint32_t late = now - task->nextRelease;
+        if (late > task->stats.maxLateMs) {
+            task->stats.maxLateMs = late;
+        }
+
+        /* Fixed rate: the next release does not depend on when this one ran */
+        uint32_t release = task->nextRelease;
+        task->nextRelease += task->periodMs;
+        Run_Task(task, Release_Latency(release));
+        ran = 1;
+    }
+
+    return ran;
+}
+
+/**
+ * @brief  Cycles since the oldest post of the given events
+ * @param  events: Events that triggered the task
+ * @param  postCycles: Post timestamps
+ * @param  now: Current DWT count
+ * @retval Latency in cycles (events above SCHED_MAX_EVENTS are not timed)
+ */
+static uint32_t Event_Latency(uint32_t events, const uint32_t* postCycles, uint32_t now)
+{
+    uint32_t latency = 0;
+
+    for (uint8_t i = 0; i < SCHED_MAX_EVENTS; i++) {
+        if ((events & (1UL << i)) && (now - postCycles[i]) > latency) {
+            latency = now - postCycles[i];
+        }
+    }
+    return latency;
+}
+
+/**
+ * @brief  Cycles since a periodic release
+ * @note   Referenced to the last timestamped tick; the release may be
+ *         before or (tickless idle) after it.
+ * @param  release: Release tick
+ * @retval Latency in cycles
+ */
+static uint32_t Release_Latency(uint32_t release)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t cycles = DWT->CYCCNT - tickCycles;
+    int32_t ticks = (int32_t)(tickCount - release);
+    __set_PRIMASK(primask);
+
+    int64_t latency = (int64_t)cycles + (int64_t)ticks * (SystemCoreClock / 1000U);
+    if (latency <= 0) {
+        return 0;
+    }
+    return (latency > UINT32_MAX) ? UINT32_MAX : (uint32_t)latency;
+}
+
+/**
+ * @brief  Run a task and account its latency and execution time
+ * @param  task: Task
+ * @param  latencyCycles: Release / event post to start
+ * @retval None
+ */
+static void Run_Task(SchedTask_t* task, uint32_t latencyCycles)
+{
+    uint32_t start = DWT->CYCCNT;
+    task->function();
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    SchedTaskStats_t* stats = &task->stats;
+    stats->runs++;
+    stats->totalCycles += cycles;
+    if (cycles < stats->minCycles) {
+        stats->minCycles = cycles;
+    }
+    if (cycles > stats->maxCycles) {
+        stats->maxCycles = cycles;
+    }
+    if (latencyCycles > stats->maxLatencyCycles) {
+        stats->maxLatencyCycles = latencyCycles;
+    }
+}
+
+/**
+ * @brief  Clear task statistics
+ * @param  stats: Statistics
+ * @retval None
+ */
+static void Reset_Stats(SchedTaskStats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->minCycles = UINT32_MAX;
+}
+
+#if SCHED_USE_FREERTOS
+/**
+ * @brief  Kernel task of one priority class
+ * @param  argument: SchedPriority_t of the class
+ * @retval None
+ */
+static void Class_Task(void* argument)
+{
+    SchedPriority_t priority = (SchedPriority_t)(uintptr_t)argument;
+
+    while (1) {
+        Run_Events(priority);
+        Run_Periodic(priority);
+
+        /* Block until the next release of the class or an event post;
+         * a post since Run_Events leaves the notification pending. */
+        ulTaskNotifyTake(pdTRUE, Class_Wait(priority));
+    }
+}
+
+/**
+ * @brief  Ticks until the next periodic release of a class
+ * @param  priority: Priority class
+ * @retval Ticks to wait (portMAX_DELAY if the class has no periodic task)
+ */
+static TickType_t Class_Wait(SchedPriority_t priority)
+{
+    uint32_t now = HAL_GetTick();
+    TickType_t wait = portMAX_DELAY;
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if (tasks[i].periodMs == 0 || tasks[i].priority != priority) {
+            continue;
+        }
+        int32_t remaining = (int32_t)(tasks[i].nextRelease - now);
+        if (remaining <= 0) {
+            return 0;
+        }
+        if (pdMS_TO_TICKS((uint32_t)remaining) < wait) {
+            wait = pdMS_TO_TICKS((uint32_t)remaining);
+        }
+    }
+    return wait;
+}
+
+/**
+ * @brief  Wake the class tasks handling the posted events
+ * @param  events: Posted events
+ * @retval None
+ */
+static void Notify_Classes(uint32_t events)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return;     // Run on the first pass of the class task
+    }
+
+    uint8_t inInterrupt = (__get_IPSR() != 0);
+    BaseType_t woken = pdFALSE;
+
+    for (uint8_t p = 0; p < SCHED_PRIORITY_COUNT; p++) {
+        if ((classEvents[p] & events) == 0 || classTasks[p] == NULL) {
+            continue;
+        }
+        if (inInterrupt) {
+            vTaskNotifyGiveFromISR(classTasks[p], &woken);
+        } else {
+            xTaskNotifyGive(classTasks[p]);
+        }
+    }
+
+    if (inInterrupt) {
+        portYIELD_FROM_ISR(woken);
+    }
+}
+#else
+/**
+ * @brief  Check for a periodic task that is due
+ * @param  now: Current tick
+ * @retval 1 if a task is due
+ */
+static uint8_t Periodic_Due(uint32_t now)
+{
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if (tasks[i].periodMs > 0 && (int32_t)(now - tasks[i].nextRelease) >= 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif